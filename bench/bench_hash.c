@@ -0,0 +1,252 @@
+/*
+_ _    _           ______   _______        
+| |  | |    /\    /___  /   |  ____|| |    
+| |__| |   /  \      / /    | |__   | |       Hazel - The Fast, Expressive & Elegant Programming Language
+|  __  |  / /\ \    / /     |  __|  | |       Languages: C, C++, and Assembly
+| |  | | / ____ \  / /___   | |____ | |____   https://github.com/HazelLang/hazel/
+|_|_ |_|/_/    \_\/_______\ |______|_\______|
+
+Licensed under the MIT License <http://opensource.org/licenses/MIT>
+SPDX-License-Identifier: MIT
+Copyright (c) 2021 Jason Dsouza <http://github.com/jasmcaus>
+*/
+
+// Hashing benchmark
+//
+// Measures the hashes of <hazel/core/hash.h> against the ones they replaced: XXH64 (which `token_cache_hash()` 
+// used to be) and the word-at-a-time hash `intern_hash()` used to be. It reports the best of `--reps` runs of:
+//
+//      throughput  GB/s hashing 256 KB (which stays in the cache) over and over, and a buffer of `--size` bytes 
+//                  (64 MB by default, which has to come from memory) in one go
+//      short keys  ns per hash of keys of 8 to 32 bytes (identifier-sized), at 1M different offsets into a buffer
+//
+//      bench_hash [--size <bytes>] [--reps <n>]
+// headers.h comes first: it enables the POSIX extensions (clock_gettime) before any system header is included
+#include <hazel/core/headers.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <hazel/core/clock.h>
+#include <hazel/core/endian.h>
+#include <hazel/core/hash.h>
+#include <hazel/core/math.h>
+
+#define BENCH_DEFAULT_SIZE      (64ull << 20)
+#define BENCH_DEFAULT_REPS      5
+#define BENCH_MIN_SIZE          1024
+// Size of the input that stays in the cache
+#define BENCH_CACHED_SIZE       (256ull << 10)
+// No. of short keys hashed per run (and per length)
+#define BENCH_NKEYS             1000000
+// Seed of the data generator
+#define BENCH_SEED              0x9E3779B97F4A7C15ull
+
+// ================ Baselines ================
+
+#define XXH_PRIME64_1   0x9E3779B185EBCA87ULL
+#define XXH_PRIME64_2   0xC2B2AE3D27D4EB4FULL
+#define XXH_PRIME64_3   0x165667B19E3779F9ULL
+#define XXH_PRIME64_4   0x85EBCA77C2B2AE63ULL
+#define XXH_PRIME64_5   0x27D4EB2F165667C5ULL
+
+static inline UInt64 bench_rotl64(UInt64 x, UInt32 r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline UInt64 bench_xxh_round(UInt64 acc, UInt64 input) {
+    acc += input * XXH_PRIME64_2;
+    acc = bench_rotl64(acc, 31);
+    return acc * XXH_PRIME64_1;
+}
+
+static inline UInt64 bench_xxh_merge_round(UInt64 acc, UInt64 value) {
+    acc ^= bench_xxh_round(0, value);
+    return acc * XXH_PRIME64_1 + XXH_PRIME64_4;
+}
+
+// XXH64 (seed 0)
+static UInt64 bench_xxh64(const void* data, UInt64 length) {
+    const char* p = (const char*)data;
+    const char* end = p + length;
+    UInt64 hash;
+
+    if(length >= 32) {
+        UInt64 v1 = XXH_PRIME64_1 + XXH_PRIME64_2;
+        UInt64 v2 = XXH_PRIME64_2;
+        UInt64 v3 = 0;
+        UInt64 v4 = 0 - XXH_PRIME64_1;
+        const char* limit = end - 32;
+        do {
+            v1 = bench_xxh_round(v1, endian_load_le64(p));
+            v2 = bench_xxh_round(v2, endian_load_le64(p + 8));
+            v3 = bench_xxh_round(v3, endian_load_le64(p + 16));
+            v4 = bench_xxh_round(v4, endian_load_le64(p + 24));
+            p += 32;
+        } while(p <= limit);
+
+        hash = bench_rotl64(v1, 1) + bench_rotl64(v2, 7) + bench_rotl64(v3, 12) + bench_rotl64(v4, 18);
+        hash = bench_xxh_merge_round(hash, v1);
+        hash = bench_xxh_merge_round(hash, v2);
+        hash = bench_xxh_merge_round(hash, v3);
+        hash = bench_xxh_merge_round(hash, v4);
+    } else {
+        hash = XXH_PRIME64_5;
+    }
+    hash += length;
+
+    for(; p + 8 <= end; p += 8) {
+        hash ^= bench_xxh_round(0, endian_load_le64(p));
+        hash = bench_rotl64(hash, 27) * XXH_PRIME64_1 + XXH_PRIME64_4;
+    }
+    if(p + 4 <= end) {
+        hash ^= (UInt64)endian_load_le32(p) * XXH_PRIME64_1;
+        hash = bench_rotl64(hash, 23) * XXH_PRIME64_2 + XXH_PRIME64_3;
+        p += 4;
+    }
+    for(; p < end; p++) {
+        hash ^= (UInt64)(UInt8)*p * XXH_PRIME64_5;
+        hash = bench_rotl64(hash, 11) * XXH_PRIME64_1;
+    }
+
+    hash ^= hash >> 33;
+    hash *= XXH_PRIME64_2;
+    hash ^= hash >> 29;
+    hash *= XXH_PRIME64_3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+// A word at a time, with a MurmurHash3 avalanche at the end
+static UInt64 bench_word_hash(const void* data, UInt64 length) {
+    const char* string = (const char*)data;
+    UInt64 hash = length * 0x9E3779B97F4A7C15ULL;
+    UInt64 word;
+
+    if(length > 8) {
+        const char* last = string + length - 8;
+        while(string < last) {
+            hash = (hash ^ endian_load_le64(string)) * 0xFF51AFD7ED558CCDULL;
+            hash ^= hash >> 29;
+            string += 8;
+        }
+        word = endian_load_le64(last);
+    } else if(length >= 4) {
+        word = ((UInt64)endian_load_le32(string) << 32) | endian_load_le32(string + length - 4);
+    } else if(length > 0) {
+        const UInt8* bytes = (const UInt8*)string;
+        word = ((UInt64)bytes[0] << 16) | ((UInt64)bytes[length >> 1] << 8) | bytes[length - 1];
+    } else {
+        word = 0;
+    }
+    hash = (hash ^ word) * 0xFF51AFD7ED558CCDULL;
+    return hash_u64(hash);
+}
+
+static UInt64 bench_bytes128(const void* data, UInt64 length) {
+    return hash_bytes128(data, length, 0).low;
+}
+
+static UInt64 bench_bytes64(const void* data, UInt64 length) {
+    return hash_bytes64(data, length, 0);
+}
+
+// ================ Runs ================
+
+typedef UInt64 (*BenchHash)(const void* data, UInt64 length);
+
+#define BENCH_NHASHES   4
+static const char* const benchNames[BENCH_NHASHES] = { "bytes128", "bytes64", "xxh64", "word" };
+static const BenchHash benchHashes[BENCH_NHASHES] = { bench_bytes128, bench_bytes64, bench_xxh64, bench_word_hash };
+
+#define BENCH_NLENGTHS  5
+static const UInt64 benchLengths[BENCH_NLENGTHS] = { 8, 12, 16, 24, 32 };
+
+// Time (in seconds) `hash` took over the `size` bytes at `data`, on average over `repeat` times
+static double bench_large(BenchHash hash, const UInt8* data, UInt64 size, UInt64 repeat, UInt64* checksum) {
+    UInt64 sum = 0;
+    UInt64 start = clock_now_ns();
+    for(UInt64 i = 0; i < repeat; i++)
+        sum += hash(data, size);
+    double seconds = (double)(clock_now_ns() - start) * 1e-9;
+    *checksum += sum;
+    return seconds / (double)repeat;
+}
+
+// Time (in seconds) `hash` took over BENCH_NKEYS keys of `length` bytes, at the offsets `offsets` into `data`
+static double bench_short(BenchHash hash, const UInt8* data, const UInt32* offsets, UInt64 length, 
+                          UInt64* checksum) {
+    UInt64 sum = 0;
+    UInt64 start = clock_now_ns();
+    for(UInt32 i = 0; i < BENCH_NKEYS; i++)
+        sum += hash(data + offsets[i], length);
+    double seconds = (double)(clock_now_ns() - start) * 1e-9;
+    *checksum += sum;
+    return seconds;
+}
+
+static void bench_usage(const char* argv0) {
+    fprintf(stderr, "Usage: %s [--size <bytes>] [--reps <n>]\n", argv0);
+}
+
+int main(int argc, char** argv) {
+    UInt64 size = BENCH_DEFAULT_SIZE;
+    UInt32 reps = BENCH_DEFAULT_REPS;
+    for(int i = 1; i < argc; i++) {
+        if(i + 1 < argc && strcmp(argv[i], "--size") == 0) {
+            size = strtoull(argv[++i], null, 10);
+        } else if(i + 1 < argc && strcmp(argv[i], "--reps") == 0) {
+            reps = (UInt32)strtoul(argv[++i], null, 10);
+        } else {
+            bench_usage(argv[0]);
+            return 2;
+        }
+    }
+    if(size < BENCH_MIN_SIZE || reps == 0) {
+        bench_usage(argv[0]);
+        return 2;
+    }
+
+    UInt8* data = (UInt8*)malloc(size);
+    UInt32* offsets = (UInt32*)malloc(BENCH_NKEYS * sizeof(UInt32));
+    CSTL_CHECK(data && offsets, "Could not allocate the data");
+    UInt64 rng = BENCH_SEED;
+    for(UInt64 i = 0; i < size; i++) {
+        rng = rng * 6364136223846793005ull + 1442695040888963407ull;
+        data[i] = (UInt8)(rng >> 56);
+    }
+    // Keys start anywhere (aligned or not) in the first kilobyte or so, so that they stay in the L1 cache
+    for(UInt32 i = 0; i < BENCH_NKEYS; i++) {
+        rng = rng * 6364136223846793005ull + 1442695040888963407ull;
+        offsets[i] = (UInt32)((rng >> 33) % (BENCH_MIN_SIZE - 32));
+    }
+    UInt64 checksum = 0;
+
+    printf("%-10s %-12s %12s\n", "hash", "input", "result");
+    UInt64 sizes[2] = { CSTL_MIN(BENCH_CACHED_SIZE, size), size };
+    for(UInt32 s = 0; s < 2; s++) {
+        // As many bytes (in all) from the cache as from memory
+        UInt64 repeat = size / sizes[s];
+        for(UInt32 h = 0; h < BENCH_NHASHES; h++) {
+            double best = 1e300;
+            for(UInt32 rep = 0; rep < reps; rep++)
+                best = CSTL_MIN(best, bench_large(benchHashes[h], data, sizes[s], repeat, &checksum));
+            printf("%-10s %-12llu %9.2f GB/s\n", benchNames[h], (unsigned long long)sizes[s], 
+                   (double)sizes[s] / best * 1e-9);
+        }
+    }
+    for(UInt32 l = 0; l < BENCH_NLENGTHS; l++) {
+        for(UInt32 h = 0; h < BENCH_NHASHES; h++) {
+            double best = 1e300;
+            for(UInt32 rep = 0; rep < reps; rep++)
+                best = CSTL_MIN(best, bench_short(benchHashes[h], data, offsets, benchLengths[l], &checksum));
+            printf("%-10s %-12llu %9.2f ns\n", benchNames[h], (unsigned long long)benchLengths[l], 
+                   best / BENCH_NKEYS * 1e9);
+        }
+    }
+    // So that none of the hashes can be optimized away
+    fprintf(stderr, "(checksum %llu)\n", (unsigned long long)checksum);
+
+    free(data);
+    free(offsets);
+    return 0;
+}
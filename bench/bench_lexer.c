@@ -0,0 +1,456 @@
+/*
+_ _    _           ______   _______        
+| |  | |    /\    /___  /   |  ____|| |    
+| |__| |   /  \      / /    | |__   | |       Hazel - The Fast, Expressive * Elegant Programming Language
+|  __  |  / /\ \    / /     |  __|  | |       Languages: C, C++, and Assembly
+| |  | | / ____ \  / /___   | |____ | |____   https://github.com/HazelLang/hazel/
+|_|_ |_|/_/    \_\/_______\ |______|_\______|
+
+Licensed under the MIT License <http://opensource.org/licenses/MIT>
+SPDX-License-Identifier: MIT
+Copyright (c) 2021 Jason Dsouza <http://github.com/jasmcaus>
+*/
+
+// Lexer throughput benchmark
+//
+// Generates deterministic, MB-scale corpora that each stress one part of the Lexer (identifiers, numeric literals,
+// strings, comments, deep nesting), lexes each of them `--reps` times with `lexer_lex()` and reports MB/s, tokens/s,
+// allocations per token and peak RSS - as a table, or as JSON (`--json`) to be compared against a stored baseline
+// with tools/scripts/compare_bench.py.
+//
+//      bench_lexer [--size <MB>] [--reps <n>] [--corpus <name>] [--json] [--dump <dir>]
+//
+// The Lexer's entry points are `static` (see hazel/compiler/lexer.h), so its sources are compiled into this file:
+// what gets measured is the code that ships, inlined the way it is in the library.
+// headers.h comes first: it enables the POSIX extensions (mmap) before any system header is included
+#include <hazel/core/headers.h>
+#include <hazel/compiler/lexer.c>
+#include <hazel/compiler/tokens.c>
+#include <hazel/compiler/intern.c>
+#include <hazel/compiler/lineindex.c>
+#include <hazel/compiler/tokencache.c>
+#include <hazel/compiler/profiler.c>
+#include <hazel/compiler/allocator.c>
+
+#if defined(CSTL_OS_WINDOWS)
+    #include <windows.h>
+    #include <psapi.h>
+#else
+    #include <sys/resource.h>
+#endif
+
+#define BENCH_DEFAULT_SIZE_MB   4
+#define BENCH_DEFAULT_REPS      10
+// Seed of the corpus generator. Changing it (or the generators) invalidates every stored baseline.
+#define BENCH_SEED              0x9E3779B97F4A7C15ull
+#define BENCH_MAX_NESTING       64
+
+// ================ Memory ================
+
+// Reset the peak RSS of this process to its current RSS, so the next `bench_peak_rss()` reports the peak of
+// whatever runs in between. Returns false if the platform can't do that (the peak is then over the whole process).
+static bool bench_reset_peak_rss() {
+#if defined(CSTL_OS_LINUX)
+    FILE* file = fopen("/proc/self/clear_refs", "w");
+    if(file == null)
+        return false;
+    bool ok = fputs("5", file) >= 0;
+    return fclose(file) == 0 && ok;
+#else
+    return false;
+#endif
+}
+
+// Peak resident set size of this process, in bytes (0 if unknown)
+static UInt64 bench_peak_rss() {
+#if defined(CSTL_OS_WINDOWS)
+    PROCESS_MEMORY_COUNTERS counters;
+    if(GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return (UInt64)counters.PeakWorkingSetSize;
+    return 0;
+#else
+    #if defined(CSTL_OS_LINUX)
+        // VmHWM (unlike `ru_maxrss`) honours `bench_reset_peak_rss()`
+        FILE* file = fopen("/proc/self/status", "r");
+        if(file != null) {
+            char line[256];
+            unsigned long long kb = 0;
+            bool found = false;
+            while(!found && fgets(line, sizeof(line), file) != null)
+                found = sscanf(line, "VmHWM: %llu kB", &kb) == 1;
+            fclose(file);
+            if(found)
+                return (UInt64)kb * 1024;
+        }
+    #endif // CSTL_OS_LINUX
+    struct rusage usage;
+    if(getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+    #if defined(CSTL_OS_OSX)
+        return (UInt64)usage.ru_maxrss;         // bytes
+    #else
+        return (UInt64)usage.ru_maxrss * 1024;  // kilobytes
+    #endif
+#endif
+}
+
+// ================ Corpora ================
+
+// Corpus being generated: `length` bytes of `data`, followed by CSTL_BUFFER_PADDING zero bytes (see
+// `lexer_init_with_length()`)
+typedef struct BenchText {
+    char* data;
+    UInt64 length;
+    UInt64 capacity;
+    UInt64 rng;
+} BenchText;
+
+static UInt64 bench_random(BenchText* text) {
+    // xorshift64* - the same seed gives the same corpus on every platform
+    text->rng ^= text->rng >> 12;
+    text->rng ^= text->rng << 25;
+    text->rng ^= text->rng >> 27;
+    return text->rng * 0x2545F4914F6CDD1Dull;
+}
+
+// Returns a random number in [0, n)
+static UInt32 bench_below(BenchText* text, UInt32 n) {
+    return (UInt32)((bench_random(text) >> 32) % n);
+}
+
+static void bench_putn(BenchText* text, const char* str, UInt64 length) {
+    if(text->length + length + CSTL_BUFFER_PADDING > text->capacity) {
+        text->capacity = (text->length + length + CSTL_BUFFER_PADDING) * 2;
+        text->data = (char*)realloc(text->data, text->capacity);
+        CSTL_CHECK_NOT_NULL(text->data, "Could not allocate the corpus");
+    }
+    memcpy(text->data + text->length, str, length);
+    text->length += length;
+}
+
+static void bench_puts(BenchText* text, const char* str) {
+    bench_putn(text, str, strlen(str));
+}
+
+static void bench_putf(BenchText* text, const char* format, ...) {
+    char str[256];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(str, sizeof(str), format, args);
+    va_end(args);
+    bench_putn(text, str, (UInt64)length < sizeof(str) ? (UInt64)length : sizeof(str) - 1);
+}
+
+static const char* const benchWords[] = {
+    "value", "count", "index", "buffer", "lexer", "token", "node", "result", "offset", "length", "parent", "child",
+    "symbol", "scope", "module", "entry", "cursor", "source", "target", "handle", "state", "context", "item", "key"
+};
+#define BENCH_NWORDS    (sizeof(benchWords) / sizeof(benchWords[0]))
+
+static const char* const benchKeywords[] = {
+    "if", "else", "for", "while", "return", "func", "const", "match", "break", "continue", "in", "import"
+};
+#define BENCH_NKEYWORDS (sizeof(benchKeywords) / sizeof(benchKeywords[0]))
+
+static const char* const benchOperators[] = { " = ", " + ", " - ", " * ", " / ", " == ", " != ", " < ", " >= ",
+                                              " && ", " || ", " += ", " << ", " % ", " & " };
+#define BENCH_NOPERATORS (sizeof(benchOperators) / sizeof(benchOperators[0]))
+
+// An identifier: a word, a few words joined with `_`, or either with a numeric suffix
+static void bench_put_identifier(BenchText* text) {
+    bench_puts(text, benchWords[bench_below(text, BENCH_NWORDS)]);
+    switch(bench_below(text, 4)) {
+        case 0: bench_putf(text, "%u", bench_below(text, 1000)); break;
+        case 1:
+            bench_puts(text, "_");
+            bench_puts(text, benchWords[bench_below(text, BENCH_NWORDS)]);
+            break;
+        default: break;
+    }
+}
+
+// Identifier-heavy: statements made of identifiers, keywords, member accesses and calls
+static void bench_gen_identifiers(BenchText* text, UInt64 size) {
+    while(text->length < size) {
+        bench_puts(text, "    ");
+        bench_puts(text, benchKeywords[bench_below(text, BENCH_NKEYWORDS)]);
+        bench_puts(text, " ");
+        bench_put_identifier(text);
+        UInt32 terms = 2 + bench_below(text, 5);
+        for(UInt32 i = 0; i < terms; i++) {
+            bench_puts(text, benchOperators[bench_below(text, BENCH_NOPERATORS)]);
+            bench_put_identifier(text);
+            switch(bench_below(text, 4)) {
+                case 0: bench_puts(text, "."); bench_put_identifier(text); break;
+                case 1: bench_puts(text, "("); bench_put_identifier(text); bench_puts(text, ")"); break;
+                default: break;
+            }
+        }
+        bench_puts(text, "\n");
+    }
+}
+
+// Numeric-heavy: lists of decimal, hex, octal, binary and floating-point literals (with separators and suffixes)
+static void bench_gen_numbers(BenchText* text, UInt64 size) {
+    static const char* const suffixes[] = { "", "", "", "", "u", "i32", "u64", "f64" };
+    while(text->length < size) {
+        bench_puts(text, "numbers = [");
+        for(UInt32 i = 0; i < 12; i++) {
+            UInt64 value = bench_random(text);
+            switch(bench_below(text, 8)) {
+                case 0: bench_putf(text, "0x%llX", (unsigned long long)(value >> bench_below(text, 48))); break;
+                case 1: bench_putf(text, "0o%llo", (unsigned long long)(value >> 40)); break;
+                case 2: bench_putf(text, "0b%u%u%u_%u%u%u%u", 1u, (UInt32)(value & 1), (UInt32)(value >> 1 & 1),
+                                   (UInt32)(value >> 2 & 1), (UInt32)(value >> 3 & 1), (UInt32)(value >> 4 & 1),
+                                   (UInt32)(value >> 5 & 1)); break;
+                case 3: bench_putf(text, "%u.%04u", (UInt32)(value % 100000), (UInt32)(value >> 32) % 10000); break;
+                case 4: bench_putf(text, "%u.%ue%s%u", (UInt32)(value % 10), (UInt32)(value >> 16) % 1000,
+                                   (value >> 40) & 1 ? "-" : "+", (UInt32)(value >> 48) % 300); break;
+                case 5: bench_putf(text, "%u_%03u_%03u", (UInt32)(value % 1000) + 1, (UInt32)(value >> 20) % 1000,
+                                   (UInt32)(value >> 40) % 1000); break;
+                case 6: bench_putf(text, "%llu", (unsigned long long)(value >> bench_below(text, 64))); break;
+                default:
+                    // Small enough for any of the suffixes
+                    bench_putf(text, "%u%s", (UInt32)(value % 100000), suffixes[bench_below(text, 8)]);
+                    break;
+            }
+            bench_puts(text, i == 11 ? "]\n" : ", ");
+        }
+    }
+}
+
+// String-heavy: string literals of varying lengths, some with escape sequences
+static void bench_gen_strings(BenchText* text, UInt64 size) {
+    static const char* const escapes[] = { "\\n", "\\t", "\\\"", "\\\\", "\\x41", "\\u{1F600}" };
+    while(text->length < size) {
+        bench_puts(text, "message = \"");
+        UInt32 words = 1 + bench_below(text, 24);
+        for(UInt32 i = 0; i < words; i++) {
+            bench_puts(text, benchWords[bench_below(text, BENCH_NWORDS)]);
+            if(bench_below(text, 6) == 0)
+                bench_puts(text, escapes[bench_below(text, 6)]);
+            else
+                bench_puts(text, " ");
+        }
+        bench_puts(text, "\"\n");
+    }
+}
+
+// Comment-heavy: line (`#`, `//`), documentation (`///`) and block (`/* */`) comments around a little code
+static void bench_gen_comments(BenchText* text, UInt64 size) {
+    static const char* const markers[] = { "# ", "// ", "/// " };
+    while(text->length < size) {
+        if(bench_below(text, 5) == 0) {
+            bench_puts(text, "/*\n");
+            UInt32 lines = 1 + bench_below(text, 6);
+            for(UInt32 i = 0; i < lines; i++) {
+                bench_puts(text, " * ");
+                for(UInt32 w = 0; w < 8; w++) {
+                    bench_puts(text, benchWords[bench_below(text, BENCH_NWORDS)]);
+                    bench_puts(text, " ");
+                }
+                bench_puts(text, "\n");
+            }
+            bench_puts(text, " */\n");
+        } else {
+            bench_puts(text, markers[bench_below(text, 3)]);
+            UInt32 words = 4 + bench_below(text, 12);
+            for(UInt32 w = 0; w < words; w++) {
+                bench_puts(text, benchWords[bench_below(text, BENCH_NWORDS)]);
+                bench_puts(text, " ");
+            }
+            bench_puts(text, "\n");
+        }
+        if(bench_below(text, 4) == 0) {
+            bench_put_identifier(text);
+            bench_puts(text, " = ");
+            bench_put_identifier(text);
+            bench_puts(text, "\n");
+        }
+    }
+}
+
+// Deep nesting: expressions and blocks nested up to BENCH_MAX_NESTING levels (mostly single-character tokens)
+static void bench_gen_nesting(BenchText* text, UInt64 size) {
+    static const char open[] = "([{";
+    static const char close[] = ")]}";
+    char stack[BENCH_MAX_NESTING];
+    while(text->length < size) {
+        UInt32 depth = 1 + bench_below(text, BENCH_MAX_NESTING);
+        bench_puts(text, "x = ");
+        for(UInt32 i = 0; i < depth; i++) {
+            stack[i] = (char)bench_below(text, 3);
+            bench_putn(text, &open[(int)stack[i]], 1);
+            if(bench_below(text, 3) == 0) {
+                bench_put_identifier(text);
+                bench_puts(text, ", ");
+            }
+        }
+        bench_put_identifier(text);
+        for(UInt32 i = depth; i-- > 0;)
+            bench_putn(text, &close[(int)stack[i]], 1);
+        bench_puts(text, "\n");
+    }
+}
+
+typedef struct BenchCorpus {
+    const char* name;
+    void (*generate)(BenchText* text, UInt64 size);
+} BenchCorpus;
+
+static const BenchCorpus benchCorpora[] = {
+    { "identifiers", bench_gen_identifiers },
+    { "numbers",     bench_gen_numbers },
+    { "strings",     bench_gen_strings },
+    { "comments",    bench_gen_comments },
+    { "nesting",     bench_gen_nesting },
+};
+#define BENCH_NCORPORA  (sizeof(benchCorpora) / sizeof(benchCorpora[0]))
+
+// Generate a corpus of (roughly, it ends on a whole line) `size` bytes
+static BenchText bench_generate(const BenchCorpus* corpus, UInt64 size) {
+    BenchText text = { null, 0, 0, BENCH_SEED };
+    corpus->generate(&text, size);
+    bench_putn(&text, "", 0);
+    memset(text.data + text.length, 0, CSTL_BUFFER_PADDING);
+    return text;
+}
+
+// ================ Measurement ================
+
+typedef struct BenchResult {
+    const char* name;
+    UInt64 bytes;
+    UInt64 tokens;
+    UInt64 allocs;
+    UInt64 peak_rss;
+    double best;        // seconds
+    double median;      // seconds
+} BenchResult;
+
+static int bench_compare_doubles(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static BenchResult bench_run(const BenchCorpus* corpus, UInt64 size, UInt32 reps, const char* dump_dir) {
+    BenchText text = bench_generate(corpus, size);
+    if(dump_dir != null) {
+        char path[1024];
+        snprintf(path, sizeof(path), "%s/%s.hzl", dump_dir, corpus->name);
+        FILE* file = fopen(path, "wb");
+        if(file == null || fwrite(text.data, 1, text.length, file) != text.length)
+            fprintf(stderr, "Could not write <%s>\n", path);
+        if(file != null)
+            fclose(file);
+    }
+
+    BenchResult result = { corpus->name, text.length, 0, 0, 0, 0, 0 };
+    double* times = (double*)calloc(reps, sizeof(double));
+    CSTL_CHECK_NOT_NULL(times, "Could not allocate the timings");
+    bench_reset_peak_rss();
+    // Symbols are interned globally, so only the first run sees an empty symbol table - the way a compiler lexing
+    // many files would after its first one. The median is over the warm runs.
+    for(UInt32 i = 0; i < reps; i++) {
+        double start = now();
+        Lexer* lexer = lexer_init_with_length(text.data, (UInt32)text.length, corpus->name);
+        lexer_lex(lexer);
+        times[i] = now() - start;
+        result.tokens = lexer->tokenList.size;
+        result.allocs = lexer_nallocs(lexer);
+        lexer_free(lexer);
+    }
+    // Without a reset, this is the peak of the whole process so far
+    result.peak_rss = bench_peak_rss();
+
+    qsort(times, reps, sizeof(double), bench_compare_doubles);
+    result.best = times[0];
+    result.median = times[reps / 2];
+    free(times);
+    free(text.data);
+    return result;
+}
+
+static void bench_usage(const char* argv0) {
+    fprintf(stderr, "Usage: %s [--size <MB>] [--reps <n>] [--corpus <name>] [--json] [--dump <dir>]\n", argv0);
+    fprintf(stderr, "Corpora:");
+    for(UInt32 i = 0; i < BENCH_NCORPORA; i++)
+        fprintf(stderr, " %s", benchCorpora[i].name);
+    fprintf(stderr, "\n");
+}
+
+int main(int argc, char** argv) {
+    UInt64 size_mb = BENCH_DEFAULT_SIZE_MB;
+    UInt32 reps = BENCH_DEFAULT_REPS;
+    const char* only = null;
+    const char* dump_dir = null;
+    bool json = false;
+
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "--json") == 0) {
+            json = true;
+        } else if(i + 1 < argc && strcmp(argv[i], "--size") == 0) {
+            size_mb = strtoull(argv[++i], null, 10);
+        } else if(i + 1 < argc && strcmp(argv[i], "--reps") == 0) {
+            reps = (UInt32)strtoul(argv[++i], null, 10);
+        } else if(i + 1 < argc && strcmp(argv[i], "--corpus") == 0) {
+            only = argv[++i];
+        } else if(i + 1 < argc && strcmp(argv[i], "--dump") == 0) {
+            dump_dir = argv[++i];
+        } else {
+            bench_usage(argv[0]);
+            return 2;
+        }
+    }
+    // The Lexer addresses its buffer with 32-bit offsets
+    if(size_mb == 0 || size_mb > 2048 || reps == 0) {
+        bench_usage(argv[0]);
+        return 2;
+    }
+
+    BenchResult results[BENCH_NCORPORA];
+    UInt32 nresults = 0;
+    for(UInt32 i = 0; i < BENCH_NCORPORA; i++) {
+        if(only != null && strcmp(only, benchCorpora[i].name) != 0)
+            continue;
+        results[nresults++] = bench_run(&benchCorpora[i], MB_TO_BYTES(size_mb), reps, dump_dir);
+    }
+    if(nresults == 0) {
+        fprintf(stderr, "Unknown corpus <%s>\n", only);
+        bench_usage(argv[0]);
+        return 2;
+    }
+
+    if(json) {
+        printf("{\n");
+        printf("    \"benchmark\": \"lexer\",\n");
+        printf("    \"seed\": \"0x%llX\",\n", (unsigned long long)BENCH_SEED);
+        printf("    \"size_mb\": %llu,\n", (unsigned long long)size_mb);
+        printf("    \"reps\": %u,\n", reps);
+        printf("    \"results\": [\n");
+        for(UInt32 i = 0; i < nresults; i++) {
+            BenchResult* r = &results[i];
+            printf("        {\"corpus\": \"%s\", \"bytes\": %llu, \"tokens\": %llu, \"best_s\": %.9f, "
+                   "\"median_s\": %.9f, \"mb_per_s\": %.2f, \"tokens_per_s\": %.0f, \"allocs_per_token\": %.6f, "
+                   "\"peak_rss_bytes\": %llu}%s\n",
+                   r->name, (unsigned long long)r->bytes, (unsigned long long)r->tokens, r->best, r->median,
+                   (double)r->bytes / (1024.0 * 1024.0) / r->best, (double)r->tokens / r->best,
+                   r->tokens ? (double)r->allocs / (double)r->tokens : 0.0, (unsigned long long)r->peak_rss,
+                   i + 1 < nresults ? "," : "");
+        }
+        printf("    ]\n");
+        printf("}\n");
+    } else {
+        printf("%-12s %10s %10s %10s %10s %14s %12s %10s\n", "corpus", "MB", "tokens", "best ms", "MB/s",
+               "tokens/s", "allocs/tok", "peak MB");
+        for(UInt32 i = 0; i < nresults; i++) {
+            BenchResult* r = &results[i];
+            printf("%-12s %10.2f %10llu %10.3f %10.1f %14.0f %12.6f %10.1f\n", r->name,
+                   (double)r->bytes / (1024.0 * 1024.0), (unsigned long long)r->tokens, r->best * 1e3,
+                   (double)r->bytes / (1024.0 * 1024.0) / r->best, (double)r->tokens / r->best,
+                   r->tokens ? (double)r->allocs / (double)r->tokens : 0.0,
+                   (double)r->peak_rss / (1024.0 * 1024.0));
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,270 @@
+/*
+_ _    _           ______   _______        
+| |  | |    /\    /___  /   |  ____|| |    
+| |__| |   /  \      / /    | |__   | |       Hazel - The Fast, Expressive & Elegant Programming Language
+|  __  |  / /\ \    / /     |  __|  | |       Languages: C, C++, and Assembly
+| |  | | / ____ \  / /___   | |____ | |____   https://github.com/HazelLang/hazel/
+|_|_ |_|/_/    \_\/_______\ |______|_\______|
+
+Licensed under the MIT License <http://opensource.org/licenses/MIT>
+SPDX-License-Identifier: MIT
+Copyright (c) 2021 Jason Dsouza <http://github.com/jasmcaus>
+*/
+
+// Hash map benchmark
+//
+// Measures the Swiss table of <hazel/core/map.h> against a chained hash map (a bucket array of singly-linked nodes,
+// one allocation per entry - the textbook layout, and that of `std::unordered_map`), both keyed by random 64-bit 
+// integers, at sizes from 1K up to `--max` entries (10M by default, growing 10x at a time). For each size it 
+// reports the best of `--reps` runs (in millions of operations per second) of:
+//
+//      insert      n new keys into an empty map (growing it as it goes)
+//      hit         n lookups of keys that are in the map (in a different order than they were inserted)
+//      miss        n lookups of keys that are not
+//      remove      n/2 removals, followed by n/2 lookups of what's left
+//
+//      bench_map [--max <n>] [--reps <n>]
+// headers.h comes first: it enables the POSIX extensions (clock_gettime) before any system header is included
+#include <hazel/core/headers.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <hazel/core/clock.h>
+#include <hazel/core/map.h>
+
+#define BENCH_DEFAULT_MAX       10000000
+#define BENCH_DEFAULT_REPS      3
+#define BENCH_MIN_SIZE          1000
+// Seed of the key generator
+#define BENCH_SEED              0x9E3779B97F4A7C15ull
+
+CSTL_MAP(BenchSwissMap, bench_swiss, UInt64, UInt64, map_hash_u64, CSTL_MAP_EQUALS)
+
+// ================ Chained baseline ================
+
+typedef struct BenchNode {
+    struct BenchNode* next;
+    UInt64 key;
+    UInt64 value;
+} BenchNode;
+
+typedef struct BenchChainedMap {
+    BenchNode** buckets;
+    UInt64 size;
+    UInt64 nbuckets;            // a power of 2 - grown (2x) once there are more entries than buckets
+} BenchChainedMap;
+
+static void bench_chained_free(BenchChainedMap* map) {
+    for(UInt64 b = 0; b < map->nbuckets; b++) {
+        BenchNode* node = map->buckets[b];
+        while(node != null) {
+            BenchNode* next = node->next;
+            free(node);
+            node = next;
+        }
+    }
+    free(map->buckets);
+    memset(map, 0, sizeof(BenchChainedMap));
+}
+
+static void bench_chained_grow(BenchChainedMap* map) {
+    UInt64 nbuckets = map->nbuckets ? map->nbuckets * 2 : 16;
+    BenchNode** buckets = (BenchNode**)calloc(nbuckets, sizeof(BenchNode*));
+    CSTL_CHECK_NOT_NULL(buckets, "Could not allocate the buckets");
+    for(UInt64 b = 0; b < map->nbuckets; b++) {
+        BenchNode* node = map->buckets[b];
+        while(node != null) {
+            BenchNode* next = node->next;
+            UInt64 i = map_hash_u64(node->key) & (nbuckets - 1);
+            node->next = buckets[i];
+            buckets[i] = node;
+            node = next;
+        }
+    }
+    free(map->buckets);
+    map->buckets = buckets;
+    map->nbuckets = nbuckets;
+}
+
+static UInt64* bench_chained_find(const BenchChainedMap* map, UInt64 key) {
+    if(map->nbuckets == 0)
+        return null;
+    for(BenchNode* node = map->buckets[map_hash_u64(key) & (map->nbuckets - 1)]; node != null; node = node->next) {
+        if(node->key == key)
+            return &node->value;
+    }
+    return null;
+}
+
+static bool bench_chained_put(BenchChainedMap* map, UInt64 key, UInt64 value) {
+    UInt64* existing = bench_chained_find(map, key);
+    if(existing != null) {
+        *existing = value;
+        return false;
+    }
+    if(map->size >= map->nbuckets)
+        bench_chained_grow(map);
+    BenchNode* node = (BenchNode*)malloc(sizeof(BenchNode));
+    CSTL_CHECK_NOT_NULL(node, "Could not allocate a node");
+    UInt64 i = map_hash_u64(key) & (map->nbuckets - 1);
+    node->key = key;
+    node->value = value;
+    node->next = map->buckets[i];
+    map->buckets[i] = node;
+    map->size++;
+    return true;
+}
+
+static bool bench_chained_remove(BenchChainedMap* map, UInt64 key) {
+    if(map->nbuckets == 0)
+        return false;
+    for(BenchNode** link = &map->buckets[map_hash_u64(key) & (map->nbuckets - 1)]; *link; link = &(*link)->next) {
+        if((*link)->key == key) {
+            BenchNode* node = *link;
+            *link = node->next;
+            free(node);
+            map->size--;
+            return true;
+        }
+    }
+    return false;
+}
+
+// ================ Runs ================
+
+#define BENCH_NOPS      4
+static const char* const benchOps[BENCH_NOPS] = { "insert", "hit", "miss", "remove" };
+
+static UInt64 bench_random(UInt64* rng) {
+    // xorshift64*
+    *rng ^= *rng >> 12;
+    *rng ^= *rng << 25;
+    *rng ^= *rng >> 27;
+    return *rng * 0x2545F4914F6CDD1Dull;
+}
+
+// Time (in seconds) each operation took on the Swiss map, for `n` keys
+static void bench_swiss(const UInt64* keys, const UInt64* lookups, const UInt64* misses, UInt64 n, double* times, 
+                        UInt64* checksum) {
+    BenchSwissMap map = {0};
+    UInt64 start = clock_now_ns();
+    for(UInt64 i = 0; i < n; i++)
+        bench_swiss_put(&map, keys[i], i);
+    times[0] = (double)(clock_now_ns() - start) * 1e-9;
+
+    start = clock_now_ns();
+    for(UInt64 i = 0; i < n; i++)
+        *checksum += *bench_swiss_find(&map, lookups[i]);
+    times[1] = (double)(clock_now_ns() - start) * 1e-9;
+
+    start = clock_now_ns();
+    for(UInt64 i = 0; i < n; i++)
+        *checksum += bench_swiss_find(&map, misses[i]) != null;
+    times[2] = (double)(clock_now_ns() - start) * 1e-9;
+
+    start = clock_now_ns();
+    for(UInt64 i = 0; i < n / 2; i++)
+        *checksum += bench_swiss_remove(&map, keys[i]);
+    for(UInt64 i = n / 2; i < n; i++)
+        *checksum += *bench_swiss_find(&map, keys[i]);
+    times[3] = (double)(clock_now_ns() - start) * 1e-9;
+    bench_swiss_free(&map);
+}
+
+// Time (in seconds) each operation took on the chained map, for `n` keys
+static void bench_chained(const UInt64* keys, const UInt64* lookups, const UInt64* misses, UInt64 n, double* times, 
+                          UInt64* checksum) {
+    BenchChainedMap map = {0};
+    UInt64 start = clock_now_ns();
+    for(UInt64 i = 0; i < n; i++)
+        bench_chained_put(&map, keys[i], i);
+    times[0] = (double)(clock_now_ns() - start) * 1e-9;
+
+    start = clock_now_ns();
+    for(UInt64 i = 0; i < n; i++)
+        *checksum += *bench_chained_find(&map, lookups[i]);
+    times[1] = (double)(clock_now_ns() - start) * 1e-9;
+
+    start = clock_now_ns();
+    for(UInt64 i = 0; i < n; i++)
+        *checksum += bench_chained_find(&map, misses[i]) != null;
+    times[2] = (double)(clock_now_ns() - start) * 1e-9;
+
+    start = clock_now_ns();
+    for(UInt64 i = 0; i < n / 2; i++)
+        *checksum += bench_chained_remove(&map, keys[i]);
+    for(UInt64 i = n / 2; i < n; i++)
+        *checksum += *bench_chained_find(&map, keys[i]);
+    times[3] = (double)(clock_now_ns() - start) * 1e-9;
+    bench_chained_free(&map);
+}
+
+static void bench_usage(const char* argv0) {
+    fprintf(stderr, "Usage: %s [--max <n>] [--reps <n>]\n", argv0);
+}
+
+int main(int argc, char** argv) {
+    UInt64 max = BENCH_DEFAULT_MAX;
+    UInt32 reps = BENCH_DEFAULT_REPS;
+    for(int i = 1; i < argc; i++) {
+        if(i + 1 < argc && strcmp(argv[i], "--max") == 0) {
+            max = strtoull(argv[++i], null, 10);
+        } else if(i + 1 < argc && strcmp(argv[i], "--reps") == 0) {
+            reps = (UInt32)strtoul(argv[++i], null, 10);
+        } else {
+            bench_usage(argv[0]);
+            return 2;
+        }
+    }
+    if(max < BENCH_MIN_SIZE || reps == 0) {
+        bench_usage(argv[0]);
+        return 2;
+    }
+
+    // Keys that are in the map, the same keys in another order, and keys that are not in it
+    UInt64* keys = (UInt64*)malloc(max * sizeof(UInt64));
+    UInt64* lookups = (UInt64*)malloc(max * sizeof(UInt64));
+    UInt64* misses = (UInt64*)malloc(max * sizeof(UInt64));
+    CSTL_CHECK(keys && lookups && misses, "Could not allocate the keys");
+    UInt64 rng = BENCH_SEED;
+    UInt64 checksum = 0;
+
+    printf("%-10s %-8s %14s %14s %9s\n", "entries", "op", "swiss Mops/s", "chained Mops/s", "speedup");
+    for(UInt64 n = BENCH_MIN_SIZE; n <= max; n *= 10) {
+        // Odd keys are inserted, even ones are missed
+        for(UInt64 i = 0; i < n; i++) {
+            keys[i] = bench_random(&rng) | 1;
+            misses[i] = bench_random(&rng) & ~(UInt64)1;
+        }
+        memcpy(lookups, keys, n * sizeof(UInt64));
+        for(UInt64 i = n - 1; i > 0; i--) {
+            UInt64 j = bench_random(&rng) % (i + 1);
+            UInt64 key = lookups[i];
+            lookups[i] = lookups[j];
+            lookups[j] = key;
+        }
+
+        double swiss[BENCH_NOPS], chained[BENCH_NOPS], times[BENCH_NOPS];
+        for(UInt32 op = 0; op < BENCH_NOPS; op++)
+            swiss[op] = chained[op] = 1e300;
+        for(UInt32 rep = 0; rep < reps; rep++) {
+            bench_swiss(keys, lookups, misses, n, times, &checksum);
+            for(UInt32 op = 0; op < BENCH_NOPS; op++)
+                swiss[op] = CSTL_MIN(swiss[op], times[op]);
+            bench_chained(keys, lookups, misses, n, times, &checksum);
+            for(UInt32 op = 0; op < BENCH_NOPS; op++)
+                chained[op] = CSTL_MIN(chained[op], times[op]);
+        }
+
+        for(UInt32 op = 0; op < BENCH_NOPS; op++) {
+            printf("%-10llu %-8s %14.1f %14.1f %8.2fx\n", (unsigned long long)n, benchOps[op], 
+                   (double)n / swiss[op] * 1e-6, (double)n / chained[op] * 1e-6, chained[op] / swiss[op]);
+        }
+    }
+    // So that none of the lookups can be optimized away
+    fprintf(stderr, "(checksum %llu)\n", (unsigned long long)checksum);
+
+    free(keys);
+    free(lookups);
+    free(misses);
+    return 0;
+}
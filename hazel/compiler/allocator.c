@@ -0,0 +1,44 @@
+/*
+_ _    _           ______   _______        
+| |  | |    /\    /___  /   |  ____|| |    
+| |__| |   /  \      / /    | |__   | |       Hazel - The Fast, Expressive & Elegant Programming Language
+|  __  |  / /\ \    / /     |  __|  | |       Languages: C, C++, and Assembly
+| |  | | / ____ \  / /___   | |____ | |____   https://github.com/HazelLang/hazel/
+|_|_ |_|/_/    \_\/_______\ |______|_\______|
+
+Licensed under the MIT License <http://opensource.org/licenses/MIT>
+SPDX-License-Identifier: MIT
+Copyright (c) 2021 Jason Dsouza <http://github.com/jasmcaus>
+*/
+
+#include <hazel/compiler/allocator.h>
+
+static cstlAllocator* compilerAllocator = null;
+static CSTL_THREAD_LOCAL cstlArena compilerScratch[2];
+
+// Returns the allocator the compiler allocates from (null for the heap)
+cstlAllocator* compiler_allocator(void) {
+    return compilerAllocator;
+}
+
+// Make the compiler allocate from `allocator` (null for the heap)
+void compiler_set_allocator(cstlAllocator* allocator) {
+    compilerAllocator = allocator;
+}
+
+// Returns one of the calling thread's scratch arenas that isn't `conflict`
+cstlArena* compiler_scratch(const cstlArena* conflict) {
+    cstlArena* scratch = &compilerScratch[conflict == &compilerScratch[0]];
+    // Chunks come from the allocator that was current when the arena was first used
+    if(scratch->chunk_size == 0)
+        arena_init(scratch, compilerAllocator, 0);
+    return scratch;
+}
+
+// Free the calling thread's scratch arenas
+void compiler_scratch_free(void) {
+    for(int i = 0; i < 2; i++) {
+        arena_free(&compilerScratch[i]);
+        compilerScratch[i].chunk_size = 0;
+    }
+}
@@ -0,0 +1,45 @@
+/*
+_ _    _           ______   _______        
+| |  | |    /\    /___  /   |  ____|| |    
+| |__| |   /  \      / /    | |__   | |       Hazel - The Fast, Expressive & Elegant Programming Language
+|  __  |  / /\ \    / /     |  __|  | |       Languages: C, C++, and Assembly
+| |  | | / ____ \  / /___   | |____ | |____   https://github.com/HazelLang/hazel/
+|_|_ |_|/_/    \_\/_______\ |______|_\______|
+
+Licensed under the MIT License <http://opensource.org/licenses/MIT>
+SPDX-License-Identifier: MIT
+Copyright (c) 2021 Jason Dsouza <http://github.com/jasmcaus>
+*/
+
+#ifndef HAZEL_COMPILER_ALLOCATOR_H
+#define HAZEL_COMPILER_ALLOCATOR_H
+
+#include <hazel/core/allocator.h>
+#include <hazel/core/memory.h>
+
+/*
+    Everything the compiler allocates while compiling (Lexers and their buffers, token streams, side tables, arenas, 
+    the interner, ...) comes from one allocator: the heap by default, or whatever `compiler_set_allocator()` was 
+    handed - eg. `profiler_allocator()`, to see how much memory each phase takes.
+
+    Containers remember the allocator they were created with, and give their memory back to it. Set the allocator 
+    before compiling anything - and leave it alone until everything allocated from it has been freed.
+
+    Memory that is only needed for the duration of a call comes from a scratch arena (`compiler_scratch()`): mark 
+    it, allocate, and restore it to the mark before returning. Every thread has two of them, so that a function 
+    can hand its own scratch arena to a callee (as the place to allocate its results) and the callee can still 
+    take the other one for its temporaries.
+*/
+
+// Returns the allocator the compiler allocates from (null for the heap)
+cstlAllocator* compiler_allocator(void);
+// Make the compiler allocate from `allocator` (null for the heap)
+void compiler_set_allocator(cstlAllocator* allocator);
+
+// Returns one of the calling thread's scratch arenas - one that isn't `conflict` (an arena the caller allocates its
+// results from, or null). Give back what you allocate with `arena_restore()`.
+cstlArena* compiler_scratch(const cstlArena* conflict);
+// Free the calling thread's scratch arenas (eg. before the thread exits - they'd leak otherwise)
+void compiler_scratch_free(void);
+
+#endif // HAZEL_COMPILER_ALLOCATOR_H
@@ -16,9 +16,15 @@ Copyright (c) 2021 Jason Dsouza <http://github.com/jasmcaus>
 
 #include <hazel/core/types.h>
 #include <hazel/core/vector.h>
+#include <hazel/compiler/intern.h>
 
 typedef struct AstNode AstNode;
 
+// No. of children an AstNodeList holds before it allocates (enough for most parameter lists)
+#define AST_NODE_LIST_SMALL     4
+// A list of `AstNode*`s (see CSTL_SMALL_VECTOR in <hazel/core/vector.h>)
+CSTL_SMALL_VECTOR(AstNodeList, ast_node_list, AstNode*, AST_NODE_LIST_SMALL)
+
 // Change values later
 typedef enum AstNodeType {
     AST_NODE_HELLO,
@@ -37,8 +43,8 @@ enum FuncInline {
 };
 
 typedef struct AstNodeFuncPrototype {
-    char* name;
-    cstlVector* params;  // vector of `AstNode*`s -> similar to cstlVector<AstNode*> if C has generics
+    Symbol name;      // interned (see <hazel/compiler/intern.h>)
+    AstNodeList params;  // the parameters (AstNodeParamDecls)
     AstNode* return_type;
     AstNode* func_def;
 
@@ -51,7 +57,7 @@ typedef struct AstNodeFuncPrototype {
 } AstNodeFuncPrototype;
 
 typedef struct AstNodeParamDecls {
-    char* name;
+    Symbol name;      // interned (see <hazel/compiler/intern.h>)
     AstNode* type;
     bool is_alias;
     bool is_var_args;
@@ -74,7 +80,7 @@ typedef struct AstNodeDefer {
 } AstNodeDefer;
 
 typedef struct AstNodeVarDecl {
-    char* name;
+    Symbol name;      // interned (see <hazel/compiler/intern.h>)
     AstNode* type;    // can be null
     AstNode* expr;
     UInt64 tok_index; // token index
@@ -0,0 +1,191 @@
+/*
+_ _    _           ______   _______        
+| |  | |    /\    /___  /   |  ____|| |    
+| |__| |   /  \      / /    | |__   | |       Hazel - The Fast, Expressive & Elegant Programming Language
+|  __  |  / /\ \    / /     |  __|  | |       Languages: C, C++, and Assembly
+| |  | | / ____ \  / /___   | |____ | |____   https://github.com/HazelLang/hazel/
+|_|_ |_|/_/    \_\/_______\ |______|_\______|
+
+Licensed under the MIT License <http://opensource.org/licenses/MIT>
+SPDX-License-Identifier: MIT
+Copyright (c) 2021 Jason Dsouza <http://github.com/jasmcaus>
+*/
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <hazel/core/debug.h>
+#include <hazel/core/hash.h>
+#include <hazel/core/math.h>
+#include <hazel/core/simd.h>
+#include <hazel/compiler/intern.h>
+
+static Interner internGlobal;
+static cstlOnce internGlobalOnce = CSTL_ONCE_INIT;
+
+// Initialize an (empty) Interner
+void interner_init(Interner* interner) {
+    memset(interner, 0, sizeof(Interner));
+    interner->allocator = compiler_allocator();
+    for(UInt32 s = 0; s < INTERN_NSHARDS; s++) {
+        InternShard* shard = &interner->shards[s];
+        thread_mutex_init(&shard->lock);
+        shard->slots = (InternEntry**)CSTL_ALLOC_ZEROED(interner->allocator, 
+                                                        INTERN_INITIAL_SLOTS * sizeof(InternEntry*));
+        CSTL_CHECK_NOT_NULL(shard->slots, "Could not allocate memory. Memory full.");
+        shard->mask = INTERN_INITIAL_SLOTS - 1;
+        arena_init(&shard->arena, interner->allocator, INTERN_CHUNK_SIZE);
+    }
+}
+
+// Free `interner` and every string interned in it
+void interner_free(Interner* interner) {
+    for(UInt32 s = 0; s < INTERN_NSHARDS; s++) {
+        InternShard* shard = &interner->shards[s];
+        CSTL_FREE(interner->allocator, shard->slots, ((UInt64)shard->mask + 1) * sizeof(InternEntry*));
+        for(UInt32 k = 0; k < INTERN_MAX_SEGMENTS; k++)
+            CSTL_FREE(interner->allocator, shard->segments[k], 
+                      ((UInt64)1 << (INTERN_SEGMENT_BITS + k)) * sizeof(InternEntry*));
+        arena_free(&shard->arena);
+        thread_mutex_free(&shard->lock);
+    }
+    memset(interner, 0, sizeof(Interner));
+}
+
+static void interner__init_global(void) {
+    interner_init(&internGlobal);
+}
+
+// Returns the process-wide Interner (created on first use)
+Interner* interner_global(void) {
+    thread_once(&internGlobalOnce, interner__init_global);
+    return &internGlobal;
+}
+
+// Returns the hash of the `length` bytes at `string`
+// Identifiers are short, and `hash_bytes64()` hashes anything up to 16 bytes with a few overlapping loads and two 
+// multiplies.
+UInt64 intern_hash(const char* string, UInt32 length) {
+    return hash_bytes64(string, length, 0);
+}
+
+// The shard a string (with hash `hash`) is interned in. The hash table slot comes from the low bits of the hash.
+static inline UInt32 intern__shard_of(UInt64 hash) {
+    return (UInt32)(hash >> (64 - INTERN_SHARD_BITS));
+}
+
+// Returns where the pointer to the `index`th entry of `shard` is kept
+static inline InternEntry** intern__entry_at(const InternShard* shard, UInt32 index) {
+    UInt64 biased = (UInt64)index + (1u << INTERN_SEGMENT_BITS);
+    UInt32 segment = 63 - simd_clz64(biased) - INTERN_SEGMENT_BITS;
+    return &shard->segments[segment][biased - ((UInt64)1 << (INTERN_SEGMENT_BITS + segment))];
+}
+
+// Returns the entry `symbol` names
+static inline const InternEntry* intern__symbol_entry(const Interner* interner, Symbol symbol) {
+    CSTL_CHECK_NE(symbol, SYMBOL_NONE);
+    const InternShard* shard = &interner->shards[symbol & (INTERN_NSHARDS - 1)];
+    // No lock: the entry was added before anyone could have been handed `symbol`, and it never moves
+    return *intern__entry_at(shard, (symbol >> INTERN_SHARD_BITS) - 1);
+}
+
+// Allocate an entry for the `length` bytes at `string` from the shard's arena
+static InternEntry* intern__new_entry(InternShard* shard, const char* string, UInt32 length, UInt64 hash) {
+    InternEntry* entry = (InternEntry*)arena_alloc_aligned(&shard->arena, sizeof(InternEntry) + (UInt64)length + 1, 
+                                                           sizeof(UInt64));
+    entry->hash = hash;
+    entry->length = length;
+    entry->index = shard->size;
+    memcpy(entry->string, string, length);
+    entry->string[length] = nullchar;
+    return entry;
+}
+
+// Double the no. of hash table slots in `shard`
+static void intern__grow(Interner* interner, InternShard* shard) {
+    UInt32 mask = shard->mask * 2 + 1;
+    InternEntry** slots = (InternEntry**)CSTL_ALLOC_ZEROED(interner->allocator, 
+                                                           ((UInt64)mask + 1) * sizeof(InternEntry*));
+    CSTL_CHECK_NOT_NULL(slots, "Could not allocate memory. Memory full.");
+
+    // Every entry has its hash on hand, so nothing needs to be re-hashed
+    for(UInt32 index = 0; index < shard->size; index++) {
+        InternEntry* entry = *intern__entry_at(shard, index);
+        UInt32 slot = (UInt32)entry->hash & mask;
+        while(slots[slot])
+            slot = (slot + 1) & mask;
+        slots[slot] = entry;
+    }
+
+    CSTL_FREE(interner->allocator, shard->slots, ((UInt64)shard->mask + 1) * sizeof(InternEntry*));
+    shard->slots = slots;
+    shard->mask = mask;
+}
+
+// Returns the Symbol of the `length` bytes at `string`, interning a copy of them if they haven't been seen before
+Symbol interner_intern(Interner* interner, const char* string, UInt32 length) {
+    return INTERN_ENTRY_SYMBOL(interner_intern_hashed(interner, string, length, intern_hash(string, length)));
+}
+
+// Same as `interner_intern()`, for a caller that already has the hash of `string`
+const InternEntry* interner_intern_hashed(Interner* interner, const char* string, UInt32 length, UInt64 hash) {
+    UInt32 s = intern__shard_of(hash);
+    InternShard* shard = &interner->shards[s];
+    thread_mutex_lock(&shard->lock);
+
+    // Linear probing - the table is never more than half full
+    UInt32 slot = (UInt32)hash & shard->mask;
+    for(InternEntry* entry; (entry = shard->slots[slot]) != null; slot = (slot + 1) & shard->mask) {
+        if(entry->hash == hash && entry->length == length && memcmp(entry->string, string, length) == 0) {
+            thread_mutex_unlock(&shard->lock);
+            return entry;
+        }
+    }
+
+    // Not seen before --> add it
+    UInt32 index = shard->size;
+    CSTL_CHECK(index < ((UInt32)1 << (32 - INTERN_SHARD_BITS)) - 1, "Too many distinct strings to intern");
+    UInt64 biased = (UInt64)index + (1u << INTERN_SEGMENT_BITS);
+    UInt32 segment = 63 - simd_clz64(biased) - INTERN_SEGMENT_BITS;
+    if(shard->segments[segment] == null) {
+        shard->segments[segment] = (InternEntry**)CSTL_ALLOC(interner->allocator, 
+                                                             ((UInt64)1 << (INTERN_SEGMENT_BITS + segment)) * 
+                                                             sizeof(InternEntry*));
+        CSTL_CHECK_NOT_NULL(shard->segments[segment], "Could not allocate memory. Memory full.");
+    }
+
+    InternEntry* entry = intern__new_entry(shard, string, length, hash);
+    *intern__entry_at(shard, index) = entry;
+    shard->slots[slot] = entry;
+    shard->size = index + 1;
+    if(shard->size * 2 > shard->mask)
+        intern__grow(interner, shard);
+
+    thread_mutex_unlock(&shard->lock);
+    return entry;
+}
+
+// Returns the (NUL-terminated) string `symbol` names
+const char* interner_string(const Interner* interner, Symbol symbol, UInt32* length) {
+    const InternEntry* entry = intern__symbol_entry(interner, symbol);
+    if(length)
+        *length = entry->length;
+    return entry->string;
+}
+
+// Returns the hash of the string `symbol` names
+UInt64 interner_hash(const Interner* interner, Symbol symbol) {
+    return intern__symbol_entry(interner, symbol)->hash;
+}
+
+// Returns the no. of distinct strings interned so far
+UInt32 interner_size(Interner* interner) {
+    UInt32 size = 0;
+    for(UInt32 s = 0; s < INTERN_NSHARDS; s++) {
+        InternShard* shard = &interner->shards[s];
+        thread_mutex_lock(&shard->lock);
+        size += shard->size;
+        thread_mutex_unlock(&shard->lock);
+    }
+    return size;
+}
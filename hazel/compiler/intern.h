@@ -0,0 +1,100 @@
+/*
+_ _    _           ______   _______        
+| |  | |    /\    /___  /   |  ____|| |    
+| |__| |   /  \      / /    | |__   | |       Hazel - The Fast, Expressive & Elegant Programming Language
+|  __  |  / /\ \    / /     |  __|  | |       Languages: C, C++, and Assembly
+| |  | | / ____ \  / /___   | |____ | |____   https://github.com/HazelLang/hazel/
+|_|_ |_|/_/    \_\/_______\ |______|_\______|
+
+Licensed under the MIT License <http://opensource.org/licenses/MIT>
+SPDX-License-Identifier: MIT
+Copyright (c) 2021 Jason Dsouza <http://github.com/jasmcaus>
+*/
+
+
+#ifndef HAZEL_INTERN_H
+#define HAZEL_INTERN_H
+
+#include <hazel/core/types.h>
+#include <hazel/core/memory.h>
+#include <hazel/core/thread.h>
+#include <hazel/compiler/allocator.h>
+
+/*
+    Every identifier is interned as it is lexed: each distinct string is stored once, for the lifetime of the 
+    Interner, and is named by a 32-bit `Symbol`. Two names are the same iff their Symbols are - later stages (the 
+    symbol table in particular) never have to compare, hash or copy the strings themselves.
+
+    The hash of every string is computed once, when it is interned, and is kept alongside it (see 
+    `interner_hash()`) so that tables keyed by Symbols can reuse it.
+
+    Interning is thread-safe. Strings are spread over INTERN_NSHARDS shards (by hash), each behind its own lock, so 
+    that threads lexing different parts of a file (see `lexer_lex_parallel()`) rarely wait on each other. Looking up 
+    the string behind a Symbol takes no lock at all: entries never move once they are added.
+*/
+
+// A 32-bit name for an interned string. SYMBOL_NONE is never handed out.
+typedef UInt32 Symbol;
+#define SYMBOL_NONE                 0
+
+// No. of bits of a Symbol that identify its shard
+#define INTERN_SHARD_BITS           4
+#define INTERN_NSHARDS              (1 << INTERN_SHARD_BITS)
+// Each shard starts out with this many (power of 2) hash table slots
+#define INTERN_INITIAL_SLOTS        1024
+// Entries are stored in segments that double in size: the first one holds `1 << INTERN_SEGMENT_BITS` entries
+#define INTERN_SEGMENT_BITS         8
+// Enough segments for the `2^28` entries a shard can name with the rest of a Symbol
+#define INTERN_MAX_SEGMENTS         20
+// Size (in bytes) of each chunk entries are allocated from. Larger strings get a chunk of their own.
+#define INTERN_CHUNK_SIZE           KB_TO_BYTES(64)
+
+// An interned string. The string is stored right after its hash, so that checking a hash table slot usually 
+// touches a single cache line.
+typedef struct InternEntry {
+    UInt64 hash;                // `intern_hash()` of the string
+    UInt32 length;              // no. of bytes in the string (excluding the NUL)
+    UInt32 index;               // position of the entry in its shard
+    char string[];              // NUL-terminated copy of the string
+} InternEntry;
+
+typedef struct InternShard {
+    cstlMutex lock;             // held while looking up (or adding) a string
+    InternEntry** slots;        // open-addressed hash table of entries (null marks an empty slot)
+    UInt32 mask;                // no. of slots - 1
+    UInt32 size;                // no. of strings interned in this shard
+    InternEntry** segments[INTERN_MAX_SEGMENTS];  // entries by index: segment `k` holds `1 << (INTERN_SEGMENT_BITS + k)`
+    cstlArena arena;            // where entries are allocated from
+} InternShard;
+
+typedef struct Interner {
+    InternShard shards[INTERN_NSHARDS];
+    cstlAllocator* allocator;   // where everything is allocated from (`compiler_allocator()`, when initialized)
+} Interner;
+
+// Initialize an (empty) Interner
+void interner_init(Interner* interner);
+// Free `interner` and every string interned in it. The Symbols it handed out become meaningless.
+void interner_free(Interner* interner);
+// Returns the process-wide Interner the Lexer interns identifiers into (created on first use)
+Interner* interner_global(void);
+
+// Returns the hash of the `length` bytes at `string`, as used by the Interner
+UInt64 intern_hash(const char* string, UInt32 length);
+// Returns the Symbol of the `length` bytes at `string`, interning a copy of them if they haven't been seen before
+Symbol interner_intern(Interner* interner, const char* string, UInt32 length);
+// Same as `interner_intern()`, for a caller that already has `hash = intern_hash(string, length)`. Returns the 
+// entry of the string (see INTERN_ENTRY_SYMBOL()).
+const InternEntry* interner_intern_hashed(Interner* interner, const char* string, UInt32 length, UInt64 hash);
+// Returns the Symbol naming `entry`
+#define INTERN_ENTRY_SYMBOL(entry)  \
+    ((((entry)->index + 1) << INTERN_SHARD_BITS) | (Symbol)((entry)->hash >> (64 - INTERN_SHARD_BITS)))
+
+// Returns the (NUL-terminated) string `symbol` names, and stores its length in `length` (unless it is null)
+const char* interner_string(const Interner* interner, Symbol symbol, UInt32* length);
+// Returns the hash of the string `symbol` names
+UInt64 interner_hash(const Interner* interner, Symbol symbol);
+// Returns the no. of distinct strings interned so far
+UInt32 interner_size(Interner* interner);
+
+#endif // HAZEL_INTERN_H
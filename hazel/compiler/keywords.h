@@ -0,0 +1,300 @@
+// Auto-generated by tools/scripts/generate_tokens.py from hazel/compiler/tokens.h
+// DO NOT EDIT. Any changes to the keywords must be made to the `ALLTOKENS` macro (and to syntax.toml) instead.
+//
+// A collision-free (perfect) hash of every Hazel keyword. An identifier is classified by hashing its length, first
+// and last two characters, followed by a single `memcmp()` against the only keyword it could possibly be.
+#ifndef HAZEL_KEYWORDS_H
+#define HAZEL_KEYWORDS_H
+
+#include <string.h>
+#include <hazel/compiler/tokens.h>
+
+#define KEYWORD_MIN_LENGTH     2
+#define KEYWORD_MAX_LENGTH     8
+#define KEYWORD_TABLE_SIZE     256
+
+// `value` must have at least KEYWORD_MIN_LENGTH (>= 2) characters
+#define KEYWORD_HASH(value, length)                          \
+    ((((UInt32)(UInt8)(value)[0] * 2u) +                   \
+      ((UInt32)(UInt8)(value)[(length) - 2] * 11u) +        \
+      ((UInt32)(UInt8)(value)[(length) - 1] * 27u) +        \
+      (UInt32)(length)) & (KEYWORD_TABLE_SIZE - 1))
+
+typedef struct {
+    const char* value;
+    UInt8 length;
+    UInt8 kind;
+} KeywordEntry;
+
+static const KeywordEntry keywordTable[KEYWORD_TABLE_SIZE] = {
+    { "", 0, IDENTIFIER },
+    { "isa", 3, ISA },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "catch", 5, CATCH },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "as", 2, AS },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "from", 4, FROM },
+    { "elseif", 6, ELSEIF },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "match", 5, MATCH },
+    { "if", 2, IF },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "module", 6, MODULE },
+    { "mutable", 7, MUTABLE },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "tuple", 5, TUPLE },
+    { "inline", 6, INLINE },
+    { "finally", 7, FINALLY },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "break", 5, BREAK },
+    { "while", 5, WHILE },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "any", 3, ANY },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "noinline", 8, NO_INLINE },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "union", 5, UNION },
+    { "", 0, IDENTIFIER },
+    { "extern", 6, EXTERN },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "enum", 4, ENUM },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "case", 4, CASE },
+    { "type", 4, TYPE },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "else", 4, ELSE },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "struct", 6, STRUCT },
+    { "return", 6, RETURN },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "decl", 4, DECL },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "typeof", 6, TYPEOF },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "macro", 5, MACRO },
+    { "", 0, IDENTIFIER },
+    { "continue", 8, CONTINUE },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "where", 5, WHERE },
+    { "raise", 5, RAISE },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "use", 3, USE },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "try", 3, TRY },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "for", 3, FOR },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "default", 7, DEFAULT },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "atomic", 6, ATOMIC },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "do", 2, DO },
+    { "include", 7, INCLUDE },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "pragma", 6, PRAGMA },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "map", 3, MAP },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "except", 6, EXCEPT },
+    { "class", 5, CLASS },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "not", 3, NOT },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "when", 4, WHEN },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "begin", 5, BEGIN },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "in", 2, IN },
+    { "export", 6, EXPORT },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "", 0, IDENTIFIER },
+    { "cast", 4, CAST },
+    { "const", 5, CONST },
+    { "", 0, IDENTIFIER },
+    { "import", 6, IMPORT },
+    { "func", 4, FUNC },
+    { "mixin", 5, MIXIN },
+    { "range", 5, RANGE },
+    { "notin", 5, NOT_IN },
+    { "", 0, IDENTIFIER },
+};
+
+// Returns the TokenKind of the keyword `value` (of `length` bytes), or IDENTIFIER if it isn't one
+static inline TokenKind keyword_lookup(const char* value, UInt32 length) {
+    if(length < KEYWORD_MIN_LENGTH || length > KEYWORD_MAX_LENGTH)
+        return IDENTIFIER;
+
+    const KeywordEntry* entry = &keywordTable[KEYWORD_HASH(value, length)];
+    if(entry->length == length && memcmp(entry->value, value, length) == 0)
+        return (TokenKind)entry->kind;
+
+    return IDENTIFIER;
+}
+
+#endif // HAZEL_KEYWORDS_H
@@ -11,7 +11,11 @@ SPDX-License-Identifier: MIT
 Copyright (c) 2021 Jason Dsouza <http://github.com/jasmcaus>
 */
 
+// Before any system header - it sets the feature macros `clock.h` relies on (clock_gettime())
+#include <hazel/core/headers.h>
+#include <math.h>
 #include <hazel/compiler/lexer.h>
+#include <hazel/compiler/keywords.h>
 
 // String representation of a TokenKind
 // To access the string representation of a TokenKind object, simply use `tokenHash[tokenkind]`
@@ -23,92 +27,218 @@ static const char* tokenHash[] = {
     #undef TOKENKIND
 };
 
-// These macros are used in the switch() statements below during the Lexing of Hazel source files.
-#define WHITESPACE_NO_NEWLINE \
-    ' ': case '\r': case '\t': case '\v': case '\f'
-
-#define DIGIT_NON_ZERO  \
-    '1': case '2': case '3': case '4': case '5': case '6': case '7': case '8': case '9'
-
-#define DIGIT \
-    '0': case DIGIT_NON_ZERO
-
-#define HEX_DIGIT \
-    'a': case 'b': case 'c': case 'd': case 'e': case 'f': case 'A': case 'B': case 'C': case 'D': case 'E': case 'F': \
-    case DIGIT
-
-#define ALPHA_EXCEPT_B_O_X \
-         'a': case 'c': case 'd': case 'e': case 'f': case 'g': case 'h': case 'i': case 'j': case 'k': case 'l': \
-    case 'm': case 'n': case 'p': case 'q': case 'r': case 's': case 't': case 'u': case 'v': case 'w': case 'y': \
-    case 'z': case 'A': case 'C': case 'D': case 'E': case 'F': case 'G': case 'H': case 'I': case 'J': case 'K': \
-    case 'L': case 'M': case 'N':case 'P': case 'Q': case 'R': case 'S': case 'T': case 'U': case 'V': case 'W':  \
-    case 'Y': case 'Z'  \
-
-#define ALPHA \
-         'b': case 'o': case 'x': case 'B': case 'O': case 'X': case ALPHA_EXCEPT_B_O_X
+Lexer* lexer_init(const char* buffer, const char* fname) {
+    // `buffer` isn't padded --> lex a (padded) copy of it
+    return lexer_init_from_buffer(buff_create(compiler_allocator(), (char*)buffer, 
+                                              buffer == null ? 0 : (UInt64)strlen(buffer), true), fname);
+}
 
+Lexer* lexer_init_with_length(const char* buffer, UInt32 length, const char* fname) {
+    // Not copied - `buffer` must outlive the Lexer
+    return lexer_init_from_buffer(buff_create(compiler_allocator(), (char*)buffer, length, false), fname);
+}
 
-Lexer* lexer_init(const char* buffer, const char* fname) {
-    Lexer* lexer = (Lexer*)calloc(1, sizeof(Lexer));
+static Lexer* lexer_init_from_buffer(cstlBuffer* buffer, const char* fname) {
+    Lexer* lexer = (Lexer*)CSTL_ALLOC_ZEROED(buffer->allocator, sizeof(Lexer));
+    CSTL_CHECK_NOT_NULL(lexer, "Could not allocate memory. Memory full.");
+    lexer->allocator = buffer->allocator;
+    arena_init(&lexer->arena, buffer->allocator, LEXER_ARENA_CHUNK_SIZE);
     
     // Buffer
-    lexer->buffer = buff_new(buffer);
-    // Tokens
-    lexer->tokenList = vec_new(sizeof(Token), TOKENLIST_ALLOC_CAPACITY);
-
+    lexer->buffer = buffer;
     if(!fname)
         fname = "";
 
-    lexer->offset = 0;
-    lexer->lineno = 1;
-    lexer->colno = 1;
+    // Tokens
+    // Every token (bar EOF) takes up at least a byte, so a large file can't have more tokens than bytes
+    if(buffer->length >= TOKENLIST_RESERVED_MIN_SIZE)
+        token_stream_init_reserved(&lexer->tokenList, fname, (UInt32)buffer->length + 2);
+    else
+        token_stream_init(&lexer->tokenList, fname, TOKENLIST_ALLOC_CAPACITY);
+    comment_table_reserve(&lexer->comments, COMMENTLIST_ALLOC_CAPACITY);
+
+    lexer->offset = lexer_start_offset(lexer);
     lexer->fname = fname;
+    lexer->interner = interner_global();
+
+    // Once the end of the buffer has been reached, this is what `lexer_next_token()` keeps returning
+    lexer->eof_token.kind = TOK_EOF;
+    lexer->eof_token.offset = (UInt32)lexer->buffer->length;
+    lexer->eof_token.length = 0;
 
     return lexer;
 }
 
-static void lexer_tokenlist_push(Lexer* lexer, Token* token) {
-    lexer->tokenList->push(lexer->tokenList, token);
+// Returns the offset lexing begins at
+static inline UInt32 lexer_start_offset(Lexer* lexer) {
+    // Some UTF8 text may start with a 3-byte 'BOM' marker sequence. If it exists, skip over them because they 
+    // are useless bytes. Generally, it is not recommended to add BOM markers to UTF8 texts, but it's not 
+    // uncommon (especially on Windows).
+    // (The padding makes it safe to look at the first 3 bytes of any buffer)
+    const char* data = lexer->buffer->data;
+    if(data[0] == (char)0xef && data[1] == (char)0xbb && data[2] == (char)0xbf)
+        return 3;
+    return 0;
+}
+
+static void lexer_tokenlist_push(Lexer* lexer, TokenKind kind, UInt32 offset, UInt32 length, Symbol symbol) {
+    // `push` had to realloc
+    if(token_stream_push(&lexer->tokenList, kind, offset, length, symbol))
+        ++lexer->nallocs;
 }
 
 static void lexer_free(Lexer* lexer) {
     if(lexer) {
-        lexer->tokenList->free(lexer->tokenList);
+        token_stream_free(&lexer->tokenList);
+        token_stream_free(&lexer->relexed);
+        literal_table_free(&lexer->literals);
+        comment_table_free(&lexer->comments);
         lexer->buffer->free(lexer->buffer);
-        free(lexer);
+        arena_free(&lexer->arena);
+        line_index_free(&lexer->lines);
+        CSTL_FREE(lexer->allocator, lexer, sizeof(Lexer));
     }
 }
 
-// Report an error and exit
+// Returns the `i`th token lexed so far
+Token lexer_token_at(Lexer* lexer, UInt32 i) {
+    return token_stream_at(&lexer->tokenList, i);
+}
+
+// Returns the no. of comments between the token at index `token` and the one before it
+UInt32 lexer_token_comments(Lexer* lexer, UInt32 token, UInt32* first) {
+    // Comments are linked to the token after them, so the ones we want are the ones linked to `token`
+    *first = comment_table_lower_bound(&lexer->comments, token);
+    return comment_table_lower_bound(&lexer->comments, token + 1) - *first;
+}
+
+// Returns the `i`th comment scanned so far
+Token lexer_comment_at(Lexer* lexer, UInt32 i) {
+    return comment_table_at(&lexer->comments, i);
+}
+
+// Returns a pointer to the value of `token` inside the Lexical buffer (no copy is made) and stores its length in 
+// `length`. The value is _not_ NUL-terminated.
+const char* lexer_token_view(Lexer* lexer, const Token* token, UInt32* length) {
+    const char* value = lexer->buffer->data + token->offset;
+    UInt32 len = token->length;
+
+    switch(token->kind) {
+        // Skip the quotes
+        case STRING: 
+        case RUNE: 
+            value += 1; 
+            len -= 2;
+            break;
+        // Skip the `@`
+        case MACRO: 
+            value += 1; 
+            len -= 1;
+            break;
+        // Skip the `#`, `//` or `/* */`
+        case COMMENT:
+            if(*value == '#') {
+                value += 1;
+                len -= 1;
+            } else if(value[1] == '*') {
+                value += 2;
+                len -= 2;
+                // An unterminated comment runs to the end of the buffer
+                if(len >= 2 && value[len - 2] == '*' && value[len - 1] == '/')
+                    len -= 2;
+            } else {
+                value += 2;
+                len -= 2;
+            }
+            break;
+        // Skip the `///`
+        case DOCS_COMMENT:
+            value += 3;
+            len -= 3;
+            break;
+        default: break;
+    }
+
+    *length = len;
+    return value;
+}
+
+// Returns a NUL-terminated copy of the value of `token`, allocated from the Lexer's arena.
+// Quotes (STRINGs and RUNEs), the `@` (MACROs) and the comment markers (COMMENTs and DOCS_COMMENTs) are stripped away.
+const char* lexer_token_value(Lexer* lexer, const Token* token) {
+    // Tokens that don't span any source (eg: TOK_EOF) are represented by their name
+    if(token->length == 0)
+        return token_to_string(token->kind);
+
+    UInt32 length;
+    const char* view = lexer_token_view(lexer, token, &length);
+
+    return arena_strndup(&lexer->arena, view, length);
+}
+
+// Returns the total number of heap allocations the Lexer has made so far
+UInt64 lexer_nallocs(Lexer* lexer) {
+    return lexer->nallocs + lexer->arena.nallocs;
+}
+
+// Returns the value of the numeric literal `token`, or null if `token` isn't one
+const LiteralValue* lexer_token_literal(Lexer* lexer, const Token* token) {
+    return literal_table_find(&lexer->literals, token->offset);
+}
+
+// Returns the line and column `offset` (into the Lexical buffer) falls on
+SourceLocation lexer_location(Lexer* lexer, UInt32 offset) {
+    // Nobody has asked for a line number yet
+    if(lexer->lines.starts == null)
+        line_index_build(&lexer->lines, lexer->buffer->data, (UInt32)lexer->buffer->length);
+
+    return line_index_lookup(&lexer->lines, offset);
+}
+
+// Returns the line and column `token` begins at
+SourceLocation lexer_token_location(Lexer* lexer, const Token* token) {
+    return lexer_location(lexer, token->offset);
+}
+
+// Report an error (at the current offset) and exit
 void lexer_error(Lexer* lexer, const char* format, ...) {
+    // A speculative lex (see `lexer_lex_parallel()`) - the error may not even be real
+    if(lexer->recover)
+        longjmp(*lexer->recover, 1);
+
+    SourceLocation location = lexer_location(lexer, lexer->offset);
     va_list vl;
     va_start(vl, format);
     fprintf(stderr, "%sSyntaxError: ", "\033[1;31m");
     vfprintf(stderr, format, vl);
-    fprintf(stderr, " at %s:%d:%d%s\n", lexer->fname, lexer->lineno,lexer->colno, "\033[0m");
+    fprintf(stderr, " at %s:%u:%u%s\n", lexer->fname, location.lineno, location.colno, "\033[0m");
     va_end(vl);
     exit(1);
 }
 
 // Returns the curent character in the Lexical Buffer and advances to the next element
 // It does this by incrementing the buffer offset.
+// There is no bounds check: the buffer ends in a NUL sentinel, where the offset stops moving.
 static inline char lexer_advance(Lexer* lexer) {
-    if(lexer->offset >= lexer->buffer->length)
-        return nullchar;
-    
-    LEXER_INCREMENT_COLNO;
-    return lexer->buffer->data[lexer->offset++];
+    BUFF_CHECK_READ(lexer->buffer, lexer->offset);
+    char ch = lexer->buffer->data[lexer->offset];
+    lexer->offset += (ch != nullchar);
+    return ch;
 }
 
-// Advance `n` characters in the Lexical Buffer
+// Advance `n` (at most CSTL_BUFFER_PADDING) characters in the Lexical Buffer
+// If that lands on (or past) the end of the buffer, the offset does not move.
 static inline char lexer_advancen(Lexer* lexer, UInt32 n) {
-    // The '>=' is here because offset and buffer_capacity are off by 1 (0-index vs 1-index respectively)
-    if(lexer->offset + n >= lexer->buffer->length)
-        return nullchar;
-    
-    lexer->colno += n;
-    lexer->offset += n;
-    return lexer->buffer->data[lexer->offset];
+    BUFF_CHECK_READ(lexer->buffer, lexer->offset + n);
+    char ch = lexer->buffer->data[lexer->offset + n];
+    if(ch != nullchar)
+        lexer->offset += n;
+    return ch;
+}
+
+// Move forward to `ptr` (which cannot be behind the current offset) in the Lexical Buffer
+static inline void lexer_skip_to(Lexer* lexer, const char* ptr) {
+    lexer->offset = (UInt32)(ptr - lexer->buffer->data);
 }
 
 // Returns the previous element in the Lexical buffer.
@@ -131,130 +261,194 @@ static inline char lexer_prevn(Lexer* lexer, UInt32 n) {
 
 // Returns the current element in the Lexical Buffer.
 static inline char lexer_peek(Lexer* lexer) {
-    return lexer->buffer->at(lexer->buffer, lexer->offset);
+    BUFF_CHECK_READ(lexer->buffer, lexer->offset);
+    return lexer->buffer->data[lexer->offset];
 }
 
-// "Look ahead" `n` characters in the Lexical buffer.
+// "Look ahead" `n` (at most CSTL_BUFFER_PADDING) characters in the Lexical buffer. Past the end of the buffer, 
+// this is NUL.
 // It _does not_ increment the buffer offset.
 static inline char lexer_peekn(Lexer* lexer, UInt32 n) {
-    if(lexer->offset + n >= lexer->buffer->length)
-        return nullchar;
-    
+    BUFF_CHECK_READ(lexer->buffer, lexer->offset + n);
     return (char)lexer->buffer->data[lexer->offset + n];
 }
 
-static void lexer_maketoken(Lexer* lexer, TokenKind kind, char* value, UInt32 offset, UInt32 lineno, UInt32 colno) {  
-    Token* token = (Token*)calloc(1, sizeof(Token));
-    CSTL_CHECK_NOT_NULL(token, "Could not allocate memory. Memory full.");
-
-    if(value == null) {
-        value = token_to_string(kind);
-
-        if(kind == STRING || kind == IDENTIFIER || kind == INTEGER || kind == HEX_INT || kind == BIN_INT ||
-        kind == OCT_INT)
-            CSTL_WARN("Expected a token value. Got `null`\n");
-    }
+// Make a token and append it to the token window
+static Token* lexer_maketoken(Lexer* lexer, TokenKind kind, UInt32 offset, UInt32 length) {  
+    LexerWindow* window = &lexer->window;
+    CSTL_CHECK_LT(window->tail - window->head, LEXER_WINDOW_SIZE);
 
+    Token* token = &window->tokens[window->tail++ & (LEXER_WINDOW_SIZE - 1)];
     token->kind = kind;
     token->offset = offset;
-    token->colno = colno;
-    token->lineno = lineno;
-    token->fname = lexer->fname;
-    token->value = value;
-    lexer_tokenlist_push(lexer, token);
+    token->length = length;
+    token->symbol = SYMBOL_NONE;
+    ++lexer->ntokens;
+    return token;
+}
+
+// Record a comment, linked to the next token to be made
+static void lexer_makecomment(Lexer* lexer, TokenKind kind, UInt32 offset, UInt32 length) {
+    // `push` had to realloc
+    if(comment_table_push(&lexer->comments, kind, offset, length, lexer->ntokens))
+        ++lexer->nallocs;
+}
+
+// Returns the Symbol of the `length` bytes at `value`
+static inline Symbol lexer_intern(Lexer* lexer, const char* value, UInt32 length) {
+    UInt64 hash = intern_hash(value, length);
+    // Most identifiers in a file are ones it has used before - those don't need the Interner's (shared) lock
+    const InternEntry** cached = &lexer->symbol_cache[(hash >> 32) & (LEXER_SYMBOL_CACHE_SIZE - 1)];
+    const InternEntry* entry = *cached;
+    if(entry == null || entry->hash != hash || entry->length != length || memcmp(entry->string, value, length) != 0) {
+        entry = interner_intern_hashed(lexer->interner, value, length, hash);
+        *cached = entry;
+    }
+    return INTERN_ENTRY_SYMBOL(entry);
 }
 
 // Scan a comment (single line)
-// We store comments in the lexing phase. The Parser will decide which comments are actually useful and which
-// aren't
+// Comments are kept on the side (in `lexer->comments`), out of the way of the Parser
 static inline void lexer_lex_sl_comment(Lexer* lexer) {
-    char ch = lexer_advance(lexer);
-    int comment_length = 0; // no. of chars in the comment (useful for allocating memory for `comment_value`)
+    // The comment marker (`#` or the first `/` of `//`) has already been consumed
     UInt32 prev_offset = lexer->offset - 1;
-    UInt32 lineno = lexer->lineno;
-    UInt32 colno = lexer->colno;
-
-    while(ch && ch != '\n') {
-        ch = lexer_advance(lexer);
-        ++comment_length;
+    const char* marker = lexer->buffer->data + prev_offset;
+    UInt32 marker_length = 1;
+    TokenKind kind = COMMENT;
+    if(marker[0] == '/') {
+        marker_length = 2;
+        // `///` (but not `////`, which is usually a separator) begins a documentation comment
+        if(marker[2] == '/' && marker[3] != '/') {
+            marker_length = 3;
+            kind = DOCS_COMMENT;
+        }
     }
 
-    CSTL_CHECK_EQ(ch, '\n');
+    // Leave the newline (if any) for `lexer_lex()`
+    lexer_skip_to(lexer, simd_find_byte(LEXER_CURR_PTR, LEXER_END_PTR, '\n'));
     
     // Do not store empty comments. Eg:
     //     `#`
-    if(comment_length == 0) 
+    UInt32 comment_length = lexer->offset - prev_offset;
+    if(comment_length <= marker_length) 
         return;
 
-    char* comment_value = (char*)calloc(comment_length + 1, sizeof(char));
-    substr(comment_value, lexer->buffer->data, prev_offset, comment_length - 1);
-    CSTL_CHECK_NOT_NULL(comment_value, "`comment_value` must not be null.");
-    lexer_maketoken(lexer, COMMENT, comment_value, prev_offset, lineno, colno);
-
-    LEXER_DECREMENT_OFFSET;
+    lexer_makecomment(lexer, kind, prev_offset, comment_length);
 }
 
 // Scan a comment (multi-line)
-// We have no reason, at the moment, to store a multi-line comment as a Token
 static inline void lexer_lex_ml_comment(Lexer* lexer) {
-    char ch = lexer_advance(lexer);
-    bool asterisk_found = false; 
-    while(ch && !(ch == '/' && asterisk_found)) {
-        asterisk_found = false; 
-        while(ch && ch!= '*')
-            ch = lexer_advance(lexer);
-        
-        if(ch == '*')
-            asterisk_found = true;
+    // The `/` of the opening `/*` has already been consumed
+    UInt32 prev_offset = lexer->offset - 1;
+    // Skip the `*` of the opening `/*`
+    LEXER_INCREMENT_OFFSET;
 
-        ch = lexer_advance(lexer);
+    // Jump from one `*` to the next, until we find the closing `*/`
+    while(true) {
+        lexer_skip_to(lexer, simd_find_byte(LEXER_CURR_PTR, LEXER_END_PTR, '*'));
+
+        if(lexer_advance(lexer) == nullchar)
+            break;
+
+        if(lexer_peek(lexer) == '/') {
+            LEXER_INCREMENT_OFFSET;
+            break;
+        }
     }
-    ch = lexer_advance(lexer);
+    lexer_makecomment(lexer, COMMENT, prev_offset, lexer->offset - prev_offset);
 }
 
-// Scan a character
+// Scan a character (RUNE) literal
 static inline void lexer_lex_char(Lexer* lexer) {
-    char ch = lexer_advance(lexer);
-    if(ch) {
-        LEXER_INCREMENT_OFFSET;
-        if(ch == '\n') {
-            LEXER_INCREMENT_LINENO;
-            LEXER_RESET_COLNO;
-        }
+    // The opening quote has already been consumed. The token spans both quotes, but `lexer_token_value()` strips 
+    // them away. Its value (the code point) goes into `lexer->literals`.
+    UInt32 prev_offset = lexer->offset - 1;
+    Rune rune;
+
+    switch(LEXER_CURR_CHAR) {
+        case '\'': lexer_error(lexer, "Empty rune literal"); return;
+        case '\n': 
+        case nullchar: lexer_error(lexer, "Unterminated rune literal"); return;
+        case '\\': 
+            LEXER_INCREMENT_OFFSET; 
+            rune = lexer_lex_esc_char(lexer); 
+            break;
+        default:
+            // The buffer is valid UTF-8, so this is a whole character
+            lexer->offset += utf8_decode(LEXER_CURR_PTR, &rune);
+            break;
     }
+
+    if(lexer_advance(lexer) != '\'')
+        lexer_error(lexer, "A rune literal must contain exactly one character (missing a closing `'`?)");
+
+    lexer_maketoken(lexer, RUNE, prev_offset, lexer->offset - prev_offset);
+    LiteralValue value;
+    value.integer = (UInt64)rune;
+    if(literal_table_push(&lexer->literals, prev_offset, value))
+        ++lexer->nallocs;
 }
 
-// Scan an escape char
-static inline void lexer_lex_esc_char(Lexer* lexer) {
+// Scan an escape sequence (the `\` has already been consumed) and return the character it stands for
+static inline Rune lexer_lex_esc_char(Lexer* lexer) {
+    char ch = lexer_advance(lexer);
+    switch(ch) {
+        case 'a':  return '\a';
+        case 'b':  return '\b';
+        case 'f':  return '\f';
+        case 'n':  return '\n';
+        case 'r':  return '\r';
+        case 't':  return '\t';
+        case 'v':  return '\v';
+        case '0':  return 0;
+        case '\\': return '\\';
+        case '\'': return '\'';
+        case '"':  return '"';
+        // `\xHH` (exactly 2 hex digits)
+        case 'x': {
+            Rune rune = 0;
+            for(UInt32 i = 0; i < 2; i++) {
+                char c = lexer_advance(lexer);
+                if(!isHexDigit(c))
+                    lexer_error(lexer, "Expected 2 hexadecimal digits [0-9A-Fa-f] after `\\x`");
+                rune = rune*16 + hexDigitToInt(c);
+            }
+            return rune;
+        }
+        // `\u{H...}` (1 to 6 hex digits)
+        case 'u': {
+            if(lexer_advance(lexer) != '{')
+                lexer_error(lexer, "Expected `{` after `\\u`");
+            Rune rune = 0;
+            UInt32 ndigits = 0;
+            while(isHexDigit(LEXER_CURR_CHAR) && ndigits < 6) {
+                rune = rune*16 + hexDigitToInt(lexer_advance(lexer));
+                ++ndigits;
+            }
+            if(ndigits == 0 || lexer_advance(lexer) != '}')
+                lexer_error(lexer, "Expected 1 to 6 hexadecimal digits [0-9A-Fa-f] and a `}` in `\\u{...}`");
+            if(rune > CSTL_RUNE_MAX || (rune >= 0xD800 && rune <= 0xDFFF))
+                lexer_error(lexer, "`\\u{%X}` is not a Unicode scalar value", rune);
+            return rune;
+        }
+        default:
+            lexer_error(lexer, "Unknown escape sequence `\\%c`", ch);
+            return CSTL_RUNE_INVALID;
+    }
 }
 
 // Scan a macro (begins with `@`)
 static inline void lexer_lex_macro(Lexer* lexer) {
-    char ch = lexer_advance(lexer);
-    int macro_length = 0; // length of macro
-
-    // Don't include the `@` in the macro symbol name
-    UInt32 prev_offset = lexer->offset;
-    UInt32 lineno = lexer->lineno;
-    UInt32 colno = lexer->colno;
+    // The `@` has already been consumed. It is part of the token, but `lexer_token_value()` strips it away.
+    UInt32 prev_offset = lexer->offset - 1;
 
-    while(isLetter(ch) || isDigit(ch)) {
-        ch = lexer_advance(lexer);
-        ++macro_length;
-    }
+    lexer_skip_to(lexer, simd_skip_identifier(LEXER_CURR_PTR, LEXER_END_PTR));
 
+    UInt32 macro_length = lexer->offset - prev_offset;
     if(macro_length > MAX_TOKEN_LENGTH)
-        CSTL_WARN(A number can never have more than 256 characters);
+        CSTL_WARN(A macro can never have more than 256 characters);
 
-    UInt32 offset_diff = lexer->offset - prev_offset;
-    printf("Offset_diff = %d\n", offset_diff);
-
-    char* macro_value = (char*)calloc(macro_length + 1, sizeof(char));
-    substr(macro_value, lexer->buffer->data, prev_offset - 1, offset_diff);
-    CSTL_CHECK_NOT_NULL(macro_value, "macro_value must not be null");
-    lexer_maketoken(lexer, MACRO, macro_value, prev_offset - 1, lineno, colno - 1);
-
-    LEXER_DECREMENT_OFFSET;
+    lexer_maketoken(lexer, MACRO, prev_offset, macro_length);
 }
 
 // Scan a string
@@ -263,431 +457,1015 @@ static inline void lexer_lex_string(Lexer* lexer) {
     // handled by `lexer_lex()`
     CSTL_CHECK_NE(LEXER_CURR_CHAR, '"');
 
-    char ch = lexer_advance(lexer);
-    int str_length = 0; // length of string
+    // The opening quote has already been consumed. The token spans both quotes, but `lexer_token_value()` strips 
+    // them away.
     UInt32 prev_offset = lexer->offset - 1;
-    UInt32 lineno = lexer->lineno;
-    UInt32 colno = lexer->colno;
+    char ch = nullchar;
     lexer->is_inside_str = true;
 
-    while(ch != '"') {
-        if(ch == '\\') {
-            // lexer_lex_esc_char(lexer);
-            ch = lexer_advance(lexer);
-        } else {
-            ch = lexer_advance(lexer);
-        }
-        ++str_length;
+    // Jump straight to the next character that needs a closer look
+    while(true) {
+        lexer_skip_to(lexer, simd_find_byte2(LEXER_CURR_PTR, LEXER_END_PTR, '"', '\\'));
+        ch = lexer_advance(lexer);
+
+        if(ch == '"')
+            break;
+        if(ch == nullchar)
+            lexer_error(lexer, "Unterminated string literal");
+
+        // Skip over whatever is being escaped
+        // lexer_lex_esc_char(lexer);
+        lexer_advance(lexer);
     }
     lexer->is_inside_str = false;
 
     CSTL_CHECK_EQ(ch, '"');
-    UInt32 offset_diff = lexer->offset - prev_offset;
-
-    char* str_value = (char*)calloc(str_length + 1, sizeof(char));
-    // `offset_diff - 1` so as to ignore the closing quote `"`
-    substr(str_value, lexer->buffer->data, prev_offset, offset_diff - 1);
-    CSTL_CHECK_NOT_NULL(str_value, "str_value must not be null");
-    lexer_maketoken(lexer, STRING, str_value, prev_offset - 1, lineno, colno - 1);
+    lexer_maketoken(lexer, STRING, prev_offset, lexer->offset - prev_offset);
 }
 
-// Returns whether `value` is a keyword or an identifier
-static inline TokenKind lexer_is_keyword_or_identifier(char* value) {
-    // Search `tokenHash` for a match for `value`. 
-    // If we can't find one, we assume an identifier
-    for(TokenKind tokenkind = TOK___KEYWORDS_BEGIN + 1; tokenkind < TOK___KEYWORDS_END; tokenkind++)
-        if(strcmp(tokenHash[tokenkind], value) == 0)
-            return tokenkind; // Found a match
-
-    // If we're still here, we haven't found a keyword match
-    return IDENTIFIER;
+// Returns whether `value` (of `length` bytes) is a keyword or an identifier
+static inline TokenKind lexer_is_keyword_or_identifier(const char* value, UInt32 length) {
+    // A single probe into the generated perfect-hash table in <hazel/compiler/keywords.h>.
+    // If it isn't a keyword, we assume an identifier
+    return keyword_lookup(value, length);
 }
 
-// Scan an identifier
-static inline void lexer_lex_identifier(Lexer* lexer) {
-    // When this function is called, we alread know that the first character statisfies the `case ALPHA`.
-    // So, the remaining characters are ALPHA, DIGIT, or `_`
+// Scan an identifier beginning at `tok_offset`
+static inline void lexer_lex_identifier(Lexer* lexer, UInt32 tok_offset) {
+    // When this function is called, we alread know that the first character is a letter or `_` (CSTL_CHAR_LETTER), 
+    // or a (multibyte) XID_Start character. So, the remaining characters are letters, digits, or `_` 
+    // (CSTL_CHAR_IDENTIFIER), or XID_Continue characters.
     // Still, we check it either way to ensure sanity.
-    CSTL_CHECK(isLetter(lexer_prev(lexer)) || isDigit(lexer_prev(lexer)),
+    CSTL_CHECK(isIdentifierChar(lexer->buffer->data[tok_offset]) || (UInt8)lexer->buffer->data[tok_offset] >= 0x80,
                "This message means you've encountered a serious bug within Hazel. Please file an issue on "
                "Hazel's Github repo.\nError: `lexer_lex_identifier()` hasn't been called with a valid identifier character");
-    UInt32 prev_offset = lexer->offset;
-    UInt32 lineno = lexer->lineno;
-    UInt32 colno = lexer->colno;
-    int ident_length = 0; // length of identifier
-    char ch = lexer_advance(lexer);
-
-    while(isLetter(ch) || isDigit(ch)) {
-        ch = lexer_advance(lexer);
-        ++ident_length;
+    UInt32 prev_offset = tok_offset;
+
+    const char* end = simd_skip_identifier(LEXER_CURR_PTR, LEXER_END_PTR);
+    // ASCII stops at the first byte >= 0x80. Non-ASCII characters are rare enough to be decoded one at a time (the 
+    // buffer is NUL-terminated, so `*end` is always safe to read).
+    while((UInt8)*end >= 0x80) {
+        Rune rune;
+        UInt32 length = utf8_decode(end, &rune);
+        if(!unicode_is_xid_continue(rune))
+            break;
+        end = simd_skip_identifier(end + length, LEXER_END_PTR);
     }
+    lexer_skip_to(lexer, end);
 
+    UInt32 ident_length = lexer->offset - prev_offset;
     if(ident_length > MAX_TOKEN_LENGTH)
         CSTL_WARN(An identifier can never have more than 256 characters);
 
-    UInt32 offset_diff = lexer->offset - prev_offset;
+    // Determine if a keyword or just a regular identifier
+    const char* value = lexer->buffer->data + prev_offset;
+    TokenKind tokenkind = lexer_is_keyword_or_identifier(value, ident_length);
+    Token* token = lexer_maketoken(lexer, tokenkind, prev_offset, ident_length);
+    if(tokenkind == IDENTIFIER)
+        token->symbol = lexer_intern(lexer, value, ident_length);
+}
+
+// Scan a lexeme beginning with a multibyte character at `tok_offset` (the buffer is valid UTF-8) - only identifiers 
+// can begin with one. This is kept out of `lexer_lex_next()`, which only ever sees ASCII in most files.
+static void lexer_lex_multibyte(Lexer* lexer, UInt32 tok_offset) {
+    const char* begin = lexer->buffer->data + tok_offset;
+    Rune rune;
+    UInt32 length = utf8_decode(begin, &rune);
+    if(!unicode_is_xid_start(rune)) {
+        lexer->offset = tok_offset;
+        lexer_error(lexer, "Invalid character `%.*s` (U+%04X)", (int)length, begin, rune);
+    }
+    lexer->offset = tok_offset + length;
+    lexer_lex_identifier(lexer, tok_offset);
+}
+
+// Significant decimal digits that always fit in a UInt64
+#define LEXER_MAX_DECIMAL_DIGITS    19
+
+// A decimal number being scanned: its value is `mantissa * 10^exp10`
+typedef struct LexerDecimal {
+    UInt64 mantissa;        // the significant digits (at most LEXER_MAX_DECIMAL_DIGITS of them)
+    Int64 exp10;            // power of 10 the mantissa is scaled by
+    UInt32 ndigits;         // no. of significant digits in `mantissa` (leading zeros don't count)
+    bool truncated;         // were any (non-zero) digits dropped because they didn't fit in `mantissa`?
+} LexerDecimal;
+
+// Scan a run of decimal digits (and `_` separators) at `p` into `num`. Each digit after the decimal point 
+// (`is_fraction`) scales the number down by 10. Returns the first byte past the run.
+static inline const char* lexer_scan_decimal(const char* p, LexerDecimal* num, bool is_fraction) {
+    UInt64 mantissa = num->mantissa;
+    UInt32 ndigits = num->ndigits;
+    Int64 exp10 = num->exp10;
+    while(true) {
+        // 8 digits at a time, as long as they're sure to fit
+        UInt64 chunk = number_load8(p);
+        if(ndigits + 8 <= LEXER_MAX_DECIMAL_DIGITS && number_is_8_digits(chunk)) {
+            mantissa = mantissa * 100000000 + number_parse_8_digits(chunk);
+            if(ndigits == 0) {
+                // Leading zeros aren't significant (the first digit is the least significant byte of `chunk`)
+                UInt64 nonzero = chunk ^ 0x3030303030303030ull;
+                ndigits = nonzero ? 8 - simd_ctz64(nonzero)/8 : 0;
+            } else {
+                ndigits += 8;
+            }
+            exp10 -= is_fraction ? 8 : 0;
+            p += 8;
+            continue;
+        }
 
-    char* ident_value = (char*)calloc(ident_length + 1, sizeof(char));
-    substr(ident_value, lexer->buffer->data, prev_offset - 1, offset_diff);
-    CSTL_CHECK_NOT_NULL(ident_value, "ident_value must not be null");
+        char ch = *p;
+        if(isDigit(ch)) {
+            UInt32 digit = (UInt32)(ch - '0');
+            if(ndigits < LEXER_MAX_DECIMAL_DIGITS) {
+                mantissa = mantissa * 10 + digit;
+                ndigits += (mantissa != 0);
+                exp10 -= is_fraction;
+            } else if(!is_fraction && !num->truncated && exp10 == 0 && mantissa <= (UInt64_MAX - digit) / 10) {
+                // A 20-digit integer may still fit
+                mantissa = mantissa * 10 + digit;
+                ++ndigits;
+            } else {
+                // The digit doesn't fit - it is dropped, but still scales the number
+                num->truncated |= (digit != 0);
+                exp10 += !is_fraction;
+            }
+        } else if(ch != '_') {
+            break;
+        }
+        ++p;
+    }
+    num->mantissa = mantissa;
+    num->ndigits = ndigits;
+    num->exp10 = exp10;
+    return p;
+}
 
-    // Determine if a keyword or just a regular identifier
-    TokenKind tokenkind = lexer_is_keyword_or_identifier(ident_value);
-    lexer_maketoken(lexer, tokenkind, ident_value, prev_offset - 1, lineno, colno - 1);
+// Scan the digits (and `_` separators) of a binary, octal or hexadecimal literal at `p` into `value`. Each digit is 
+// worth `bits` bits. Returns the first byte past the digits.
+static inline const char* lexer_scan_radix(Lexer* lexer, const char* p, UInt32 bits, UInt64* value) {
+    const char* digits = p;
+    UInt64 result = 0;
+    UInt32 ndigits = 0;
+    while(true) {
+        char ch = *p;
+        bool is_digit = bits == 4 ? isHexDigit(ch) : bits == 3 ? isOctalDigit(ch) : isBinaryDigit(ch);
+        if(is_digit) {
+            if(result >> (64 - bits))
+                lexer_error(lexer, "Integer literal is too large (it doesn't fit in 64 bits)");
+            result = (result << bits) | (UInt64)hexDigitToInt(ch);
+            ++ndigits;
+        } else if(ch != '_') {
+            break;
+        }
+        ++p;
+    }
 
-    LEXER_DECREMENT_OFFSET;
+    if(ndigits == 0) {
+        lexer_skip_to(lexer, digits);
+        switch(bits) {
+            case 4: lexer_error(lexer, "Expected hexadecimal digits [0-9A-Fa-f] after `0x`"); break;
+            case 3: lexer_error(lexer, "Expected octal digits [0-7] after `0o`"); break;
+            default: lexer_error(lexer, "Expected binary digit [0-1] after `0b`"); break;
+        }
+    }
+    *value = result;
+    return p;
 }
 
-static inline void lexer_lex_digit(Lexer* lexer) {
-    // 0x... --> Hexadecimal ("0x"|"0X")[0-9A-Fa-f_]+
-    // 0o... --> Octal       ("0o"|"0O")[0-7_]+
-    // 0b... --> Binary      ("0b"|"0B")[01_]+
-    // This cannot be `lexer_advance(lexer)` because we enter here from `lexer_lex()` where we already
-    // know that the first char is a digit value. 
-    // This value needs to be captured as well in `token->value`
-    char ch = lexer_prev(lexer);
-    UInt32 prev_offset = lexer->offset - 1;
-    UInt32 lineno = lexer->lineno;
-    UInt32 colno = lexer->colno - 1;
+// Returns the kind of numeric literal the suffix [suffix, suffix + length) makes, or TOK_ILLEGAL if it isn't one
+static inline TokenKind lexer_number_suffix(const char* suffix, UInt32 length) {
+    #define SUFFIX_IS(s)   (length == sizeof(s) - 1 && memcmp(suffix, s, sizeof(s) - 1) == 0)
+    switch(suffix[0]) {
+        case 'i':
+            if(SUFFIX_IS("i8"))     return INT8_LIT;
+            if(SUFFIX_IS("i16"))    return INT16_LIT;
+            if(SUFFIX_IS("i32"))    return INT32_LIT;
+            if(SUFFIX_IS("i64"))    return INT64_LIT;
+            break;
+        case 'u':
+            if(SUFFIX_IS("u"))      return UINT_LIT;
+            if(SUFFIX_IS("u8"))     return UINT8_LIT;
+            if(SUFFIX_IS("u16"))    return UINT16_LIT;
+            if(SUFFIX_IS("u32"))    return UINT32_LIT;
+            if(SUFFIX_IS("u64"))    return UINT64_LIT;
+            break;
+        case 'f':
+            if(SUFFIX_IS("f32"))    return FLOAT32_LIT;
+            if(SUFFIX_IS("f64"))    return FLOAT64_LIT;
+            if(SUFFIX_IS("f128"))   return FLOAT128_LIT;
+            break;
+        case 'j': case 'J':
+            if(length == 1)         return IMAG;
+            break;
+    }
+    #undef SUFFIX_IS
+    return TOK_ILLEGAL;
+}
+
+// Returns the largest value a literal of kind `kind` can hold. Signed kinds may go one past their maximum, so that 
+// the smallest value (eg. `-128i8`) can be written.
+static inline UInt64 lexer_integer_max(TokenKind kind) {
+    switch(kind) {
+        case INT8_LIT:      return (UInt64)Int8_MAX + 1;
+        case INT16_LIT:     return (UInt64)Int16_MAX + 1;
+        case INT32_LIT:     return (UInt64)Int32_MAX + 1;
+        case INT64_LIT:     return (UInt64)Int64_MAX + 1;
+        case UINT8_LIT:     return UInt8_MAX;
+        case UINT16_LIT:    return UInt16_MAX;
+        case UINT32_LIT:    return UInt32_MAX;
+        default:            return UInt64_MAX;
+    }
+}
+
+// Convert the decimal float [begin, end) to `kind` (TOK_FLOAT, FLOAT*_LIT or IMAG), using the fast path where 
+// possible and the C library otherwise
+static inline Float64 lexer_convert_float(Lexer* lexer, const LexerDecimal* num, const char* begin, const char* end, 
+                                          TokenKind kind) {
+    if(num->mantissa == 0 && !num->truncated)
+        return 0.0;
+
+    if(!num->truncated) {
+        if(kind == FLOAT32_LIT) {
+            Float32 value;
+            if(number_decimal_to_float32(num->mantissa, num->exp10, &value))
+                return (Float64)value;
+        } else {
+            Float64 value;
+            if(number_decimal_to_float64(num->mantissa, num->exp10, &value))
+                return value;
+        }
+    }
+
+    // Slow path: hand the digits (without the separators) over to the C library. An overlong literal is only
+    // warned about (see `lexer_lex_digit()`), so its digits go to scratch memory rather than being cut short.
+    char buffer[MAX_TOKEN_LENGTH + 1];
+    char* digits = buffer;
+    cstlArena* scratch = null;
+    cstlArenaMark mark;
+    if(end - begin > MAX_TOKEN_LENGTH) {
+        scratch = compiler_scratch(null);
+        mark = arena_mark(scratch);
+        digits = (char*)arena_alloc_aligned(scratch, (UInt64)(end - begin) + 1, 1);
+    }
+    UInt64 n = 0;
+    for(const char* p = begin; p < end; p++) {
+        if(*p != '_')
+            digits[n++] = *p;
+    }
+    digits[n] = nullchar;
+
+    Float64 value = kind == FLOAT32_LIT ? (Float64)strtof(digits, null) : strtod(digits, null);
+    if(scratch != null)
+        arena_restore(scratch, mark);
+    if(isinf(value))
+        lexer_error(lexer, "Floating-point literal is out of range");
+    return value;
+}
+
+// Scan a numeric literal that begins at `tok_offset` (with a digit, or with a `.` followed by a digit), converting 
+// it along the way. The value goes into `lexer->literals`.
+// 
+//      Decimal     [0-9][0-9_]* ("." [0-9][0-9_]*)? ([eE] [+-]? [0-9][0-9_]*)?  or  "." [0-9][0-9_]* ...
+//      Hex         ("0x"|"0X") [0-9A-Fa-f_]+
+//      Octal       ("0o"|"0O") [0-7_]+
+//      Binary      ("0b"|"0B") [01_]+
+// 
+// followed by an optional type suffix: i8 i16 i32 i64 u u8 u16 u32 u64 f32 f64 f128, or j (imaginary).
+// Note: Hazel departs from the (error-prone) C-style octals with an initial zero (eg. 0123) - those are decimal.
+static inline void lexer_lex_digit(Lexer* lexer, UInt32 tok_offset) {
+    const char* begin = lexer->buffer->data + tok_offset;
+    const char* p = begin;
+    TokenKind tokenkind = INTEGER;
+    LexerDecimal num = {0, 0, 0, false};
+    UInt64 integer = 0;
+    bool is_float = false;
+
+    // Hex, Octal, or Binary?
+    // NB: The Lexical buffer is padded, so looking a couple of bytes ahead is always safe
+    char prefix = p[0] == '0' ? toLower(p[1]) : nullchar;
+    if(prefix == 'x' || prefix == 'o' || prefix == 'b') {
+        UInt32 bits = prefix == 'x' ? 4 : prefix == 'o' ? 3 : 1;
+        tokenkind = prefix == 'x' ? HEX_INT : prefix == 'o' ? OCT_INT : BIN_INT;
+        p = lexer_scan_radix(lexer, p + 2, bits, &integer);
+    } else {
+        p = lexer_scan_decimal(p, &num, false);
+        // Fractions (a `.` that isn't followed by a digit is a DOT - eg. `1..5` or `x.0.y`)
+        if(*p == '.' && isDigit(p[1])) {
+            p = lexer_scan_decimal(p + 1, &num, true);
+            is_float = true;
+        }
+        // Exponents
+        if(toLower(*p) == 'e') {
+            const char* exp = p + 1;
+            bool negative = *exp == '-';
+            if(*exp == '+' || *exp == '-')
+                ++exp;
+            if(isDigit(*exp)) {
+                Int64 exp10 = 0;
+                for(; isDigit(*exp) || *exp == '_'; exp++) {
+                    // Anything this large overflows (or underflows) anyway - don't let it wrap around
+                    if(*exp != '_' && exp10 < 100000)
+                        exp10 = exp10 * 10 + (*exp - '0');
+                }
+                num.exp10 += negative ? -exp10 : exp10;
+                p = exp;
+                is_float = true;
+            }
+        }
+        if(is_float) {
+            tokenkind = TOK_FLOAT;
+        } else {
+            if(num.exp10 != 0 || num.truncated)
+                lexer_error(lexer, "Integer literal is too large (it doesn't fit in 64 bits)");
+            integer = num.mantissa;
+        }
+    }
+    const char* digits_end = p;
+
+    // Type suffix
+    if(isLetter(*p)) {
+        const char* suffix = p;
+        while(isIdentifierChar(*p))
+            ++p;
+        tokenkind = lexer_number_suffix(suffix, (UInt32)(p - suffix));
+        lexer_skip_to(lexer, suffix);
+        if(tokenkind == TOK_ILLEGAL)
+            lexer_error(lexer, "Invalid suffix `%.*s` on a numeric literal", (int)(p - suffix), suffix);
+        if(is_float && tokenkind != FLOAT32_LIT && tokenkind != FLOAT64_LIT && tokenkind != FLOAT128_LIT && 
+           tokenkind != IMAG)
+            lexer_error(lexer, "Integer suffix `%.*s` on a floating-point literal", (int)(p - suffix), suffix);
+    }
+    lexer_skip_to(lexer, p);
+
+    UInt32 length = (UInt32)(p - begin);
+    if(length > MAX_TOKEN_LENGTH)
+        CSTL_WARN(A number can never have more than 256 characters);
+
+    LiteralValue value;
+    switch(tokenkind) {
+        case TOK_FLOAT: case FLOAT32_LIT: case FLOAT64_LIT: case FLOAT128_LIT: case IMAG:
+            if(is_float)
+                value.real = lexer_convert_float(lexer, &num, begin, digits_end, tokenkind);
+            // An integer with a float (or imaginary) suffix
+            else if(tokenkind == FLOAT32_LIT)
+                value.real = (Float64)(Float32)integer;
+            else
+                value.real = (Float64)integer;
+            break;
+        default:
+            if(integer > lexer_integer_max(tokenkind))
+                lexer_error(lexer, "Integer literal `%.*s` is out of range for its type", (int)length, begin);
+            value.integer = integer;
+            break;
+    }
+
+    lexer_maketoken(lexer, tokenkind, tok_offset, length);
+    if(literal_table_push(&lexer->literals, tok_offset, value))
+        ++lexer->nallocs;
+}
+
+// Scan the next lexeme in the Lexical buffer. At most one token is produced (whitespace, for example, produces none)
+static inline void lexer_lex_next(Lexer* lexer) {
+    // Where the current token begins
+    UInt32 tok_offset = lexer->offset;
+    // `lexer_advance()` returns the current character and moves forward, and `lexer_peek()` returns the current
+    // character (after the advance).
+    // For example, if we start from buff[0], 
+    //      curr = buff[0]
+    //      next = buff[1]
+    char curr = lexer_advance(lexer);
+    char next = lexer_peek(lexer);
     TokenKind tokenkind = TOK_ILLEGAL;
-    int digit_length = 0; // no. of digits in the number
-
-    CSTL_CHECK_TRUE(isDigit(ch));
-    while(isDigit(ch)) {
-        // Hex, Octal, or Binary?
-        if(ch == '0') {
-            ch = lexer_advance(lexer);
-            switch(ch) {
-                // Hex
-                case 'x': case 'X':;
-                    // Skip [xX]
-                    ch = lexer_advance(lexer);
-                    int hexcount = 0;
-                    while(isHexDigit(ch)) {
-                        ++hexcount; 
-                        ch = lexer_advance(lexer);
+
+    // Identifiers, numbers and whitespace make up the bulk of any source file. They're dispatched on a single 
+    // lookup of their character class, leaving the switch below to the punctuation.
+    UInt8 charclass = CSTL_CHAR_CLASS(curr);
+    if(charclass & CSTL_CHAR_LETTER) {
+        lexer_lex_identifier(lexer, tok_offset);
+        return;
+    }
+    if(charclass & CSTL_CHAR_DIGIT) {
+        lexer_lex_digit(lexer, tok_offset);
+        return;
+    }
+    // NB: Whitespace as a token is useless for our case (will this change later?)
+    if(charclass & CSTL_CHAR_BLANK) {
+        // Runs of indentation are skipped in one go
+        if(CSTL_CHAR_IS(next, CSTL_CHAR_BLANK))
+            lexer_skip_to(lexer, simd_skip_blanks(LEXER_CURR_PTR, LEXER_END_PTR));
+        return;
+    }
+
+    switch(curr) {
+        case nullchar: 
+            lexer_maketoken(lexer, TOK_EOF, lexer->offset, 0);
+            lexer->is_eof = true;
+            return;
+        // The `-1` is there to prevent an ILLEGAL token kind from being appended to `lexer->tokenList`
+        case '\n': tokenkind = -1; break;
+        case '"':
+            switch(next) {
+                // Empty String literal 
+                case '"': LEXER_INCREMENT_OFFSET; tokenkind = STRING; break;
+                default: tokenkind = -1; lexer_lex_string(lexer); break;
+            }
+            break;
+        case ';':  tokenkind = SEMICOLON; break;
+        case ',':  tokenkind = COMMA; break;
+        case '\\': tokenkind = BACKSLASH; break;
+        case '[':  tokenkind = LSQUAREBRACK; break;
+        case ']':  tokenkind = RSQUAREBRACK; break;
+        case '{':  lexer->nest_level++; tokenkind = LBRACE; break;
+        case '}':  lexer->nest_level--; tokenkind = RBRACE; break;
+        case '(':  tokenkind = LPAREN; break;
+        case ')':  tokenkind = RPAREN; break;
+        case '=':
+            switch(next) {
+                case '=': LEXER_INCREMENT_OFFSET; tokenkind = EQUALS_EQUALS; break;
+                case '>': LEXER_INCREMENT_OFFSET; tokenkind = EQUALS_ARROW; break;
+                default: tokenkind = EQUALS; break;
+            }
+            break;
+        case '+':
+            switch(next) {
+                // This might be removed at some point. 
+                // '++' serves no purpose since Hazel doesn't (and won't) support pointer arithmetic.
+                case '+': LEXER_INCREMENT_OFFSET; tokenkind = PLUS_PLUS; break;
+                case '=': LEXER_INCREMENT_OFFSET; tokenkind  = PLUS_EQUALS; break;
+                default: tokenkind = PLUS; break;
+            }
+            break;
+        case '-':
+            switch(next) {
+                // This might be removed at some point. 
+                // '--' serves no purpose since Hazel doesn't (and won't) support pointer arithmetic.
+                case '-': LEXER_INCREMENT_OFFSET; tokenkind = MINUS_MINUS; break;
+                case '=': LEXER_INCREMENT_OFFSET; tokenkind = MINUS_EQUALS; break;
+                case '>': LEXER_INCREMENT_OFFSET; tokenkind = RARROW; break;
+                default: tokenkind = MINUS; break;
+            } 
+            break;
+        case '*':
+            switch(next) {
+                case '*': LEXER_INCREMENT_OFFSET; tokenkind = MULT_MULT; break;
+                case '=': LEXER_INCREMENT_OFFSET; tokenkind = MULT_EQUALS; break;
+                default: tokenkind = MULT; break;
+            }
+            break;
+        case '/':
+            switch(next) {
+                // Add tokenkind here? 
+                // (TODO) jasmcaus
+                case '/': tokenkind = -1; lexer_lex_sl_comment(lexer); break;
+                case '*': tokenkind = -1; lexer_lex_ml_comment(lexer); break;
+                case '=': LEXER_INCREMENT_OFFSET; tokenkind = SLASH_EQUALS; break;
+                default: tokenkind = SLASH; break;
+            }
+            break;
+        case '#': 
+            // Ignore shebang on the first line
+            if(tok_offset == 0 && next == '!' && lexer_peekn(lexer, 1) == '/') {
+                tokenkind = -1;
+                // Skip till end of line
+                lexer_skip_to(lexer, simd_find_byte(LEXER_CURR_PTR, LEXER_END_PTR, '\n'));
+            }
+            // Comment
+            else {
+                tokenkind = -1;
+                lexer_lex_sl_comment(lexer);
+            }
+            break;
+        case '!':
+            switch(next) {
+                case '=': LEXER_INCREMENT_OFFSET; tokenkind = EXCLAMATION_EQUALS; break;
+                default: tokenkind = MINUS_MINUS; break;
+            }
+            break;
+        case '%':
+            switch(next) {
+                case '%': LEXER_INCREMENT_OFFSET; tokenkind = MOD_MOD; break;
+                case '=': LEXER_INCREMENT_OFFSET; tokenkind = MOD_EQUALS; break;
+                default: tokenkind = MOD; break;
+            }
+            break;
+        case '&':
+            switch(next) {
+                case '&': LEXER_INCREMENT_OFFSET; tokenkind = AND_AND; break;
+                case '^': LEXER_INCREMENT_OFFSET; tokenkind = AND_NOT; break;
+                case '=': LEXER_INCREMENT_OFFSET; tokenkind = AND_EQUALS; break;
+                default: tokenkind = AND; break;
+            }
+            break;
+        case '|':
+            switch(next) {
+                case '|': LEXER_INCREMENT_OFFSET; tokenkind = OR_OR; break;
+                case '=': LEXER_INCREMENT_OFFSET; tokenkind = OR_EQUALS; break;
+                default: tokenkind = OR; break;
+            }
+            break;
+        case '^':
+            switch(next) {
+                case '=': LEXER_INCREMENT_OFFSET; tokenkind = XOR_EQUALS; break;
+                default: tokenkind = XOR; break;
+            }
+            break;
+        case '<':
+            switch(next) {
+                case '=': LEXER_INCREMENT_OFFSET; tokenkind = LESS_THAN_OR_EQUAL_TO; break;
+                case '-': LEXER_INCREMENT_OFFSET; tokenkind = LARROW; break;
+                case '<': 
+                    LEXER_INCREMENT_OFFSET;
+                    char c = lexer_peek(lexer);
+                    if(c == '=') {
+                        LEXER_INCREMENT_OFFSET; tokenkind = LBITSHIFT_EQUALS;
+                    } else {
+                        tokenkind = LBITSHIFT;
                     }
-                    if(hexcount == 0)
-                        lexer_error(lexer, "Expected hexadecimal digits [0-9A-Fa-f] after `0x`");
-                    
-                    tokenkind = HEX_INT;
-                    digit_length = hexcount + 1; // Account for the '0'
                     break;
-                // Binary
-                case 'b': case 'B':
-                    // Skip [bB]
-                    ch = lexer_advance(lexer);
-                    int bincount = 0;
-                    while(isBinaryDigit(ch)) {
-                        ++bincount; 
-                        ch = lexer_advance(lexer);
+                default: tokenkind = LESS_THAN; break;
+            }
+            break;
+        case '>':
+            switch(next) {
+                case '=': LEXER_INCREMENT_OFFSET; tokenkind = GREATER_THAN_OR_EQUAL_TO; break;
+                case '>': 
+                    LEXER_INCREMENT_OFFSET;
+                    char c = lexer_peek(lexer);
+                    if(c == '=') {
+                        LEXER_INCREMENT_OFFSET; tokenkind = RBITSHIFT_EQUALS;
+                    } else {
+                        tokenkind = RBITSHIFT;
                     }
-                    if(bincount == 0)
-                        lexer_error(lexer, "Expected binary digit [0-1] after `0b`");
-                    
-                    tokenkind = BIN_INT;
-                    digit_length = bincount + 1; // Account for the '0'
                     break;
-                // Octal
-                // Depart from the (error-prone) C-style octals with an inital zero e.g 0123
-                // Instead, we support the `0o` or `0O` prefix, like 0o123
-                case 'o': case 'O':
-                    // Skip [oO]
-                    ch = lexer_advance(lexer);
-                    int octcount = 0;
-                    while(isOctalDigit(ch)) {
-                        ++octcount; 
-                        ch = lexer_advance(lexer);
+                default: tokenkind = GREATER_THAN; break;
+            }
+            break;
+        case '~':
+            switch(next) {
+                case '=': LEXER_INCREMENT_OFFSET; tokenkind = TILDA_EQUALS; break;
+                default: tokenkind = TILDA; break;
+            }
+            break;
+        case '.':
+            switch(next) {
+                case '.': 
+                    LEXER_INCREMENT_OFFSET;
+                    char c = lexer_peek(lexer);
+                    if(c == '.') {
+                        LEXER_INCREMENT_OFFSET; tokenkind = ELLIPSIS;
+                    } else {
+                        tokenkind = DDOT;
                     }
-                    if(octcount == 0)
-                        lexer_error(lexer, "Expected octal digits [0-7] after `0o`");
-                    
-                    tokenkind = OCT_INT;
-                    digit_length = octcount + 1; // Account for the '0'
                     break;
-                case ALPHA_EXCEPT_B_O_X:
-                    // Error
-                    lexer_error(lexer, "Invalid character `%c`. Hazel currently supports [xXbBoO] after `0`", ch);
+                default: 
+                    // Fractions are possible here:
+                    // Eg: `.0192` or `.9983838`
+                    if(isDigit(next)) {
+                        tokenkind = -1; 
+                        lexer_lex_digit(lexer, tok_offset);
+                    } else {
+                        tokenkind = DOT; 
+                    }
                     break;
-                default:
-                    // An integer?
-                    // lexer_error(lexer, "Cannot have an integer beginning with `0`");     
-                    break;               
-            } // switch(ch)
-        }
-        // Fractions, or Integer?
-        else {
-            // Normal Floats
-            if(ch == '.' || ch == '_')
-                ch = lexer_advance(lexer);
-            
-            // Exponents (Float)
-            else if(ch == 'e' || ch == 'E') {
-                // Skip over [eE]
-                ch = lexer_advance(lexer);
-                if(ch == '+' || ch == '-') { 
-                    ch = lexer_advance(lexer);
-                } else {
-                    lexer_error(lexer, "Expected [+-] after exponent `e`. Got `%c`", ch);
-                }
-                
-                int exp_digits = 0;
-                while(isDigit(ch)) {
-                    ch = lexer_advance(lexer);
-                    ++exp_digits;
-                }
-                if(exp_digits == 0)
-                    lexer_error(lexer, "Invalid character after exponent `e`. Expected a digit, got `%c`", ch);
-                
-                // (TODO) Verify this is correct
-                digit_length = exp_digits + 1; // Account for the prev digit
             }
-            // Imaginary
-            else if(ch == 'j' || ch == 'J') {
-                // digit_length = imag_count;
+            break;
+        case ':':
+            switch(next) {
+                case ':': LEXER_INCREMENT_OFFSET; tokenkind = COLON_COLON; break;
+                default: tokenkind = COLON; break;
             }
-        }
-        // ch = lexer_advance(lexer);
-    }
+            break;
+        case '?': tokenkind = QUESTION; break;
+        case '@': tokenkind = -1; lexer_lex_macro(lexer); break;
+        case '\'': tokenkind = -1; lexer_lex_char(lexer); break;
+        default:
+            if((UInt8)curr >= 0x80) {
+                tokenkind = -1;
+                lexer_lex_multibyte(lexer, tok_offset);
+                break;
+            }
+            lexer_error(lexer, "Invalid character `%c`", curr);
+            break;
+    } // switch(ch)
 
-    CSTL_CHECK(tokenkind != TOK_ILLEGAL);
+    if(tokenkind == -1) return;
+    lexer_maketoken(lexer, tokenkind, tok_offset, lexer->offset - tok_offset);
+}
 
-    UInt32 offset_diff = lexer->offset - prev_offset;
-    CSTL_CHECK_NE(offset_diff, 0);
+// Check that the whole Lexical buffer is valid UTF-8 (see lexer.h)
+static void lexer_validate_utf8(Lexer* lexer) {
+    const char* data = lexer->buffer->data;
+    const char* end = data + lexer->buffer->length;
+    const char* invalid = utf8_validate(data, end);
+    if(invalid != end) {
+        lexer->offset = (UInt32)(invalid - data);
+        lexer_error(lexer, "Invalid UTF-8 (byte `0x%02X`)", (UInt8)*invalid);
+    }
+    lexer->is_validated = true;
+}
 
-    if(digit_length > MAX_TOKEN_LENGTH)
-        CSTL_WARN(A number can never have more than 256 characters);
+// Scan ahead until the token window is full (or we've hit the end of the buffer)
+static void lexer_fill_window(Lexer* lexer) {
+    if(!lexer->is_validated)
+        lexer_validate_utf8(lexer);
 
-    // digit_length can be 0 and we can still have a number. Reasoning is as follows:
-    // This function is guaranteed to be called when there's at least one "number-like". We simply check if
-    // there are more digits to lex.
-    // If digit_length = 0, this means that there's only one digit in the number (eg. 0, 2, 9)
-    char* digit_value = (char*)calloc(digit_length + 1, sizeof(char));
-    substr(digit_value, lexer->buffer->data, prev_offset, offset_diff - 1);
-    CSTL_CHECK_NOT_NULL(digit_value, "digit_value must not be null");
+    LexerWindow* window = &lexer->window;
+    // Every call to `lexer_lex_next()` produces at most one token
+    while(!lexer->is_eof && window->tail - window->head < LEXER_WINDOW_SIZE)
+        lexer_lex_next(lexer);
+}
 
-    lexer_maketoken(lexer, tokenkind, digit_value, prev_offset, lineno, colno);
+// Returns the next token in the Lexical buffer, scanning more of the buffer only when the token window runs dry.
+// Once the end of the buffer is reached, TOK_EOF is returned on every call.
+Token lexer_next_token(Lexer* lexer) {
+    LexerWindow* window = &lexer->window;
+    if(window->head == window->tail) {
+        lexer_fill_window(lexer);
+        // TOK_EOF has already been handed out
+        if(window->head == window->tail)
+            return lexer->eof_token;
+    }
+    return window->tokens[window->head++ & (LEXER_WINDOW_SIZE - 1)];
+}
 
-    LEXER_DECREMENT_OFFSET;
+// Returns the `n`th token after the next one (`lexer_peek_token(lexer, 0)` is what `lexer_next_token()` would return)
+// without consuming anything. `n` must be less than LEXER_WINDOW_SIZE.
+Token lexer_peek_token(Lexer* lexer, UInt32 n) {
+    CSTL_CHECK_LT(n, LEXER_WINDOW_SIZE);
+    LexerWindow* window = &lexer->window;
+    if(window->tail - window->head <= n) {
+        // Scan further ahead (into the slots freed up by consumed tokens)
+        lexer_fill_window(lexer);
+        if(window->tail - window->head <= n)
+            return lexer->eof_token;
+    }
+    return window->tokens[(window->head + n) & (LEXER_WINDOW_SIZE - 1)];
 }
 
-// Lex the Source files
+// Lex the entire Source file into `lexer->tokenList`
 static void lexer_lex(Lexer* lexer) {
-    // Some UTF8 text may start with a 3-byte 'BOM' marker sequence. If it exists, skip over them because they 
-    // are useless bytes. Generally, it is not recommended to add BOM markers to UTF8 texts, but it's not 
-    // uncommon (especially on Windows).
-    if(lexer->buffer->data[0] == (char)0xef && lexer->buffer->data[1] == (char)0xbb && lexer->buffer->data[2] == (char)0xbf)
-        lexer_advancen(lexer, 3);
+    profiler_begin(PROFILER_LEX, lexer->fname);
+    LexerWindow* window = &lexer->window;
+    while(true) {
+        lexer_fill_window(lexer);
+        if(window->head == window->tail)
+            break;
+
+        // Move the whole window over in one go
+        while(window->head != window->tail) {
+            Token* token = &window->tokens[window->head++ & (LEXER_WINDOW_SIZE - 1)];
+            lexer_tokenlist_push(lexer, token->kind, token->offset, token->length, token->symbol);
+        }
+    }
+    profiler_end();
+}
 
-    char next = nullchar;
-    char curr = nullchar;
-    TokenKind tokenkind = TOK_ILLEGAL;
+// Lex the entire Source file into `lexer->tokenList`, or load its tokens from `directory` (see lexer.h)
+bool lexer_lex_cached(Lexer* lexer, const char* directory) {
+    CSTL_CHECK(lexer->ntokens == 0, "`lexer_lex_cached()` must be called on a fresh Lexer");
+
+    UInt32 length = (UInt32)lexer->buffer->length;
+    UInt64 hash = token_cache_hash(lexer->buffer->data, length);
+    char path[4096];
+    if(!token_cache_path(path, sizeof(path), directory, hash)) {
+        lexer_lex(lexer);
+        return false;
+    }
 
+    TokenCacheData data = { &lexer->tokenList, &lexer->literals, &lexer->comments, lexer->interner };
+    profiler_begin("token cache load", lexer->fname);
+    bool loaded = token_cache_load(path, hash, length, &data);
+    profiler_end();
+    if(loaded) {
+        // As if `lexer_lex()` had run to the end of the buffer (the cache was only ever saved for a valid one)
+        lexer->offset = length;
+        lexer->is_eof = true;
+        lexer->is_validated = true;
+        lexer->ntokens = lexer->tokenList.size;
+        return true;
+    }
+
+    lexer_lex(lexer);
+    // Best effort: failing to write the cache (a read-only directory, say) only costs the next build some time
+    PROFILER_SCOPE("token cache save", lexer->fname)
+        token_cache_save(path, hash, length, &data);
+    return false;
+}
+
+// Returns the no. of tokens at the start of `stream` that end at least LEXER_RELEX_LOOKAHEAD bytes before `offset`
+static UInt32 lexer_relex_restart(const TokenStream* stream, UInt32 offset) {
+    // Tokens never overlap, so their ends only ever increase
+    UInt32 lo = 0;
+    UInt32 hi = stream->size;
+    while(lo < hi) {
+        UInt32 mid = lo + (hi - lo)/2;
+        if((UInt64)TOKEN_OFFSET(stream, mid) + TOKEN_LENGTH(stream, mid) + LEXER_RELEX_LOOKAHEAD <= offset)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+// Check that the `length` bytes just spliced in at `offset` left the Lexical buffer valid UTF-8. The rest of it was 
+// valid before, so only the new bytes and the characters on either side of them need a look.
+static void lexer_validate_edit(Lexer* lexer, UInt32 offset, UInt32 length) {
+    const char* data = lexer->buffer->data;
+    UInt32 size = (UInt32)lexer->buffer->length;
+    // From the beginning of the character before the edit...
+    UInt32 from = offset;
+    if(from > 0) {
+        --from;
+        for(UInt32 i = 0; i < 3 && from > 0 && UTF8_IS_CONTINUATION(data[from]); i++)
+            --from;
+    }
+    // ... to the end of the character the edit ends in
+    UInt32 to = offset + length;
+    for(UInt32 i = 0; i < 3 && to < size && UTF8_IS_CONTINUATION(data[to]); i++)
+        ++to;
+
+    const char* invalid = utf8_validate(data + from, data + to);
+    if(invalid != data + to) {
+        lexer->offset = (UInt32)(invalid - data);
+        lexer_error(lexer, "Invalid UTF-8 (byte `0x%02X`)", (UInt8)*invalid);
+    }
+}
+
+// Apply an edit to the Lexical buffer and re-lex the tokens around it (see lexer.h)
+LexerSplice lexer_relex(Lexer* lexer, UInt32 offset, UInt32 removed, const char* inserted, UInt32 inserted_length) {
+    TokenStream* tokens = &lexer->tokenList;
+    CSTL_CHECK(tokens->size > 0 && TOKEN_KIND(tokens, tokens->size - 1) == TOK_EOF, 
+               "`lexer_relex()` needs the tokens of the whole buffer (see `lexer_lex()`)");
+    CSTL_CHECK_LE((UInt64)offset + removed, lexer->buffer->length);
+
+    buff_splice((cstlBuffer*)lexer->buffer, offset, removed, inserted, inserted_length);
+    line_index_free(&lexer->lines);
+    lexer_validate_edit(lexer, offset, inserted_length);
+    lexer->eof_token.offset = (UInt32)lexer->buffer->length;
+
+    // How far the tokens after the edit move
+    Int64 shift = (Int64)inserted_length - (Int64)removed;
+    // Where the edit ends (before it was applied). Old tokens that begin here or later are still around.
+    UInt32 edit_end = offset + removed;
+
+    // Restart from the end of the last token the edit could not have affected
+    UInt32 first = lexer_relex_restart(tokens, offset);
+    if(first == 0)
+        lexer->offset = lexer_start_offset(lexer);
+    else
+        lexer->offset = TOKEN_OFFSET(tokens, first - 1) + TOKEN_LENGTH(tokens, first - 1);
+    lexer->is_eof = false;
+    lexer->window.head = lexer->window.tail = 0;
+    lexer->ntokens = first;
+
+    TokenStream* relexed = &lexer->relexed;
+    if(relexed->capacity == 0)
+        token_stream_init(relexed, lexer->fname, LEXER_WINDOW_SIZE);
+    relexed->size = 0;
+    // The values of the re-lexed literals (and the re-lexed comments) are collected on their own, and spliced in 
+    // along with the tokens
+    UInt32 restart = lexer->offset;
+    LiteralTable literals = lexer->literals;
+    LiteralTable relexed_literals = {0};
+    lexer->literals = relexed_literals;
+    CommentTable comments = lexer->comments;
+    CommentTable relexed_comments = {0};
+    lexer->comments = relexed_comments;
+
+    // Re-lex until a new token lines up with an old one (moved by `shift`) - the rest of the buffer is unchanged, so 
+    // lexing on from there would only produce the old tokens all over again
+    LexerWindow* window = &lexer->window;
+    UInt32 synced = first;
     while(true) {
-        // `lexer_advance()` returns the current character and moves forward, and `lexer_peek()` returns the current
-        // character (after the advance).
-        // For example, if we start from buff[0], 
-        //      curr = buff[0]
-        //      next = buff[1]
-        curr = lexer_advance(lexer);
-        next = lexer_peek(lexer);
-
-        tokenkind = TOK_ILLEGAL;
-
-        switch(curr) {
-            case nullchar: goto lex_eof;
-            // The `-1` is there to prevent an ILLEGAL token kind from being appended to `lexer->tokenList`
-            // NB: Whitespace as a token is useless for our case (will this change later?)
-            case WHITESPACE_NO_NEWLINE: tokenkind = -1; break;
-            case '\n':
-                LEXER_INCREMENT_LINENO;
-                LEXER_RESET_COLNO;
-                tokenkind = -1;
-                break;
-            // Identifier
-            case ALPHA: case '_': tokenkind = -1; lexer_lex_identifier(lexer); break;
-            case DIGIT: tokenkind = -1; lexer_lex_digit(lexer); break;
-            case '"':
-                switch(next) {
-                    // Empty String literal 
-                    case '"': LEXER_INCREMENT_OFFSET; lexer_maketoken(lexer, STRING, "\"\"", lexer->offset - 1, 
-                                                                      lexer->lineno, lexer->colno - 1); 
-                              break;
-                    default: tokenkind = -1; lexer_lex_string(lexer); break;
-                }
-                break;
-            case ';':  tokenkind = SEMICOLON; break;
-            case ',':  tokenkind = COMMA; break;
-            case '\\': tokenkind = BACKSLASH; break;
-            case '[':  tokenkind = LSQUAREBRACK; break;
-            case ']':  tokenkind = RSQUAREBRACK; break;
-            case '{':  lexer->nest_level++; tokenkind = LBRACE; break;
-            case '}':  lexer->nest_level--; tokenkind = RBRACE; break;
-            case '(':  tokenkind = LPAREN; break;
-            case ')':  tokenkind = RPAREN; break;
-            case '=':
-                switch(next) {
-                    case '=': LEXER_INCREMENT_OFFSET; tokenkind = EQUALS_EQUALS; break;
-                    case '>': LEXER_INCREMENT_OFFSET; tokenkind = EQUALS_ARROW; break;
-                    default: tokenkind = EQUALS; break;
-                }
-                break;
-            case '+':
-                switch(next) {
-                    // This might be removed at some point. 
-                    // '++' serves no purpose since Hazel doesn't (and won't) support pointer arithmetic.
-                    case '+': LEXER_INCREMENT_OFFSET; tokenkind = PLUS_PLUS; break;
-                    case '=': LEXER_INCREMENT_OFFSET; tokenkind  = PLUS_EQUALS; break;
-                    default: tokenkind = PLUS; break;
-                }
-                break;
-            case '-':
-                switch(next) {
-                    // This might be removed at some point. 
-                    // '--' serves no purpose since Hazel doesn't (and won't) support pointer arithmetic.
-                    case '-': LEXER_INCREMENT_OFFSET; tokenkind = MINUS_MINUS; break;
-                    case '=': LEXER_INCREMENT_OFFSET; tokenkind = MINUS_EQUALS; break;
-                    case '>': LEXER_INCREMENT_OFFSET; tokenkind = RARROW; break;
-                    default: tokenkind = MINUS; break;
-                } 
-                break;
-            case '*':
-                switch(next) {
-                    case '*': LEXER_INCREMENT_OFFSET; tokenkind = MULT_MULT; break;
-                    case '=': LEXER_INCREMENT_OFFSET; tokenkind = MULT_EQUALS; break;
-                    default: tokenkind = MULT; break;
-                }
-                break;
-            case '/':
-                switch(next) {
-                    // Add tokenkind here? 
-                    // (TODO) jasmcaus
-                    case '/': tokenkind = -1; lexer_lex_sl_comment(lexer); break;
-                    case '*': tokenkind = -1; lexer_lex_ml_comment(lexer); break;
-                    case '=': LEXER_INCREMENT_OFFSET; tokenkind = SLASH_EQUALS; break;
-                    default: tokenkind = SLASH; break;
-                }
-                break;
-            case '#': 
-                // Ignore shebang on the first line
-                if(lexer->lineno == 1 && next == '!' && lexer_peekn(lexer, 1) == '/') {
-                    tokenkind = -1;
-                    // Skip till end of line
-                    while(LEXER_CURR_CHAR && (LEXER_CURR_CHAR != '\n' || LEXER_CURR_CHAR != nullchar))
-                        curr = lexer_advance(lexer);
-                }
-                // Comment
-                else {
-                    tokenkind = -1;
-                    lexer_lex_sl_comment(lexer);
-                }
-                break;
-            case '!':
-                switch(next) {
-                    case '=': LEXER_INCREMENT_OFFSET; tokenkind = EXCLAMATION_EQUALS; break;
-                    default: tokenkind = MINUS_MINUS; break;
-                }
-                break;
-            case '%':
-                switch(next) {
-                    case '%': LEXER_INCREMENT_OFFSET; tokenkind = MOD_MOD; break;
-                    case '=': LEXER_INCREMENT_OFFSET; tokenkind = MOD_EQUALS; break;
-                    default: tokenkind = MOD; break;
-                }
-                break;
-            case '&':
-                switch(next) {
-                    case '&': LEXER_INCREMENT_OFFSET; tokenkind = AND_AND; break;
-                    case '^': LEXER_INCREMENT_OFFSET; tokenkind = AND_NOT; break;
-                    case '=': LEXER_INCREMENT_OFFSET; tokenkind = AND_EQUALS; break;
-                    default: tokenkind = AND; break;
-                }
-                break;
-            case '|':
-                switch(next) {
-                    case '|': LEXER_INCREMENT_OFFSET; tokenkind = OR_OR; break;
-                    case '=': LEXER_INCREMENT_OFFSET; tokenkind = OR_EQUALS; break;
-                    default: tokenkind = OR; break;
-                }
-                break;
-            case '^':
-                switch(next) {
-                    case '=': LEXER_INCREMENT_OFFSET; tokenkind = XOR_EQUALS; break;
-                    default: tokenkind = XOR; break;
-                }
-                break;
-            case '<':
-                switch(next) {
-                    case '=': LEXER_INCREMENT_OFFSET; tokenkind = LESS_THAN_OR_EQUAL_TO; break;
-                    case '-': LEXER_INCREMENT_OFFSET; tokenkind = LARROW; break;
-                    case '<': 
-                        LEXER_INCREMENT_OFFSET;
-                        char c = lexer_peek(lexer);
-                        if(c == '=') {
-                            LEXER_INCREMENT_OFFSET; tokenkind = LBITSHIFT_EQUALS;
-                        } else {
-                            tokenkind = LBITSHIFT;
-                        }
-                        break;
-                    default: tokenkind = LESS_THAN; break;
-                }
-                break;
-            case '>':
-                switch(next) {
-                    case '=': LEXER_INCREMENT_OFFSET; tokenkind = GREATER_THAN_OR_EQUAL_TO; break;
-                    case '>': 
-                        LEXER_INCREMENT_OFFSET;
-                        char c = lexer_peek(lexer);
-                        if(c == '=') {
-                            LEXER_INCREMENT_OFFSET; tokenkind = RBITSHIFT_EQUALS;
-                        } else {
-                            tokenkind = RBITSHIFT;
-                        }
-                        break;
-                    default: tokenkind = GREATER_THAN; break;
-                }
-                break;
-            case '~':
-                switch(next) {
-                    case '=': LEXER_INCREMENT_OFFSET; tokenkind = TILDA_EQUALS; break;
-                    default: tokenkind = TILDA; break;
-                }
-                break;
-            case '.':
-                switch(next) {
-                    case '.': 
-                        LEXER_INCREMENT_OFFSET;
-                        char c = lexer_peek(lexer);
-                        if(c == '.') {
-                            LEXER_INCREMENT_OFFSET; tokenkind = ELLIPSIS;
-                        } else {
-                            tokenkind = DDOT;
-                        }
+        lexer_lex_next(lexer);
+        if(window->head == window->tail)
+            continue;
+        Token* token = &window->tokens[window->head++ & (LEXER_WINDOW_SIZE - 1)];
+
+        // Skip over the old tokens that overlap the edit, or that the new tokens have moved past. The old TOK_EOF
+        // (moved) is at the very end of the buffer, so this never runs off the end of `tokens`.
+        while(TOKEN_OFFSET(tokens, synced) < edit_end || 
+              (Int64)TOKEN_OFFSET(tokens, synced) + shift < (Int64)token->offset)
+            ++synced;
+
+        if((Int64)TOKEN_OFFSET(tokens, synced) + shift == (Int64)token->offset &&
+           TOKEN_KIND(tokens, synced) == token->kind && TOKEN_LENGTH(tokens, synced) == token->length) {
+            // The old token (and its value) is kept
+            if(lexer->literals.size && lexer->literals.offsets[lexer->literals.size - 1] == token->offset)
+                --lexer->literals.size;
+            break;
+        }
+
+        token_stream_push(relexed, token->kind, token->offset, token->length, token->symbol);
+        // Stopped short of the end of the buffer (at a NUL byte) - nothing after this is a token anymore
+        if(token->kind == TOK_EOF) {
+            synced = tokens->size;
+            break;
+        }
+    }
+
+    LexerSplice splice;
+    splice.first = first;
+    splice.nremoved = synced - first;
+    splice.ninserted = relexed->size;
+    // Old literals and comments from `restart` up to the (old) token we synced on are replaced
+    UInt32 restart_end = synced < tokens->size ? TOKEN_OFFSET(tokens, synced) : UInt32_MAX;
+    relexed_literals = lexer->literals;
+    lexer->literals = literals;
+    literal_table_splice(&lexer->literals, restart, restart_end, &relexed_literals, shift);
+    literal_table_free(&relexed_literals);
+    relexed_comments = lexer->comments;
+    lexer->comments = comments;
+    comment_table_splice(&lexer->comments, restart, restart_end, &relexed_comments, shift, 
+                         (Int64)splice.ninserted - (Int64)splice.nremoved);
+    comment_table_free(&relexed_comments);
+    token_stream_splice(tokens, first, splice.nremoved, relexed, shift);
+    lexer->ntokens = tokens->size;
+
+    // Leave the Lexer where `lexer_lex()` would have (on the TOK_EOF)
+    lexer->offset = TOKEN_OFFSET(tokens, tokens->size - 1);
+    lexer->is_eof = true;
+    window->head = window->tail = 0;
+    return splice;
+}
+
+// Move whatever is in the token window over to `stream`
+static inline void lexer_drain_window(Lexer* lexer, TokenStream* stream) {
+    LexerWindow* window = &lexer->window;
+    while(window->head != window->tail) {
+        Token* token = &window->tokens[window->head++ & (LEXER_WINDOW_SIZE - 1)];
+        token_stream_push(stream, token->kind, token->offset, token->length, token->symbol);
+    }
+}
+
+// Lex every lexeme that begins in `chunk` into `chunk->tokens` (runs on its own thread)
+static void* lexer_lex_chunk(void* arg) {
+    LexerChunk* chunk = (LexerChunk*)arg;
+    Lexer* lexer = chunk->lexer;
+    jmp_buf recover;
+
+    lexer->recover = &recover;
+    profiler_begin("lex chunk", lexer->fname);
+    if(setjmp(recover) == 0) {
+        while(!lexer->is_eof && lexer->offset < chunk->end) {
+            lexer_lex_next(lexer);
+            lexer_drain_window(lexer, &chunk->tokens);
+        }
+        chunk->resume = lexer->offset;
+    } else {
+        chunk->failed = true;
+    }
+    profiler_end();
+    lexer->recover = null;
+    return null;
+}
+
+// Lex the entire Source file into `lexer->tokenList`, using `nthreads` threads
+static void lexer_lex_parallel(Lexer* lexer, UInt32 nthreads) {
+    const char* data = lexer->buffer->data;
+    UInt32 length = (UInt32)lexer->buffer->length;
+    UInt32 begin = lexer->offset;
+
+    if(nthreads == 0) {
+        nthreads = thread_hardware_concurrency();
+        nthreads = CSTL_MIN(nthreads, (length - begin) / LEXER_PARALLEL_MIN_CHUNK_SIZE);
+    }
+    if(nthreads <= 1 || length - begin < nthreads) {
+        lexer_lex(lexer);
+        return;
+    }
+    profiler_begin(PROFILER_LEX, lexer->fname);
+    // Up front, so that no chunk has to (chunks begin after a newline, so they never split a character)
+    if(!lexer->is_validated)
+        lexer_validate_utf8(lexer);
+
+    // Split the buffer at the first newline after every `1/nthreads`th of it
+    LexerChunk* chunks = (LexerChunk*)CSTL_ALLOC_ZEROED(lexer->allocator, (UInt64)nthreads * sizeof(LexerChunk));
+    CSTL_CHECK_NOT_NULL(chunks, "Could not allocate memory. Memory full.");
+    UInt32 nchunks = 0;
+    UInt32 start = begin;
+    for(UInt32 i = 1; i <= nthreads && start < length; i++) {
+        UInt32 end = length + 1; // The last chunk goes on to lex TOK_EOF
+        if(i < nthreads) {
+            UInt32 target = begin + (UInt32)((UInt64)(length - begin) * i / nthreads);
+            if(target > start) {
+                const char* newline = simd_find_byte(data + target, data + length, '\n');
+                if(newline + 1 < data + length)
+                    end = (UInt32)(newline + 1 - data);
+            } else {
+                continue;
+            }
+        }
+
+        LexerChunk* chunk = &chunks[nchunks++];
+        chunk->start = start;
+        chunk->end = end;
+        chunk->lexer = (Lexer*)CSTL_ALLOC_ZEROED(lexer->allocator, sizeof(Lexer));
+        CSTL_CHECK_NOT_NULL(chunk->lexer, "Could not allocate memory. Memory full.");
+        chunk->lexer->allocator = lexer->allocator;
+        arena_init(&chunk->lexer->arena, lexer->allocator, LEXER_ARENA_CHUNK_SIZE);
+        chunk->lexer->buffer = lexer->buffer;
+        chunk->lexer->fname = lexer->fname;
+        chunk->lexer->offset = start;
+        chunk->lexer->eof_token = lexer->eof_token;
+        chunk->lexer->interner = lexer->interner;
+        chunk->lexer->is_validated = true;
+        // Roughly one token every 4 bytes
+        token_stream_init(&chunk->tokens, lexer->fname, (CSTL_MIN(end, length) - start) / 4 + 16);
+
+        start = end;
+    }
+
+    // The first chunk is lexed on this thread
+    for(UInt32 i = 1; i < nchunks; i++) {
+        chunks[i].started = thread_create(&chunks[i].thread, lexer_lex_chunk, &chunks[i]);
+        if(!chunks[i].started)
+            lexer_lex_chunk(&chunks[i]);
+    }
+    lexer_lex_chunk(&chunks[0]);
+    // Only threads that actually started can be joined (the handle of one that didn't is garbage)
+    for(UInt32 i = 1; i < nchunks; i++) 
+        if(chunks[i].started)
+            thread_join(&chunks[i].thread);
+
+    // Stitch the chunks together. 
+    // `offset` is where the (serial) Lexer would begin its next lexeme - as long as that is where a chunk began, 
+    // the chunk's tokens can be used as they are. Otherwise (a string or comment ran over into the chunk, or the 
+    // speculative lex failed), we lex from `offset` ourselves until one of our tokens shows up in the chunk. 
+    TokenStream* out = &lexer->tokenList;
+    UInt32 offset = begin;
+    for(UInt32 i = 0; i < nchunks; i++) {
+        LexerChunk* chunk = &chunks[i];
+        TokenStream* tokens = &chunk->tokens;
+        UInt32 synced_at = 0;
+        bool synced = !chunk->failed && offset == chunk->start;
+        // The chunk's comments from here on are the right ones
+        UInt32 comments_from = chunk->start;
+
+        if(!synced) {
+            lexer->offset = offset;
+            lexer->ntokens = out->size;
+            while(!lexer->is_eof && lexer->offset < chunk->end) {
+                lexer_lex_next(lexer);
+                LexerWindow* window = &lexer->window;
+                if(window->head == window->tail)
+                    continue;
+
+                Token* token = &window->tokens[window->head & (LEXER_WINDOW_SIZE - 1)];
+                if(!chunk->failed) {
+                    while(synced_at < tokens->size && TOKEN_OFFSET(tokens, synced_at) < token->offset)
+                        ++synced_at;
+                    // Lexing is deterministic from the start of a token - everything from here on is the same
+                    if(synced_at < tokens->size && 
+                       TOKEN_OFFSET(tokens, synced_at) == token->offset && 
+                       TOKEN_KIND(tokens, synced_at) == token->kind && 
+                       TOKEN_LENGTH(tokens, synced_at) == token->length) {
+                        window->head = window->tail;
+                        // The chunk has the value of this token, too
+                        LiteralTable* literals = &lexer->literals;
+                        if(literals->size && literals->offsets[literals->size - 1] == token->offset)
+                            --literals->size;
+                        comments_from = token->offset;
+                        synced = true;
                         break;
-                    // Fractions are possible here:
-                    // Eg: `.0192` or `.9983838`
-                    case DIGIT: tokenkind = -1; lexer_lex_digit(lexer); break;
-                    default: tokenkind = DOT; break;
-                }
-                break;
-            case ':':
-                switch(next) {
-                    case ':': LEXER_INCREMENT_OFFSET; tokenkind = COLON_COLON; break;
-                    default: tokenkind = COLON; break;
+                    }
                 }
-                break;
-            case '?': tokenkind = QUESTION; break;
-            case '@': tokenkind = -1; lexer_lex_macro(lexer); break;
-            default:
-                lexer_error(lexer, "Invalid character `%c`", curr);
-                break;
-        } // switch(ch)
+                lexer_drain_window(lexer, out);
+            }
+            offset = lexer->offset;
+        }
 
-        if(tokenkind == -1) continue;
-        lexer_maketoken(lexer, tokenkind, null, lexer->offset - 1, lexer->lineno, lexer->colno - 1);
-    } // while
+        if(synced) {
+            // Comments are linked to tokens by index - the chunk's tokens move from `synced_at` to `out->size`
+            CommentTable* comments = &chunk->lexer->comments;
+            UInt32 token_base = out->size - synced_at;
+            for(UInt32 c = comment_table_lower_bound_offset(comments, comments_from); c < comments->size; c++)
+                comment_table_push(&lexer->comments, (TokenKind)comments->kinds[c], comments->offsets[c], 
+                                   comments->lengths[c], comments->tokens[c] + token_base);
+
+            token_stream_reserve(out, out->size + (tokens->size - synced_at));
+            for(UInt32 t = synced_at; t < tokens->size; t++)
+                token_stream_push(out, TOKEN_KIND(tokens, t), TOKEN_OFFSET(tokens, t), TOKEN_LENGTH(tokens, t), 
+                                  TOKEN_SYMBOL(tokens, t));
+
+            LiteralTable* literals = &chunk->lexer->literals;
+            UInt32 v = synced_at < tokens->size ? literal_table_lower_bound(literals, TOKEN_OFFSET(tokens, synced_at)) 
+                                                : literals->size;
+            for(; v < literals->size; v++)
+                literal_table_push(&lexer->literals, literals->offsets[v], literals->values[v]);
+            offset = chunk->resume;
+            lexer->is_eof = chunk->lexer->is_eof;
+        }
 
-lex_eof:;
+        token_stream_free(tokens);
+        literal_table_free(&chunk->lexer->literals);
+        comment_table_free(&chunk->lexer->comments);
+        CSTL_FREE(lexer->allocator, chunk->lexer, sizeof(Lexer));
+    }
+    CSTL_FREE(lexer->allocator, chunks, (UInt64)nthreads * sizeof(LexerChunk));
 
-    lexer_maketoken(lexer, TOK_EOF, null, lexer->offset - 1, lexer->lineno, lexer->colno - 1);
+    lexer->offset = offset;
+    lexer->ntokens = out->size;
+    CSTL_CHECK(lexer->is_eof, "`lexer_lex_parallel()` did not reach the end of the buffer");
+    profiler_end();
 }
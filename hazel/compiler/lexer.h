@@ -16,6 +16,7 @@ Copyright (c) 2021 Jason Dsouza <http://github.com/jasmcaus>
 #include <stdio.h>
 #include <string.h>
 #include <stdarg.h>
+#include <setjmp.h>
 
 #include <hazel/core/misc.h>
 #include <hazel/core/types.h>
@@ -23,14 +24,37 @@ Copyright (c) 2021 Jason Dsouza <http://github.com/jasmcaus>
 #include <hazel/core/vector.h>
 #include <hazel/core/buffer.h>
 #include <hazel/core/debug.h>
+#include <hazel/core/memory.h>
+#include <hazel/core/simd.h>
+#include <hazel/core/number.h>
+#include <hazel/core/thread.h>
+#include <hazel/core/utf8.h>
+#include <hazel/core/unicode.h>
 
 #include <hazel/compiler/tokens.h>
+#include <hazel/compiler/intern.h>
+#include <hazel/compiler/tokencache.h>
+#include <hazel/compiler/lineindex.h>
+#include <hazel/compiler/profiler.h>
 
 /*
     Hazel's Lexer is built in such a way that no (or negligible) memory allocations are necessary during usage. 
 
-    In order to be able to not allocate any memory during tokenization, STRINGs and NUMBERs are just sanity checked
-    but _not_ converted - it is the Parser's responsibility to perform the right conversion.
+    In order to be able to not allocate any memory during tokenization, STRINGs are just sanity checked but _not_ 
+    converted - it is the Parser's responsibility to perform the right conversion. NUMBERs are converted while they 
+    are scanned (the digits have to be looked at anyway), and their values are kept in a side table - see 
+    `lexer_token_literal()`.
+
+    Identifiers are interned (see <hazel/compiler/intern.h>) as they are scanned - every IDENTIFIER token carries 
+    the Symbol of its name.
+
+    Tokens never own a copy of their value - they only record the slice (offset, length) of the Lexical Buffer they 
+    were scanned from. If the Parser needs a NUL-terminated value, `lexer_token_value()` copies it into the Lexer's 
+    bump arena (which is released, in one go, by `lexer_free()`).
+
+    Comments are not part of the token stream - the Parser has no use for them. They are kept in a side table 
+    (`lexer->comments`), each linked to the token that follows it, for tools that do (see `lexer_token_comments()`).
+    A line comment beginning with `///` is a DOCS_COMMENT.
 
     In case of a scan error, ILLEGAL is returned and the error details can be extracted from the token itself.
 
@@ -39,11 +63,44 @@ Copyright (c) 2021 Jason Dsouza <http://github.com/jasmcaus>
 */
 
 // This macro defines how many tokens we initially expect in lexer->tokenList. 
-// When this limit is reached, we realloc using this same constant (TOKENLIST_ALLOC_CAPACITY * sizeof(Token)) bytes 
-// at a time (which works out to around 0.26MB) per (re)allocation
+// When this limit is reached, the token stream grows by a factor of 1.5
 #define TOKENLIST_ALLOC_CAPACITY    8192
+// Buffers of at least this many bytes get a token stream that reserves address space for a token per byte, and 
+// grows in place (see `token_stream_init_reserved()`) - instead of being copied every time it grows
+#define TOKENLIST_RESERVED_MIN_SIZE (MB_TO_BYTES(1))
+// No. of comments we initially expect in lexer->comments
+#define COMMENTLIST_ALLOC_CAPACITY  256
 // Maximum length of an individual token
 #define MAX_TOKEN_LENGTH            256
+// Size (in bytes) of each chunk in the Lexer's bump arena. Larger requests get a chunk of their own.
+#define LEXER_ARENA_CHUNK_SIZE      KB_TO_BYTES(64)
+
+// No. of recently interned identifiers each Lexer remembers (by hash), so that it usually only has to go to the 
+// (shared) Interner the first time it sees a name. Must be a power of 2.
+#define LEXER_SYMBOL_CACHE_SIZE     2048
+
+// No. of tokens `lexer_next_token()` scans ahead (and keeps) at a time. Must be a power of 2.
+#define LEXER_WINDOW_SIZE           64
+
+// A fixed-size ring of tokens that have been scanned but not yet handed out. `head` and `tail` only ever increase
+// (and wrap around) - the no. of buffered tokens is `tail - head`.
+typedef struct LexerWindow {
+    Token tokens[LEXER_WINDOW_SIZE];
+    UInt32 head;                // index (before masking) of the next token to be handed out
+    UInt32 tail;                // index (before masking) of the next free slot
+} LexerWindow;
+
+// No. of bytes the Lexer may look past the end of a token before it decides where the token ends. A token that ends 
+// further than this before an edit could not have been affected by it (see `lexer_relex()`).
+#define LEXER_RELEX_LOOKAHEAD       4
+
+// Which tokens in `lexer->tokenList` were replaced by `lexer_relex()`. Every token after them is unchanged (except 
+// for its offset).
+typedef struct LexerSplice {
+    UInt32 first;               // index of the first token that was re-lexed
+    UInt32 nremoved;            // no. of (old) tokens that were replaced
+    UInt32 ninserted;           // no. of (new) tokens that replaced them
+} LexerSplice;
 
 typedef struct Lexer {
     const cstlBuffer* buffer;   // the Lexical buffer
@@ -51,13 +108,28 @@ typedef struct Lexer {
                                 // offset of the curr char (no. of chars b/w the beginning of the Lexical Buffer
                                 // and the curr char)
 
-    cstlVector* tokenList;      // list of tokens
-    UInt32 lineno;              // the line number in the source where the token occured
-    UInt32 colno;               // the column number
+    TokenStream tokenList;      // list of tokens (only filled by `lexer_lex()`)
+    CommentTable comments;      // comments scanned so far, linked to the token after them
+    UInt32 ntokens;             // no. of tokens made so far (the index the next token will have)
+    LexerWindow window;         // tokens scanned ahead of the consumer
+    Token eof_token;            // TOK_EOF at the end of the buffer
+    bool is_eof;                // has the end of the buffer been reached?
+    bool is_validated;          // has the buffer been checked to be valid UTF-8 (see `lexer_validate_utf8()`)?
+    jmp_buf* recover;           // if set, `lexer_error()` jumps here instead of exiting (see `lexer_lex_parallel()`)
     const char* fname;          // /path/to/file.hzl
+    LineIndex lines;            // where each line of the buffer begins (built on the first line/column query)
+    TokenStream relexed;        // scratch space for the tokens re-lexed by `lexer_relex()`
+    LiteralTable literals;      // values of the numeric literals scanned so far
+    Interner* interner;         // where identifiers are interned (`interner_global()` unless set otherwise)
+    const InternEntry* symbol_cache[LEXER_SYMBOL_CACHE_SIZE];  // recently interned identifiers, by hash
 
     bool is_inside_str;         // set to true inside a string
     int nest_level;             // used to infer if we're inside many `{}`s
+
+    cstlArena arena;            // backing storage for token values copied out of the buffer (chunks come from 
+                                // the Lexer's allocator)
+    UInt64 nallocs;             // no. of heap allocations made while lexing (excluding `arena`)
+    cstlAllocator* allocator;   // where the Lexer (and everything it owns) comes from - that of its buffer
 } Lexer;
 
 
@@ -65,48 +137,41 @@ typedef struct Lexer {
 #define LEXER_MACROS_
     // Get the current character in the Lexical buffer
     // NB: This does not increase the offset
-    #define LEXER_CURR_CHAR                   lexer->buffer->at(lexer->buffer, lexer->offset)
-
-    // Reset the line
-    #define LEXER_RESET_LINENO                lexer->lineno = 0
-    // Reset the column number 
-    #define LEXER_RESET_COLNO                 lexer->colno = 0
-
-    // Increment the line number
-    #define LEXER_INCREMENT_LINENO            ++lexer->lineno; LEXER_RESET_COLNO
-    // Decrement the lineno
-    #define LEXER_DECREMENT_LINENO            --lexer->lineno; LEXER_RESET_COLNO
-    // Increment the column number
-    #define LEXER_INCREMENT_COLNO             ++lexer->colno 
-    // Decrement the colno
-    #define LEXER_DECREMENT_COLNO             --lexer->colno
+    #define LEXER_CURR_CHAR                   lexer_peek(lexer)
+
+    // Pointer to the current character in the Lexical buffer
+    #define LEXER_CURR_PTR                    (lexer->buffer->data + lexer->offset)
+    // Pointer one past the last character in the Lexical buffer
+    #define LEXER_END_PTR                     (lexer->buffer->data + lexer->buffer->length)
 
     // Increment the Lexical Buffer offset
-    #define LEXER_INCREMENT_OFFSET            ++lexer->offset; LEXER_INCREMENT_COLNO
+    #define LEXER_INCREMENT_OFFSET            ++lexer->offset
     // Decrement the Lexical Buffer offset
-    #define LEXER_DECREMENT_OFFSET            --lexer->offset; LEXER_DECREMENT_COLNO
-
-    // Increment the Lexical Buffer offset without affecting `colno`
-    #define LEXER_INCREMENT_OFFSET_ONLY       ++lexer->offset;
-    // Decrement the Lexical Buffer offset without affecting `colno`
-    #define LEXER_DECREMENT_OFFSET_ONLY       --lexer->offset;
+    #define LEXER_DECREMENT_OFFSET            --lexer->offset
 
     // Reset the buffer 
     #define LEXER_RESET_BUFFER              \
-        lexer->buffer->free(lexer->buffer)
+        lexer->buffer->free(lexer->buffer); \
+        lexer->buffer = null
 
     // Reset the Lexer state
     #define LEXER_RESET                     \
         lexer->buffer->free(lexer->buffer); \
+        lexer->buffer = null;               \
+        line_index_free(&lexer->lines);     \
         lexer->offset = 0;                  \
-        lexer->lineno = 1;                  \
-        lexer->colno = 1;                   \
         lexer->fname = ""
 
 #endif // LEXER_MACROS_
 
 Lexer* lexer_init(const char* buffer, const char* fname);
-static void lexer_tokenlist_append(Lexer* lexer, Token* tk);
+// Same as `lexer_init()`, but lexes `length` bytes of `buffer` in place (no copy is made). `buffer` must be followed 
+// by CSTL_BUFFER_PADDING zero bytes - sources loaded by `file_load()` are.
+Lexer* lexer_init_with_length(const char* buffer, UInt32 length, const char* fname);
+static Lexer* lexer_init_from_buffer(cstlBuffer* buffer, const char* fname);
+// Returns the offset lexing begins at (past the BOM, if any)
+static inline UInt32 lexer_start_offset(Lexer* lexer);
+static void lexer_tokenlist_push(Lexer* lexer, TokenKind kind, UInt32 offset, UInt32 length, Symbol symbol);
 static void lexer_free(Lexer* lexer);
 
 // Returns the current character in the Lexical Buffer and advances to the next element.
@@ -114,6 +179,8 @@ static void lexer_free(Lexer* lexer);
 static inline char lexer_advance(Lexer* lexer);
 // Advance `n` characters in the Lexical Buffer
 static inline char lexer_advancen(Lexer* lexer, UInt32 n);
+// Move forward to `ptr` (which cannot be behind the current offset) in the Lexical Buffer
+static inline void lexer_skip_to(Lexer* lexer, const char* ptr);
 
 // Returns the previous element in the Lexical buffer.
 // This is non-destructive --> the buffer offset is not updated.
@@ -128,30 +195,120 @@ static inline char lexer_peek(Lexer* lexer);
 // It _does not_ increment the buffer offset.
 static inline char lexer_peekn(Lexer* lexer, UInt32 n);
 
+// Apply an edit to the Lexical buffer - replace `removed` bytes at `offset` with `inserted_length` bytes of 
+// `inserted` - and bring `lexer->tokenList` (which must hold the tokens of the whole buffer, see `lexer_lex()`) up 
+// to date. Only the tokens around the edit are re-lexed: from the last token the edit could not have affected, up 
+// to the first (old) token the new tokens line up with again. The tokens after that are kept, with their offsets 
+// moved.
+// An edit that leaves the buffer with invalid UTF-8 is reported with `lexer_error()`.
+LexerSplice lexer_relex(Lexer* lexer, UInt32 offset, UInt32 removed, const char* inserted, UInt32 inserted_length);
+// Check that the `length` bytes just spliced in at `offset` (by `lexer_relex()`) left the buffer valid UTF-8
+static void lexer_validate_edit(Lexer* lexer, UInt32 offset, UInt32 length);
+
+// Returns the value of the numeric literal `token`, or null if `token` isn't one
+const LiteralValue* lexer_token_literal(Lexer* lexer, const Token* token);
+
+// Returns the line and column `offset` (into the Lexical buffer) falls on
+SourceLocation lexer_location(Lexer* lexer, UInt32 offset);
+// Returns the line and column `token` begins at
+SourceLocation lexer_token_location(Lexer* lexer, const Token* token);
+
+// Report an error (at the current offset) and exit
 void lexer_error(Lexer* lexer, const char* format, ...);
 
-// Make a token
-static void lexer_maketoken(Lexer* lexer, TokenKind kind, char* value, UInt32 offset, UInt32 lineno, UInt32 colno);
+// Make a token and append it to the token window. Returns the token (so its `symbol` can be filled in).
+static Token* lexer_maketoken(Lexer* lexer, TokenKind kind, UInt32 offset, UInt32 length);
+// Record a comment (in `lexer->comments`), linked to the next token to be made
+static void lexer_makecomment(Lexer* lexer, TokenKind kind, UInt32 offset, UInt32 length);
+// Returns the Symbol of the `length` bytes at `value`
+static inline Symbol lexer_intern(Lexer* lexer, const char* value, UInt32 length);
+
+// Returns the `i`th token lexed so far
+Token lexer_token_at(Lexer* lexer, UInt32 i);
+// Returns the no. of comments between the token at index `token` and the one before it, and stores the index (into 
+// `lexer->comments`) of the first of them in `first`. Takes O(log n).
+UInt32 lexer_token_comments(Lexer* lexer, UInt32 token, UInt32* first);
+// Returns the `i`th comment scanned so far (a COMMENT or DOCS_COMMENT Token)
+Token lexer_comment_at(Lexer* lexer, UInt32 i);
+// Returns a pointer to the value of `token` inside the Lexical buffer (no copy is made) and stores its length in 
+// `length`. The value is _not_ NUL-terminated.
+const char* lexer_token_view(Lexer* lexer, const Token* token, UInt32* length);
+// Returns a NUL-terminated copy of the value of `token`, allocated from the Lexer's arena.
+// Quotes (STRINGs and RUNEs), the `@` (MACROs) and the comment markers (COMMENTs and DOCS_COMMENTs) are stripped away.
+const char* lexer_token_value(Lexer* lexer, const Token* token);
+// Returns the total number of heap allocations the Lexer has made so far
+UInt64 lexer_nallocs(Lexer* lexer);
 
 // Scan a comment (single line)
 static inline void lexer_lex_sl_comment(Lexer* lexer);
 // Scan a comment (multi line)
 static inline void lexer_lex_ml_comment(Lexer* lexer);
-// Scan a character
+// Scan a character (RUNE) literal
 static inline void lexer_lex_char(Lexer* lexer);
-// Scan an escape char
-static inline void lexer_lex_esc_char(Lexer* lexer);
+// Scan an escape sequence (the `\` has already been consumed) and return the character it stands for
+static inline Rune lexer_lex_esc_char(Lexer* lexer);
 // Scan a macro (begins with `@`)
 static inline void lexer_lex_macro(Lexer* lexer);
 // Scan a string
 static inline void lexer_lex_string(Lexer* lexer);
-// Returns whether `value` is a keyword or an identifier
-static inline TokenKind lexer_is_keyword_or_identifier(char* value);
-// Scan an identifier
-static inline void lexer_lex_identifier(Lexer* lexer);
-// Scan a digit
-static inline void lexer_lex_digit(Lexer* lexer);
-// Lex the Source files
+// Returns whether `value` (of `length` bytes) is a keyword or an identifier
+static inline TokenKind lexer_is_keyword_or_identifier(const char* value, UInt32 length);
+// Scan an identifier beginning at `tok_offset`. Besides ASCII, identifiers can be made up of any XID_Start 
+// character followed by XID_Continue characters (see <hazel/core/unicode.h>).
+static inline void lexer_lex_identifier(Lexer* lexer, UInt32 tok_offset);
+// Scan a lexeme beginning with a multibyte character at `tok_offset` (an identifier, or else an error)
+static void lexer_lex_multibyte(Lexer* lexer, UInt32 tok_offset);
+// Scan (and convert) a numeric literal beginning at `tok_offset`
+static inline void lexer_lex_digit(Lexer* lexer, UInt32 tok_offset);
+// Scan the next lexeme in the Lexical buffer. At most one token is produced (whitespace, for example, produces none)
+static inline void lexer_lex_next(Lexer* lexer);
+// Scan ahead until the token window is full (or we've hit the end of the buffer)
+static void lexer_fill_window(Lexer* lexer);
+// Check that the whole Lexical buffer is valid UTF-8 (and report the first invalid byte if it isn't). This is done 
+// once, before anything is lexed, so that multibyte characters never have to be checked again.
+static void lexer_validate_utf8(Lexer* lexer);
+
+// Streaming interface: 
+// Tokens are scanned on demand, LEXER_WINDOW_SIZE at a time, so memory use doesn't grow with the size of the file.
+// 
+// Returns the next token in the Lexical buffer, scanning more of the buffer only when the token window runs dry.
+// Once the end of the buffer is reached, TOK_EOF is returned on every call.
+Token lexer_next_token(Lexer* lexer);
+// Returns the `n`th token after the next one (`lexer_peek_token(lexer, 0)` is what `lexer_next_token()` would return)
+// without consuming anything. `n` must be less than LEXER_WINDOW_SIZE.
+Token lexer_peek_token(Lexer* lexer, UInt32 n);
+
+// Batch interface: 
+// Lex the entire Source file into `lexer->tokenList`
 static void lexer_lex(Lexer* lexer);
+// Same as `lexer_lex()`, but reuses the tokens cached in `directory` (see <hazel/compiler/tokencache.h>) if the 
+// Lexical buffer hasn't changed since they were saved. Otherwise, the buffer is lexed and its tokens are saved there 
+// for next time. Returns `true` if the cache was used.
+// Must be called on a fresh Lexer.
+bool lexer_lex_cached(Lexer* lexer, const char* directory);
+
+// Chunks smaller than this are not worth a thread of their own in `lexer_lex_parallel()`
+#define LEXER_PARALLEL_MIN_CHUNK_SIZE   (MB_TO_BYTES(1))
+
+// A slice of the Lexical buffer, lexed on its own thread by `lexer_lex_parallel()`
+typedef struct LexerChunk {
+    Lexer* lexer;               // a Lexer sharing the parent's buffer, positioned at `start`
+    UInt32 start;               // offset of the first byte of the chunk (always just after a newline)
+    UInt32 end;                 // offset of the first byte of the next chunk
+    UInt32 resume;              // offset where the last lexeme begun in the chunk actually ended (can be past `end`)
+    TokenStream tokens;         // tokens lexed, assuming nothing (a string or comment) is still open at `start`
+    bool failed;                // did the speculative lex hit a syntax error?
+    bool started;               // is the chunk lexed on `thread`? (if it couldn't be started, it is lexed inline)
+    cstlThread thread;
+} LexerChunk;
+
+// Lex the entire Source file into `lexer->tokenList`, using `nthreads` threads. If `nthreads` is 0, one thread per 
+// processor is used, as long as each gets at least LEXER_PARALLEL_MIN_CHUNK_SIZE bytes. 
+// 
+// The buffer is split at newlines and each chunk is lexed speculatively, as if it didn't begin in the middle of a 
+// string or comment. Wherever a chunk turns out to begin somewhere else than where its predecessor left off, it is 
+// re-lexed from the right offset until it lines up with a token of the speculative lex again. The result is always 
+// identical to `lexer_lex()`.
+static void lexer_lex_parallel(Lexer* lexer, UInt32 nthreads);
 
 #endif // HAZEL_LEXER_H
\ No newline at end of file
@@ -0,0 +1,63 @@
+/*
+_ _    _           ______   _______        
+| |  | |    /\    /___  /   |  ____|| |    
+| |__| |   /  \      / /    | |__   | |       Hazel - The Fast, Expressive & Elegant Programming Language
+|  __  |  / /\ \    / /     |  __|  | |       Languages: C, C++, and Assembly
+| |  | | / ____ \  / /___   | |____ | |____   https://github.com/HazelLang/hazel/
+|_|_ |_|/_/    \_\/_______\ |______|_\______|
+
+Licensed under the MIT License <http://opensource.org/licenses/MIT>
+SPDX-License-Identifier: MIT
+Copyright (c) 2021 Jason Dsouza <http://github.com/jasmcaus>
+*/
+
+
+#include <stdlib.h>
+#include <hazel/core/debug.h>
+#include <hazel/core/simd.h>
+#include <hazel/compiler/lineindex.h>
+
+// Build the line index of the `length` bytes at `source`
+void line_index_build(LineIndex* index, const char* source, UInt32 length) {
+    const char* end = source + length;
+    UInt32 nnewlines = (UInt32)simd_count_byte(source, end, '\n');
+
+    index->allocator = compiler_allocator();
+    index->starts = (UInt32*)CSTL_ALLOC(index->allocator, ((UInt64)nnewlines + 1) * sizeof(UInt32));
+    CSTL_CHECK_NOT_NULL(index->starts, "Could not allocate memory. Memory full.");
+    index->nlines = nnewlines + 1;
+
+    // Each newline begins a new line on the byte right after it
+    index->starts[0] = 0;
+    simd_index_byte(source, end, '\n', index->starts + 1);
+    for(UInt32 i = 1; i < index->nlines; i++)
+        ++index->starts[i];
+}
+
+// Free `index` from its associated memory
+void line_index_free(LineIndex* index) {
+    CSTL_FREE(index->allocator, index->starts, (UInt64)index->nlines * sizeof(UInt32));
+    index->starts = null;
+    index->nlines = 0;
+}
+
+// Returns the line and column `offset` falls on
+SourceLocation line_index_lookup(const LineIndex* index, UInt32 offset) {
+    CSTL_CHECK_GT(index->nlines, 0);
+
+    // Find the last line that begins at or before `offset`
+    UInt32 lo = 0;
+    UInt32 hi = index->nlines;
+    while(hi - lo > 1) {
+        UInt32 mid = lo + (hi - lo)/2;
+        if(index->starts[mid] <= offset)
+            lo = mid;
+        else 
+            hi = mid;
+    }
+
+    SourceLocation location;
+    location.lineno = lo + 1;
+    location.colno = offset - index->starts[lo] + 1;
+    return location;
+}
@@ -0,0 +1,49 @@
+/*
+_ _    _           ______   _______        
+| |  | |    /\    /___  /   |  ____|| |    
+| |__| |   /  \      / /    | |__   | |       Hazel - The Fast, Expressive & Elegant Programming Language
+|  __  |  / /\ \    / /     |  __|  | |       Languages: C, C++, and Assembly
+| |  | | / ____ \  / /___   | |____ | |____   https://github.com/HazelLang/hazel/
+|_|_ |_|/_/    \_\/_______\ |______|_\______|
+
+Licensed under the MIT License <http://opensource.org/licenses/MIT>
+SPDX-License-Identifier: MIT
+Copyright (c) 2021 Jason Dsouza <http://github.com/jasmcaus>
+*/
+
+
+#ifndef HAZEL_LINEINDEX_H
+#define HAZEL_LINEINDEX_H
+
+#include <hazel/core/types.h>
+#include <hazel/compiler/allocator.h>
+
+/*
+    The Lexer (and everything after it) only ever deals in byte offsets into a source file. Line and column numbers 
+    are only needed to report diagnostics, so instead of tracking them for every byte we look them up, when asked, 
+    in an index of where each line of the file begins.
+
+    The index is built in a single (vectorized) pass over the source and is queried with a binary search.
+*/
+
+// A position in a source file, as reported to the user. Both are 1-based. 
+// `colno` counts bytes (not characters) from the beginning of the line.
+typedef struct SourceLocation {
+    UInt32 lineno;
+    UInt32 colno;
+} SourceLocation;
+
+typedef struct LineIndex {
+    UInt32* starts;     // offset of the first byte of each line (`starts[0]` is always 0)
+    UInt32 nlines;      // no. of lines in the source (a file without newlines has one)
+    cstlAllocator* allocator;   // where `starts` comes from (`compiler_allocator()`, when the index was built)
+} LineIndex;
+
+// Build the line index of the `length` bytes at `source`
+void line_index_build(LineIndex* index, const char* source, UInt32 length);
+// Free `index` from its associated memory
+void line_index_free(LineIndex* index);
+// Returns the line and column `offset` falls on
+SourceLocation line_index_lookup(const LineIndex* index, UInt32 offset);
+
+#endif // HAZEL_LINEINDEX_H
@@ -0,0 +1,616 @@
+/*
+_ _    _           ______   _______        
+| |  | |    /\    /___  /   |  ____|| |    
+| |__| |   /  \      / /    | |__   | |       Hazel - The Fast, Expressive & Elegant Programming Language
+|  __  |  / /\ \    / /     |  __|  | |       Languages: C, C++, and Assembly
+| |  | | / ____ \  / /___   | |____ | |____   https://github.com/HazelLang/hazel/
+|_|_ |_|/_/    \_\/_______\ |______|_\______|
+
+Licensed under the MIT License <http://opensource.org/licenses/MIT>
+SPDX-License-Identifier: MIT
+Copyright (c) 2021 Jason Dsouza <http://github.com/jasmcaus>
+*/
+
+#include <hazel/compiler/profiler.h>
+#include <hazel/core/hash.h>
+
+// At most this many files are listed (the slowest ones) by `profiler_report()`
+#define PROFILER_REPORT_MAX_FILES   20
+// At most this many phases are broken down per file by `profiler_report()`
+#define PROFILER_REPORT_MAX_PHASES  4
+// At most this many allocation sites are listed per phase by `profiler_report()`
+#define PROFILER_REPORT_MAX_SITES   5
+
+static bool profilerEnabled = false;
+// Read the time-stamp counter (instead of the monotonic clock)?
+static bool profilerUseTsc = false;
+// Taken when the profiler is first turned on - the ticks recorded are converted into nanoseconds by measuring the
+// rate of the counter over the whole run
+static cstlClockCalibration profilerCalibration;
+static cstlOnce profilerOnce = CSTL_ONCE_INIT;
+// Guards the list of threads (not their records)
+static cstlMutex profilerLock;
+static ProfilerThread* profilerThreads = null;
+static UInt32 profilerNthreads = 0;
+// Bumped by `profiler_free()`, so that threads know their records are gone
+static UInt32 profilerGeneration = 1;
+
+static CSTL_THREAD_LOCAL ProfilerThread* profilerThread = null;
+static CSTL_THREAD_LOCAL UInt32 profilerThreadGeneration = 0;
+
+static void profiler__init(void) {
+    thread_mutex_init(&profilerLock);
+    profilerUseTsc = clock_has_invariant_tsc();
+    profilerCalibration = clock_calibration_begin(profilerUseTsc);
+}
+
+// Turn the profiler on (or off)
+void profiler_enable(bool enable) {
+    thread_once(&profilerOnce, profiler__init);
+    profilerEnabled = enable;
+}
+
+// Is the profiler on?
+bool profiler_enabled(void) {
+    return profilerEnabled;
+}
+
+// Returns the records of this thread (created on first use)
+static ProfilerThread* profiler__thread(void) {
+    if(profilerThread != null && profilerThreadGeneration == profilerGeneration)
+        return profilerThread;
+
+    ProfilerThread* thread = (ProfilerThread*)calloc(1, sizeof(ProfilerThread));
+    CSTL_CHECK_NOT_NULL(thread, "Could not allocate memory. Memory full.");
+    thread_mutex_lock(&profilerLock);
+    thread->id = profilerNthreads++;
+    thread->next = profilerThreads;
+    profilerThreads = thread;
+    profilerThreadGeneration = profilerGeneration;
+    thread_mutex_unlock(&profilerLock);
+    profilerThread = thread;
+    return thread;
+}
+
+static inline bool profiler__same(const char* a, const char* b) {
+    return a == b || (a != null && b != null && strcmp(a, b) == 0);
+}
+
+// Names are compared by content (the same phase may be named by a different literal in another file), so that's 
+// what they are hashed by, too
+static inline UInt64 profiler__hash(UInt32 parent, const char* phase, const char* fname) {
+    UInt64 hash = hash_bytes64(phase, strlen(phase), parent);
+    return fname ? hash_bytes64(fname, strlen(fname), hash) : hash_u64(hash);
+}
+
+// Add node `i` to the index of `thread` (which has room for it)
+static void profiler__index(ProfilerThread* thread, UInt32 i) {
+    UInt32 mask = thread->index_capacity - 1;
+    UInt32 slot = (UInt32)thread->nodes[i].hash & mask;
+    while(thread->index[slot] != 0)
+        slot = (slot + 1) & mask;
+    thread->index[slot] = i + 1;
+}
+
+// Returns the node of `phase` on `fname` under `parent`, adding it if this is its first run
+// Every file gets nodes of its own, so they're looked up by hash - a build of many files would otherwise spend 
+// (in the profiler) time quadratic in their number.
+static UInt32 profiler__node(ProfilerThread* thread, UInt32 parent, const char* phase, const char* fname) {
+    UInt64 hash = profiler__hash(parent, phase, fname);
+    if(thread->index_capacity > 0) {
+        UInt32 mask = thread->index_capacity - 1;
+        for(UInt32 slot = (UInt32)hash & mask; thread->index[slot] != 0; slot = (slot + 1) & mask) {
+            UInt32 i = thread->index[slot] - 1;
+            ProfilerNode* node = &thread->nodes[i];
+            if(node->hash == hash && node->parent == parent && profiler__same(node->phase, phase) && 
+               profiler__same(node->fname, fname))
+                return i;
+        }
+    }
+
+    if(thread->nnodes == thread->capacity) {
+        thread->capacity = thread->capacity ? thread->capacity * 2 : 64;
+        thread->nodes = (ProfilerNode*)realloc(thread->nodes, thread->capacity * sizeof(ProfilerNode));
+        CSTL_CHECK_NOT_NULL(thread->nodes, "Could not allocate memory. Memory full.");
+    }
+    // At most half full
+    if(2 * (thread->nnodes + 1) > thread->index_capacity) {
+        free(thread->index);
+        thread->index_capacity = thread->index_capacity ? thread->index_capacity * 2 : 128;
+        thread->index = (UInt32*)calloc(thread->index_capacity, sizeof(UInt32));
+        CSTL_CHECK_NOT_NULL(thread->index, "Could not allocate memory. Memory full.");
+        for(UInt32 i = 0; i < thread->nnodes; i++)
+            profiler__index(thread, i);
+    }
+
+    ProfilerNode* node = &thread->nodes[thread->nnodes];
+    memset(node, 0, sizeof(ProfilerNode));
+    node->phase = phase;
+    node->fname = fname;
+    node->parent = parent;
+    node->depth = parent == PROFILER_ROOT ? 0 : thread->nodes[parent].depth + 1;
+    node->hash = hash;
+    profiler__index(thread, thread->nnodes);
+    return thread->nnodes++;
+}
+
+// Begin the phase `phase` on `fname`
+void profiler_begin(const char* phase, const char* fname) {
+    if(!profilerEnabled)
+        return;
+
+    ProfilerThread* thread = profiler__thread();
+    // Too deep: the phase is timed as a part of its parent
+    if(thread->depth >= PROFILER_MAX_DEPTH) {
+        ++thread->depth;
+        return;
+    }
+    UInt32 parent = PROFILER_ROOT;
+    if(thread->depth > 0) {
+        parent = thread->frames[thread->depth - 1].node;
+        if(fname == null)
+            fname = thread->nodes[parent].fname;
+    }
+
+    ProfilerFrame* frame = &thread->frames[thread->depth++];
+    frame->node = profiler__node(thread, parent, phase, fname);
+    frame->live = frame->peak = thread->live;
+    frame->start = clock_ticks(profilerUseTsc);
+}
+
+// End the phase begun last
+void profiler_end(void) {
+    if(!profilerEnabled)
+        return;
+    UInt64 end = clock_ticks(profilerUseTsc);
+
+    ProfilerThread* thread = profilerThread;
+    if(thread == null || profilerThreadGeneration != profilerGeneration || thread->depth == 0)
+        return;
+    if(thread->depth-- > PROFILER_MAX_DEPTH)
+        return;
+
+    ProfilerFrame* frame = &thread->frames[thread->depth];
+    ProfilerNode* node = &thread->nodes[frame->node];
+    UInt64 elapsed = end - frame->start;
+    ++node->count;
+    node->ticks += elapsed;
+    if(node->parent != PROFILER_ROOT)
+        thread->nodes[node->parent].nested_ticks += elapsed;
+
+    // What the phase held at its peak, and what its parent did (the parent held it too)
+    node->peak = CSTL_MAX(node->peak, (UInt64)(frame->peak - frame->live));
+    if(thread->depth > 0)
+        thread->frames[thread->depth - 1].peak = CSTL_MAX(thread->frames[thread->depth - 1].peak, frame->peak);
+}
+
+// Returns the entry of the allocations made at `site` while `node` was running, adding it if need be
+static ProfilerSite* profiler__site(ProfilerThread* thread, const char* site, UInt32 node) {
+    // Never more than half full
+    if(2 * (thread->nsites + 1) > thread->site_capacity) {
+        UInt32 capacity = thread->site_capacity ? thread->site_capacity * 2 : 64;
+        ProfilerSite* sites = (ProfilerSite*)calloc(capacity, sizeof(ProfilerSite));
+        CSTL_CHECK_NOT_NULL(sites, "Could not allocate memory. Memory full.");
+        ProfilerSite* old = thread->sites;
+        UInt32 old_capacity = thread->site_capacity;
+        thread->sites = sites;
+        thread->site_capacity = capacity;
+        thread->nsites = 0;
+        for(UInt32 i = 0; i < old_capacity; i++) {
+            if(old[i].site != null)
+                *profiler__site(thread, old[i].site, old[i].node) = old[i];
+        }
+        free(old);
+    }
+
+    UInt64 hash = ((UInt64)(uintptr_t)site ^ ((UInt64)node << 32)) * 0x9e3779b97f4a7c15ULL;
+    UInt32 mask = thread->site_capacity - 1;
+    for(UInt32 i = (UInt32)(hash >> 32) & mask;; i = (i + 1) & mask) {
+        ProfilerSite* entry = &thread->sites[i];
+        if(entry->site == site && entry->node == node)
+            return entry;
+        if(entry->site == null) {
+            entry->site = site;
+            entry->node = node;
+            ++thread->nsites;
+            return entry;
+        }
+    }
+}
+
+// Charge `size` bytes, allocated at `site`, to the phase running on this thread
+static void profiler__charge(const char* site, UInt64 size) {
+    ProfilerThread* thread = profiler__thread();
+    thread->live += (Int64)size;
+
+    UInt32 node = PROFILER_ROOT;
+    UInt32 depth = CSTL_MIN(thread->depth, PROFILER_MAX_DEPTH);
+    if(depth > 0) {
+        ProfilerFrame* frame = &thread->frames[depth - 1];
+        node = frame->node;
+        ++thread->nodes[node].nallocs;
+        thread->nodes[node].bytes += size;
+        frame->peak = CSTL_MAX(frame->peak, thread->live);
+    }
+    ProfilerSite* entry = profiler__site(thread, site ? site : "(unknown)", node);
+    ++entry->nallocs;
+    entry->bytes += size;
+}
+
+static void* profiler__alloc(cstlAllocator* self, UInt64 size, bool zeroed, const char* site);
+static void* profiler__resize(cstlAllocator* self, void* ptr, UInt64 old_size, UInt64 new_size, const char* site);
+static void profiler__free(cstlAllocator* self, void* ptr, UInt64 size);
+
+// Everything allocated from `profiler_allocator()`, over all threads (allocated from the heap)
+static cstlCountingAllocator profilerCounter = {
+    { allocator__counting_alloc, allocator__counting_resize, allocator__counting_free }, null, 0, 0, 0, 0, 0
+};
+static cstlAllocator profilerAllocator = { profiler__alloc, profiler__resize, profiler__free };
+
+static void* profiler__alloc(cstlAllocator* self, UInt64 size, bool zeroed, const char* site) {
+    void* ptr = allocator_alloc(&profilerCounter.base, size, zeroed, site);
+    if(ptr != null)
+        profiler__charge(site, size);
+    return ptr;
+}
+
+static void* profiler__resize(cstlAllocator* self, void* ptr, UInt64 old_size, UInt64 new_size, const char* site) {
+    void* resized = allocator_resize(&profilerCounter.base, ptr, old_size, new_size, site);
+    if(resized == null)
+        return null;
+    if(ptr == null)
+        old_size = 0;
+    // Growing a block is charged as an allocation of what it grew by
+    if(new_size >= old_size)
+        profiler__charge(site, new_size - old_size);
+    else
+        profiler__thread()->live -= (Int64)(old_size - new_size);
+    return resized;
+}
+
+// Charged to this thread, even if another one allocated the block (see profiler.h)
+static void profiler__free(cstlAllocator* self, void* ptr, UInt64 size) {
+    allocator_free(&profilerCounter.base, ptr, size);
+    profiler__thread()->live -= (Int64)size;
+}
+
+// Returns an allocator that charges every allocation to the phase running on the calling thread
+cstlAllocator* profiler_allocator(void) {
+    thread_once(&profilerOnce, profiler__init);
+    return &profilerAllocator;
+}
+
+// Returns the totals of everything allocated from `profiler_allocator()` so far
+const cstlCountingAllocator* profiler_allocator_totals(void) {
+    return &profilerCounter;
+}
+
+// A phase, merged over every thread and file (for `profiler_report()`)
+typedef struct ProfilerSummary {
+    const char* name;           // a phase, or a file
+    UInt32 parent;
+    UInt32 depth;
+    UInt64 count;
+    UInt64 ticks;
+    UInt64 nested_ticks;
+    UInt64 nallocs;
+    UInt64 bytes;
+    UInt64 peak;
+    UInt64 hash;                // of (parent, name), for `ProfilerSummaries.index`
+    UInt32 first;               // the first summary listed under this one (index + 1, or 0 if none)
+    UInt32 next;                // the next summary listed under the same one (index + 1, or 0 if none)
+} ProfilerSummary;
+
+typedef struct ProfilerSummaries {
+    ProfilerSummary* items;
+    UInt32 size;
+    UInt32 capacity;
+    UInt32* index;              // open-addressed table of summaries by (parent, name): index + 1, or 0 if empty
+    UInt32 index_capacity;
+} ProfilerSummaries;
+
+// Add summary `i` to the index of `summaries` (which has room for it)
+static void profiler__index_summary(ProfilerSummaries* summaries, UInt32 i) {
+    UInt32 mask = summaries->index_capacity - 1;
+    UInt32 slot = (UInt32)summaries->items[i].hash & mask;
+    while(summaries->index[slot] != 0)
+        slot = (slot + 1) & mask;
+    summaries->index[slot] = i + 1;
+}
+
+// Returns the summary of `name` under `parent` in `summaries`, adding it if need be (and then listing it in `list`,
+// unless that's null)
+// Looked up by hash, like the nodes: there is a summary per file, and a build may well have thousands of them.
+static ProfilerSummary* profiler__summary(ProfilerSummaries* summaries, UInt32 parent, const char* name,
+                                          UInt32 depth, UInt32* list) {
+    UInt64 hash = profiler__hash(parent, name, null);
+    if(summaries->index_capacity > 0) {
+        UInt32 mask = summaries->index_capacity - 1;
+        for(UInt32 slot = (UInt32)hash & mask; summaries->index[slot] != 0; slot = (slot + 1) & mask) {
+            ProfilerSummary* summary = &summaries->items[summaries->index[slot] - 1];
+            if(summary->hash == hash && summary->parent == parent && profiler__same(summary->name, name))
+                return summary;
+        }
+    }
+
+    if(summaries->size == summaries->capacity) {
+        summaries->capacity = summaries->capacity ? summaries->capacity * 2 : 64;
+        summaries->items = (ProfilerSummary*)realloc(summaries->items,
+                                                     summaries->capacity * sizeof(ProfilerSummary));
+        CSTL_CHECK_NOT_NULL(summaries->items, "Could not allocate memory. Memory full.");
+    }
+    // At most half full
+    if(2 * (summaries->size + 1) > summaries->index_capacity) {
+        free(summaries->index);
+        summaries->index_capacity = summaries->index_capacity ? summaries->index_capacity * 2 : 128;
+        summaries->index = (UInt32*)calloc(summaries->index_capacity, sizeof(UInt32));
+        CSTL_CHECK_NOT_NULL(summaries->index, "Could not allocate memory. Memory full.");
+        for(UInt32 i = 0; i < summaries->size; i++)
+            profiler__index_summary(summaries, i);
+    }
+
+    UInt32 i = summaries->size++;
+    ProfilerSummary* summary = &summaries->items[i];
+    memset(summary, 0, sizeof(ProfilerSummary));
+    summary->name = name;
+    summary->parent = parent;
+    summary->depth = depth;
+    summary->hash = hash;
+    profiler__index_summary(summaries, i);
+    if(list != null) {
+        summary->next = *list;
+        *list = i + 1;
+    }
+    return summary;
+}
+
+static void profiler__free_summaries(ProfilerSummaries* summaries) {
+    free(summaries->items);
+    free(summaries->index);
+}
+
+static int profiler__compare_ticks(const void* a, const void* b) {
+    UInt64 x = ((const ProfilerSummary*)a)->ticks;
+    UInt64 y = ((const ProfilerSummary*)b)->ticks;
+    return (x < y) - (x > y);
+}
+
+static int profiler__compare_bytes(const void* a, const void* b) {
+    UInt64 x = ((const ProfilerSummary*)a)->bytes;
+    UInt64 y = ((const ProfilerSummary*)b)->bytes;
+    return (x < y) - (x > y);
+}
+
+static inline double profiler__percent(UInt64 ticks, UInt64 total) {
+    return total ? 100.0 * (double)ticks / (double)total : 0.0;
+}
+
+// Print the phases nested in `parent` (and theirs, and so on)
+static void profiler__print_phases(FILE* out, const ProfilerSummaries* phases, UInt32 parent, UInt64 total,
+                                   double ns_per_tick) {
+    for(UInt32 i = 0; i < phases->size; i++) {
+        const ProfilerSummary* phase = &phases->items[i];
+        if(phase->parent != parent)
+            continue;
+        UInt64 self = phase->ticks - phase->nested_ticks;
+        fprintf(out, " %*s%-*s %12.3f ms (%5.1f%%) %12.3f ms (%5.1f%%) %10" CSTL_PRIu64 "\n",
+                (int)(2 * phase->depth), "", (int)(28 - 2 * CSTL_MIN(phase->depth, 10)), phase->name,
+                (double)phase->ticks * ns_per_tick * 1e-6, profiler__percent(phase->ticks, total),
+                (double)self * ns_per_tick * 1e-6, profiler__percent(self, total), phase->count);
+        profiler__print_phases(out, phases, i, total, ns_per_tick);
+    }
+}
+
+static inline double profiler__mb(UInt64 bytes) {
+    return (double)bytes / (1024.0 * 1024.0);
+}
+
+// Print what the phases nested in `parent` (and theirs, and so on) allocated
+static void profiler__print_memory(FILE* out, const ProfilerSummaries* phases, UInt32 parent) {
+    for(UInt32 i = 0; i < phases->size; i++) {
+        const ProfilerSummary* phase = &phases->items[i];
+        if(phase->parent != parent)
+            continue;
+        fprintf(out, " %*s%-*s %10" CSTL_PRIu64 " %12.3f MB %12.3f MB\n", (int)(2 * phase->depth), "", 
+                (int)(28 - 2 * CSTL_MIN(phase->depth, 10)), phase->name, phase->nallocs, profiler__mb(phase->bytes), 
+                profiler__mb(phase->peak));
+        profiler__print_memory(out, phases, i);
+    }
+}
+
+// Print the summaries listed from `first` (see `ProfilerSummary.first`) that took the longest, out of `total` ticks
+static void profiler__print_slowest(FILE* out, const ProfilerSummaries* summaries, UInt32 first, UInt64 total) {
+    UInt32 n = 0;
+    for(UInt32 i = first; i != 0; i = summaries->items[i - 1].next)
+        ++n;
+    ProfilerSummary* top = (ProfilerSummary*)calloc(n + 1, sizeof(ProfilerSummary));
+    CSTL_CHECK_NOT_NULL(top, "Could not allocate memory. Memory full.");
+    n = 0;
+    for(UInt32 i = first; i != 0; i = summaries->items[i - 1].next)
+        top[n++] = summaries->items[i - 1];
+    qsort(top, n, sizeof(ProfilerSummary), profiler__compare_ticks);
+    for(UInt32 i = 0; i < n && i < PROFILER_REPORT_MAX_PHASES; i++)
+        fprintf(out, "%s%s %.1f%%", i ? ", " : " ", top[i].name, profiler__percent(top[i].ticks, total));
+    free(top);
+}
+
+// Print the sites listed from `first` (see `ProfilerSummary.first`) that allocated the most, out of `bytes`
+static void profiler__print_sites(FILE* out, const ProfilerSummaries* sites, UInt32 first, UInt64 bytes) {
+    UInt32 nsites = 0;
+    for(UInt32 i = first; i != 0; i = sites->items[i - 1].next)
+        ++nsites;
+    ProfilerSummary* top = (ProfilerSummary*)calloc(nsites + 1, sizeof(ProfilerSummary));
+    CSTL_CHECK_NOT_NULL(top, "Could not allocate memory. Memory full.");
+    nsites = 0;
+    for(UInt32 i = first; i != 0; i = sites->items[i - 1].next)
+        top[nsites++] = sites->items[i - 1];
+    qsort(top, nsites, sizeof(ProfilerSummary), profiler__compare_bytes);
+
+    for(UInt32 i = 0; i < nsites && i < PROFILER_REPORT_MAX_SITES; i++)
+        fprintf(out, "   %-40s %10" CSTL_PRIu64 " %12.3f MB (%5.1f%%)\n", top[i].name, top[i].nallocs, 
+                profiler__mb(top[i].bytes), profiler__percent(top[i].bytes, bytes));
+    if(nsites > PROFILER_REPORT_MAX_SITES)
+        fprintf(out, "   ... and %u more site%s\n", nsites - PROFILER_REPORT_MAX_SITES,
+                nsites - PROFILER_REPORT_MAX_SITES == 1 ? "" : "s");
+    free(top);
+}
+
+// Print a summary of every phase recorded so far to `out`
+void profiler_report(FILE* out) {
+    thread_once(&profilerOnce, profiler__init);
+    double ns_per_tick = clock_ns_per_tick(&profilerCalibration);
+
+    // Phases, by the phases they ran in (whatever the thread or the file)
+    ProfilerSummaries phases = { null, 0, 0, null, 0 };
+    // Files, each listing (by name) the phases that ran on it, with their self time
+    ProfilerSummaries files = { null, 0, 0, null, 0 };
+    ProfilerSummaries file_phases = { null, 0, 0, null, 0 };
+    // Allocation sites (merged by name), by the phase they allocated under (and listed by it)
+    ProfilerSummaries sites = { null, 0, 0, null, 0 };
+    // The sites outside of any phase
+    UInt32 outside = 0;
+    UInt64 total = 0;
+    UInt32 nthreads = 0;
+
+    thread_mutex_lock(&profilerLock);
+    for(ProfilerThread* thread = profilerThreads; thread != null; thread = thread->next) {
+        if(thread->nnodes == 0 && thread->nsites == 0)
+            continue;
+        nthreads += thread->nnodes > 0;
+        // Where each of the thread's nodes went. A node is added while its parent runs, so parents come first.
+        UInt32* merged = (UInt32*)calloc(thread->nnodes + 1, sizeof(UInt32));
+        CSTL_CHECK_NOT_NULL(merged, "Could not allocate memory. Memory full.");
+        for(UInt32 i = 0; i < thread->nnodes; i++) {
+            ProfilerNode* node = &thread->nodes[i];
+            UInt32 parent = node->parent == PROFILER_ROOT ? PROFILER_ROOT : merged[node->parent];
+            ProfilerSummary* phase = profiler__summary(&phases, parent, node->phase, node->depth, null);
+            merged[i] = (UInt32)(phase - phases.items);
+            phase->count += node->count;
+            phase->ticks += node->ticks;
+            phase->nested_ticks += node->nested_ticks;
+            phase->nallocs += node->nallocs;
+            phase->bytes += node->bytes;
+            phase->peak = CSTL_MAX(phase->peak, node->peak);
+            if(node->parent == PROFILER_ROOT)
+                total += node->ticks;
+
+            if(node->fname != null) {
+                UInt64 self = node->ticks - node->nested_ticks;
+                ProfilerSummary* file = profiler__summary(&files, PROFILER_ROOT, node->fname, 0, null);
+                file->ticks += self;
+                UInt32 f = (UInt32)(file - files.items);
+                profiler__summary(&file_phases, f, node->phase, 1, &file->first)->ticks += self;
+            }
+        }
+        for(UInt32 i = 0; i < thread->site_capacity; i++) {
+            const ProfilerSite* site = &thread->sites[i];
+            if(site->site == null)
+                continue;
+            UInt32 phase = site->node == PROFILER_ROOT ? PROFILER_ROOT : merged[site->node];
+            UInt32* list = phase == PROFILER_ROOT ? &outside : &phases.items[phase].first;
+            ProfilerSummary* summary = profiler__summary(&sites, phase, site->site, 0, list);
+            summary->nallocs += site->nallocs;
+            summary->bytes += site->bytes;
+        }
+        free(merged);
+    }
+    thread_mutex_unlock(&profilerLock);
+
+    fprintf(out, "\nTime report (%u thread%s, %s)\n", nthreads, nthreads == 1 ? "" : "s",
+            profilerCalibration.use_tsc ? "time-stamp counter" : "monotonic clock");
+    fprintf(out, " %-28s %24s %24s %10s\n", "Phase", "Total", "Self", "Runs");
+    profiler__print_phases(out, &phases, PROFILER_ROOT, total, ns_per_tick);
+    fprintf(out, " %-28s %12.3f ms\n", "TOTAL", (double)total * ns_per_tick * 1e-6);
+
+    // The slowest files, with the phases that took the longest on each
+    UInt32 nfiles = files.size;
+    if(nfiles > 0) {
+        ProfilerSummary* roots = (ProfilerSummary*)calloc(nfiles, sizeof(ProfilerSummary));
+        CSTL_CHECK_NOT_NULL(roots, "Could not allocate memory. Memory full.");
+        memcpy(roots, files.items, nfiles * sizeof(ProfilerSummary));
+        qsort(roots, nfiles, sizeof(ProfilerSummary), profiler__compare_ticks);
+
+        fprintf(out, "\n %-28s %24s   %s\n", "File", "Self", "Slowest phases");
+        for(UInt32 i = 0; i < nfiles && i < PROFILER_REPORT_MAX_FILES; i++) {
+            fprintf(out, " %-28s %12.3f ms (%5.1f%%)  ", roots[i].name, (double)roots[i].ticks * ns_per_tick * 1e-6,
+                    profiler__percent(roots[i].ticks, total));
+            profiler__print_slowest(out, &file_phases, roots[i].first, roots[i].ticks);
+            fprintf(out, "\n");
+        }
+        if(nfiles > PROFILER_REPORT_MAX_FILES)
+            fprintf(out, " ... and %u more file%s\n", nfiles - PROFILER_REPORT_MAX_FILES,
+                    nfiles - PROFILER_REPORT_MAX_FILES == 1 ? "" : "s");
+        free(roots);
+    }
+
+    // What the phases allocated, and where
+    const cstlCountingAllocator* totals = &profilerCounter;
+    if(totals->nallocs > 0) {
+        UInt64 outside_nallocs = 0, outside_bytes = 0;
+        for(UInt32 i = outside; i != 0; i = sites.items[i - 1].next) {
+            outside_nallocs += sites.items[i - 1].nallocs;
+            outside_bytes += sites.items[i - 1].bytes;
+        }
+
+        fprintf(out, "\nMemory report (%" CSTL_PRIu64 " allocations, %.3f MB allocated, %.3f MB at peak, "
+                "%.3f MB still held)\n", totals->nallocs, profiler__mb(totals->bytes), profiler__mb(totals->peak),
+                profiler__mb(totals->live));
+        fprintf(out, " %-28s %10s %15s %15s\n", "Phase", "Allocs", "Allocated", "Peak");
+        profiler__print_memory(out, &phases, PROFILER_ROOT);
+        if(outside_nallocs > 0)
+            fprintf(out, " %-28s %10" CSTL_PRIu64 " %12.3f MB\n", "(outside any phase)", outside_nallocs, 
+                    profiler__mb(outside_bytes));
+
+        fprintf(out, "\n %-42s %10s %15s\n", "Top allocation sites", "Allocs", "Allocated");
+        for(UInt32 i = 0; i < phases.size; i++) {
+            if(phases.items[i].nallocs == 0)
+                continue;
+            fprintf(out, " %*s%s\n", (int)(2 * phases.items[i].depth), "", phases.items[i].name);
+            profiler__print_sites(out, &sites, phases.items[i].first, phases.items[i].bytes);
+        }
+        if(outside_nallocs > 0) {
+            fprintf(out, " %s\n", "(outside any phase)");
+            profiler__print_sites(out, &sites, outside, outside_bytes);
+        }
+    }
+
+    profiler__free_summaries(&phases);
+    profiler__free_summaries(&files);
+    profiler__free_summaries(&file_phases);
+    profiler__free_summaries(&sites);
+}
+
+// Forget every phase recorded so far
+void profiler_reset(void) {
+    thread_once(&profilerOnce, profiler__init);
+    thread_mutex_lock(&profilerLock);
+    for(ProfilerThread* thread = profilerThreads; thread != null; thread = thread->next) {
+        thread->nnodes = 0;
+        thread->depth = 0;
+        if(thread->index != null)
+            memset(thread->index, 0, thread->index_capacity * sizeof(UInt32));
+        if(thread->sites != null)
+            memset(thread->sites, 0, thread->site_capacity * sizeof(ProfilerSite));
+        thread->nsites = 0;
+    }
+    thread_mutex_unlock(&profilerLock);
+}
+
+// Free everything the profiler has recorded
+void profiler_free(void) {
+    thread_once(&profilerOnce, profiler__init);
+    thread_mutex_lock(&profilerLock);
+    ProfilerThread* thread = profilerThreads;
+    while(thread != null) {
+        ProfilerThread* next = thread->next;
+        free(thread->nodes);
+        free(thread->index);
+        free(thread->sites);
+        free(thread);
+        thread = next;
+    }
+    profilerThreads = null;
+    profilerNthreads = 0;
+    ++profilerGeneration;
+    thread_mutex_unlock(&profilerLock);
+}
@@ -0,0 +1,150 @@
+/*
+_ _    _           ______   _______        
+| |  | |    /\    /___  /   |  ____|| |    
+| |__| |   /  \      / /    | |__   | |       Hazel - The Fast, Expressive & Elegant Programming Language
+|  __  |  / /\ \    / /     |  __|  | |       Languages: C, C++, and Assembly
+| |  | | / ____ \  / /___   | |____ | |____   https://github.com/HazelLang/hazel/
+|_|_ |_|/_/    \_\/_______\ |______|_\______|
+
+Licensed under the MIT License <http://opensource.org/licenses/MIT>
+SPDX-License-Identifier: MIT
+Copyright (c) 2021 Jason Dsouza <http://github.com/jasmcaus>
+*/
+
+#ifndef HAZEL_PROFILER_H
+#define HAZEL_PROFILER_H
+
+// Before any system header (see hazel/core/clock.h)
+#include <hazel/core/clock.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <hazel/core/math.h>
+#include <hazel/core/misc.h>
+#include <hazel/core/types.h>
+#include <hazel/core/thread.h>
+#include <hazel/compiler/allocator.h>
+
+/*
+    Where does the time of a build go? The profiler times the phases of the compiler (reading, lexing, parsing, ...)
+    as they run, for every file and on every thread, and sums them up in a report (`profiler_report()`) in the
+    spirit of GCC's `-ftime-report`.
+
+    Phases nest: a phase begun while another is running (on the same thread) is timed as a part of it, and the
+    report shows both the total time of a phase and its self time (the total minus that of its nested phases).
+    Every `profiler_begin()` must be matched by a `profiler_end()` on the same thread - `PROFILER_SCOPE()` does that
+    for a block (which must not be left with `return`, `break` or `goto`).
+
+    The profiler is off by default, and then costs a (predictable) branch per phase. When it is on, a phase costs two
+    reads of the time-stamp counter (or of the monotonic clock, without an invariant one - see hazel/core/clock.h)
+    and a lookup among the phases of the same parent. Each thread records its phases on its own, without any locks.
+
+    The profiler also keeps the books on memory: hand `profiler_allocator()` to `compiler_set_allocator()`, and every
+    allocation is charged to the (innermost) phase running on the thread that made it, and to the line it was made
+    on. The report then shows how many bytes each phase allocated, the most it held at once, and where it allocated
+    them.
+
+    Frees are charged to the thread that makes them, not to the one that allocated the block (that would take a 
+    lookup shared by all threads on every free). A block that changes threads - eg. the tokens of a chunk lexed on a 
+    worker of `lexer_lex_parallel()`, which the calling thread frees once it has stitched them together - counts as 
+    held by the worker until the end of the run, and drives the `live` count of the thread that frees it below what 
+    that thread allocated (even below 0). The bytes and sites of each phase are exact either way, but the peaks of the 
+    phases running on either thread at the time are only approximate.
+*/
+
+// The phases of the compiler. Any other (string literal) name works, too.
+#define PROFILER_READ               "read"
+#define PROFILER_LEX                "lex"
+#define PROFILER_PARSE              "parse"
+#define PROFILER_CHECK              "check"
+#define PROFILER_CODEGEN            "codegen"
+
+// How deep phases can be nested (deeper ones are folded into their parent)
+#define PROFILER_MAX_DEPTH          32
+// Phases are recorded under this parent when they're not nested in any other one
+#define PROFILER_ROOT               ((UInt32)-1)
+
+// A phase, as recorded by a thread: every distinct (parent, name, file) gets one
+typedef struct ProfilerNode {
+    const char* phase;
+    const char* fname;          // the file the phase ran on (null if none)
+    UInt32 parent;              // index of the enclosing phase, or PROFILER_ROOT
+    UInt32 depth;               // no. of enclosing phases
+    UInt64 count;               // no. of times the phase ran
+    UInt64 ticks;               // total time (in `clock_ticks()`), nested phases included
+    UInt64 nested_ticks;        // time spent in nested phases
+    UInt64 nallocs;             // no. of allocations made by the phase itself (see `profiler_allocator()`)
+    UInt64 bytes;               // no. of bytes allocated by the phase itself
+    UInt64 peak;                // the most bytes the phase (nested phases included) held at once, over any run
+    UInt64 hash;                // of (parent, phase, fname), for `ProfilerThread.index`
+} ProfilerNode;
+
+// A phase that is running
+typedef struct ProfilerFrame {
+    UInt32 node;
+    UInt64 start;
+    Int64 live;                 // bytes held by the thread when the phase began
+    Int64 peak;                 // the most bytes the thread has held since
+} ProfilerFrame;
+
+// The allocations made at one line (`site`, see CSTL_ALLOC_SITE) while a phase (`node`) was running
+typedef struct ProfilerSite {
+    const char* site;           // null for an empty slot
+    UInt32 node;                // PROFILER_ROOT outside of any phase
+    UInt64 nallocs;
+    UInt64 bytes;
+} ProfilerSite;
+
+// The phases recorded by one thread. Threads are chained (newest first) and live until `profiler_free()`.
+typedef struct ProfilerThread {
+    ProfilerNode* nodes;
+    UInt32 nnodes;
+    UInt32 capacity;
+    UInt32* index;              // open-addressed table of nodes by (parent, phase, fname): index + 1, or 0 if empty
+    UInt32 index_capacity;
+    ProfilerFrame frames[PROFILER_MAX_DEPTH];
+    UInt32 depth;               // no. of running phases (the deeper ones too)
+    UInt32 id;                  // 0 for the first thread to record a phase, 1 for the next one, ...
+    Int64 live;                 // bytes allocated, less the bytes freed, by this thread (can be < 0, see above)
+    ProfilerSite* sites;        // open-addressed table of allocation sites, by (site, node)
+    UInt32 nsites;
+    UInt32 site_capacity;
+    struct ProfilerThread* next;
+} ProfilerThread;
+
+// Turn the profiler on (or off). Phases that are running when this is called are not recorded properly - turn it
+// on before compiling anything.
+void profiler_enable(bool enable);
+// Is the profiler on?
+bool profiler_enabled(void);
+
+// Begin the phase `phase` (a string that must outlive the profiler, eg. one of PROFILER_*) on `fname`. If `fname`
+// is null, the phase runs on the file of the phase it's nested in (if any).
+void profiler_begin(const char* phase, const char* fname);
+// End the phase begun last (on this thread)
+void profiler_end(void);
+
+// Time the block that follows as `phase` on `fname`
+#define PROFILER_SCOPE(phase, fname)                                                                \
+    for(int CSTL_CONCATENATE(profiler__once_, __LINE__) = (profiler_begin((phase), (fname)), 0);   \
+        !CSTL_CONCATENATE(profiler__once_, __LINE__);                                               \
+        CSTL_CONCATENATE(profiler__once_, __LINE__) = (profiler_end(), 1))
+
+// Returns an allocator (over the heap) that charges every allocation to the phase running on the calling thread, 
+// and to the line it was made on. It keeps count whether or not the profiler is on (phases are only recorded when
+// it is).
+cstlAllocator* profiler_allocator(void);
+// Returns the totals of everything allocated from `profiler_allocator()` so far (over all threads and phases)
+const cstlCountingAllocator* profiler_allocator_totals(void);
+
+// Print a summary of every phase recorded so far to `out`: per phase (merged over all threads and files, nested
+// under the phases they ran in) and per file - followed by what they allocated, if anything was allocated from
+// `profiler_allocator()`.
+// The threads that recorded them must be done (or at least be between phases) - their records aren't locked.
+void profiler_report(FILE* out);
+// Forget every phase recorded so far (no phase may be running)
+void profiler_reset(void);
+// Free everything the profiler has recorded. It can be used again afterwards.
+void profiler_free(void);
+
+#endif // HAZEL_PROFILER_H
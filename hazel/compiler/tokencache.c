@@ -0,0 +1,388 @@
+/*
+_ _    _           ______   _______        
+| |  | |    /\    /___  /   |  ____|| |    
+| |__| |   /  \      / /    | |__   | |       Hazel - The Fast, Expressive & Elegant Programming Language
+|  __  |  / /\ \    / /     |  __|  | |       Languages: C, C++, and Assembly
+| |  | | / ____ \  / /___   | |____ | |____   https://github.com/HazelLang/hazel/
+|_|_ |_|/_/    \_\/_______\ |______|_\______|
+
+Licensed under the MIT License <http://opensource.org/licenses/MIT>
+SPDX-License-Identifier: MIT
+Copyright (c) 2021 Jason Dsouza <http://github.com/jasmcaus>
+*/
+
+
+// Before any system header - it sets the feature macros `io.h` relies on (mmap()'s MAP_ANONYMOUS)
+#include <hazel/core/headers.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <hazel/core/debug.h>
+#include <hazel/core/endian.h>
+#include <hazel/core/hash.h>
+#include <hazel/core/io.h>
+#include <hazel/compiler/allocator.h>
+#include <hazel/compiler/tokencache.h>
+
+#if defined(CSTL_OS_WINDOWS)
+    #include <process.h>
+    #define token_cache__getpid()       _getpid()
+#else
+    #include <unistd.h>
+    #define token_cache__getpid()       getpid()
+#endif // CSTL_OS_WINDOWS
+
+// Where each section of a cache file begins (see tokencache.h)
+typedef struct TokenCacheLayout {
+    UInt64 token_kinds, token_offsets, token_lengths, token_strings;
+    UInt64 literal_offsets, literal_values;
+    UInt64 comment_kinds, comment_offsets, comment_lengths, comment_tokens;
+    UInt64 string_offsets, string_lengths, string_bytes;
+    UInt64 size;                // size of the whole file
+} TokenCacheLayout;
+
+// Returns the hash of the `length` bytes at `data` (the low half of `hash_bytes128()`, with a seed of 0)
+// Sources can be large, so this runs eight lanes over 64 bytes at a time (vectorized where the CPU allows).
+UInt64 token_cache_hash(const void* data, UInt64 length) {
+    return hash_bytes128(data, length, 0).low;
+}
+
+// Write the path of the cache file for a source with hash `source_hash` in `directory` to `path`
+bool token_cache_path(char* path, UInt64 size, const char* directory, UInt64 source_hash) {
+    int written = snprintf(path, (size_t)size, "%s/%016llx" TOKEN_CACHE_EXTENSION, directory, 
+                           (unsigned long long)source_hash);
+    return written > 0 && (UInt64)written < size;
+}
+
+static inline UInt64 token_cache__align8(UInt64 offset) {
+    return (offset + 7) & ~(UInt64)7;
+}
+
+// Work out where each section described by `header` begins
+static void token_cache__layout(const TokenCacheHeader* header, TokenCacheLayout* layout) {
+    UInt64 n = header->ntokens;
+    UInt64 offset = TOKEN_CACHE_HEADER_SIZE;
+
+    layout->token_kinds = offset;       offset = token_cache__align8(offset + n);
+    layout->token_offsets = offset;     offset = token_cache__align8(offset + n * 4);
+    layout->token_lengths = offset;     offset = token_cache__align8(offset + n * 4);
+    layout->token_strings = offset;     offset = token_cache__align8(offset + n * 4);
+
+    n = header->nliterals;
+    layout->literal_offsets = offset;   offset = token_cache__align8(offset + n * 4);
+    layout->literal_values = offset;    offset = token_cache__align8(offset + n * 8);
+
+    n = header->ncomments;
+    layout->comment_kinds = offset;     offset = token_cache__align8(offset + n);
+    layout->comment_offsets = offset;   offset = token_cache__align8(offset + n * 4);
+    layout->comment_lengths = offset;   offset = token_cache__align8(offset + n * 4);
+    layout->comment_tokens = offset;    offset = token_cache__align8(offset + n * 4);
+
+    n = header->nstrings;
+    layout->string_offsets = offset;    offset = token_cache__align8(offset + n * 4);
+    layout->string_lengths = offset;    offset = token_cache__align8(offset + n * 4);
+    layout->string_bytes = offset;      offset = token_cache__align8(offset + header->strings_length);
+
+    layout->size = offset;
+}
+
+// Copy `n` UInt32s to (or from) their little-endian representation
+static void token_cache__store32s(char* out, const UInt32* in, UInt32 n) {
+    if(!native_is_big_endian) {
+        memcpy(out, in, (UInt64)n * sizeof(UInt32));
+        return;
+    }
+    for(UInt32 i = 0; i < n; i++)
+        endian_store_le32(out + (UInt64)i * 4, in[i]);
+}
+
+static void token_cache__load32s(UInt32* out, const char* in, UInt32 n) {
+    if(!native_is_big_endian) {
+        memcpy(out, in, (UInt64)n * sizeof(UInt32));
+        return;
+    }
+    for(UInt32 i = 0; i < n; i++)
+        out[i] = endian_load_le32(in + (UInt64)i * 4);
+}
+
+static void token_cache__write_header(char* out, const TokenCacheHeader* header) {
+    memcpy(out, header->magic, 8);
+    endian_store_le32(out + 8, header->version);
+    endian_store_le32(out + 12, header->nkinds);
+    endian_store_le64(out + 16, header->source_hash);
+    endian_store_le64(out + 24, header->checksum);
+    endian_store_le32(out + 32, header->source_length);
+    endian_store_le32(out + 36, header->ntokens);
+    endian_store_le32(out + 40, header->nliterals);
+    endian_store_le32(out + 44, header->ncomments);
+    endian_store_le32(out + 48, header->nstrings);
+    endian_store_le32(out + 52, header->strings_length);
+}
+
+static void token_cache__read_header(TokenCacheHeader* header, const char* in) {
+    memcpy(header->magic, in, 8);
+    header->version = endian_load_le32(in + 8);
+    header->nkinds = endian_load_le32(in + 12);
+    header->source_hash = endian_load_le64(in + 16);
+    header->checksum = endian_load_le64(in + 24);
+    header->source_length = endian_load_le32(in + 32);
+    header->ntokens = endian_load_le32(in + 36);
+    header->nliterals = endian_load_le32(in + 40);
+    header->ncomments = endian_load_le32(in + 44);
+    header->nstrings = endian_load_le32(in + 48);
+    header->strings_length = endian_load_le32(in + 52);
+}
+
+// Gives every distinct Symbol in `tokens` an index into the string table (`strings[i]` is the index + 1 of the 
+// `i`th token's name, or 0 if it has none). Returns the no. of distinct Symbols, and stores them in `symbols`
+// (allocated from `arena`, as is everything else this needs).
+static UInt32 token_cache__number_symbols(const TokenStream* tokens, UInt32* strings, Symbol** symbols, 
+                                          cstlArena* arena) {
+    // Open-addressed map from a Symbol to its index + 1 (Symbols are never 0, so 0 marks an empty slot)
+    UInt32 capacity = 64;
+    while(capacity < tokens->size * 2)
+        capacity *= 2;
+    Symbol* keys = (Symbol*)arena_alloc_zeroed(arena, (UInt64)capacity * sizeof(Symbol));
+    UInt32* values = (UInt32*)arena_alloc(arena, (UInt64)capacity * sizeof(UInt32));
+    Symbol* distinct = (Symbol*)arena_alloc(arena, ((UInt64)tokens->size + 1) * sizeof(Symbol));
+
+    UInt32 count = 0;
+    for(UInt32 i = 0; i < tokens->size; i++) {
+        Symbol symbol = tokens->symbols[i];
+        if(symbol == SYMBOL_NONE) {
+            strings[i] = 0;
+            continue;
+        }
+
+        UInt32 slot = (symbol * 0x9E3779B1u) & (capacity - 1);
+        while(keys[slot] != SYMBOL_NONE && keys[slot] != symbol)
+            slot = (slot + 1) & (capacity - 1);
+        if(keys[slot] == SYMBOL_NONE) {
+            keys[slot] = symbol;
+            values[slot] = ++count;
+            distinct[count - 1] = symbol;
+        }
+        strings[i] = values[slot];
+    }
+
+    *symbols = distinct;
+    return count;
+}
+
+// Write `data` to the cache file at `path`
+int token_cache_save(const char* path, UInt64 source_hash, UInt32 source_length, const TokenCacheData* data) {
+    const TokenStream* tokens = data->tokens;
+    const LiteralTable* literals = data->literals;
+    const CommentTable* comments = data->comments;
+
+    // Everything below is only needed until the file has been written
+    cstlArena* scratch = compiler_scratch(null);
+    cstlArenaMark mark = arena_mark(scratch);
+
+    UInt32* strings = (UInt32*)arena_alloc(scratch, ((UInt64)tokens->size + 1) * sizeof(UInt32));
+    Symbol* symbols;
+    UInt32 nstrings = token_cache__number_symbols(tokens, strings, &symbols, scratch);
+
+    TokenCacheHeader header;
+    memcpy(header.magic, TOKEN_CACHE_MAGIC, 8);
+    header.version = TOKEN_CACHE_VERSION;
+    header.nkinds = TOK_COUNT;
+    header.source_hash = source_hash;
+    header.checksum = 0;
+    header.source_length = source_length;
+    header.ntokens = tokens->size;
+    header.nliterals = literals->size;
+    header.ncomments = comments->size;
+    header.nstrings = nstrings;
+    UInt64 strings_length = 0;
+    for(UInt32 s = 0; s < nstrings; s++) {
+        UInt32 length;
+        interner_string(data->interner, symbols[s], &length);
+        strings_length += length;
+    }
+    CSTL_CHECK_LE(strings_length, UInt32_MAX);
+    header.strings_length = (UInt32)strings_length;
+
+    TokenCacheLayout layout;
+    token_cache__layout(&header, &layout);
+    // Zeroed, so that the padding between sections is deterministic (it is covered by the checksum)
+    char* out = (char*)arena_alloc_zeroed(scratch, layout.size);
+
+    memcpy(out + layout.token_kinds, tokens->kinds, tokens->size);
+    token_cache__store32s(out + layout.token_offsets, tokens->offsets, tokens->size);
+    token_cache__store32s(out + layout.token_lengths, tokens->lengths, tokens->size);
+    token_cache__store32s(out + layout.token_strings, strings, tokens->size);
+
+    token_cache__store32s(out + layout.literal_offsets, literals->offsets, literals->size);
+    for(UInt32 i = 0; i < literals->size; i++)
+        endian_store_le64(out + layout.literal_values + (UInt64)i * 8, literals->values[i].integer);
+
+    memcpy(out + layout.comment_kinds, comments->kinds, comments->size);
+    token_cache__store32s(out + layout.comment_offsets, comments->offsets, comments->size);
+    token_cache__store32s(out + layout.comment_lengths, comments->lengths, comments->size);
+    token_cache__store32s(out + layout.comment_tokens, comments->tokens, comments->size);
+
+    UInt32 string_offset = 0;
+    for(UInt32 s = 0; s < nstrings; s++) {
+        UInt32 length;
+        const char* string = interner_string(data->interner, symbols[s], &length);
+        endian_store_le32(out + layout.string_offsets + (UInt64)s * 4, string_offset);
+        endian_store_le32(out + layout.string_lengths + (UInt64)s * 4, length);
+        memcpy(out + layout.string_bytes + string_offset, string, length);
+        string_offset += length;
+    }
+
+    header.checksum = token_cache_hash(out + TOKEN_CACHE_HEADER_SIZE, layout.size - TOKEN_CACHE_HEADER_SIZE);
+    token_cache__write_header(out, &header);
+
+    // Write to a file of our own, and move it into place in one step - other builds may be reading (or writing) 
+    // the same cache file
+    int error = 0;
+    UInt64 tmp_size = strlen(path) + 32;
+    char* tmp_path = (char*)arena_alloc_aligned(scratch, tmp_size, 1);
+    snprintf(tmp_path, (size_t)tmp_size, "%s.%d.tmp", path, (int)token_cache__getpid());
+
+    FILE* file = fopen(tmp_path, "wb");
+    if(file == null) {
+        error = errno;
+    } else {
+        if(fwrite(out, 1, (size_t)layout.size, file) != layout.size)
+            error = errno ? errno : EIO;
+        if(fclose(file) != 0 && error == 0)
+            error = errno;
+#if defined(CSTL_OS_WINDOWS)
+        // `rename()` doesn't replace an existing file on Windows
+        if(error == 0)
+            remove(path);
+#endif // CSTL_OS_WINDOWS
+        if(error == 0 && rename(tmp_path, path) != 0)
+            error = errno;
+        if(error != 0)
+            remove(tmp_path);
+    }
+
+    arena_restore(scratch, mark);
+    return error;
+}
+
+// Is every kind, span and index in the cache file `in` (of which `header` and `layout` are already known to be 
+// right) within bounds? Whatever is loaded is trusted from then on - token spans are read from the source, and 
+// kinds and indices index tables.
+static bool token_cache__check(const char* in, const TokenCacheHeader* header, const TokenCacheLayout* layout) {
+    for(UInt32 i = 0; i < header->ntokens; i++) {
+        UInt64 offset = endian_load_le32(in + layout->token_offsets + (UInt64)i * 4);
+        UInt64 length = endian_load_le32(in + layout->token_lengths + (UInt64)i * 4);
+        if((UInt8)in[layout->token_kinds + i] >= TOK_COUNT || offset + length > header->source_length || 
+           endian_load_le32(in + layout->token_strings + (UInt64)i * 4) > header->nstrings)
+            return false;
+    }
+
+    // Literals are looked up by offset, so they must be in ascending order
+    UInt64 previous = 0;
+    for(UInt32 i = 0; i < header->nliterals; i++) {
+        UInt64 offset = endian_load_le32(in + layout->literal_offsets + (UInt64)i * 4);
+        if(offset >= header->source_length || (i > 0 && offset <= previous))
+            return false;
+        previous = offset;
+    }
+
+    // A comment can be followed by the end of the tokens (index `ntokens`)
+    previous = 0;
+    for(UInt32 c = 0; c < header->ncomments; c++) {
+        TokenKind kind = (TokenKind)(UInt8)in[layout->comment_kinds + c];
+        UInt64 offset = endian_load_le32(in + layout->comment_offsets + (UInt64)c * 4);
+        UInt64 length = endian_load_le32(in + layout->comment_lengths + (UInt64)c * 4);
+        UInt64 token = endian_load_le32(in + layout->comment_tokens + (UInt64)c * 4);
+        if((kind != COMMENT && kind != DOCS_COMMENT) || offset + length > header->source_length || 
+           token > header->ntokens || token < previous)
+            return false;
+        previous = token;
+    }
+
+    for(UInt32 s = 0; s < header->nstrings; s++) {
+        UInt64 offset = endian_load_le32(in + layout->string_offsets + (UInt64)s * 4);
+        UInt64 length = endian_load_le32(in + layout->string_lengths + (UInt64)s * 4);
+        if(offset + length > header->strings_length)
+            return false;
+    }
+    return true;
+}
+
+// Load the cache file at `path` into `data`, provided it is valid and matches the source
+bool token_cache_load(const char* path, UInt64 source_hash, UInt32 source_length, TokenCacheData* data) {
+    cstlFile file;
+    if(file_load(&file, path) != 0)
+        return false;
+
+    const char* in = file.data;
+    TokenCacheHeader header;
+    TokenCacheLayout layout;
+    bool valid = file.length >= TOKEN_CACHE_HEADER_SIZE;
+    if(valid) {
+        token_cache__read_header(&header, in);
+        valid = memcmp(header.magic, TOKEN_CACHE_MAGIC, 8) == 0 && 
+                header.version == TOKEN_CACHE_VERSION && 
+                header.nkinds == TOK_COUNT && 
+                header.source_hash == source_hash && 
+                header.source_length == source_length;
+    }
+    if(valid) {
+        token_cache__layout(&header, &layout);
+        valid = layout.size == file.length && 
+                token_cache_hash(in + TOKEN_CACHE_HEADER_SIZE, file.length - TOKEN_CACHE_HEADER_SIZE) == header.checksum;
+    }
+    // The checksum catches a damaged file, not one that was made wrong (anyone can recompute it)
+    valid = valid && token_cache__check(in, &header, &layout);
+    if(!valid) {
+        file_unload(&file);
+        return false;
+    }
+
+    // Intern the names again - Symbols don't carry over from one run to the next. They're only needed until the 
+    // tokens have been loaded.
+    cstlArena* scratch = compiler_scratch(null);
+    cstlArenaMark mark = arena_mark(scratch);
+    Symbol* symbols = (Symbol*)arena_alloc(scratch, ((UInt64)header.nstrings + 1) * sizeof(Symbol));
+    symbols[0] = SYMBOL_NONE;
+    for(UInt32 s = 0; s < header.nstrings; s++) {
+        UInt32 offset = endian_load_le32(in + layout.string_offsets + (UInt64)s * 4);
+        UInt32 length = endian_load_le32(in + layout.string_lengths + (UInt64)s * 4);
+        symbols[s + 1] = interner_intern(data->interner, in + layout.string_bytes + offset, length);
+    }
+
+    TokenStream* tokens = data->tokens;
+    UInt32 n = header.ntokens;
+    tokens->size = 0;
+    token_stream_reserve(tokens, n);
+    memcpy(tokens->kinds, in + layout.token_kinds, n);
+    token_cache__load32s(tokens->offsets, in + layout.token_offsets, n);
+    token_cache__load32s(tokens->lengths, in + layout.token_lengths, n);
+    token_cache__load32s(tokens->symbols, in + layout.token_strings, n);
+    for(UInt32 i = 0; i < n; i++)
+        tokens->symbols[i] = symbols[tokens->symbols[i]];
+    tokens->size = n;
+
+    LiteralTable* literals = data->literals;
+    n = header.nliterals;
+    literals->size = 0;
+    literal_table_reserve(literals, n);
+    token_cache__load32s(literals->offsets, in + layout.literal_offsets, n);
+    for(UInt32 i = 0; i < n; i++)
+        literals->values[i].integer = endian_load_le64(in + layout.literal_values + (UInt64)i * 8);
+    literals->size = n;
+
+    CommentTable* comments = data->comments;
+    n = header.ncomments;
+    comments->size = 0;
+    comment_table_reserve(comments, n);
+    memcpy(comments->kinds, in + layout.comment_kinds, n);
+    token_cache__load32s(comments->offsets, in + layout.comment_offsets, n);
+    token_cache__load32s(comments->lengths, in + layout.comment_lengths, n);
+    token_cache__load32s(comments->tokens, in + layout.comment_tokens, n);
+    comments->size = n;
+
+    arena_restore(scratch, mark);
+    file_unload(&file);
+    return true;
+}
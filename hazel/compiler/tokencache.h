@@ -0,0 +1,87 @@
+/*
+_ _    _           ______   _______        
+| |  | |    /\    /___  /   |  ____|| |    
+| |__| |   /  \      / /    | |__   | |       Hazel - The Fast, Expressive & Elegant Programming Language
+|  __  |  / /\ \    / /     |  __|  | |       Languages: C, C++, and Assembly
+| |  | | / ____ \  / /___   | |____ | |____   https://github.com/HazelLang/hazel/
+|_|_ |_|/_/    \_\/_______\ |______|_\______|
+
+Licensed under the MIT License <http://opensource.org/licenses/MIT>
+SPDX-License-Identifier: MIT
+Copyright (c) 2021 Jason Dsouza <http://github.com/jasmcaus>
+*/
+
+
+#ifndef HAZEL_TOKENCACHE_H
+#define HAZEL_TOKENCACHE_H
+
+#include <hazel/core/types.h>
+#include <hazel/compiler/tokens.h>
+#include <hazel/compiler/intern.h>
+
+/*
+    The tokens of a source file only depend on its contents. Most files are unchanged from one build to the next, so 
+    the result of lexing them is cached on disk (in a `.hzltok` file named after the hash of the source), and is 
+    loaded back instead of lexing the file again.
+
+    A `.hzltok` file is laid out as follows. Every integer is little-endian and every section begins on an 8-byte 
+    boundary (sections are zero-padded):
+
+        Header (TOKEN_CACHE_HEADER_SIZE bytes, see `TokenCacheHeader`)
+        Tokens:     UInt8 kinds[ntokens], UInt32 offsets[ntokens], UInt32 lengths[ntokens], 
+                    UInt32 strings[ntokens] (the string table index + 1 of each IDENTIFIER's name, 0 for the rest)
+        Literals:   UInt32 offsets[nliterals], UInt64 values[nliterals] (Float64s are stored as their bits)
+        Comments:   UInt8 kinds[ncomments], UInt32 offsets[ncomments], UInt32 lengths[ncomments], 
+                    UInt32 tokens[ncomments]
+        Strings:    UInt32 offsets[nstrings], UInt32 lengths[nstrings], char bytes[strings_length]
+
+    Symbols are only meaningful within a single run, so identifiers are stored as strings (each distinct one once), 
+    and are interned again when the cache is loaded.
+
+    A cache file is only used if its version, its token kinds and the hash and length of the source all match, and 
+    if the checksum of everything after the header is right - anything else is treated as a miss.
+*/
+
+#define TOKEN_CACHE_MAGIC           "HZLTOK\r\n"
+// Bump this whenever the layout above, what the Lexer produces for a given source, or `token_cache_hash()` changes
+#define TOKEN_CACHE_VERSION         2
+#define TOKEN_CACHE_EXTENSION       ".hzltok"
+#define TOKEN_CACHE_HEADER_SIZE     64
+
+typedef struct TokenCacheHeader {
+    char magic[8];              // TOKEN_CACHE_MAGIC
+    UInt32 version;             // TOKEN_CACHE_VERSION
+    UInt32 nkinds;              // TOK_COUNT (the token kinds must not have been renumbered)
+    UInt64 source_hash;         // `token_cache_hash()` of the source
+    UInt64 checksum;            // `token_cache_hash()` of everything after the header
+    UInt32 source_length;       // no. of bytes in the source
+    UInt32 ntokens;
+    UInt32 nliterals;
+    UInt32 ncomments;
+    UInt32 nstrings;
+    UInt32 strings_length;      // no. of bytes of string data
+} TokenCacheHeader;
+
+// Everything a cache file holds
+typedef struct TokenCacheData {
+    TokenStream* tokens;
+    LiteralTable* literals;
+    CommentTable* comments;
+    Interner* interner;         // where the tokens' Symbols were (or are to be) interned
+} TokenCacheData;
+
+// Returns the hash of the `length` bytes at `data` (the low half of `hash_bytes128()`, with a seed of 0)
+UInt64 token_cache_hash(const void* data, UInt64 length);
+// Write the path of the cache file for a source with hash `source_hash` in `directory` to `path` (which can hold 
+// `size` bytes). Returns `false` if it doesn't fit.
+bool token_cache_path(char* path, UInt64 size, const char* directory, UInt64 source_hash);
+
+// Write `data` to the cache file at `path`. The file is written to a temporary file first and then renamed, so 
+// that a reader never sees a half-written cache.
+// Returns 0 on success, or an `errno` value.
+int token_cache_save(const char* path, UInt64 source_hash, UInt32 source_length, const TokenCacheData* data);
+// Load the cache file at `path` into `data` (whose tables are replaced), provided it is valid and was made from a 
+// source with this hash and length. Returns `false` (leaving `data` untouched) otherwise.
+bool token_cache_load(const char* path, UInt64 source_hash, UInt32 source_length, TokenCacheData* data);
+
+#endif // HAZEL_TOKENCACHE_H
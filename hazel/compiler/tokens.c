@@ -11,6 +11,10 @@ SPDX-License-Identifier: MIT
 Copyright (c) 2021 Jason Dsouza <http://github.com/jasmcaus>
 */
 
+// Before any system header - it sets the feature macros `vmem.h` relies on (mmap()'s MAP_ANONYMOUS)
+#include <hazel/core/headers.h>
+#include <string.h>
+#include <hazel/core/vmem.h>
 #include <hazel/compiler/tokens.h>
 
 // Token constructor
@@ -18,11 +22,8 @@ Token* token_init() {
     Token* token = calloc(1, sizeof(Token));
     token->kind = TOK_ILLEGAL;
     token->offset = 0;
-    token->value = "";
-    token->start = 0;
-    token->lineno = 1;
-    token->colno = 1;
-    token->fname = "";
+    token->length = 0;
+    token->symbol = SYMBOL_NONE;
 
     return token;
 }
@@ -31,10 +32,443 @@ Token* token_init() {
 void token_reset_token(Token* token) {
     token->kind = TOK_ILLEGAL; 
     token->offset = 0; 
-    token->value = "";
-    token->lineno = 0; 
-    token->colno = 0; 
-    token->fname = "";
+    token->length = 0;
+    token->symbol = SYMBOL_NONE;
+}
+
+// Initialize `stream` with room for `capacity` tokens
+void token_stream_init(TokenStream* stream, const char* fname, UInt32 capacity) {
+    stream->kinds = null;
+    stream->offsets = null;
+    stream->lengths = null;
+    stream->symbols = null;
+    stream->size = 0;
+    stream->capacity = 0;
+    stream->fname = fname ? fname : "";
+    stream->allocator = compiler_allocator();
+    stream->reserved = null;
+    stream->reserved_size = 0;
+    stream->reserved_capacity = 0;
+    stream->reserved_granularity = 0;
+    token_stream_reserve(stream, capacity);
+}
+
+// Size of the part of a reserved stream holding `capacity` elements of `objsize` bytes
+static inline UInt64 token_stream__reserved_bytes(const TokenStream* stream, UInt64 capacity, UInt64 objsize) {
+    return vmem__align(capacity * objsize, stream->reserved_granularity);
+}
+
+// Initialize `stream`, reserving address space for `max_tokens` tokens
+void token_stream_init_reserved(TokenStream* stream, const char* fname, UInt32 max_tokens) {
+    token_stream_init(stream, fname, 0);
+    bool huge_pages = max_tokens >= TOKEN_STREAM_HUGE_PAGES_MIN;
+    stream->reserved_granularity = (UInt32)(huge_pages ? CSTL_VMEM_HUGE_PAGE_SIZE 
+                                                       : CSTL_MAX(vmem_page_size(), CSTL_VMEM_COMMIT_GRANULARITY));
+
+    // One range, split into an array for each field
+    UInt64 kinds = token_stream__reserved_bytes(stream, max_tokens, sizeof(UInt8));
+    UInt64 offsets = token_stream__reserved_bytes(stream, max_tokens, sizeof(UInt32));
+    UInt64 symbols = token_stream__reserved_bytes(stream, max_tokens, sizeof(Symbol));
+    UInt64 size = kinds + 2 * offsets + symbols;
+    char* reserved = (char*)vmem_reserve(size, huge_pages);
+    if(reserved == null) {
+        stream->reserved_granularity = 0;
+        return;
+    }
+
+    stream->reserved = reserved;
+    stream->reserved_size = size;
+    stream->reserved_capacity = max_tokens;
+    stream->kinds = (UInt8*)reserved;
+    stream->offsets = (UInt32*)(reserved + kinds);
+    stream->lengths = (UInt32*)(reserved + kinds + offsets);
+    stream->symbols = (Symbol*)(reserved + kinds + 2 * offsets);
+}
+
+// Commit enough of a reserved stream's arrays for at least `capacity` tokens (but no more than it was reserved for)
+static void token_stream__commit(TokenStream* stream, UInt32 capacity) {
+    // Commit 1.5 times as much as before (at least), so that a growing stream only commits O(log n) times
+    UInt64 target = CSTL_MAX((UInt64)capacity, (UInt64)stream->capacity + stream->capacity/2);
+    target = CSTL_MIN(target, (UInt64)stream->reserved_capacity);
+
+    void* arrays[4] = { stream->kinds, stream->offsets, stream->lengths, stream->symbols };
+    UInt64 sizes[4] = { sizeof(UInt8), sizeof(UInt32), sizeof(UInt32), sizeof(Symbol) };
+    for(int i = 0; i < 4; i++) {
+        UInt64 committed = token_stream__reserved_bytes(stream, stream->capacity, sizes[i]);
+        UInt64 needed = token_stream__reserved_bytes(stream, target, sizes[i]);
+        if(needed > committed)
+            CSTL_CHECK(vmem_commit((char*)arrays[i] + committed, needed - committed), 
+                       "Could not commit memory. Memory full.");
+    }
+    stream->capacity = (UInt32)target;
+}
+
+// Move the tokens of a reserved stream into the heap, and release its address space
+static void token_stream__unreserve(TokenStream* stream) {
+    cstlAllocator* allocator = stream->allocator;
+    UInt64 capacity = stream->capacity;
+    UInt8* kinds = (UInt8*)CSTL_ALLOC(allocator, capacity * sizeof(UInt8));
+    UInt32* offsets = (UInt32*)CSTL_ALLOC(allocator, capacity * sizeof(UInt32));
+    UInt32* lengths = (UInt32*)CSTL_ALLOC(allocator, capacity * sizeof(UInt32));
+    Symbol* symbols = (Symbol*)CSTL_ALLOC(allocator, capacity * sizeof(Symbol));
+    CSTL_CHECK((kinds && offsets && lengths && symbols) || capacity == 0, "Could not allocate memory. Memory full.");
+
+    memcpy(kinds, stream->kinds, stream->size * sizeof(UInt8));
+    memcpy(offsets, stream->offsets, stream->size * sizeof(UInt32));
+    memcpy(lengths, stream->lengths, stream->size * sizeof(UInt32));
+    memcpy(symbols, stream->symbols, stream->size * sizeof(Symbol));
+    vmem_release(stream->reserved, stream->reserved_size);
+    stream->kinds = kinds;
+    stream->offsets = offsets;
+    stream->lengths = lengths;
+    stream->symbols = symbols;
+    stream->reserved = null;
+    stream->reserved_size = 0;
+    stream->reserved_capacity = 0;
+}
+
+// Free `stream` from its associated memory
+void token_stream_free(TokenStream* stream) {
+    UInt64 capacity = stream->capacity;
+    if(stream->reserved != null) {
+        vmem_release(stream->reserved, stream->reserved_size);
+        stream->reserved = null;
+        stream->reserved_size = 0;
+        stream->reserved_capacity = 0;
+        stream->kinds = null;
+        stream->offsets = null;
+        stream->lengths = null;
+        stream->symbols = null;
+        capacity = 0;
+    }
+    CSTL_FREE(stream->allocator, stream->kinds, capacity * sizeof(UInt8));
+    CSTL_FREE(stream->allocator, stream->offsets, capacity * sizeof(UInt32));
+    CSTL_FREE(stream->allocator, stream->lengths, capacity * sizeof(UInt32));
+    CSTL_FREE(stream->allocator, stream->symbols, capacity * sizeof(Symbol));
+    stream->kinds = null;
+    stream->offsets = null;
+    stream->lengths = null;
+    stream->symbols = null;
+    stream->size = 0;
+    stream->capacity = 0;
+}
+
+// Make sure `stream` can hold at least `capacity` tokens
+// Returns `true` if the stream had to be reallocated
+bool token_stream_reserve(TokenStream* stream, UInt32 capacity) {
+    if(capacity <= stream->capacity)
+        return false;
+    if(stream->reserved != null) {
+        // Grown in place - nothing was reallocated
+        if(capacity <= stream->reserved_capacity) {
+            token_stream__commit(stream, capacity);
+            return false;
+        }
+        token_stream__unreserve(stream);
+    }
+
+    cstlAllocator* allocator = stream->allocator;
+    UInt64 old = stream->capacity;
+    stream->kinds = (UInt8*)CSTL_RESIZE(allocator, stream->kinds, old * sizeof(UInt8), capacity * sizeof(UInt8));
+    stream->offsets = (UInt32*)CSTL_RESIZE(allocator, stream->offsets, old * sizeof(UInt32), 
+                                           capacity * sizeof(UInt32));
+    stream->lengths = (UInt32*)CSTL_RESIZE(allocator, stream->lengths, old * sizeof(UInt32), 
+                                           capacity * sizeof(UInt32));
+    stream->symbols = (Symbol*)CSTL_RESIZE(allocator, stream->symbols, old * sizeof(Symbol), 
+                                           capacity * sizeof(Symbol));
+    CSTL_CHECK(stream->kinds && stream->offsets && stream->lengths && stream->symbols, 
+               "Could not allocate memory. Memory full.");
+
+    stream->capacity = capacity;
+    return true;
+}
+
+// Append a token to the end of `stream`
+// Returns `true` if the stream had to be reallocated
+bool token_stream_push(TokenStream* stream, TokenKind kind, UInt32 offset, UInt32 length, Symbol symbol) {
+    bool grown = false;
+    // Grow by a factor of 1.5
+    if(stream->size == stream->capacity) {
+        UInt32 capacity = stream->capacity + stream->capacity/2 + 16;
+        // A reserved stream commits 1.5 times as much on its own - it only has to move once it is full
+        if(stream->reserved != null && stream->capacity < stream->reserved_capacity)
+            capacity = stream->size + 1;
+        grown = token_stream_reserve(stream, capacity);
+    }
+
+    UInt32 i = stream->size++;
+    stream->kinds[i] = (UInt8)kind;
+    stream->offsets[i] = offset;
+    stream->lengths[i] = length;
+    stream->symbols[i] = symbol;
+    return grown;
+}
+
+// Returns the `i`th token in `stream`
+Token token_stream_at(const TokenStream* stream, UInt32 i) {
+    Token token;
+    CSTL_CHECK_LT(i, stream->size);
+
+    token.kind = TOKEN_KIND(stream, i);
+    token.offset = stream->offsets[i];
+    token.length = stream->lengths[i];
+    token.symbol = stream->symbols[i];
+    return token;
+}
+
+// Replace the `nremoved` tokens starting at index `first` with the tokens in `with`, and move the offsets of every 
+// token after them by `shift` bytes
+void token_stream_splice(TokenStream* stream, UInt32 first, UInt32 nremoved, const TokenStream* with, Int64 shift) {
+    CSTL_CHECK_LE(first + nremoved, stream->size);
+    UInt32 tail = first + nremoved;           // first token that is kept after the splice
+    UInt32 ntail = stream->size - tail;       // no. of tokens kept after the splice
+    UInt32 size = stream->size - nremoved + with->size;
+    token_stream_reserve(stream, size);
+
+    UInt32 moved = first + with->size;        // where the kept tokens end up
+    if(moved != tail) {
+        memmove(stream->kinds + moved, stream->kinds + tail, ntail * sizeof(UInt8));
+        memmove(stream->offsets + moved, stream->offsets + tail, ntail * sizeof(UInt32));
+        memmove(stream->lengths + moved, stream->lengths + tail, ntail * sizeof(UInt32));
+        memmove(stream->symbols + moved, stream->symbols + tail, ntail * sizeof(Symbol));
+    }
+    memcpy(stream->kinds + first, with->kinds, with->size * sizeof(UInt8));
+    memcpy(stream->offsets + first, with->offsets, with->size * sizeof(UInt32));
+    memcpy(stream->lengths + first, with->lengths, with->size * sizeof(UInt32));
+    memcpy(stream->symbols + first, with->symbols, with->size * sizeof(Symbol));
+
+    // Unsigned wrap-around takes care of a negative shift
+    UInt32 delta = (UInt32)shift;
+    UInt32* offsets = stream->offsets;
+    if(delta)
+        for(UInt32 i = moved; i < size; i++)
+            offsets[i] += delta;
+
+    stream->size = size;
+}
+
+// Free `table` from its associated memory
+void literal_table_free(LiteralTable* table) {
+    CSTL_FREE(table->allocator, table->offsets, (UInt64)table->capacity * sizeof(UInt32));
+    CSTL_FREE(table->allocator, table->values, (UInt64)table->capacity * sizeof(LiteralValue));
+    table->offsets = null;
+    table->values = null;
+    table->size = 0;
+    table->capacity = 0;
+}
+
+// Make sure `table` can hold at least `capacity` values
+// Returns `true` if the table had to be reallocated
+bool literal_table_reserve(LiteralTable* table, UInt32 capacity) {
+    if(capacity <= table->capacity)
+        return false;
+
+    // A zeroed table allocates from the compiler's allocator
+    if(table->capacity == 0)
+        table->allocator = compiler_allocator();
+    cstlAllocator* allocator = table->allocator;
+    UInt64 old = table->capacity;
+    table->offsets = (UInt32*)CSTL_RESIZE(allocator, table->offsets, old * sizeof(UInt32), capacity * sizeof(UInt32));
+    table->values = (LiteralValue*)CSTL_RESIZE(allocator, table->values, old * sizeof(LiteralValue), 
+                                               capacity * sizeof(LiteralValue));
+    CSTL_CHECK(table->offsets && table->values, "Could not allocate memory. Memory full.");
+
+    table->capacity = capacity;
+    return true;
+}
+
+// Append the value of the token at `offset` (which must be past every token already in `table`)
+// Returns `true` if the table had to be reallocated
+bool literal_table_push(LiteralTable* table, UInt32 offset, LiteralValue value) {
+    bool grown = false;
+    // Grow by a factor of 1.5
+    if(table->size == table->capacity)
+        grown = literal_table_reserve(table, table->capacity + table->capacity/2 + 16);
+
+    UInt32 i = table->size++;
+    table->offsets[i] = offset;
+    table->values[i] = value;
+    return grown;
+}
+
+// Returns the index of the first value in `table` whose token begins at or after `offset`
+UInt32 literal_table_lower_bound(const LiteralTable* table, UInt32 offset) {
+    UInt32 lo = 0;
+    UInt32 hi = table->size;
+    while(lo < hi) {
+        UInt32 mid = lo + (hi - lo)/2;
+        if(table->offsets[mid] < offset)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+// Returns the value of the token at `offset`, or null if there is none
+const LiteralValue* literal_table_find(const LiteralTable* table, UInt32 offset) {
+    UInt32 i = literal_table_lower_bound(table, offset);
+    if(i < table->size && table->offsets[i] == offset)
+        return &table->values[i];
+    return null;
+}
+
+// Replace the values of the tokens in [begin, end) with the values in `with`, and move the offsets of every value 
+// after them by `shift` bytes
+void literal_table_splice(LiteralTable* table, UInt32 begin, UInt32 end, const LiteralTable* with, Int64 shift) {
+    UInt32 first = literal_table_lower_bound(table, begin);
+    UInt32 tail = literal_table_lower_bound(table, end);
+    UInt32 ntail = table->size - tail;
+    UInt32 size = table->size - (tail - first) + with->size;
+    literal_table_reserve(table, size);
+
+    UInt32 moved = first + with->size;
+    if(moved != tail) {
+        memmove(table->offsets + moved, table->offsets + tail, ntail * sizeof(UInt32));
+        memmove(table->values + moved, table->values + tail, ntail * sizeof(LiteralValue));
+    }
+    if(with->size) {
+        memcpy(table->offsets + first, with->offsets, with->size * sizeof(UInt32));
+        memcpy(table->values + first, with->values, with->size * sizeof(LiteralValue));
+    }
+
+    // Unsigned wrap-around takes care of a negative shift
+    UInt32 delta = (UInt32)shift;
+    if(delta)
+        for(UInt32 i = moved; i < size; i++)
+            table->offsets[i] += delta;
+
+    table->size = size;
+}
+
+// Free `table` from its associated memory
+void comment_table_free(CommentTable* table) {
+    UInt64 capacity = table->capacity;
+    CSTL_FREE(table->allocator, table->kinds, capacity * sizeof(UInt8));
+    CSTL_FREE(table->allocator, table->offsets, capacity * sizeof(UInt32));
+    CSTL_FREE(table->allocator, table->lengths, capacity * sizeof(UInt32));
+    CSTL_FREE(table->allocator, table->tokens, capacity * sizeof(UInt32));
+    table->kinds = null;
+    table->offsets = null;
+    table->lengths = null;
+    table->tokens = null;
+    table->size = 0;
+    table->capacity = 0;
+}
+
+// Make sure `table` can hold at least `capacity` comments
+// Returns `true` if the table had to be reallocated
+bool comment_table_reserve(CommentTable* table, UInt32 capacity) {
+    if(capacity <= table->capacity)
+        return false;
+
+    // A zeroed table allocates from the compiler's allocator
+    if(table->capacity == 0)
+        table->allocator = compiler_allocator();
+    cstlAllocator* allocator = table->allocator;
+    UInt64 old = table->capacity;
+    table->kinds = (UInt8*)CSTL_RESIZE(allocator, table->kinds, old * sizeof(UInt8), capacity * sizeof(UInt8));
+    table->offsets = (UInt32*)CSTL_RESIZE(allocator, table->offsets, old * sizeof(UInt32), capacity * sizeof(UInt32));
+    table->lengths = (UInt32*)CSTL_RESIZE(allocator, table->lengths, old * sizeof(UInt32), capacity * sizeof(UInt32));
+    table->tokens = (UInt32*)CSTL_RESIZE(allocator, table->tokens, old * sizeof(UInt32), capacity * sizeof(UInt32));
+    CSTL_CHECK(table->kinds && table->offsets && table->lengths && table->tokens, 
+               "Could not allocate memory. Memory full.");
+
+    table->capacity = capacity;
+    return true;
+}
+
+// Append a comment (which must come after every comment already in `table`), followed by the token at index `token`
+// Returns `true` if the table had to be reallocated
+bool comment_table_push(CommentTable* table, TokenKind kind, UInt32 offset, UInt32 length, UInt32 token) {
+    bool grown = false;
+    // Grow by a factor of 1.5
+    if(table->size == table->capacity)
+        grown = comment_table_reserve(table, table->capacity + table->capacity/2 + 16);
+
+    UInt32 i = table->size++;
+    table->kinds[i] = (UInt8)kind;
+    table->offsets[i] = offset;
+    table->lengths[i] = length;
+    table->tokens[i] = token;
+    return grown;
+}
+
+// Returns the `i`th comment in `table` as a Token
+Token comment_table_at(const CommentTable* table, UInt32 i) {
+    Token token;
+    CSTL_CHECK_LT(i, table->size);
+
+    token.kind = (TokenKind)table->kinds[i];
+    token.offset = table->offsets[i];
+    token.length = table->lengths[i];
+    token.symbol = SYMBOL_NONE;
+    return token;
+}
+
+// Returns the index of the first comment in `table` that is followed by the token at index `token` (or a later one)
+UInt32 comment_table_lower_bound(const CommentTable* table, UInt32 token) {
+    UInt32 lo = 0;
+    UInt32 hi = table->size;
+    while(lo < hi) {
+        UInt32 mid = lo + (hi - lo)/2;
+        if(table->tokens[mid] < token)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+// Returns the index of the first comment in `table` that begins at or after `offset`
+UInt32 comment_table_lower_bound_offset(const CommentTable* table, UInt32 offset) {
+    UInt32 lo = 0;
+    UInt32 hi = table->size;
+    while(lo < hi) {
+        UInt32 mid = lo + (hi - lo)/2;
+        if(table->offsets[mid] < offset)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+// Replace the comments in [begin, end) (by offset) with the comments in `with`, and move every comment after them 
+// by `shift` bytes and `token_shift` tokens
+void comment_table_splice(CommentTable* table, UInt32 begin, UInt32 end, const CommentTable* with, Int64 shift, 
+                          Int64 token_shift) {
+    UInt32 first = comment_table_lower_bound_offset(table, begin);
+    UInt32 tail = comment_table_lower_bound_offset(table, end);
+    UInt32 ntail = table->size - tail;
+    UInt32 size = table->size - (tail - first) + with->size;
+    comment_table_reserve(table, size);
+
+    UInt32 moved = first + with->size;
+    if(moved != tail) {
+        memmove(table->kinds + moved, table->kinds + tail, ntail * sizeof(UInt8));
+        memmove(table->offsets + moved, table->offsets + tail, ntail * sizeof(UInt32));
+        memmove(table->lengths + moved, table->lengths + tail, ntail * sizeof(UInt32));
+        memmove(table->tokens + moved, table->tokens + tail, ntail * sizeof(UInt32));
+    }
+    if(with->size) {
+        memcpy(table->kinds + first, with->kinds, with->size * sizeof(UInt8));
+        memcpy(table->offsets + first, with->offsets, with->size * sizeof(UInt32));
+        memcpy(table->lengths + first, with->lengths, with->size * sizeof(UInt32));
+        memcpy(table->tokens + first, with->tokens, with->size * sizeof(UInt32));
+    }
+
+    // Unsigned wrap-around takes care of a negative shift
+    UInt32 delta = (UInt32)shift;
+    UInt32 token_delta = (UInt32)token_shift;
+    if(delta || token_delta) {
+        for(UInt32 i = moved; i < size; i++) {
+            table->offsets[i] += delta;
+            table->tokens[i] += token_delta;
+        }
+    }
+
+    table->size = size;
 }
 
 // Convert a Token to its respective String representation
@@ -18,6 +18,8 @@ Copyright (c) 2021 Jason Dsouza <http://github.com/jasmcaus>
 
 #include <hazel/core/misc.h>
 #include <hazel/core/types.h> 
+#include <hazel/compiler/intern.h>
+#include <hazel/compiler/allocator.h>
 
 
 // tokens.h defines constants representing the lexical tokens of the Hazel programming language and basic operations on 
@@ -224,17 +226,90 @@ typedef enum {
     #undef TOKENKIND
 } TokenKind;
 
+// A TokenKind must fit in a single byte (see `TokenStream`)
+CSTL_DEBUG_CHECK(TOK_COUNT <= 256);
+
 // Main Token Struct 
+// A Token does not own its value. Instead, it refers to a slice (`offset`, `length`) of the Lexical Buffer it was 
+// scanned from - use `lexer_token_value()` if you need a NUL-terminated copy of it.
+// 
+// The Lexer does not store Tokens like this - see `TokenStream` below. This is only a (by-value) view over a single 
+// token in a stream.
+// 
+// Tokens don't carry a line/column number - those are only ever needed for diagnostics and are computed (on demand)
+// from the token's offset. See `lexer_location()`.
+// 
+// Identifiers are interned as they are lexed (see <hazel/compiler/intern.h>): two IDENTIFIERs name the same thing 
+// iff their `symbol`s are equal.
 typedef struct {
     TokenKind kind;     // Token Kind
     UInt32 offset;      // Offset of the first character of the Token
-    const char* value;  // Token value
-    UInt32 start;       // Starting offset of the token (used in substring-ing tokens of length >1)
-    UInt32 lineno;      // the line number in the source where the token occured
-    UInt32 colno;       // the column number
-    const char* fname;  // /path/to/file.hzl
+    UInt32 length;      // Number of bytes (starting from `offset`) the Token spans in the source
+    Symbol symbol;      // Interned value of an IDENTIFIER (SYMBOL_NONE for every other Token)
 } Token;
 
+// The list of tokens handed over from the Lexer to the Parser.
+// 
+// Tokens are stored as a structure of arrays: the Parser's lookahead only ever needs the kind of a token (and 
+// sometimes its span), so those are kept in their own dense arrays. Anything that is the same for every token (the 
+// file name) is stored once.
+//
+// The arrays normally live in the heap, and move as the stream grows. A stream that knows how many tokens it can 
+// ever hold (`token_stream_init_reserved()`) reserves address space for all of them up front instead, and commits 
+// memory as it fills up (see <hazel/core/vmem.h>): it grows without copying, and its tokens never move.
+typedef struct TokenStream {
+    UInt8* kinds;       // TokenKind of each token
+    UInt32* offsets;    // offset of the first character of each token
+    UInt32* lengths;    // no. of bytes each token spans
+    Symbol* symbols;    // interned value of each IDENTIFIER (SYMBOL_NONE for every other token)
+    UInt32 size;        // no. of tokens in the stream
+    UInt32 capacity;    // no. of tokens the stream can hold before it needs to grow
+    const char* fname;  // /path/to/file.hzl
+    cstlAllocator* allocator;   // where the arrays come from (`compiler_allocator()` when the stream was initialized)
+    char* reserved;             // the address space the arrays live in (null if they're in the heap)
+    UInt64 reserved_size;       // no. of bytes reserved
+    UInt32 reserved_capacity;   // no. of tokens the reserved arrays can hold
+    UInt32 reserved_granularity;// what each array's committed size is rounded up to
+} TokenStream;
+
+// Streams reserved for at least this many tokens are backed by (transparent) huge pages
+#define TOKEN_STREAM_HUGE_PAGES_MIN     (1u << 22)
+
+// The value of a numeric literal, converted by the Lexer while it was scanned
+typedef union LiteralValue {
+    UInt64 integer;     // INTEGER, BIN_INT, HEX_INT, OCT_INT, INT*_LIT and UINT*_LIT
+    Float64 real;       // TOK_FLOAT, FLOAT*_LIT and IMAG (the value of the imaginary part)
+} LiteralValue;
+
+// The values of the numeric literals in a TokenStream. Only numeric literals have a value, so this is kept on the 
+// side, keyed by the offset of the literal's token (in ascending order).
+typedef struct LiteralTable {
+    UInt32* offsets;        // offset of the token each value belongs to
+    LiteralValue* values;   // value of each literal
+    UInt32 size;            // no. of values in the table
+    UInt32 capacity;        // no. of values the table can hold before it needs to grow
+    cstlAllocator* allocator;   // where the arrays come from (`compiler_allocator()` when they were first allocated)
+} LiteralTable;
+
+// The comments (COMMENTs and DOCS_COMMENTs) in a source file. Comments play no part in parsing, so they are kept out 
+// of the TokenStream (the Parser never has to skip over them) and are stored here instead, in the order they appear 
+// in. Each one is linked to the token that follows it, by that token's index in the TokenStream.
+typedef struct CommentTable {
+    UInt8* kinds;           // COMMENT or DOCS_COMMENT
+    UInt32* offsets;        // offset of the first character of each comment (including the comment marker)
+    UInt32* lengths;        // no. of bytes each comment spans
+    UInt32* tokens;         // index of the token that follows each comment (in ascending order)
+    UInt32 size;            // no. of comments in the table
+    UInt32 capacity;        // no. of comments the table can hold before it needs to grow
+    cstlAllocator* allocator;   // where the arrays come from (`compiler_allocator()` when they were first allocated)
+} CommentTable;
+
+// Fast accessors into a TokenStream (no bounds checks)
+#define TOKEN_KIND(stream, i)       ((TokenKind)(stream)->kinds[(i)])
+#define TOKEN_OFFSET(stream, i)     ((stream)->offsets[(i)])
+#define TOKEN_LENGTH(stream, i)     ((stream)->lengths[(i)])
+#define TOKEN_SYMBOL(stream, i)     ((stream)->symbols[(i)])
+
 // Create a basic (ILLEGAL) token
 Token* token_init(void);
 // Reset a Token instance
@@ -242,4 +317,60 @@ void token_reset_token(Token* token);
 // Convert a Token to its respective String representation
 char* token_to_string(TokenKind kind);
 
+// Initialize `stream` with room for `capacity` tokens
+void token_stream_init(TokenStream* stream, const char* fname, UInt32 capacity);
+// Initialize `stream`, reserving address space for `max_tokens` tokens: up to that many, it grows in place. It can 
+// grow past them (the tokens are then moved to the heap, once). Falls back to `token_stream_init()` if the address
+// space can't be had.
+void token_stream_init_reserved(TokenStream* stream, const char* fname, UInt32 max_tokens);
+// Free `stream` from its associated memory
+void token_stream_free(TokenStream* stream);
+// Make sure `stream` can hold at least `capacity` tokens
+// Returns `true` if the stream had to be reallocated
+bool token_stream_reserve(TokenStream* stream, UInt32 capacity);
+// Append a token to the end of `stream`
+// Returns `true` if the stream had to be reallocated
+bool token_stream_push(TokenStream* stream, TokenKind kind, UInt32 offset, UInt32 length, Symbol symbol);
+// Returns the `i`th token in `stream`
+Token token_stream_at(const TokenStream* stream, UInt32 i);
+// Replace the `nremoved` tokens starting at index `first` with the tokens in `with`, and move the offsets of every 
+// token after them by `shift` bytes
+void token_stream_splice(TokenStream* stream, UInt32 first, UInt32 nremoved, const TokenStream* with, Int64 shift);
+
+// Free `table` from its associated memory
+void literal_table_free(LiteralTable* table);
+// Make sure `table` can hold at least `capacity` values
+// Returns `true` if the table had to be reallocated
+bool literal_table_reserve(LiteralTable* table, UInt32 capacity);
+// Append the value of the token at `offset` (which must be past every token already in `table`)
+// Returns `true` if the table had to be reallocated
+bool literal_table_push(LiteralTable* table, UInt32 offset, LiteralValue value);
+// Returns the index of the first value in `table` whose token begins at or after `offset`
+UInt32 literal_table_lower_bound(const LiteralTable* table, UInt32 offset);
+// Returns the value of the token at `offset`, or null if there is none
+const LiteralValue* literal_table_find(const LiteralTable* table, UInt32 offset);
+// Replace the values of the tokens in [begin, end) with the values in `with`, and move the offsets of every value 
+// after them by `shift` bytes
+void literal_table_splice(LiteralTable* table, UInt32 begin, UInt32 end, const LiteralTable* with, Int64 shift);
+
+// Free `table` from its associated memory
+void comment_table_free(CommentTable* table);
+// Make sure `table` can hold at least `capacity` comments
+// Returns `true` if the table had to be reallocated
+bool comment_table_reserve(CommentTable* table, UInt32 capacity);
+// Append a comment (which must come after every comment already in `table`), followed by the token at index `token`
+// Returns `true` if the table had to be reallocated
+bool comment_table_push(CommentTable* table, TokenKind kind, UInt32 offset, UInt32 length, UInt32 token);
+// Returns the `i`th comment in `table` as a Token
+Token comment_table_at(const CommentTable* table, UInt32 i);
+// Returns the index of the first comment in `table` that is followed by the token at index `token`, or by a later 
+// one
+UInt32 comment_table_lower_bound(const CommentTable* table, UInt32 token);
+// Returns the index of the first comment in `table` that begins at or after `offset`
+UInt32 comment_table_lower_bound_offset(const CommentTable* table, UInt32 offset);
+// Replace the comments in [begin, end) (by offset) with the comments in `with`, and move every comment after them 
+// by `shift` bytes and `token_shift` tokens
+void comment_table_splice(CommentTable* table, UInt32 begin, UInt32 end, const CommentTable* with, Int64 shift, 
+                          Int64 token_shift);
+
 #endif // HAZEL_TOKEN_H
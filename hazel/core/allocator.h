@@ -0,0 +1,140 @@
+/*
+_ _    _           ______   _______        
+| |  | |    /\    /___  /   |  ____|| |    
+| |__| |   /  \      / /    | |__   | |       Hazel - The Fast, Expressive & Elegant Programming Language
+|  __  |  / /\ \    / /     |  __|  | |       Languages: C, C++, and Assembly
+| |  | | / ____ \  / /___   | |____ | |____   https://github.com/HazelLang/hazel/
+|_|_ |_|/_/    \_\/_______\ |______|_\______|
+
+Licensed under the MIT License <http://opensource.org/licenses/MIT>
+SPDX-License-Identifier: MIT
+Copyright (c) 2021 Jason Dsouza <http://github.com/jasmcaus>
+*/
+
+#ifndef CSTL_ALLOCATOR_H
+#define CSTL_ALLOCATOR_H
+
+#include <stdlib.h>
+#include <string.h>
+#include <hazel/core/types.h>
+#include <hazel/core/debug.h>
+#include <hazel/core/misc.h>
+#include <hazel/core/thread.h>
+
+/*
+    Allocators
+
+    Containers that own memory (`cstlVector`, `cstlBuffer`, and the compiler's token streams, tables and arenas) get
+    it from a `cstlAllocator`, so that what they allocate can be counted, attributed or redirected without touching
+    them. A null allocator is the C heap (malloc/realloc/free) - it is what every container uses unless it's told
+    otherwise, and it costs a single (predictable) branch over calling malloc() directly.
+
+    Every call names its call site (`CSTL_ALLOC_SITE`, ie. "file.c:123"), and frees pass the size of the block being
+    freed, so that an allocator can keep exact books without a header in front of every block.
+*/
+
+typedef struct cstlAllocator cstlAllocator;
+struct cstlAllocator {
+    // Returns `size` bytes (zeroed if `zeroed`), or null if there's no memory left
+    void* (*alloc)(cstlAllocator* self, UInt64 size, bool zeroed, const char* site);
+    // Resize `ptr` (a block of `old_size` bytes, or null) to `new_size` bytes. Returns null (and leaves `ptr` alone)
+    // if there's no memory left.
+    void* (*resize)(cstlAllocator* self, void* ptr, UInt64 old_size, UInt64 new_size, const char* site);
+    // Free `ptr` (a block of `size` bytes, or null)
+    void (*free)(cstlAllocator* self, void* ptr, UInt64 size);
+};
+
+// Names the line it is used on, eg. "hazel/core/vector.h:123"
+#define CSTL_ALLOC_SITE                         __FILE__ ":" CSTL_STRINGIZE(__LINE__)
+
+// Allocate from `allocator` (null for the heap), naming the calling line as the call site
+#define CSTL_ALLOC(allocator, size)             allocator_alloc((allocator), (size), false, CSTL_ALLOC_SITE)
+#define CSTL_ALLOC_ZEROED(allocator, size)      allocator_alloc((allocator), (size), true, CSTL_ALLOC_SITE)
+#define CSTL_RESIZE(allocator, ptr, old, size)  allocator_resize((allocator), (ptr), (old), (size), CSTL_ALLOC_SITE)
+#define CSTL_FREE(allocator, ptr, size)         allocator_free((allocator), (ptr), (size))
+
+static inline void* allocator_alloc(cstlAllocator* allocator, UInt64 size, bool zeroed, const char* site) {
+    if(allocator == null)
+        return zeroed ? calloc(1, size) : malloc(size);
+    return allocator->alloc(allocator, size, zeroed, site);
+}
+
+static inline void* allocator_resize(cstlAllocator* allocator, void* ptr, UInt64 old_size, UInt64 new_size,
+                                     const char* site) {
+    if(allocator == null)
+        return realloc(ptr, new_size);
+    return allocator->resize(allocator, ptr, old_size, new_size, site);
+}
+
+static inline void allocator_free(cstlAllocator* allocator, void* ptr, UInt64 size) {
+    if(allocator == null)
+        free(ptr);
+    else if(ptr != null)
+        allocator->free(allocator, ptr, size);
+}
+
+/*
+    Counting Allocator
+
+    Forwards to another allocator (`parent`), keeping count of what goes through it. It can be shared by any number
+    of threads (the counters are atomic).
+*/
+typedef struct cstlCountingAllocator {
+    cstlAllocator base;             // must come first (a `cstlCountingAllocator*` is a `cstlAllocator*`)
+    cstlAllocator* parent;          // where the memory comes from (null for the heap)
+    volatile UInt64 nallocs;        // no. of allocations (resizes included)
+    volatile UInt64 nfrees;         // no. of frees
+    volatile UInt64 bytes;          // no. of bytes allocated over time (a resize counts what it grew by)
+    volatile UInt64 live;           // no. of bytes allocated, but not freed yet
+    volatile UInt64 peak;           // the most `live` has ever been
+} cstlCountingAllocator;
+
+// Charge an allocation of `size` bytes (or a block that grew by `size` bytes) to `counter`
+static inline void allocator__count(cstlCountingAllocator* counter, UInt64 size) {
+    thread_atomic_add(&counter->nallocs, 1);
+    thread_atomic_add(&counter->bytes, size);
+    thread_atomic_max(&counter->peak, thread_atomic_add(&counter->live, size));
+}
+
+static void* allocator__counting_alloc(cstlAllocator* self, UInt64 size, bool zeroed, const char* site) {
+    cstlCountingAllocator* counter = (cstlCountingAllocator*)self;
+    void* ptr = allocator_alloc(counter->parent, size, zeroed, site);
+    if(ptr != null)
+        allocator__count(counter, size);
+    return ptr;
+}
+
+static void* allocator__counting_resize(cstlAllocator* self, void* ptr, UInt64 old_size, UInt64 new_size,
+                                        const char* site) {
+    cstlCountingAllocator* counter = (cstlCountingAllocator*)self;
+    void* resized = allocator_resize(counter->parent, ptr, old_size, new_size, site);
+    if(resized == null)
+        return null;
+    if(ptr == null)
+        old_size = 0;
+    if(new_size >= old_size) {
+        allocator__count(counter, new_size - old_size);
+    } else {
+        thread_atomic_add(&counter->nallocs, 1);
+        thread_atomic_add(&counter->live, (UInt64)0 - (old_size - new_size));
+    }
+    return resized;
+}
+
+static void allocator__counting_free(cstlAllocator* self, void* ptr, UInt64 size) {
+    cstlCountingAllocator* counter = (cstlCountingAllocator*)self;
+    allocator_free(counter->parent, ptr, size);
+    thread_atomic_add(&counter->nfrees, 1);
+    thread_atomic_add(&counter->live, (UInt64)0 - size);
+}
+
+// Initialize a counting allocator over `parent` (null for the heap)
+static void allocator_counting_init(cstlCountingAllocator* counter, cstlAllocator* parent) {
+    memset(counter, 0, sizeof(cstlCountingAllocator));
+    counter->base.alloc = allocator__counting_alloc;
+    counter->base.resize = allocator__counting_resize;
+    counter->base.free = allocator__counting_free;
+    counter->parent = parent;
+}
+
+#endif // CSTL_ALLOCATOR_H
@@ -15,13 +15,46 @@ Copyright (c) 2021 Jason Dsouza <http://github.com/jasmcaus>
 #define CSTL_BUFFER_H
 
 #include <string.h>
+#include <stdlib.h>
 #include <hazel/core/types.h>
 #include <hazel/core/debug.h>
+#include <hazel/core/math.h>
+#include <hazel/core/allocator.h>
+
+/*
+    Sentinel Padding
+
+    The data of a `cstlBuffer` is always followed by at least CSTL_BUFFER_PADDING zero bytes. Readers can look 
+    up to that many bytes past `length` (they read as NUL) without checking the length first - eg. the Lexer stops 
+    on the NUL sentinel instead of comparing its offset against `length` on every character.
+
+    Data handed over through `buff_new_with_length()` must already be padded (`file_load()` guarantees this). 
+    Anything else (`buff_new()`, `buff_set()`) is copied into padded storage owned by the buffer.
+
+    Define CSTL_BUFFER_DEBUG (done for Debug builds) to verify the padding whenever a buffer is created, and every 
+    read that relies on it.
+*/
+
+// No. of zero bytes that always follow the data of a `cstlBuffer`
+#define CSTL_BUFFER_PADDING    64
+
+#ifdef CSTL_BUFFER_DEBUG
+    // Verify that reading byte `n` of `buffer` does not go past the padding
+    #define BUFF_CHECK_READ(buffer, n)      CSTL_CHECK_LT((UInt64)(n), (buffer)->length + CSTL_BUFFER_PADDING)
+    // Verify that the data of `buffer` is followed by CSTL_BUFFER_PADDING zero bytes
+    #define BUFF_CHECK_PADDING(buffer)      buff_check_padding(buffer)
+#else
+    #define BUFF_CHECK_READ(buffer, n)      ((void)0)
+    #define BUFF_CHECK_PADDING(buffer)      ((void)0)
+#endif // CSTL_BUFFER_DEBUG
 
 typedef struct cstlBuffer cstlBuffer;
 struct cstlBuffer {
     char* data;    // buffer data
     UInt64 length; // buffer size
+    char* storage; // padded copy of the data owned by the buffer (null if the data was handed over)
+    UInt64 capacity; // no. of bytes `storage` can hold (excluding the padding)
+    cstlAllocator* allocator; // where `storage` (and the buffer itself) come from (null for the heap)
 
     char (*at)(cstlBuffer*, UInt64);
     // Front and back iterators
@@ -35,7 +68,15 @@ struct cstlBuffer {
 
 // Create a new `cstlBuffer`
 static cstlBuffer* buff_new(char* buff_data);
-// Return the n'th character in the buffer data
+// Create a new `cstlBuffer` over `length` bytes of `buff_data`, which must be followed by CSTL_BUFFER_PADDING 
+// zero bytes. No copy is made.
+static cstlBuffer* buff_new_with_length(char* buff_data, UInt64 length);
+// Create a new `cstlBuffer` from `allocator` (null for the heap), over a padded copy of `length` bytes of 
+// `buff_data` if `copy` - or else over `buff_data` itself (see `buff_new_with_length()`)
+static cstlBuffer* buff_create(cstlAllocator* allocator, char* buff_data, UInt64 length, bool copy);
+// Verify that the buffer data is followed by CSTL_BUFFER_PADDING zero bytes
+static void buff_check_padding(cstlBuffer* buffer);
+// Return the n'th character in the buffer data (NUL for the CSTL_BUFFER_PADDING bytes past the end)
 static char buff_at(cstlBuffer* buffer, UInt64 n);
 // Return a pointer to the beginning of the buffer data
 static char* buff_begin(cstlBuffer* buffer);
@@ -45,23 +86,50 @@ static char* buff_end(cstlBuffer* buffer);
 static bool buff_is_empty(cstlBuffer* buffer);
 // Assign `new` to the buffer data
 static void buff_set(cstlBuffer* buffer, char* new);
-// Free the cstlBuffer from it's associated memory
+// Replace `removed` bytes at `offset` with `inserted_length` bytes of `inserted`
+static void buff_splice(cstlBuffer* buffer, UInt64 offset, UInt64 removed, const char* inserted, 
+                        UInt64 inserted_length);
+// Free the cstlBuffer (and the memory associated with it)
 static void buff_free(cstlBuffer* buffer);
 
+// Returns a copy of `length` bytes of `data`, followed by CSTL_BUFFER_PADDING zero bytes
+static char* buff__padded_copy(cstlAllocator* allocator, const char* data, UInt64 length) {
+    char* storage = (char*)CSTL_ALLOC(allocator, length + CSTL_BUFFER_PADDING);
+    CSTL_CHECK_NOT_NULL(storage, "Could not allocate memory. Memory full.");
+
+    if(length)
+        memcpy(storage, data, length);
+    memset(storage + length, 0, CSTL_BUFFER_PADDING);
+    return storage;
+}
+
 // Create a new `cstlBuffer`
 static cstlBuffer* buff_new(char* buff_data) {
-    cstlBuffer* buffer = (cstlBuffer*)calloc(1, sizeof(cstlBuffer));
-    CSTL_CHECK_NOT_NULL(buffer, "Could not allocate memory. Memory full.");
+    return buff_create(null, buff_data, buff_data == null ? 0 : (UInt64)strlen(buff_data), true);
+}
 
-    UInt64 len;
-    if(buff_data == null) {
-        len = 0;
-    } else {
-        len = (UInt64)strlen(buff_data);
-    }
+// Create a new `cstlBuffer` over `length` bytes of `buff_data`, which must be followed by CSTL_BUFFER_PADDING 
+// zero bytes. No copy is made.
+static cstlBuffer* buff_new_with_length(char* buff_data, UInt64 length) {
+    return buff_create(null, buff_data, length, false);
+}
+
+// Create a new `cstlBuffer` from `allocator` (null for the heap), over a padded copy of `length` bytes of 
+// `buff_data` if `copy` - or else over `buff_data` itself
+static cstlBuffer* buff_create(cstlAllocator* allocator, char* buff_data, UInt64 length, bool copy) {
+    char* storage = null;
+    if(copy)
+        buff_data = storage = buff__padded_copy(allocator, buff_data, length);
+    CSTL_CHECK_NOT_NULL(buff_data, "Expected not null");
+
+    cstlBuffer* buffer = (cstlBuffer*)CSTL_ALLOC_ZEROED(allocator, sizeof(cstlBuffer));
+    CSTL_CHECK_NOT_NULL(buffer, "Could not allocate memory. Memory full.");
 
     buffer->data = buff_data;
-    buffer->length = len;
+    buffer->length = length;
+    buffer->storage = storage;
+    buffer->capacity = copy ? length : 0;
+    buffer->allocator = allocator;
     buffer->at = &buff_at;
     buffer->begin = &buff_begin;
     buffer->end = &buff_end;
@@ -69,17 +137,26 @@ static cstlBuffer* buff_new(char* buff_data) {
     buffer->set = &buff_set;
     buffer->free = &buff_free;
 
+    BUFF_CHECK_PADDING(buffer);
     return buffer;
 }
 
+// Verify that the buffer data is followed by CSTL_BUFFER_PADDING zero bytes
+static void buff_check_padding(cstlBuffer* buffer) {
+    CSTL_CHECK_NOT_NULL(buffer, "Expected not null");
+    CSTL_CHECK_NOT_NULL(buffer->data, "Expected not null");
+
+    for(UInt64 i = 0; i < CSTL_BUFFER_PADDING; i++)
+        CSTL_CHECK_EQ(buffer->data[buffer->length + i], nullchar);
+}
+
 // Return the n'th character in the buffer data
 static char buff_at(cstlBuffer* buffer, UInt64 n) {
     CSTL_CHECK_NOT_NULL(buffer, "Expected not null");
     CSTL_CHECK_NOT_NULL(buffer->data, "Expected not null");
     
-    if(n >= buffer->length)
-        return nullchar;
-
+    // `n` may go up to CSTL_BUFFER_PADDING bytes past the end (the padding reads as NUL)
+    BUFF_CHECK_READ(buffer, n);
     return (char)buffer->data[n];
 }
 
@@ -107,21 +184,65 @@ static bool buff_is_empty(cstlBuffer* buffer) {
     return buffer->length == 0;
 }
 
+// Free the padded copy owned by `buffer` (if any)
+static inline void buff__free_storage(cstlBuffer* buffer) {
+    if(buffer->storage != null)
+        CSTL_FREE(buffer->allocator, buffer->storage, buffer->capacity + CSTL_BUFFER_PADDING);
+}
+
 // Assign `new` to the buffer data
 static void buff_set(cstlBuffer* buffer, char* new) {
     CSTL_CHECK_NOT_NULL(buffer, "Expected not null");
 
-    buffer->data = new;
-    buffer->length = (UInt64)strlen(new);
+    UInt64 length = new == null ? 0 : (UInt64)strlen(new);
+    char* storage = buff__padded_copy(buffer->allocator, new, length);
+
+    buff__free_storage(buffer);
+    buffer->data = storage;
+    buffer->length = length;
+    buffer->storage = storage;
+    buffer->capacity = length;
+}
+
+// Replace `removed` bytes at `offset` with `inserted_length` bytes of `inserted`
+// Data that was handed over (`buff_new_with_length()`) is never written to - it is copied into storage owned by the
+// buffer first. 
+static void buff_splice(cstlBuffer* buffer, UInt64 offset, UInt64 removed, const char* inserted, 
+                        UInt64 inserted_length) {
+    CSTL_CHECK_NOT_NULL(buffer, "Expected not null");
+    CSTL_CHECK_LE(offset + removed, buffer->length);
+
+    UInt64 length = buffer->length - removed + inserted_length;
+    if(buffer->storage == null || length > buffer->capacity) {
+        // Grow by a factor of 1.5, so that a run of small insertions doesn't copy the whole buffer every time
+        UInt64 capacity = CSTL_MAX(length, buffer->capacity + buffer->capacity/2);
+        char* storage = (char*)CSTL_ALLOC(buffer->allocator, capacity + CSTL_BUFFER_PADDING);
+        CSTL_CHECK_NOT_NULL(storage, "Could not allocate memory. Memory full.");
+
+        memcpy(storage, buffer->data, offset);
+        memcpy(storage + offset + inserted_length, buffer->data + offset + removed, buffer->length - offset - removed);
+        buff__free_storage(buffer);
+        buffer->data = storage;
+        buffer->storage = storage;
+        buffer->capacity = capacity;
+    } else {
+        memmove(buffer->data + offset + inserted_length, buffer->data + offset + removed, 
+                buffer->length - offset - removed);
+    }
+
+    if(inserted_length)
+        memcpy(buffer->data + offset, inserted, inserted_length);
+    memset(buffer->data + length, 0, CSTL_BUFFER_PADDING);
+    buffer->length = length;
 }
 
-// Free the cstlBuffer from it's associated memory
+// Free the cstlBuffer (and the memory associated with it)
 static void buff_free(cstlBuffer* buffer) {
     if(buffer == null)
         return;
 
-    buffer->data = null;
-    buffer->length = 0;
+    buff__free_storage(buffer);
+    CSTL_FREE(buffer->allocator, buffer, sizeof(cstlBuffer));
 }
 
 #endif // CSTL_BUFFER_H
\ No newline at end of file
@@ -14,17 +14,121 @@ Copyright (c) 2021 Jason Dsouza <http://github.com/jasmcaus>
 #ifndef CSTL_CLOCK_H
 #define CSTL_CLOCK_H
 
+// Before any system header: `clock_gettime()` is POSIX, not C11
+#include <hazel/core/headers.h>
+#include <hazel/core/cpu.h>
+#include <hazel/core/types.h>
 #include <time.h>
 
-// Returns the current time (in clock_t)
-static double now() {
-    return clock();
+#if defined(CSTL_OS_OSX)
+    #include <mach/mach_time.h>
+#endif // CSTL_OS_OSX
+
+// On x86, `clock_ticks()` reads the time-stamp counter (when it is invariant - it then ticks at a constant rate,
+// whatever the core's frequency or power state). Define CSTL_CLOCK_NO_TSC to always use the monotonic clock instead.
+#if defined(CSTL_CPU_X86) && !defined(CSTL_CLOCK_NO_TSC)
+    #define CSTL_CLOCK_TSC 1
+    #if defined(_MSC_VER)
+        #include <intrin.h>
+    #else
+        #include <x86intrin.h>
+        #include <cpuid.h>
+    #endif // _MSC_VER
+#endif // CSTL_CPU_X86
+
+// Returns the time (in nanoseconds) of a monotonic clock - one that is unaffected by changes to the system time.
+// Only differences between two readings mean anything.
+static UInt64 clock_now_ns(void) {
+#if defined(CSTL_OS_WINDOWS)
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    // Split up, so that `counter * 1e9` can't overflow
+    UInt64 seconds = (UInt64)counter.QuadPart / (UInt64)frequency.QuadPart;
+    UInt64 rest = (UInt64)counter.QuadPart % (UInt64)frequency.QuadPart;
+    return seconds * 1000000000ull + rest * 1000000000ull / (UInt64)frequency.QuadPart;
+#elif defined(CSTL_OS_OSX)
+    mach_timebase_info_data_t timebase;
+    mach_timebase_info(&timebase);
+    UInt64 ticks = mach_absolute_time();
+    return ticks / timebase.denom * timebase.numer + ticks % timebase.denom * timebase.numer / timebase.denom;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (UInt64)ts.tv_sec * 1000000000ull + (UInt64)ts.tv_nsec;
+#endif // CSTL_OS_WINDOWS
+}
+
+// Returns the current time (in seconds), from the monotonic clock
+static double now(void) {
+    return (double)clock_now_ns() * 1e-9;
+}
+
+// Get duration between `start` and `end` (both from `now()`) in seconds.
+static double duration(double start, double end) {
+    return end - start;
 }
 
-// Get duration between `start` and `end` in seconds.
-static double duration(clock_t start, clock_t end) {
-    return (double)(end - start)/CLOCKS_PER_SEC;
+// Does this CPU have an invariant time-stamp counter?
+static bool clock_has_invariant_tsc(void) {
+#if defined(CSTL_CLOCK_TSC)
+    #if defined(_MSC_VER)
+        int regs[4];
+        __cpuid(regs, 0x80000000);
+        if((unsigned)regs[0] < 0x80000007u)
+            return false;
+        __cpuid(regs, 0x80000007);
+        return (regs[3] >> 8) & 1;
+    #else
+        unsigned eax, ebx, ecx, edx;
+        if(__get_cpuid_max(0x80000000u, null) < 0x80000007u)
+            return false;
+        __get_cpuid(0x80000007u, &eax, &ebx, &ecx, &edx);
+        return (edx >> 8) & 1;
+    #endif // _MSC_VER
+#else
+    return false;
+#endif // CSTL_CLOCK_TSC
 }
 
+// Returns a reading of the cheapest clock around: the time-stamp counter if `use_tsc` (see
+// `clock_has_invariant_tsc()`), and `clock_now_ns()` otherwise. Only differences between two readings mean anything -
+// convert them into nanoseconds with `clock_ns_per_tick()`.
+static inline UInt64 clock_ticks(bool use_tsc) {
+#if defined(CSTL_CLOCK_TSC)
+    if(use_tsc)
+        return __rdtsc();
+#endif // CSTL_CLOCK_TSC
+    (void)use_tsc;
+    return clock_now_ns();
+}
+
+// A reading of both clocks, to calibrate the ticks of `clock_ticks()` against
+typedef struct cstlClockCalibration {
+    UInt64 ns;
+    UInt64 ticks;
+    bool use_tsc;
+} cstlClockCalibration;
+
+static cstlClockCalibration clock_calibration_begin(bool use_tsc) {
+    cstlClockCalibration calibration;
+    calibration.use_tsc = use_tsc;
+    calibration.ns = clock_now_ns();
+    calibration.ticks = clock_ticks(use_tsc);
+    return calibration;
+}
+
+// Returns the no. of nanoseconds per tick of `clock_ticks()`, measured since `calibration` was taken (the longer
+// ago, the more precise - this waits until at least a millisecond has passed)
+static double clock_ns_per_tick(const cstlClockCalibration* calibration) {
+    if(!calibration->use_tsc)
+        return 1.0;
+    UInt64 ns, ticks;
+    do {
+        ns = clock_now_ns();
+        ticks = clock_ticks(true);
+    } while(ns - calibration->ns < 1000000);
+    return ticks > calibration->ticks ? (double)(ns - calibration->ns) / (double)(ticks - calibration->ticks) : 1.0;
+}
 
-#endif // CSTL_CLOCK_H
\ No newline at end of file
+#endif // CSTL_CLOCK_H
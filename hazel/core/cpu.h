@@ -54,5 +54,41 @@ Copyright (c) 2021 Jason Dsouza <http://github.com/jasmcaus>
     #error Unknown CPU Type
 #endif // CSTL_CPU_...
 
+// SIMD Instruction Sets
+// These are selected at compile-time (from what the compiler has been allowed to target - eg: `-mavx2` or
+// `-march=native`), so there is no runtime dispatch.
+// Define CSTL_NO_SIMD to force the scalar fallbacks everywhere.
+#ifndef CSTL_NO_SIMD
+    #if defined(CSTL_CPU_X86)
+        #if defined(__AVX2__)
+            #define CSTL_SIMD_AVX2 1
+        #endif
+
+        #if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+            #define CSTL_SIMD_SSE2 1
+        #endif
+
+        // Byte shuffles (`pshufb`), for table lookups on 16 bytes at a time. AVX2 implies it.
+        #if defined(__SSSE3__) || defined(__AVX2__)
+            #define CSTL_SIMD_SSSE3 1
+        #endif
+
+    #elif defined(CSTL_CPU_ARM)
+        // Only AArch64 NEON is used (for its horizontal reductions)
+        #if defined(__ARM_NEON) && (defined(__aarch64__) || defined(_M_ARM64))
+            #define CSTL_SIMD_NEON 1
+        #endif
+    #endif
+#endif // CSTL_NO_SIMD
+
+// The widest vector (in bytes) we can operate on
+#if defined(CSTL_SIMD_AVX2)
+    #define CSTL_SIMD_WIDTH     32
+#elif defined(CSTL_SIMD_SSE2) || defined(CSTL_SIMD_NEON)
+    #define CSTL_SIMD_WIDTH     16
+#else
+    #define CSTL_SIMD_WIDTH     8  // SWAR (a UInt64 at a time)
+#endif
+
 
 #endif // CSTL_CPU_H
\ No newline at end of file
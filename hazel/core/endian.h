@@ -1,6 +1,9 @@
 #ifndef CSTL_ENDIAN_H_
 #define CSTL_ENDIAN_H_
 
+#include <string.h>
+#include <hazel/core/types.h>
+
 #if defined(__APPLE__)
     #include <machine/endian.h>
     #define CSTL_BIG_ENDIAN    BIG_ENDIAN
@@ -23,11 +26,50 @@
 #endif
 
 #if defined(CSTL_BYTE_ORDER) && CSTL_BYTE_ORDER == CSTL_LITTLE_ENDIAN
-    const bool native_is_big_endian = false;
+    static const bool native_is_big_endian = false;
 #elif defined(CSTL_BYTE_ORDER) && CSTL_BYTE_ORDER == CSTL_BIG_ENDIAN
-    const bool native_is_big_endian = true;
+    static const bool native_is_big_endian = true;
 #else
     #error Unsupported endianness
 #endif
 
+// Reverse the order of the bytes in `x`
+static inline UInt16 endian_swap16(UInt16 x) {
+    return (UInt16)((x << 8) | (x >> 8));
+}
+
+static inline UInt32 endian_swap32(UInt32 x) {
+    return ((x & 0x000000FFu) << 24) | ((x & 0x0000FF00u) << 8) | 
+           ((x & 0x00FF0000u) >> 8)  | ((x & 0xFF000000u) >> 24);
+}
+
+static inline UInt64 endian_swap64(UInt64 x) {
+    return ((UInt64)endian_swap32((UInt32)x) << 32) | endian_swap32((UInt32)(x >> 32));
+}
+
+// Little-endian loads and stores (`p` need not be aligned). Used for anything written to disk.
+static inline UInt32 endian_load_le32(const void* p) {
+    UInt32 x;
+    memcpy(&x, p, sizeof(x));
+    return native_is_big_endian ? endian_swap32(x) : x;
+}
+
+static inline UInt64 endian_load_le64(const void* p) {
+    UInt64 x;
+    memcpy(&x, p, sizeof(x));
+    return native_is_big_endian ? endian_swap64(x) : x;
+}
+
+static inline void endian_store_le32(void* p, UInt32 x) {
+    if(native_is_big_endian)
+        x = endian_swap32(x);
+    memcpy(p, &x, sizeof(x));
+}
+
+static inline void endian_store_le64(void* p, UInt64 x) {
+    if(native_is_big_endian)
+        x = endian_swap64(x);
+    memcpy(p, &x, sizeof(x));
+}
+
 #endif // CSTL_ENDIAN_H_
\ No newline at end of file
@@ -0,0 +1,424 @@
+/*
+_ _    _           ______   _______        
+| |  | |    /\    /___  /   |  ____|| |    
+| |__| |   /  \      / /    | |__   | |       Hazel - The Fast, Expressive & Elegant Programming Language
+|  __  |  / /\ \    / /     |  __|  | |       Languages: C, C++, and Assembly
+| |  | | / ____ \  / /___   | |____ | |____   https://github.com/HazelLang/hazel/
+|_|_ |_|/_/    \_\/_______\ |______|_\______|
+
+Licensed under the MIT License <http://opensource.org/licenses/MIT>
+SPDX-License-Identifier: MIT
+Copyright (c) 2021 Jason Dsouza <http://github.com/jasmcaus>
+*/
+
+#ifndef CSTL_HASH_H
+#define CSTL_HASH_H
+
+#include <string.h>
+#include <hazel/core/types.h>
+#include <hazel/core/cpu.h>
+#include <hazel/core/compilers.h>
+#include <hazel/core/endian.h>
+
+#if defined(CSTL_SIMD_AVX2) || defined(CSTL_SIMD_SSE2)
+    #include <immintrin.h>
+#elif defined(CSTL_SIMD_NEON)
+    #include <arm_neon.h>
+#endif // CSTL_SIMD_AVX2
+
+#if defined(CSTL_COMPILER_MSVC)
+    #include <intrin.h>
+#endif // CSTL_COMPILER_MSVC
+
+/*
+    Non-cryptographic hashing.
+
+    `hash_bytes64()` is for short keys (identifiers, paths, map keys): everything up to 16 bytes is read with at most 
+    four (overlapping) loads and finished with a single 64x64->128-bit multiply, and longer keys go 16 (or 48) bytes 
+    per multiply. `hash_u64()` mixes a single integer.
+
+    `hash_bytes128()` (or `hash_init()`, `hash_update()`s and `hash_final()`, for data that arrives in pieces - both 
+    give the same hash) is for whole files. It runs eight 64-bit lanes over 64-byte stripes (two AVX2 registers, four
+    SSE2 or NEON ones, or eight scalar ones, as <hazel/core/cpu.h> allows), multiplying the 32-bit halves of every 
+    lane's input (xored with a secret) together, and scrambling the lanes every 16 stripes. The lanes are folded 
+    into two 64-bit halves at the end.
+
+    Hashes are the same on every platform and instruction set (input is read as little-endian), so they can be 
+    stored on disk - but they are pinned by the known-answer tests: changing any of this invalidates whatever was 
+    stored (eg. token caches - bump TOKEN_CACHE_VERSION).
+*/
+
+#define CSTL_HASH_PRIME64_1         0x9E3779B185EBCA87ULL
+#define CSTL_HASH_PRIME64_2         0xC2B2AE3D27D4EB4FULL
+#define CSTL_HASH_PRIME32           0x9E3779B1U
+
+// Size (in bytes) of a stripe, and its no. of 64-bit lanes
+#define CSTL_HASH_STRIPE_SIZE       64
+#define CSTL_HASH_LANES             8
+// The lanes are scrambled after every this many stripes
+#define CSTL_HASH_BLOCK_STRIPES     16
+
+// The secret: the words each stripe of a block is xored with (stripe `n` starts at word `n`), then those the lanes 
+// are scrambled with, and those they're folded with (into each half of the hash)
+#define CSTL_HASH_SECRET_SCRAMBLE   (CSTL_HASH_LANES + CSTL_HASH_BLOCK_STRIPES - 1)
+#define CSTL_HASH_SECRET_LOW        (CSTL_HASH_SECRET_SCRAMBLE + CSTL_HASH_LANES)
+#define CSTL_HASH_SECRET_HIGH       (CSTL_HASH_SECRET_LOW + CSTL_HASH_LANES)
+#define CSTL_HASH_SECRET_WORDS      (CSTL_HASH_SECRET_HIGH + CSTL_HASH_LANES)
+
+// SplitMix64 of the digits of pi
+static const UInt64 hash__secret[CSTL_HASH_SECRET_WORDS] = {
+    0x2CB0F69F4ABEA221ULL, 0x9417034723148989ULL, 0xDD555950609DFE03ULL, 0xDBAFB150DEB12800ULL,
+    0x7E789B2E6C442CB6ULL, 0xF41E5636C7E4F8C4ULL, 0x0959D150F8FBA7E4ULL, 0xA97316F13CDB9EEAULL,
+    0x74CD8258F9520068ULL, 0x55C74A62E116868BULL, 0xD2F4C799A2023CBDULL, 0xDF98CB79A37B51B9ULL,
+    0x396F5885524F3905ULL, 0xAF1D56386CA3B276ULL, 0xA9FFBE6B5104E85AULL, 0x6BD0C51B9FD533B3ULL,
+    0x980CE91C50AB4B56ULL, 0x28AC395780FE62C5ULL, 0x768912E3A6BCEDC7ULL, 0x50B3E8C9332C7C88ULL,
+    0xCE3BBFE520BD47DAULL, 0xCBA6C8E8E0BB7C4FULL, 0xBF194DB8434A346DULL, 0x7D8F2A7B60416D7FULL,
+    0x0849D1F6E0E10A5EULL, 0x7654B590D064E22FULL, 0x16D1DA9507DF3AF2ULL, 0xF63AEF1089EA30E4ULL,
+    0x9ADE6673CC6C522BULL, 0x4C75BC274E37087CULL, 0xD35E12B49F51F27BULL, 0x22DDF2FFCEE481EAULL,
+    0x06007FB13C59A1F1ULL, 0x8966A38C651EA4DAULL, 0x25242F018FC01AC6ULL, 0xA73EC74FA31B717CULL,
+    0x7EE0ABDD9797D3A2ULL, 0x5C06FF7DC4AC1880ULL, 0x8434E41042C28A7DULL, 0x770A372D64327351ULL,
+    0xEED940DAD9E9C06DULL, 0x8977E93646524825ULL, 0xA9897F0A62A51616ULL, 0xA35D4250C53F2B3AULL,
+    0x4072542A94B9C33EULL, 0x3154A7A62447E8ABULL, 0x686865712A1A245EULL,
+};
+
+// Multiply `a` and `b` into a 128-bit product
+static inline void hash__multiply(UInt64 a, UInt64 b, UInt64* low, UInt64* high) {
+#if defined(__SIZEOF_INT128__)
+    __extension__ unsigned __int128 product = (unsigned __int128)a * b;
+    *low = (UInt64)product;
+    *high = (UInt64)(product >> 64);
+#elif defined(CSTL_COMPILER_MSVC) && defined(_M_X64)
+    *low = _umul128(a, b, high);
+#else
+    UInt64 lo_lo = (a & 0xFFFFFFFF) * (b & 0xFFFFFFFF);
+    UInt64 hi_lo = (a >> 32) * (b & 0xFFFFFFFF);
+    UInt64 lo_hi = (a & 0xFFFFFFFF) * (b >> 32);
+    UInt64 hi_hi = (a >> 32) * (b >> 32);
+    UInt64 cross = (lo_lo >> 32) + (hi_lo & 0xFFFFFFFF) + lo_hi;
+    *low = (cross << 32) | (lo_lo & 0xFFFFFFFF);
+    *high = hi_hi + (hi_lo >> 32) + (cross >> 32);
+#endif // __SIZEOF_INT128__
+}
+
+// Returns the 128-bit product of `a` and `b`, folded into 64 bits
+static inline UInt64 hash__mix(UInt64 a, UInt64 b) {
+    UInt64 low, high;
+    hash__multiply(a, b, &low, &high);
+    return low ^ high;
+}
+
+// Final avalanche (from MurmurHash3), so that every bit of the result depends on every bit of `h`
+static inline UInt64 hash__avalanche(UInt64 h) {
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+// Returns a well-mixed hash of `x` (a 64-bit integer, a pointer, ...)
+static inline UInt64 hash_u64(UInt64 x) {
+    return hash__avalanche(x);
+}
+
+// Returns the 64-bit hash of the `length` bytes at `data`, with `seed`
+static inline UInt64 hash_bytes64(const void* data, UInt64 length, UInt64 seed) {
+    const UInt8* p = (const UInt8*)data;
+    UInt64 a, b;
+
+    seed ^= hash__mix(seed ^ hash__secret[0], hash__secret[1]);
+    if(length <= 16) {
+        if(length >= 4) {
+            // The first and last 4 bytes, and (from 8 bytes on) the 4 bytes after the first and before the last
+            UInt64 middle = (length >> 3) << 2;
+            a = ((UInt64)endian_load_le32(p) << 32) | endian_load_le32(p + middle);
+            b = ((UInt64)endian_load_le32(p + length - 4) << 32) | endian_load_le32(p + length - 4 - middle);
+        } else if(length > 0) {
+            a = ((UInt64)p[0] << 16) | ((UInt64)p[length >> 1] << 8) | p[length - 1];
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        UInt64 left = length;
+        if(left > 48) {
+            // Three independent multiplies at a time
+            UInt64 seed1 = seed, seed2 = seed;
+            do {
+                seed = hash__mix(endian_load_le64(p) ^ hash__secret[2], endian_load_le64(p + 8) ^ seed);
+                seed1 = hash__mix(endian_load_le64(p + 16) ^ hash__secret[3], endian_load_le64(p + 24) ^ seed1);
+                seed2 = hash__mix(endian_load_le64(p + 32) ^ hash__secret[4], endian_load_le64(p + 40) ^ seed2);
+                p += 48;
+                left -= 48;
+            } while(left > 48);
+            seed ^= seed1 ^ seed2;
+        }
+        while(left > 16) {
+            seed = hash__mix(endian_load_le64(p) ^ hash__secret[2], endian_load_le64(p + 8) ^ seed);
+            p += 16;
+            left -= 16;
+        }
+        // The final 16 bytes (these may overlap the ones just hashed)
+        a = endian_load_le64(p + left - 16);
+        b = endian_load_le64(p + left - 8);
+    }
+
+    UInt64 low, high;
+    hash__multiply(a ^ hash__secret[2], b ^ seed, &low, &high);
+    return hash__mix(low ^ hash__secret[0] ^ length, high ^ hash__secret[1]);
+}
+
+/*
+    Streaming (128-bit) hashes
+*/
+typedef struct cstlHash128 {
+    UInt64 low;
+    UInt64 high;
+} cstlHash128;
+
+typedef struct cstlHashState {
+    UInt64 acc[CSTL_HASH_LANES];                // the lanes
+    UInt64 secret[CSTL_HASH_SECRET_WORDS];      // `hash__secret`, seeded
+    UInt8 buffer[CSTL_HASH_STRIPE_SIZE];        // the start of a stripe that hasn't been consumed yet
+    UInt64 buffered;                            // no. of bytes in `buffer`
+    UInt64 stripe;                              // index (in its block) of the next stripe
+    UInt64 length;                              // no. of bytes hashed so far
+} cstlHashState;
+
+#if defined(CSTL_SIMD_AVX2)
+    // Four lanes at a time
+    static inline __m256i hash__accumulate_avx2(__m256i acc, const UInt8* p, const UInt64* secret) {
+        __m256i data = _mm256_loadu_si256((const __m256i*)p);
+        __m256i key = _mm256_xor_si256(data, _mm256_loadu_si256((const __m256i*)secret));
+        __m256i product = _mm256_mul_epu32(key, _mm256_shuffle_epi32(key, _MM_SHUFFLE(0, 3, 0, 1)));
+        __m256i swapped = _mm256_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2));
+        return _mm256_add_epi64(acc, _mm256_add_epi64(product, swapped));
+    }
+
+    static inline __m256i hash__scramble_avx2(__m256i acc, const UInt64* secret) {
+        __m256i prime = _mm256_set1_epi32((int)CSTL_HASH_PRIME32);
+        acc = _mm256_xor_si256(acc, _mm256_srli_epi64(acc, 47));
+        acc = _mm256_xor_si256(acc, _mm256_loadu_si256((const __m256i*)secret));
+        __m256i low = _mm256_mul_epu32(acc, prime);
+        __m256i high = _mm256_mul_epu32(_mm256_srli_epi64(acc, 32), prime);
+        return _mm256_add_epi64(low, _mm256_slli_epi64(high, 32));
+    }
+#elif defined(CSTL_SIMD_SSE2)
+    // Two lanes at a time
+    static inline __m128i hash__accumulate_sse2(__m128i acc, const UInt8* p, const UInt64* secret) {
+        __m128i data = _mm_loadu_si128((const __m128i*)p);
+        __m128i key = _mm_xor_si128(data, _mm_loadu_si128((const __m128i*)secret));
+        __m128i product = _mm_mul_epu32(key, _mm_shuffle_epi32(key, _MM_SHUFFLE(0, 3, 0, 1)));
+        __m128i swapped = _mm_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2));
+        return _mm_add_epi64(acc, _mm_add_epi64(product, swapped));
+    }
+
+    static inline __m128i hash__scramble_sse2(__m128i acc, const UInt64* secret) {
+        __m128i prime = _mm_set1_epi32((int)CSTL_HASH_PRIME32);
+        acc = _mm_xor_si128(acc, _mm_srli_epi64(acc, 47));
+        acc = _mm_xor_si128(acc, _mm_loadu_si128((const __m128i*)secret));
+        __m128i low = _mm_mul_epu32(acc, prime);
+        __m128i high = _mm_mul_epu32(_mm_srli_epi64(acc, 32), prime);
+        return _mm_add_epi64(low, _mm_slli_epi64(high, 32));
+    }
+#elif defined(CSTL_SIMD_NEON)
+    // Two lanes at a time
+    static inline uint64x2_t hash__accumulate_neon(uint64x2_t acc, const UInt8* p, const UInt64* secret) {
+        uint64x2_t data = vreinterpretq_u64_u8(vld1q_u8(p));
+        uint64x2_t key = veorq_u64(data, vld1q_u64(secret));
+        uint64x2_t product = vmull_u32(vmovn_u64(key), vshrn_n_u64(key, 32));
+        uint64x2_t swapped = vextq_u64(data, data, 1);
+        return vaddq_u64(acc, vaddq_u64(product, swapped));
+    }
+
+    static inline uint64x2_t hash__scramble_neon(uint64x2_t acc, const UInt64* secret) {
+        uint32x2_t prime = vdup_n_u32(CSTL_HASH_PRIME32);
+        acc = veorq_u64(acc, vshrq_n_u64(acc, 47));
+        acc = veorq_u64(acc, vld1q_u64(secret));
+        uint64x2_t low = vmull_u32(vmovn_u64(acc), prime);
+        uint64x2_t high = vmull_u32(vshrn_n_u64(acc, 32), prime);
+        return vaddq_u64(low, vshlq_n_u64(high, 32));
+    }
+#endif // CSTL_SIMD_AVX2
+
+// Consume the `n` stripes at `p` into the lanes `acc` (`*stripe` is the index of the first one in its block), 
+// scrambling them after the last stripe of every block
+static void hash__consume(UInt64* acc, const UInt8* p, UInt64 n, const UInt64* secret, UInt64* stripe) {
+    UInt64 s = *stripe;
+#if defined(CSTL_SIMD_AVX2)
+    __m256i a0 = _mm256_loadu_si256((const __m256i*)acc);
+    __m256i a1 = _mm256_loadu_si256((const __m256i*)(acc + 4));
+    for(; n > 0; n--, p += CSTL_HASH_STRIPE_SIZE) {
+        a0 = hash__accumulate_avx2(a0, p, secret + s);
+        a1 = hash__accumulate_avx2(a1, p + 32, secret + s + 4);
+        if(++s == CSTL_HASH_BLOCK_STRIPES) {
+            a0 = hash__scramble_avx2(a0, secret + CSTL_HASH_SECRET_SCRAMBLE);
+            a1 = hash__scramble_avx2(a1, secret + CSTL_HASH_SECRET_SCRAMBLE + 4);
+            s = 0;
+        }
+    }
+    _mm256_storeu_si256((__m256i*)acc, a0);
+    _mm256_storeu_si256((__m256i*)(acc + 4), a1);
+#elif defined(CSTL_SIMD_SSE2) || defined(CSTL_SIMD_NEON)
+    #if defined(CSTL_SIMD_SSE2)
+        #define hash__vector                    __m128i
+        #define hash__load(acc)                 _mm_loadu_si128((const __m128i*)(acc))
+        #define hash__store(acc, v)             _mm_storeu_si128((__m128i*)(acc), (v))
+        #define hash__accumulate(v, p, secret)  hash__accumulate_sse2((v), (p), (secret))
+        #define hash__scramble(v, secret)       hash__scramble_sse2((v), (secret))
+    #else
+        #define hash__vector                    uint64x2_t
+        #define hash__load(acc)                 vld1q_u64(acc)
+        #define hash__store(acc, v)             vst1q_u64((acc), (v))
+        #define hash__accumulate(v, p, secret)  hash__accumulate_neon((v), (p), (secret))
+        #define hash__scramble(v, secret)       hash__scramble_neon((v), (secret))
+    #endif // CSTL_SIMD_SSE2
+    hash__vector a0 = hash__load(acc), a1 = hash__load(acc + 2), a2 = hash__load(acc + 4), a3 = hash__load(acc + 6);
+    for(; n > 0; n--, p += CSTL_HASH_STRIPE_SIZE) {
+        a0 = hash__accumulate(a0, p, secret + s);
+        a1 = hash__accumulate(a1, p + 16, secret + s + 2);
+        a2 = hash__accumulate(a2, p + 32, secret + s + 4);
+        a3 = hash__accumulate(a3, p + 48, secret + s + 6);
+        if(++s == CSTL_HASH_BLOCK_STRIPES) {
+            a0 = hash__scramble(a0, secret + CSTL_HASH_SECRET_SCRAMBLE);
+            a1 = hash__scramble(a1, secret + CSTL_HASH_SECRET_SCRAMBLE + 2);
+            a2 = hash__scramble(a2, secret + CSTL_HASH_SECRET_SCRAMBLE + 4);
+            a3 = hash__scramble(a3, secret + CSTL_HASH_SECRET_SCRAMBLE + 6);
+            s = 0;
+        }
+    }
+    hash__store(acc, a0);
+    hash__store(acc + 2, a1);
+    hash__store(acc + 4, a2);
+    hash__store(acc + 6, a3);
+    #undef hash__vector
+    #undef hash__load
+    #undef hash__store
+    #undef hash__accumulate
+    #undef hash__scramble
+#else
+    UInt64 lanes[CSTL_HASH_LANES];
+    memcpy(lanes, acc, sizeof(lanes));
+    for(; n > 0; n--, p += CSTL_HASH_STRIPE_SIZE) {
+        for(UInt32 i = 0; i < CSTL_HASH_LANES; i++) {
+            // Each lane adds the product of the halves of its (keyed) input, and the input of its neighbour
+            UInt64 data = endian_load_le64(p + 8 * i);
+            UInt64 key = data ^ secret[s + i];
+            lanes[i ^ 1] += data;
+            lanes[i] += (key & 0xFFFFFFFF) * (key >> 32);
+        }
+        if(++s == CSTL_HASH_BLOCK_STRIPES) {
+            for(UInt32 i = 0; i < CSTL_HASH_LANES; i++) {
+                UInt64 lane = lanes[i] ^ (lanes[i] >> 47) ^ secret[CSTL_HASH_SECRET_SCRAMBLE + i];
+                lanes[i] = lane * CSTL_HASH_PRIME32;
+            }
+            s = 0;
+        }
+    }
+    memcpy(acc, lanes, sizeof(lanes));
+#endif // CSTL_SIMD_AVX2
+    *stripe = s;
+}
+
+// Write `hash__secret`, seeded with `seed`, to `secret` (a seed of 0 leaves it as is)
+static inline void hash__seed_secret(UInt64* secret, UInt64 seed) {
+    for(UInt32 i = 0; i < CSTL_HASH_SECRET_WORDS; i++)
+        secret[i] = (i & 1) ? hash__secret[i] - seed : hash__secret[i] + seed;
+}
+
+// Begin hashing (with `seed`) into `state`
+static inline void hash_init(cstlHashState* state, UInt64 seed) {
+    for(UInt32 i = 0; i < CSTL_HASH_LANES; i++)
+        state->acc[i] = (UInt64)(i + 1) * CSTL_HASH_PRIME64_1;
+    hash__seed_secret(state->secret, seed);
+    state->buffered = 0;
+    state->stripe = 0;
+    state->length = 0;
+}
+
+// Hash the `length` bytes at `data` (after everything hashed into `state` so far)
+static inline void hash_update(cstlHashState* state, const void* data, UInt64 length) {
+    const UInt8* p = (const UInt8*)data;
+    state->length += length;
+
+    // Complete the stripe that was begun last time
+    if(state->buffered > 0) {
+        UInt64 n = CSTL_HASH_STRIPE_SIZE - state->buffered;
+        if(n > length)
+            n = length;
+        memcpy(state->buffer + state->buffered, p, (size_t)n);
+        state->buffered += n;
+        p += n;
+        length -= n;
+        if(state->buffered < CSTL_HASH_STRIPE_SIZE)
+            return;
+        hash__consume(state->acc, state->buffer, 1, state->secret, &state->stripe);
+        state->buffered = 0;
+    }
+
+    UInt64 nstripes = length / CSTL_HASH_STRIPE_SIZE;
+    if(nstripes > 0) {
+        hash__consume(state->acc, p, nstripes, state->secret, &state->stripe);
+        p += nstripes * CSTL_HASH_STRIPE_SIZE;
+        length -= nstripes * CSTL_HASH_STRIPE_SIZE;
+    }
+    memcpy(state->buffer, p, (size_t)length);
+    state->buffered = length;
+}
+
+// Returns the hash of `length` bytes, given the lanes (`acc`) and stripe index they were left at, and the `ntail` 
+// bytes at `tail` that didn't make a whole stripe
+static inline cstlHash128 hash__finish(const UInt64* lanes, UInt64 stripe, const UInt8* tail, UInt64 ntail, 
+                                       UInt64 length, const UInt64* secret) {
+    UInt64 acc[CSTL_HASH_LANES];
+    memcpy(acc, lanes, sizeof(acc));
+    if(ntail > 0) {
+        // The last stripe is padded with zeros (the length is hashed below, so that doesn't collide)
+        UInt8 last[CSTL_HASH_STRIPE_SIZE] = {0};
+        memcpy(last, tail, (size_t)ntail);
+        hash__consume(acc, last, 1, secret, &stripe);
+    }
+
+    cstlHash128 hash;
+    hash.low = length * CSTL_HASH_PRIME64_1;
+    hash.high = ~length * CSTL_HASH_PRIME64_2;
+    for(UInt32 i = 0; i < CSTL_HASH_LANES; i += 2) {
+        hash.low += hash__mix(acc[i] ^ secret[CSTL_HASH_SECRET_LOW + i], 
+                              acc[i + 1] ^ secret[CSTL_HASH_SECRET_LOW + i + 1]);
+        hash.high += hash__mix(acc[i] ^ secret[CSTL_HASH_SECRET_HIGH + i], 
+                               acc[i + 1] ^ secret[CSTL_HASH_SECRET_HIGH + i + 1]);
+    }
+    hash.low = hash__avalanche(hash.low);
+    hash.high = hash__avalanche(hash.high);
+    return hash;
+}
+
+// Returns the hash of everything hashed into `state` (which can still be added to afterwards)
+static inline cstlHash128 hash_final(const cstlHashState* state) {
+    return hash__finish(state->acc, state->stripe, state->buffer, state->buffered, state->length, state->secret);
+}
+
+// Returns the 128-bit hash of the `length` bytes at `data`, with `seed` (the same as hashing them into a 
+// `cstlHashState`, without copying anything but the last partial stripe)
+static inline cstlHash128 hash_bytes128(const void* data, UInt64 length, UInt64 seed) {
+    const UInt8* p = (const UInt8*)data;
+    UInt64 seeded[CSTL_HASH_SECRET_WORDS];
+    const UInt64* secret = hash__secret;
+    if(seed != 0) {
+        hash__seed_secret(seeded, seed);
+        secret = seeded;
+    }
+
+    UInt64 acc[CSTL_HASH_LANES];
+    for(UInt32 i = 0; i < CSTL_HASH_LANES; i++)
+        acc[i] = (UInt64)(i + 1) * CSTL_HASH_PRIME64_1;
+    UInt64 stripe = 0;
+    UInt64 nstripes = length / CSTL_HASH_STRIPE_SIZE;
+    if(nstripes > 0)
+        hash__consume(acc, p, nstripes, secret, &stripe);
+    UInt64 consumed = nstripes * CSTL_HASH_STRIPE_SIZE;
+    return hash__finish(acc, stripe, p + consumed, length - consumed, length, secret);
+}
+
+#endif // CSTL_HASH_H
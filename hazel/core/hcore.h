@@ -54,18 +54,28 @@ CREDITS
 #endif // CSTL_USING_CUSTOM_GENERATED_MACROS
 
 #include <hazel/core/headers.h>
+#include <hazel/core/allocator.h>
 #include <hazel/core/clock.h>
 #include <hazel/core/compilers.h>
 #include <hazel/core/cpu.h>
 #include <hazel/core/debug.h>
+#include <hazel/core/endian.h>
+#include <hazel/core/hash.h>
 #include <hazel/core/misc.h>
 #include <hazel/core/types.h>
 #include <hazel/core/io.h>
+#include <hazel/core/map.h>
 #include <hazel/core/memory.h>
 #include <hazel/core/os.h>
 #include <hazel/core/math.h>
+#include <hazel/core/number.h>
 #include <hazel/core/buffer.h>
 #include <hazel/core/string.h>
+#include <hazel/core/simd.h>
+#include <hazel/core/thread.h>
+#include <hazel/core/unicode.h>
+#include <hazel/core/utf8.h>
 #include <hazel/core/vector.h>
+#include <hazel/core/vmem.h>
 
 #endif // _CSTL_CORE_CSTL_H
\ No newline at end of file
@@ -16,30 +16,209 @@ Copyright (c) 2021 Jason Dsouza <http://github.com/jasmcaus>
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <hazel/core/os.h>
+#include <hazel/core/types.h>
+#include <hazel/core/buffer.h>
 
-// C-version
-char* readFile(const char* fname) {
-    FILE* file = fopen(fname, "rb"); 
-    
-    if(!file)
-        printf("Could not open file: <%s>\n", fname);
-
-    // Get the length of the input buffer
-    fseek(file, 0, SEEK_END); 
-    long buf_length = ftell(file); 
-    fseek(file, 0, SEEK_SET);
-
-    char* buffer = (char*)malloc(sizeof(char) * (buf_length + 1) );
-    if(!buffer) {
-        printf("Could not allocate memory for buffer for file at %s\n", fname);
-		exit(1);
+#if defined(CSTL_OS_WINDOWS)
+    #include <io.h>
+    #include <fcntl.h>
+#else
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+
+    #if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+        #define MAP_ANONYMOUS MAP_ANON
+    #endif 
+#endif // CSTL_OS_WINDOWS
+
+/*
+    Loading Source Files
+
+    Regular files are mapped (read-only) straight into memory instead of being copied into a heap buffer - the 
+    Lexer reads the page cache directly. Anything that can't be mapped (pipes, `stdin`, character devices, or when 
+    `mmap()` isn't available) is read() into a heap buffer instead.
+
+    Either way, `data` is followed by at least CSTL_FILE_PADDING zero bytes (so it is always NUL-terminated, and 
+    scanners may safely over-read the end of the file by that many bytes).
+*/
+
+// No. of zero bytes guaranteed to follow the contents of a `cstlFile` (enough for `buff_new_with_length()`)
+#define CSTL_FILE_PADDING      CSTL_BUFFER_PADDING
+
+typedef struct cstlFile {
+    const char* data;       // contents of the file (followed by CSTL_FILE_PADDING zero bytes)
+    UInt64 length;          // size of the file (in bytes), without the padding
+    void* base;             // start of the mapping (or of the heap buffer)
+    UInt64 capacity;        // size of the mapping (or of the heap buffer)
+    bool is_mapped;         // was `data` mmap()'d (as opposed to read into the heap)?
+} cstlFile;
+
+// Largest file we'll load. Token offsets into a file are 32-bit.
+#define CSTL_FILE_MAX_LENGTH   ((UInt64)0xFFFFFFFFu - CSTL_FILE_PADDING)
+
+#if defined(CSTL_OS_WINDOWS)
+    #define file__open(fname)               _open((fname), _O_RDONLY | _O_BINARY)
+    #define file__read(fd, buf, n)          _read((fd), (buf), (unsigned int)(n))
+    #define file__close(fd)                 _close(fd)
+    #define FILE__STDIN                     0
+#else
+    #define file__open(fname)               open((fname), O_RDONLY)
+    #define file__read(fd, buf, n)          read((fd), (buf), (size_t)(n))
+    #define file__close(fd)                 close(fd)
+    #define FILE__STDIN                     STDIN_FILENO
+#endif // CSTL_OS_WINDOWS
+
+// read() everything from `fd` into a heap buffer. `size_hint` is the expected size of the file (0 if unknown).
+// Returns 0 on success, or an `errno` value.
+static int file__read_all(cstlFile* file, int fd, UInt64 size_hint) {
+    // One byte more than the hint, so that a file of exactly that size is followed by a (zero-length) read of its 
+    // end instead of growing the buffer just to make room for it
+    UInt64 capacity = (size_hint ? size_hint + 1 : 64 * 1024) + CSTL_FILE_PADDING;
+    UInt64 length = 0;
+    char* buffer = (char*)malloc(capacity);
+    if(!buffer)
+        return ENOMEM;
+
+    while(true) {
+        // Always leave room for the padding
+        if(capacity - length <= CSTL_FILE_PADDING) {
+            if(length > CSTL_FILE_MAX_LENGTH) {
+                free(buffer);
+                return EFBIG;
+            }
+            char* grown = (char*)realloc(buffer, capacity * 2);
+            if(!grown) {
+                free(buffer);
+                return ENOMEM;
+            }
+            buffer = grown;
+            capacity *= 2;
+        }
+
+        UInt64 want = capacity - length - CSTL_FILE_PADDING;
+        // Keep every single read well within `int` (Windows)
+        if(want > (1u << 30))
+            want = 1u << 30;
+
+        long got = (long)file__read(fd, buffer + length, want);
+        if(got == 0)
+            break;
+        if(got < 0) {
+            if(errno == EINTR)
+                continue;
+            int error = errno;
+            free(buffer);
+            return error;
+        }
+        length += (UInt64)got;
+    }
+
+    if(length > CSTL_FILE_MAX_LENGTH) {
+        free(buffer);
+        return EFBIG;
+    }
+
+    memset(buffer + length, 0, CSTL_FILE_PADDING);
+    file->data = buffer;
+    file->length = length;
+    file->base = buffer;
+    file->capacity = capacity;
+    file->is_mapped = false;
+    return 0;
+}
+
+#if !defined(CSTL_OS_WINDOWS)
+// Map the regular file `fd` (of `length` bytes) into memory. 
+// Returns `false` if it couldn't be mapped (the caller should fall back to read()).
+static bool file__map(cstlFile* file, int fd, UInt64 length) {
+    UInt64 page = (UInt64)sysconf(_SC_PAGESIZE);
+    // The file is mapped over an anonymous (zero-filled) reservation that is at least a page longer. Whatever the 
+    // length of the file, it is followed by at least a page worth of zeros - the tail of its own last page is 
+    // zero-filled by the kernel, and the page after is (anonymous) zeros.
+    UInt64 capacity = ((length + page - 1) / page) * page + page;
+
+    void* base = mmap(null, capacity, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(base == MAP_FAILED)
+        return false;
+
+    if(mmap(base, length, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        munmap(base, capacity);
+        return false;
     }
 
-    fread(buffer, 1, buf_length, file); 
-    buffer[buf_length] = nullchar;
-    fclose(file); 
+    #ifdef MADV_SEQUENTIAL
+        // The Lexer reads a source file front to back, exactly once
+        madvise(base, length, MADV_SEQUENTIAL);
+    #endif // MADV_SEQUENTIAL
 
-    return buffer;
+    file->data = (const char*)base;
+    file->length = length;
+    file->base = base;
+    file->capacity = capacity;
+    file->is_mapped = true;
+    return true;
+}
+#endif // CSTL_OS_WINDOWS
+
+// Load the contents of `fname` into `file`. A null `fname` (or "-") reads from `stdin`.
+// Returns 0 on success, or an `errno` value (use `strerror()` to describe it) - `file` is left empty on failure.
+static int file_load(cstlFile* file, const char* fname) {
+    memset(file, 0, sizeof(cstlFile));
+    bool is_stdin = fname == null || strcmp(fname, "-") == 0;
+    int fd = is_stdin ? FILE__STDIN : file__open(fname);
+    if(fd < 0)
+        return errno;
+
+    int error = 0;
+    UInt64 size_hint = 0;
+#if !defined(CSTL_OS_WINDOWS)
+    struct stat st;
+    if(fstat(fd, &st) != 0) {
+        error = errno;
+        if(!is_stdin)
+            file__close(fd);
+        return error;
+    }
+
+    if(S_ISREG(st.st_mode)) {
+        if((UInt64)st.st_size > CSTL_FILE_MAX_LENGTH) {
+            if(!is_stdin)
+                file__close(fd);
+            return EFBIG;
+        }
+        size_hint = (UInt64)st.st_size;
+    }
+
+    // An empty file can't be mapped - it is "read" instead
+    if(size_hint > 0 && file__map(file, fd, size_hint)) {
+        if(!is_stdin)
+            file__close(fd);
+        return 0;
+    }
+#endif // CSTL_OS_WINDOWS
+
+    error = file__read_all(file, fd, size_hint);
+    if(!is_stdin)
+        file__close(fd);
+    return error;
+}
+
+// Release the memory held by `file`
+static void file_unload(cstlFile* file) {
+    if(file->base) {
+#if !defined(CSTL_OS_WINDOWS)
+        if(file->is_mapped)
+            munmap(file->base, file->capacity);
+        else
+#endif // CSTL_OS_WINDOWS
+            free(file->base);
+    }
+    memset(file, 0, sizeof(cstlFile));
 }
 
 #endif // _CSTL_IO_H
\ No newline at end of file
@@ -0,0 +1,333 @@
+/*
+_ _    _           ______   _______        
+| |  | |    /\    /___  /   |  ____|| |    
+| |__| |   /  \      / /    | |__   | |       Hazel - The Fast, Expressive & Elegant Programming Language
+|  __  |  / /\ \    / /     |  __|  | |       Languages: C, C++, and Assembly
+| |  | | / ____ \  / /___   | |____ | |____   https://github.com/HazelLang/hazel/
+|_|_ |_|/_/    \_\/_______\ |______|_\______|
+
+Licensed under the MIT License <http://opensource.org/licenses/MIT>
+SPDX-License-Identifier: MIT
+Copyright (c) 2021 Jason Dsouza <http://github.com/jasmcaus>
+*/
+
+#ifndef CSTL_MAP_H
+#define CSTL_MAP_H
+
+#include <string.h>
+#include <hazel/core/types.h>
+#include <hazel/core/debug.h>
+#include <hazel/core/math.h>
+#include <hazel/core/misc.h>
+#include <hazel/core/hash.h>
+#include <hazel/core/endian.h>
+#include <hazel/core/simd.h>
+#include <hazel/core/allocator.h>
+
+/*
+    Hash Maps
+
+    CSTL_MAP(Name, prefix, K, V, hash, equals) defines a map from `K`s to `V`s (`Name`), and the functions that go 
+    with it (`prefix_find()`, `prefix_put()`, ...), in the spirit of CSTL_VECTOR (see <hazel/core/vector.h>). `hash` 
+    is a function (or function-like macro) returning a well-mixed 64-bit hash of a key - eg. `map_hash_u64()`, and 
+    `equals` one that compares two keys - eg. CSTL_MAP_EQUALS. 
+
+        CSTL_MAP(IntMap, intmap, UInt64, int, map_hash_u64, CSTL_MAP_EQUALS)
+
+        IntMap map = {0};               // an empty map (allocating from the heap)
+        intmap_put(&map, 42, 1);
+        int* value = intmap_find(&map, 42);
+        for(UInt64 i = intmap_next(&map, 0); i < map.capacity; i = intmap_next(&map, i + 1))
+            ... map.entries[i].key, map.entries[i].value ...
+        intmap_free(&map);
+
+    The map is a "Swiss table": entries live in one open-addressed array, next to an array of one-byte control words 
+    - CSTL_MAP_EMPTY for a free slot, or the low 7 bits of its entry's hash (its "tag") for a full one. A lookup 
+    compares the tag of the key against a whole group of CSTL_MAP_GROUP_WIDTH control bytes at once (with SSE2 or 
+    NEON, or 8 at a time with SWAR), and only compares the keys of the slots whose tags match - about one in 128 of 
+    the others. The control bytes of the first group are cloned after the last one, so that a group can be loaded 
+    at any slot without wrapping around.
+
+    Keys are probed for linearly (a group at a time), starting at the slot picked by the rest of their hash: a key 
+    is always found before the first free slot after that one. Removing an entry shifts the entries after it back 
+    (as long as that doesn't move them before their own slot) - so there are no tombstones, and lookups never slow 
+    down as entries come and go. Removals pay for it: they rehash the keys they move past.
+
+    Pointers to entries are invalidated by anything that inserts or removes an entry.
+*/
+
+#if defined(CSTL_SIMD_SSE2) || defined(CSTL_SIMD_NEON)
+    #define CSTL_MAP_GROUP_WIDTH    16
+#else
+    #define CSTL_MAP_GROUP_WIDTH    8
+#endif
+// The control byte of a free slot (the tag of a full one is in [0, 127])
+#define CSTL_MAP_EMPTY              ((UInt8)0x80)
+// No. of slots a map has, at least (once it holds anything)
+#define CSTL_MAP_MIN_CAPACITY       16
+// A map grows once more than 7/8 of its slots are full
+#define CSTL_MAP_MAX_LOAD(capacity) ((capacity) - (capacity) / 8)
+
+// Compares two keys with `==` (for integers, pointers, ... - see CSTL_MAP)
+#define CSTL_MAP_EQUALS(a, b)       ((a) == (b))
+
+// Returns a well-mixed hash of `x` (a 64-bit integer, a pointer, ...)
+static inline UInt64 map_hash_u64(UInt64 x) {
+    return hash_u64(x);
+}
+
+// Returns the slot a key with hash `hash` belongs in (`mask` is the no. of slots - 1)
+static inline UInt64 map__slot(UInt64 hash, UInt64 mask) {
+    return (hash >> 7) & mask;
+}
+
+// Returns the tag of a key with hash `hash`
+static inline UInt8 map__tag(UInt64 hash) {
+    return (UInt8)(hash & 0x7F);
+}
+
+/*
+    Group matching. `map__match()` and `map__match_empty()` return a bitmask of the slots in the group at `ctrl` 
+    whose control byte is `tag` (or CSTL_MAP_EMPTY) - slot `i` is bit `i << CSTL_MAP_MATCH_SHIFT`.
+    `map__first()` counts trailing zeros, so the first slot must land in the lowest bits whatever the byte order: 
+    the SWAR fallback reads its groups as little-endian.
+*/
+#if defined(CSTL_SIMD_SSE2)
+    #define CSTL_MAP_MATCH_SHIFT    0
+
+    static inline UInt64 map__match(const UInt8* ctrl, UInt8 tag) {
+        __m128i group = _mm_loadu_si128((const __m128i*)ctrl);
+        return (UInt64)(UInt32)_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char)tag)));
+    }
+
+    static inline UInt64 map__match_empty(const UInt8* ctrl) {
+        // Only free slots have their high bit set
+        return (UInt64)(UInt32)_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)ctrl));
+    }
+#elif defined(CSTL_SIMD_NEON)
+    // No `movemask` on NEON: each byte of the comparison is narrowed to a nibble, and the top bit of every nibble 
+    // is kept
+    #define CSTL_MAP_MATCH_SHIFT    2
+
+    static inline UInt64 map__nibbles(uint8x16_t matches) {
+        uint8x8_t narrowed = vshrn_n_u16(vreinterpretq_u16_u8(matches), 4);
+        return vget_lane_u64(vreinterpret_u64_u8(narrowed), 0) & 0x8888888888888888ULL;
+    }
+
+    static inline UInt64 map__match(const UInt8* ctrl, UInt8 tag) {
+        return map__nibbles(vceqq_u8(vld1q_u8(ctrl), vdupq_n_u8(tag)));
+    }
+
+    static inline UInt64 map__match_empty(const UInt8* ctrl) {
+        return map__nibbles(vcltzq_s8(vreinterpretq_s8_u8(vld1q_u8(ctrl))));
+    }
+#else
+    // SWAR: a group is a UInt64, and a slot matches when the high bit of its byte is set
+    #define CSTL_MAP_MATCH_SHIFT    3
+
+    static inline UInt64 map__match(const UInt8* ctrl, UInt8 tag) {
+        UInt64 group = endian_load_le64(ctrl);
+        // Bytes that are equal to `tag` are zero - and only they end up with their high bit set
+        UInt64 x = group ^ (0x0101010101010101ULL * tag);
+        UInt64 low = 0x7F7F7F7F7F7F7F7FULL;
+        return ~(((x & low) + low) | x | low);
+    }
+
+    static inline UInt64 map__match_empty(const UInt8* ctrl) {
+        UInt64 group = endian_load_le64(ctrl);
+        return group & 0x8080808080808080ULL;
+    }
+#endif // CSTL_SIMD_SSE2
+
+// Returns the index (in its group) of the lowest slot in `matches` (which must not be 0)
+static inline UInt64 map__first(UInt64 matches) {
+    return simd_ctz64(matches) >> CSTL_MAP_MATCH_SHIFT;
+}
+
+// Set the control byte of slot `i` (and its clone, if it has one)
+static inline void map__set_ctrl(UInt8* ctrl, UInt64 capacity, UInt64 i, UInt8 value) {
+    ctrl[i] = value;
+    if(i < CSTL_MAP_GROUP_WIDTH)
+        ctrl[capacity + i] = value;
+}
+
+// Returns the first free slot at or after the slot a key with hash `hash` belongs in (there must be one)
+static inline UInt64 map__find_empty(const UInt8* ctrl, UInt64 mask, UInt64 hash) {
+    UInt64 pos = map__slot(hash, mask);
+    for(;;) {
+        UInt64 empty = map__match_empty(ctrl + pos);
+        if(empty != 0)
+            return (pos + map__first(empty)) & mask;
+        pos = (pos + CSTL_MAP_GROUP_WIDTH) & mask;
+    }
+}
+
+// Returns the no. of slots a map needs to hold `size` entries (a power of 2)
+static inline UInt64 map__capacity_for(UInt64 size) {
+    UInt64 capacity = CSTL_MAP_MIN_CAPACITY;
+    while(CSTL_MAP_MAX_LOAD(capacity) < size)
+        capacity *= 2;
+    return capacity;
+}
+
+#define CSTL_MAP(Name, prefix, K, V, hash, equals)                                                                  \
+    typedef struct Name##Entry {                                                                                    \
+        K key;                                                                                                      \
+        V value;                                                                                                    \
+    } Name##Entry;                                                                                                  \
+                                                                                                                    \
+    typedef struct Name {                                                                                           \
+        Name##Entry* entries;       /* slots (only those whose control byte isn't CSTL_MAP_EMPTY hold an entry) */  \
+        UInt8* ctrl;                /* control byte of each slot, then a clone of the first group's */              \
+        UInt64 size;                /* no. of entries in the map */                                                 \
+        UInt64 capacity;            /* no. of slots (0, or a power of 2) */                                         \
+        cstlAllocator* allocator;   /* where the slots come from (null for the heap) */                             \
+    } Name;                                                                                                         \
+                                                                                                                    \
+    /* Initialize an empty map allocating from `allocator` (null for the heap - same as zeroing it) */              \
+    static inline void prefix##_init(Name* map, cstlAllocator* allocator) {                                         \
+        memset(map, 0, sizeof(Name));                                                                               \
+        map->allocator = allocator;                                                                                 \
+    }                                                                                                               \
+                                                                                                                    \
+    /* Size (in bytes) of the block holding `capacity` slots, and their control bytes */                            \
+    static inline UInt64 prefix##__bytes(UInt64 capacity) {                                                         \
+        return capacity * sizeof(Name##Entry) + capacity + CSTL_MAP_GROUP_WIDTH;                                    \
+    }                                                                                                               \
+                                                                                                                    \
+    /* Free the entries of `map` (it is left empty, and can be used again) */                                       \
+    static inline void prefix##_free(Name* map) {                                                                   \
+        if(map->capacity != 0)                                                                                      \
+            CSTL_FREE(map->allocator, map->entries, prefix##__bytes(map->capacity));                                \
+        map->entries = null;                                                                                        \
+        map->ctrl = null;                                                                                           \
+        map->size = map->capacity = 0;                                                                              \
+    }                                                                                                               \
+                                                                                                                    \
+    /* Move the entries of `map` into `capacity` (a power of 2) slots */                                            \
+    static CSTL_NOINLINE void prefix##__rehash(Name* map, UInt64 capacity) {                                        \
+        CSTL_CHECK_LT(capacity, (UInt64)-1 / (sizeof(Name##Entry) + 1));                                            \
+        Name##Entry* entries = (Name##Entry*)CSTL_ALLOC(map->allocator, prefix##__bytes(capacity));                 \
+        CSTL_CHECK_NOT_NULL(entries, "Could not allocate memory. Memory full.");                                    \
+        UInt8* ctrl = (UInt8*)(entries + capacity);                                                                 \
+        memset(ctrl, CSTL_MAP_EMPTY, capacity + CSTL_MAP_GROUP_WIDTH);                                              \
+                                                                                                                    \
+        for(UInt64 i = 0; i < map->capacity; i++) {                                                                 \
+            if(map->ctrl[i] == CSTL_MAP_EMPTY)                                                                      \
+                continue;                                                                                           \
+            UInt64 h = hash(map->entries[i].key);                                                                   \
+            UInt64 slot = map__find_empty(ctrl, capacity - 1, h);                                                   \
+            map__set_ctrl(ctrl, capacity, slot, map__tag(h));                                                       \
+            entries[slot] = map->entries[i];                                                                        \
+        }                                                                                                           \
+                                                                                                                    \
+        if(map->capacity != 0)                                                                                      \
+            CSTL_FREE(map->allocator, map->entries, prefix##__bytes(map->capacity));                                \
+        map->entries = entries;                                                                                     \
+        map->ctrl = ctrl;                                                                                           \
+        map->capacity = capacity;                                                                                   \
+    }                                                                                                               \
+                                                                                                                    \
+    /* Make sure `map` can hold at least `size` entries without growing */                                          \
+    static inline void prefix##_reserve(Name* map, UInt64 size) {                                                   \
+        if(size > CSTL_MAP_MAX_LOAD(map->capacity) || map->capacity == 0)                                           \
+            prefix##__rehash(map, CSTL_MAX(map__capacity_for(size), map->capacity));                                \
+    }                                                                                                               \
+                                                                                                                    \
+    /* Returns the slot holding `key` (whose hash is `h`), or `map->capacity` if there is none */                   \
+    static inline UInt64 prefix##__lookup(const Name* map, K key, UInt64 h) {                                       \
+        if(map->size == 0)                                                                                          \
+            return map->capacity;                                                                                   \
+        UInt64 mask = map->capacity - 1;                                                                            \
+        UInt64 pos = map__slot(h, mask);                                                                            \
+        UInt8 tag = map__tag(h);                                                                                    \
+        for(;;) {                                                                                                   \
+            const UInt8* group = map->ctrl + pos;                                                                   \
+            for(UInt64 matches = map__match(group, tag); matches != 0; matches &= matches - 1) {                    \
+                UInt64 i = (pos + map__first(matches)) & mask;                                                      \
+                if(equals(map->entries[i].key, key))                                                                \
+                    return i;                                                                                       \
+            }                                                                                                       \
+            if(map__match_empty(group) != 0)                                                                        \
+                return map->capacity;                                                                               \
+            pos = (pos + CSTL_MAP_GROUP_WIDTH) & mask;                                                              \
+        }                                                                                                           \
+    }                                                                                                               \
+                                                                                                                    \
+    /* Returns (a pointer to) the value of `key` in `map`, or null if it isn't there */                             \
+    static inline V* prefix##_find(const Name* map, K key) {                                                        \
+        UInt64 i = prefix##__lookup(map, key, hash(key));                                                           \
+        return i < map->capacity ? &map->entries[i].value : null;                                                   \
+    }                                                                                                               \
+                                                                                                                    \
+    /* Is `key` in `map`? */                                                                                        \
+    static inline bool prefix##_contains(const Name* map, K key) {                                                  \
+        return prefix##__lookup(map, key, hash(key)) < map->capacity;                                               \
+    }                                                                                                               \
+                                                                                                                    \
+    /* Returns (a pointer to) the value of `key` in `map`, adding `key` first if it isn't there - its value is */   \
+    /* then left for the caller to fill in, and `*inserted` (if given) is set. */                                   \
+    static inline V* prefix##_find_or_insert(Name* map, K key, bool* inserted) {                                    \
+        UInt64 h = hash(key);                                                                                       \
+        UInt64 i = prefix##__lookup(map, key, h);                                                                   \
+        if(inserted)                                                                                                \
+            *inserted = i >= map->capacity;                                                                         \
+        if(i < map->capacity)                                                                                       \
+            return &map->entries[i].value;                                                                          \
+                                                                                                                    \
+        if(map->size >= CSTL_MAP_MAX_LOAD(map->capacity))                                                           \
+            prefix##__rehash(map, map->capacity ? map->capacity * 2 : CSTL_MAP_MIN_CAPACITY);                       \
+        i = map__find_empty(map->ctrl, map->capacity - 1, h);                                                       \
+        map__set_ctrl(map->ctrl, map->capacity, i, map__tag(h));                                                    \
+        map->entries[i].key = key;                                                                                  \
+        map->size++;                                                                                                \
+        return &map->entries[i].value;                                                                              \
+    }                                                                                                               \
+                                                                                                                    \
+    /* Map `key` to `value` (replacing its value, if it is already in `map`). Returns true if `key` is new. */      \
+    static inline bool prefix##_put(Name* map, K key, V value) {                                                    \
+        bool inserted;                                                                                              \
+        *prefix##_find_or_insert(map, key, &inserted) = value;                                                      \
+        return inserted;                                                                                            \
+    }                                                                                                               \
+                                                                                                                    \
+    /* Remove `key` from `map`. Returns false if it wasn't there. */                                                \
+    static inline bool prefix##_remove(Name* map, K key) {                                                          \
+        UInt64 i = prefix##__lookup(map, key, hash(key));                                                           \
+        if(i >= map->capacity)                                                                                      \
+            return false;                                                                                           \
+                                                                                                                    \
+        /* Shift back the entries after `i` that may move closer to their own slot (or onto it), until a free */    \
+        /* slot ends the run */                                                                                     \
+        UInt64 mask = map->capacity - 1;                                                                            \
+        for(UInt64 j = (i + 1) & mask; map->ctrl[j] != CSTL_MAP_EMPTY; j = (j + 1) & mask) {                        \
+            UInt64 home = map__slot(hash(map->entries[j].key), mask);                                               \
+            if(((j - home) & mask) >= ((j - i) & mask)) {                                                           \
+                map->entries[i] = map->entries[j];                                                                  \
+                map__set_ctrl(map->ctrl, map->capacity, i, map->ctrl[j]);                                           \
+                i = j;                                                                                              \
+            }                                                                                                       \
+        }                                                                                                           \
+        map__set_ctrl(map->ctrl, map->capacity, i, CSTL_MAP_EMPTY);                                                 \
+        map->size--;                                                                                                \
+        return true;                                                                                                \
+    }                                                                                                               \
+                                                                                                                    \
+    /* Returns the first slot at or after `i` that holds an entry (`map->capacity` if there is none) */             \
+    static inline UInt64 prefix##_next(const Name* map, UInt64 i) {                                                 \
+        while(i < map->capacity && map->ctrl[i] == CSTL_MAP_EMPTY)                                                  \
+            i++;                                                                                                    \
+        return i;                                                                                                   \
+    }                                                                                                               \
+                                                                                                                    \
+    /* Remove every entry of `map` (keeping its slots) */                                                           \
+    static inline void prefix##_clear(Name* map) {                                                                  \
+        if(map->capacity != 0)                                                                                      \
+            memset(map->ctrl, CSTL_MAP_EMPTY, map->capacity + CSTL_MAP_GROUP_WIDTH);                                \
+        map->size = 0;                                                                                              \
+    }                                                                                                               \
+                                                                                                                    \
+    static inline UInt64 prefix##_size(const Name* map) { return map->size; }                                       \
+    static inline bool prefix##_is_empty(const Name* map) { return map->size == 0; }
+
+#endif // CSTL_MAP_H
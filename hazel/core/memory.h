@@ -14,17 +14,196 @@ Copyright (c) 2021 Jason Dsouza <http://github.com/jasmcaus>
 #ifndef CSTL_MEMORY_H
 #define CSTL_MEMORY_H
 
+#include <string.h>
+#include <hazel/core/types.h>
+#include <hazel/core/debug.h>
+#include <hazel/core/math.h>
+#include <hazel/core/misc.h>
+#include <hazel/core/allocator.h>
 
 #ifndef KB_TO_BYTES
-    #define KB_TO_BYTES(x)               (x) * (Int64)(1024)
-    #define MB_TO_BYTES(x)    KB_TO_BYTES(x) * (Int64)(1024)
-    #define GB_TO_BYTES(x)    MB_TO_BYTES(x) * (Int64)(1024)
-    #define TB_TO_BYTES(x)    GB_TO_BYTES(x) * (Int64)(1024)
+    #define KB_TO_BYTES(x)    ((x) * (Int64)(1024))
+    #define MB_TO_BYTES(x)    (KB_TO_BYTES(x) * (Int64)(1024))
+    #define GB_TO_BYTES(x)    (MB_TO_BYTES(x) * (Int64)(1024))
+    #define TB_TO_BYTES(x)    (GB_TO_BYTES(x) * (Int64)(1024))
 #endif 
 
 #define CSTL__ONES            cast(Ull)-1/UInt8_MAX
 #define CSTL__HIGHS           CSTL__ONES * (UInt8_MAX/2+1)
 #define CSTL__HAS_ZERO(x)     (x)-CSTL__ONES & ~(x) & CSTL__HIGHS
 
+/*
+    Arenas
+
+    An arena hands out memory by bumping a pointer through large chunks (taken from a `cstlAllocator`), and gives 
+    all of it back at once: whatever lives as long as a compilation unit (token values, interned strings, AST nodes, 
+    ...) is allocated from an arena, and torn down with a single `arena_free()` - never with a `free()` per object. 
+
+    Allocations are aligned to CSTL_ARENA_ALIGNMENT bytes (`arena_alloc()`), or to any power of 2 
+    (`arena_alloc_aligned()`). A request that doesn't fit in a chunk gets a chunk of its own.
+
+    Temporary (scratch) memory is allocated past a mark (`arena_mark()`), and released by going back to it 
+    (`arena_restore()`) - everything allocated since is freed, everything allocated before stays put. 
+*/
+
+// Size (in bytes) of the chunks of an arena, unless it's told otherwise
+#define CSTL_ARENA_CHUNK_SIZE       KB_TO_BYTES(64)
+// What `arena_alloc()` aligns to (that of `malloc()` on 64-bit platforms)
+#define CSTL_ARENA_ALIGNMENT        16
+
+// A chunk of memory in an arena. Chunks are chained (newest first).
+typedef struct cstlArenaChunk cstlArenaChunk;
+struct cstlArenaChunk {
+    cstlArenaChunk* prev;       // the previously allocated chunk
+    UInt64 used;                // no. of bytes handed out from `data`
+    UInt64 capacity;            // no. of bytes available in `data`
+    char data[];
+};
+
+typedef struct cstlArena {
+    cstlArenaChunk* head;       // chunk we're currently allocating from
+    cstlAllocator* allocator;   // where chunks come from (null for the heap)
+    UInt64 chunk_size;          // size (in bytes) of a chunk
+
+    // Statistics
+    UInt64 nchunks;             // no. of chunks held right now
+    UInt64 nallocs;             // no. of chunks allocated over time
+    UInt64 used;                // no. of bytes handed out (alignment padding included), and not yet given back
+    UInt64 capacity;            // no. of bytes in the chunks held right now
+    UInt64 peak;                // the most `used` has ever been
+} cstlArena;
+
+// A point in the life of an arena to go back to (see `arena_restore()`)
+typedef struct cstlArenaMark {
+    cstlArenaChunk* chunk;      // the arena's `head` when the mark was made
+    UInt64 chunk_used;          // ... and how much of it was used
+    UInt64 used;                // the arena's `used`
+} cstlArenaMark;
+
+// Initialize an (empty) arena, allocating chunks of `chunk_size` bytes (0 for CSTL_ARENA_CHUNK_SIZE) from 
+// `allocator` (null for the heap). An arena allocates nothing until it is first used.
+static inline void arena_init(cstlArena* arena, cstlAllocator* allocator, UInt64 chunk_size) {
+    memset(arena, 0, sizeof(cstlArena));
+    arena->allocator = allocator;
+    arena->chunk_size = chunk_size ? chunk_size : (UInt64)CSTL_ARENA_CHUNK_SIZE;
+}
+
+// Returns the no. of bytes needed to align `ptr` to `alignment` (a power of 2)
+static inline UInt64 arena__padding(const char* ptr, UInt64 alignment) {
+    return (UInt64)(0 - (UIntptr)ptr) & (alignment - 1);
+}
+
+// Allocate `size` bytes (aligned to `alignment`) from a new chunk
+static CSTL_NOINLINE void* arena__alloc_slow(cstlArena* arena, UInt64 size, UInt64 alignment) {
+    if(arena->chunk_size == 0)
+        arena->chunk_size = CSTL_ARENA_CHUNK_SIZE;
+    UInt64 capacity = CSTL_MAX(size + alignment - 1, arena->chunk_size);
+    cstlArenaChunk* chunk = (cstlArenaChunk*)CSTL_ALLOC(arena->allocator, sizeof(cstlArenaChunk) + capacity);
+    CSTL_CHECK_NOT_NULL(chunk, "Could not allocate memory. Memory full.");
+
+    chunk->prev = arena->head;
+    chunk->capacity = capacity;
+    UInt64 padding = arena__padding(chunk->data, alignment);
+    chunk->used = padding + size;
+    arena->head = chunk;
+    ++arena->nchunks;
+    ++arena->nallocs;
+    arena->capacity += capacity;
+    arena->used += padding + size;
+    arena->peak = CSTL_MAX(arena->peak, arena->used);
+    return chunk->data + padding;
+}
+
+// Allocate `size` bytes, aligned to `alignment` (a power of 2), from `arena`
+static inline void* arena_alloc_aligned(cstlArena* arena, UInt64 size, UInt64 alignment) {
+    CSTL_CHECK(alignment != 0 && (alignment & (alignment - 1)) == 0, "The alignment must be a power of 2");
+    cstlArenaChunk* chunk = arena->head;
+    if(chunk != null) {
+        char* ptr = chunk->data + chunk->used;
+        UInt64 padding = arena__padding(ptr, alignment);
+        if(padding + size <= chunk->capacity - chunk->used) {
+            chunk->used += padding + size;
+            arena->used += padding + size;
+            arena->peak = CSTL_MAX(arena->peak, arena->used);
+            return ptr + padding;
+        }
+    }
+    return arena__alloc_slow(arena, size, alignment);
+}
+
+// Allocate `size` bytes (aligned to CSTL_ARENA_ALIGNMENT) from `arena`
+static inline void* arena_alloc(cstlArena* arena, UInt64 size) {
+    return arena_alloc_aligned(arena, size, CSTL_ARENA_ALIGNMENT);
+}
+
+// Allocate `size` zeroed bytes (aligned to CSTL_ARENA_ALIGNMENT) from `arena`
+static inline void* arena_alloc_zeroed(cstlArena* arena, UInt64 size) {
+    void* ptr = arena_alloc(arena, size);
+    memset(ptr, 0, (size_t)size);
+    return ptr;
+}
+
+// Returns a NUL-terminated copy of the `length` bytes at `string`, allocated from `arena`
+static inline char* arena_strndup(cstlArena* arena, const char* string, UInt64 length) {
+    char* copy = (char*)arena_alloc_aligned(arena, length + 1, 1);
+    memcpy(copy, string, (size_t)length);
+    copy[length] = nullchar;
+    return copy;
+}
+
+// Returns a mark to go back to with `arena_restore()`
+static inline cstlArenaMark arena_mark(const cstlArena* arena) {
+    cstlArenaMark mark;
+    mark.chunk = arena->head;
+    mark.chunk_used = arena->head ? arena->head->used : 0;
+    mark.used = arena->used;
+    return mark;
+}
+
+// Free the chunks of `arena` newer than `last` (null for every one of them)
+static void arena__free_chunks(cstlArena* arena, cstlArenaChunk* last) {
+    cstlArenaChunk* chunk = arena->head;
+    while(chunk != last) {
+        cstlArenaChunk* prev = chunk->prev;
+        --arena->nchunks;
+        arena->capacity -= chunk->capacity;
+        CSTL_FREE(arena->allocator, chunk, sizeof(cstlArenaChunk) + chunk->capacity);
+        chunk = prev;
+    }
+    arena->head = last;
+}
+
+// Give back everything allocated from `arena` since `mark` was made (the memory of any chunks allocated since is
+// freed). Marks made after `mark` become invalid.
+static void arena_restore(cstlArena* arena, cstlArenaMark mark) {
+    if(mark.chunk == null && arena->head != null) {
+        // Back to an empty arena: hold on to its first chunk (if it's a regular one), for the next allocations
+        cstlArenaChunk* first = arena->head;
+        while(first->prev != null)
+            first = first->prev;
+        if(first->capacity == arena->chunk_size) {
+            arena__free_chunks(arena, first);
+            first->used = 0;
+            arena->used = 0;
+            return;
+        }
+    }
+    arena__free_chunks(arena, mark.chunk);
+    if(mark.chunk != null)
+        mark.chunk->used = mark.chunk_used;
+    arena->used = mark.used;
+}
+
+// Give back everything allocated from `arena`, holding on to (at most) one chunk for the next allocations
+static void arena_reset(cstlArena* arena) {
+    cstlArenaMark empty = { null, 0, 0 };
+    arena_restore(arena, empty);
+}
+
+// Free every chunk of `arena`. It can be used again afterwards.
+static void arena_free(cstlArena* arena) {
+    arena__free_chunks(arena, null);
+    arena->used = 0;
+}
 
 #endif // CSTL_MEMORY_H
\ No newline at end of file
@@ -62,6 +62,20 @@ Copyright (c) 2021 Jason Dsouza <http://github.com/jasmcaus>
 #endif 
 
 
+// Thread-local storage (every thread gets its own copy of the variable)
+#ifndef CSTL_THREAD_LOCAL
+    #if defined(__cplusplus) && (__cplusplus >= 201103L)
+        #define CSTL_THREAD_LOCAL   thread_local
+    #elif defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 201112L)
+        #define CSTL_THREAD_LOCAL   _Thread_local
+    #elif defined(_MSC_VER)
+        #define CSTL_THREAD_LOCAL   __declspec(thread)
+    #else 
+        #define CSTL_THREAD_LOCAL   __thread
+    #endif 
+#endif 
+
+
 // Casts
 #ifdef __cplusplus
     #define CSTL_CAST(type, x)       static_cast<type>(x)
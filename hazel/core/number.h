@@ -0,0 +1,125 @@
+/*
+_ _    _           ______   _______        
+| |  | |    /\    /___  /   |  ____|| |    
+| |__| |   /  \      / /    | |__   | |       Hazel - The Fast, Expressive & Elegant Programming Language
+|  __  |  / /\ \    / /     |  __|  | |       Languages: C, C++, and Assembly
+| |  | | / ____ \  / /___   | |____ | |____   https://github.com/HazelLang/hazel/
+|_|_ |_|/_/    \_\/_______\ |______|_\______|
+
+Licensed under the MIT License <http://opensource.org/licenses/MIT>
+SPDX-License-Identifier: MIT
+Copyright (c) 2021 Jason Dsouza <http://github.com/jasmcaus>
+*/
+
+#ifndef CSTL_NUMBER_H
+#define CSTL_NUMBER_H
+
+#include <float.h>
+#include <string.h>
+#include <hazel/core/types.h>
+#include <hazel/core/endian.h>
+
+/*
+    Number conversion building blocks.
+
+    Decimal digits are converted 8 at a time (SWAR - "SIMD within a register"): 8 bytes are loaded into a UInt64, 
+    checked to all be digits, and combined into their value with 3 multiplications.
+
+    Decimal floats are converted with Clinger's fast path: if the decimal mantissa and the power of 10 it is scaled by 
+    are both exactly representable, a single (correctly rounded) multiplication or division gives the correctly 
+    rounded result. That covers practically every literal written by hand. Anything else is left to the C library 
+    (`strtod()`).
+*/
+
+// Load 8 bytes from `p` (which need not be aligned) such that `p[0]` ends up in the least significant byte
+static inline UInt64 number_load8(const char* p) {
+    UInt64 chunk;
+    memcpy(&chunk, p, sizeof(chunk));
+#if CSTL_BYTE_ORDER == CSTL_BIG_ENDIAN
+    chunk = __builtin_bswap64(chunk);
+#endif // CSTL_BYTE_ORDER
+    return chunk;
+}
+
+// Are all 8 bytes of `chunk` decimal digits ([0-9])?
+static inline bool number_is_8_digits(UInt64 chunk) {
+    // Every byte must be 0x3_, and must stay so when 6 is added to it ('9' + 6 = 0x3F)
+    return ((chunk & 0xF0F0F0F0F0F0F0F0ull) | 
+            (((chunk + 0x0606060606060606ull) & 0xF0F0F0F0F0F0F0F0ull) >> 4)) == 0x3333333333333333ull;
+}
+
+// Returns the value of the 8 decimal digits in `chunk` (the first digit being the least significant byte)
+static inline UInt32 number_parse_8_digits(UInt64 chunk) {
+    chunk -= 0x3030303030303030ull;
+    // Combine neighbouring digits into 2-digit values...
+    chunk = (chunk * 10) + (chunk >> 8);
+    // ... and those into 4-digit values, and then the two 4-digit values into one
+    chunk = (((chunk & 0x000000FF000000FFull) * 0x000F424000000064ull) + 
+             (((chunk >> 16) & 0x000000FF000000FFull) * 0x0000271000000001ull)) >> 32;
+    return (UInt32)chunk;
+}
+
+// Clinger's fast path is only valid if floating-point arithmetic isn't carried out in a wider (x87) precision
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD == 0
+    #define NUMBER_HAS_FAST_PATH    1
+#else
+    #define NUMBER_HAS_FAST_PATH    0
+#endif // FLT_EVAL_METHOD
+
+// Powers of 10 that are exact as a Float64 (10^22 is the largest)
+static const Float64 numberPowersOf10[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11, 
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// Computes `mantissa * 10^exp10`, correctly rounded to a Float64, into `out`. 
+// Returns `false` (leaving `out` alone) if that can't be done exactly with the fast path.
+static inline bool number_decimal_to_float64(UInt64 mantissa, Int64 exp10, Float64* out) {
+#if NUMBER_HAS_FAST_PATH
+    // Every integer up to 2^53 is exact
+    if(mantissa > (1ull << 53))
+        return false;
+    Float64 value = (Float64)mantissa;
+    if(exp10 < 0) {
+        if(exp10 < -22)
+            return false;
+        *out = value / numberPowersOf10[-exp10];
+        return true;
+    }
+    if(exp10 > 22) {
+        // `1e30` is `1000000000 * 10^22`: the mantissa can absorb some of the exponent, as long as it stays exact
+        if(exp10 > 22 + 15)
+            return false;
+        value *= numberPowersOf10[exp10 - 22];
+        if(value >= (Float64)(1ull << 53))
+            return false;
+        exp10 = 22;
+    }
+    *out = value * numberPowersOf10[exp10];
+    return true;
+#else
+    return false;
+#endif // NUMBER_HAS_FAST_PATH
+}
+
+// Powers of 10 that are exact as a Float32 (10^10 is the largest)
+static const Float32 numberPowersOf10f[] = {
+    1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f
+};
+
+// Computes `mantissa * 10^exp10`, correctly rounded to a Float32, into `out`. 
+// Returns `false` (leaving `out` alone) if that can't be done exactly with the fast path.
+static inline bool number_decimal_to_float32(UInt64 mantissa, Int64 exp10, Float32* out) {
+#if NUMBER_HAS_FAST_PATH
+    // Every integer up to 2^24 is exact
+    if(mantissa > (1ull << 24) || exp10 < -10 || exp10 > 10)
+        return false;
+    Float32 value = (Float32)mantissa;
+    *out = exp10 < 0 ? value / numberPowersOf10f[-exp10] : value * numberPowersOf10f[exp10];
+    return true;
+#else
+    return false;
+#endif // NUMBER_HAS_FAST_PATH
+}
+
+#endif // CSTL_NUMBER_H
@@ -0,0 +1,301 @@
+/*
+_ _    _           ______   _______        
+| |  | |    /\    /___  /   |  ____|| |    
+| |__| |   /  \      / /    | |__   | |       Hazel - The Fast, Expressive & Elegant Programming Language
+|  __  |  / /\ \    / /     |  __|  | |       Languages: C, C++, and Assembly
+| |  | | / ____ \  / /___   | |____ | |____   https://github.com/HazelLang/hazel/
+|_|_ |_|/_/    \_\/_______\ |______|_\______|
+
+Licensed under the MIT License <http://opensource.org/licenses/MIT>
+SPDX-License-Identifier: MIT
+Copyright (c) 2021 Jason Dsouza <http://github.com/jasmcaus>
+*/
+
+
+#ifndef CSTL_SIMD_H
+#define CSTL_SIMD_H
+
+#include <string.h>
+#include <hazel/core/cpu.h>
+#include <hazel/core/compilers.h>
+#include <hazel/core/types.h>
+#include <hazel/core/string.h>
+
+/*
+    Vectorized scanning kernels.
+
+    Each kernel takes the half-open range [p, end) and returns a pointer to the first byte that matches (or, for the 
+    `simd_skip_*()` kernels, does _not_ match) its predicate, or `end` if there is no such byte. 
+
+    The instruction set is picked in <hazel/core/cpu.h>: AVX2 looks at 32 bytes at a time, SSE2 and NEON at 16, 
+    and everything else falls back to scalar loops. Vector loads never read at or beyond `end` - the last 
+    (< CSTL_SIMD_WIDTH) bytes are always handled by the scalar tail.
+*/
+
+#if defined(CSTL_SIMD_AVX2) || defined(CSTL_SIMD_SSE2)
+    #include <immintrin.h>
+#elif defined(CSTL_SIMD_NEON)
+    #include <arm_neon.h>
+#endif 
+
+#if defined(CSTL_COMPILER_MSVC)
+    #include <intrin.h>
+#endif 
+
+#if defined(CSTL_SIMD_AVX2) || defined(CSTL_SIMD_SSE2) || defined(CSTL_SIMD_NEON)
+    #define CSTL_SIMD_VECTORIZED 1
+#endif 
+
+// Index of the lowest set bit in `x` (`x` must be non-zero)
+static inline UInt32 simd_ctz64(UInt64 x) {
+#if defined(CSTL_COMPILER_MSVC)
+    unsigned long index;
+    _BitScanForward64(&index, x);
+    return (UInt32)index;
+#else
+    return (UInt32)__builtin_ctzll(x);
+#endif 
+}
+
+// No. of zero bits above the highest set bit in `x` (`x` must be non-zero)
+static inline UInt32 simd_clz64(UInt64 x) {
+#if defined(CSTL_COMPILER_MSVC)
+    unsigned long index;
+    _BitScanReverse64(&index, x);
+    return 63 - (UInt32)index;
+#else
+    return (UInt32)__builtin_clzll(x);
+#endif 
+}
+
+// No. of set bits in `x`
+static inline UInt32 simd_popcount64(UInt64 x) {
+#if defined(CSTL_COMPILER_MSVC) && defined(_M_X64)
+    return (UInt32)__popcnt64(x);
+#elif defined(CSTL_COMPILER_MSVC)
+    x = x - ((x >> 1) & 0x5555555555555555ull);
+    x = (x & 0x3333333333333333ull) + ((x >> 2) & 0x3333333333333333ull);
+    return (UInt32)((((x + (x >> 4)) & 0x0F0F0F0F0F0F0F0Full) * 0x0101010101010101ull) >> 56);
+#else
+    return (UInt32)__builtin_popcountll(x);
+#endif 
+}
+
+// 
+// Per-ISA block masks
+// `simd__*_mask()` return a bitmask of the CSTL_SIMD_WIDTH bytes at `p` that satisfy the predicate, with exactly one 
+// bit set per matching byte. SIMD_MASK_INDEX() converts the (non-zero) mask into the index of the first such byte.
+// 
+#if defined(CSTL_SIMD_AVX2)
+    typedef __m256i SimdVec;
+    #define SIMD_MASK_INDEX(mask)           simd_ctz64(mask)
+    #define SIMD_MASK_ALL                   0xFFFFFFFFull
+
+    static inline SimdVec simd__load(const char* p) { return _mm256_loadu_si256((const __m256i*)p); }
+    static inline UInt64 simd__movemask(SimdVec v) { return (UInt64)(UInt32)_mm256_movemask_epi8(v); }
+    static inline SimdVec simd__eq(SimdVec v, char c) { return _mm256_cmpeq_epi8(v, _mm256_set1_epi8(c)); }
+    static inline SimdVec simd__or(SimdVec a, SimdVec b) { return _mm256_or_si256(a, b); }
+    static inline SimdVec simd__andnot(SimdVec a, SimdVec b) { return _mm256_andnot_si256(a, b); }
+    static inline SimdVec simd__or_byte(SimdVec v, char c) { return _mm256_or_si256(v, _mm256_set1_epi8(c)); }
+    // Shift [lo, hi] down to [-128, -128 + (hi - lo)] so that a single signed compare checks both bounds
+    static inline SimdVec simd__in_range(SimdVec v, char lo, char hi) {
+        SimdVec t = _mm256_add_epi8(v, _mm256_set1_epi8((char)(0x80 - (UInt8)lo)));
+        return _mm256_cmpgt_epi8(_mm256_set1_epi8((char)(0x80 + (UInt8)(hi - lo) + 1)), t);
+    }
+
+#elif defined(CSTL_SIMD_SSE2)
+    typedef __m128i SimdVec;
+    #define SIMD_MASK_INDEX(mask)           simd_ctz64(mask)
+    #define SIMD_MASK_ALL                   0xFFFFull
+
+    static inline SimdVec simd__load(const char* p) { return _mm_loadu_si128((const __m128i*)p); }
+    static inline UInt64 simd__movemask(SimdVec v) { return (UInt64)(UInt32)_mm_movemask_epi8(v); }
+    static inline SimdVec simd__eq(SimdVec v, char c) { return _mm_cmpeq_epi8(v, _mm_set1_epi8(c)); }
+    static inline SimdVec simd__or(SimdVec a, SimdVec b) { return _mm_or_si128(a, b); }
+    static inline SimdVec simd__andnot(SimdVec a, SimdVec b) { return _mm_andnot_si128(a, b); }
+    static inline SimdVec simd__or_byte(SimdVec v, char c) { return _mm_or_si128(v, _mm_set1_epi8(c)); }
+    // Shift [lo, hi] down to [-128, -128 + (hi - lo)] so that a single signed compare checks both bounds
+    static inline SimdVec simd__in_range(SimdVec v, char lo, char hi) {
+        SimdVec t = _mm_add_epi8(v, _mm_set1_epi8((char)(0x80 - (UInt8)lo)));
+        return _mm_cmplt_epi8(t, _mm_set1_epi8((char)(0x80 + (UInt8)(hi - lo) + 1)));
+    }
+
+#elif defined(CSTL_SIMD_NEON)
+    typedef uint8x16_t SimdVec;
+    // NEON has no `movemask` - narrowing every 16-bit lane by 4 leaves a 64-bit mask with 4 bits per byte, of which 
+    // we keep one
+    #define SIMD_MASK_INDEX(mask)           (simd_ctz64(mask) >> 2)
+    #define SIMD_MASK_ALL                   0x8888888888888888ull
+
+    static inline SimdVec simd__load(const char* p) { return vld1q_u8((const uint8_t*)p); }
+    static inline UInt64 simd__movemask(SimdVec v) { 
+        return vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(v), 4)), 0) & SIMD_MASK_ALL;
+    }
+    static inline SimdVec simd__eq(SimdVec v, char c) { return vceqq_u8(v, vdupq_n_u8((uint8_t)c)); }
+    static inline SimdVec simd__or(SimdVec a, SimdVec b) { return vorrq_u8(a, b); }
+    static inline SimdVec simd__andnot(SimdVec a, SimdVec b) { return vbicq_u8(b, a); }
+    static inline SimdVec simd__or_byte(SimdVec v, char c) { return vorrq_u8(v, vdupq_n_u8((uint8_t)c)); }
+    static inline SimdVec simd__in_range(SimdVec v, char lo, char hi) {
+        return vcleq_u8(vsubq_u8(v, vdupq_n_u8((uint8_t)lo)), vdupq_n_u8((uint8_t)(hi - lo)));
+    }
+#endif // CSTL_SIMD_...
+
+#ifdef CSTL_SIMD_VECTORIZED
+    // [A-Za-z0-9_]
+    static inline UInt64 simd__identifier_mask(const char* p) {
+        SimdVec v = simd__load(p);
+        SimdVec alpha = simd__in_range(simd__or_byte(v, 0x20), 'a', 'z');
+        SimdVec digit = simd__in_range(v, '0', '9');
+        return simd__movemask(simd__or(simd__or(alpha, digit), simd__eq(v, '_')));
+    }
+
+    // [ \t\v\f\r]
+    static inline UInt64 simd__blank_mask(const char* p) {
+        SimdVec v = simd__load(p);
+        // '\t' (9) to '\r' (13), except for the newline (10)
+        SimdVec ctrl = simd__andnot(simd__eq(v, '\n'), simd__in_range(v, '\t', '\r'));
+        return simd__movemask(simd__or(ctrl, simd__eq(v, ' ')));
+    }
+#endif // CSTL_SIMD_VECTORIZED
+
+// Returns the first occurrence of `a` in [p, end), or `end`
+static inline const char* simd_find_byte(const char* p, const char* end, char a) {
+#ifdef CSTL_SIMD_VECTORIZED
+    while(end - p >= CSTL_SIMD_WIDTH) {
+        UInt64 mask = simd__movemask(simd__eq(simd__load(p), a));
+        if(mask)
+            return p + SIMD_MASK_INDEX(mask);
+        p += CSTL_SIMD_WIDTH;
+    }
+    while(p < end && *p != a)
+        ++p;
+    return p;
+#else
+    // The C library's `memchr()` is already vectorized on most platforms
+    const char* found = (const char*)memchr(p, a, (size_t)(end - p));
+    return found ? found : end;
+#endif // CSTL_SIMD_VECTORIZED
+}
+
+// Returns the first occurrence of either `a` or `b` in [p, end), or `end`
+static inline const char* simd_find_byte2(const char* p, const char* end, char a, char b) {
+#ifdef CSTL_SIMD_VECTORIZED
+    while(end - p >= CSTL_SIMD_WIDTH) {
+        SimdVec v = simd__load(p);
+        UInt64 mask = simd__movemask(simd__or(simd__eq(v, a), simd__eq(v, b)));
+        if(mask)
+            return p + SIMD_MASK_INDEX(mask);
+        p += CSTL_SIMD_WIDTH;
+    }
+#endif // CSTL_SIMD_VECTORIZED
+    while(p < end && *p != a && *p != b)
+        ++p;
+    return p;
+}
+
+// Returns the first occurrence of any of `a`, `b` or `c` in [p, end), or `end`
+static inline const char* simd_find_byte3(const char* p, const char* end, char a, char b, char c) {
+#ifdef CSTL_SIMD_VECTORIZED
+    while(end - p >= CSTL_SIMD_WIDTH) {
+        SimdVec v = simd__load(p);
+        UInt64 mask = simd__movemask(simd__or(simd__or(simd__eq(v, a), simd__eq(v, b)), simd__eq(v, c)));
+        if(mask)
+            return p + SIMD_MASK_INDEX(mask);
+        p += CSTL_SIMD_WIDTH;
+    }
+#endif // CSTL_SIMD_VECTORIZED
+    while(p < end && *p != a && *p != b && *p != c)
+        ++p;
+    return p;
+}
+
+// Returns the no. of occurrences of `a` in [p, end)
+static inline UInt64 simd_count_byte(const char* p, const char* end, char a) {
+    UInt64 count = 0;
+#ifdef CSTL_SIMD_VECTORIZED
+    while(end - p >= CSTL_SIMD_WIDTH) {
+        count += simd_popcount64(simd__movemask(simd__eq(simd__load(p), a)));
+        p += CSTL_SIMD_WIDTH;
+    }
+#endif // CSTL_SIMD_VECTORIZED
+    for(; p < end; ++p)
+        count += (*p == a);
+    return count;
+}
+
+// Writes the offset (relative to `begin`) of every occurrence of `a` in [begin, end) to `out`, in ascending order, 
+// and returns how many were written. `out` must have room for `simd_count_byte(begin, end, a)` entries.
+static inline UInt64 simd_index_byte(const char* begin, const char* end, char a, UInt32* out) {
+    const char* p = begin;
+    UInt64 n = 0;
+#ifdef CSTL_SIMD_VECTORIZED
+    while(end - p >= CSTL_SIMD_WIDTH) {
+        UInt64 mask = simd__movemask(simd__eq(simd__load(p), a));
+        while(mask) {
+            out[n++] = (UInt32)(p - begin) + SIMD_MASK_INDEX(mask);
+            mask &= mask - 1; // clear the lowest set bit
+        }
+        p += CSTL_SIMD_WIDTH;
+    }
+#endif // CSTL_SIMD_VECTORIZED
+    for(; p < end; ++p)
+        if(*p == a)
+            out[n++] = (UInt32)(p - begin);
+    return n;
+}
+
+// Skips over [A-Za-z0-9_] and returns the first byte that can't be part of an (ASCII) identifier, or `end`
+static inline const char* simd_skip_identifier(const char* p, const char* end) {
+#ifdef CSTL_SIMD_VECTORIZED
+    while(end - p >= CSTL_SIMD_WIDTH) {
+        UInt64 mask = ~simd__identifier_mask(p) & SIMD_MASK_ALL;
+        if(mask)
+            return p + SIMD_MASK_INDEX(mask);
+        p += CSTL_SIMD_WIDTH;
+    }
+#endif // CSTL_SIMD_VECTORIZED
+    while(p < end && CSTL_CHAR_IS(*p, CSTL_CHAR_IDENTIFIER))
+        ++p;
+    return p;
+}
+
+// Skips over whitespace other than the newline ([ \t\v\f\r]) and returns the first non-blank byte, or `end`
+static inline const char* simd_skip_blanks(const char* p, const char* end) {
+#ifdef CSTL_SIMD_VECTORIZED
+    while(end - p >= CSTL_SIMD_WIDTH) {
+        UInt64 mask = ~simd__blank_mask(p) & SIMD_MASK_ALL;
+        if(mask)
+            return p + SIMD_MASK_INDEX(mask);
+        p += CSTL_SIMD_WIDTH;
+    }
+#endif // CSTL_SIMD_VECTORIZED
+    while(p < end && CSTL_CHAR_IS(*p, CSTL_CHAR_BLANK))
+        ++p;
+    return p;
+}
+
+// Skips over ASCII (bytes < 0x80) and returns the first byte that isn't, or `end`
+static inline const char* simd_skip_ascii(const char* p, const char* end) {
+#ifdef CSTL_SIMD_VECTORIZED
+    while(end - p >= CSTL_SIMD_WIDTH) {
+        UInt64 mask = simd__movemask(simd__in_range(simd__load(p), (char)0x80, (char)0xFF));
+        if(mask)
+            return p + SIMD_MASK_INDEX(mask);
+        p += CSTL_SIMD_WIDTH;
+    }
+#else
+    // A UInt64 at a time
+    while(end - p >= 8) {
+        UInt64 word;
+        memcpy(&word, p, sizeof(word));
+        if(word & 0x8080808080808080ull)
+            break;
+        p += 8;
+    }
+#endif // CSTL_SIMD_VECTORIZED
+    while(p < end && (UInt8)*p < 0x80)
+        ++p;
+    return p;
+}
+
+#endif // CSTL_SIMD_H
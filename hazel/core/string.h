@@ -22,50 +22,92 @@ Copyright (c) 2021 Jason Dsouza <http://github.com/jasmcaus>
 // UTF8 Inspiration: https://github.com/sheredom/utf8.h/blob/master/utf8.h
 
 // Char Things ==========================================
-static inline bool isUpper(char c) { return c>='A' && c<='Z'; }
-static inline bool isLower(char c) { return c>='a' && c<='z'; }
-static inline bool isDigit(char c) { return c >= '0' && c <= '9'; }
-static inline bool isAlpha(char c) { return isUpper(c) || isLower(c); }
-static inline bool isAlphanumeric(char c) { return isAlpha(c) || isDigit(c); }
-
-static inline bool isOctalDigit(char c) {
-    return CSTL_IS_BETWEEN(c, '0', '7');
-}
-
+// Every (ASCII) character class is a single lookup into `cstlCharClass`, as opposed to a chain of comparisons.
+// Bytes >= 0x80 (UTF-8 lead/continuation bytes) don't belong to any class.
+#define CSTL_CHAR_UPPER         0x01 // [A-Z]
+#define CSTL_CHAR_LOWER         0x02 // [a-z]
+#define CSTL_CHAR_DIGIT         0x04 // [0-9]
+#define CSTL_CHAR_HEX           0x08 // [0-9A-Fa-f]
+#define CSTL_CHAR_UNDERSCORE    0x10 // _
+#define CSTL_CHAR_BLANK         0x20 // [ \t\r\v\f]
+#define CSTL_CHAR_NEWLINE       0x40 // \n
+#define CSTL_CHAR_OCTAL         0x80 // [0-7]
+
+#define CSTL_CHAR_ALPHA         (CSTL_CHAR_UPPER | CSTL_CHAR_LOWER)
+#define CSTL_CHAR_LETTER        (CSTL_CHAR_ALPHA | CSTL_CHAR_UNDERSCORE)
+#define CSTL_CHAR_ALNUM         (CSTL_CHAR_ALPHA | CSTL_CHAR_DIGIT)
+#define CSTL_CHAR_IDENTIFIER    (CSTL_CHAR_LETTER | CSTL_CHAR_DIGIT)
+#define CSTL_CHAR_WHITESPACE    (CSTL_CHAR_BLANK | CSTL_CHAR_NEWLINE)
+
+// The class(es) of `c`
+#define CSTL_CHAR_CLASS(c)              (cstlCharClass[(UInt8)(c)])
+// Does `c` belong to any of the classes in `mask`?
+#define CSTL_CHAR_IS(c, mask)           ((CSTL_CHAR_CLASS(c) & (mask)) != 0)
+
+#define CU  CSTL_CHAR_UPPER
+#define CL  CSTL_CHAR_LOWER
+#define CD  CSTL_CHAR_DIGIT
+#define CX  CSTL_CHAR_HEX
+#define C_  CSTL_CHAR_UNDERSCORE
+#define CB  CSTL_CHAR_BLANK
+#define CN  CSTL_CHAR_NEWLINE
+#define CO  CSTL_CHAR_OCTAL
+static const UInt8 cstlCharClass[256] = {
+    0,        0,        0,        0,        0,        0,        0,        0,        // 0x00 - 0x07
+    0,        CB,       CN,       CB,       CB,       CB,       0,        0,        // 0x08 - 0x0F
+    0,        0,        0,        0,        0,        0,        0,        0,        // 0x10 - 0x17
+    0,        0,        0,        0,        0,        0,        0,        0,        // 0x18 - 0x1F
+    CB,       0,        0,        0,        0,        0,        0,        0,        // 0x20 - 0x27
+    0,        0,        0,        0,        0,        0,        0,        0,        // 0x28 - 0x2F
+    CD|CX|CO, CD|CX|CO, CD|CX|CO, CD|CX|CO, CD|CX|CO, CD|CX|CO, CD|CX|CO, CD|CX|CO, // 0x30 - 0x37
+    CD|CX,    CD|CX,    0,        0,        0,        0,        0,        0,        // 0x38 - 0x3F
+    0,        CU|CX,    CU|CX,    CU|CX,    CU|CX,    CU|CX,    CU|CX,    CU,       // 0x40 - 0x47
+    CU,       CU,       CU,       CU,       CU,       CU,       CU,       CU,       // 0x48 - 0x4F
+    CU,       CU,       CU,       CU,       CU,       CU,       CU,       CU,       // 0x50 - 0x57
+    CU,       CU,       CU,       0,        0,        0,        0,        C_,       // 0x58 - 0x5F
+    0,        CL|CX,    CL|CX,    CL|CX,    CL|CX,    CL|CX,    CL|CX,    CL,       // 0x60 - 0x67
+    CL,       CL,       CL,       CL,       CL,       CL,       CL,       CL,       // 0x68 - 0x6F
+    CL,       CL,       CL,       CL,       CL,       CL,       CL,       CL,       // 0x70 - 0x77
+    CL,       CL,       CL,       0,        0,        0,        0,        0,        // 0x78 - 0x7F
+    // 0x80 - 0xFF are zero-initialized
+};
+#undef CU
+#undef CL
+#undef CD
+#undef CX
+#undef C_
+#undef CB
+#undef CN
+#undef CO
+
+static inline bool isUpper(char c) { return CSTL_CHAR_IS(c, CSTL_CHAR_UPPER); }
+static inline bool isLower(char c) { return CSTL_CHAR_IS(c, CSTL_CHAR_LOWER); }
+static inline bool isDigit(char c) { return CSTL_CHAR_IS(c, CSTL_CHAR_DIGIT); }
+static inline bool isAlpha(char c) { return CSTL_CHAR_IS(c, CSTL_CHAR_ALPHA); }
+static inline bool isAlphanumeric(char c) { return CSTL_CHAR_IS(c, CSTL_CHAR_ALNUM); }
+static inline bool isOctalDigit(char c) { return CSTL_CHAR_IS(c, CSTL_CHAR_OCTAL); }
 static inline bool isBinaryDigit(char c) {
     return c == '0' || c == '1';
 }
-
-static inline bool isHexDigit(char c) {
-    return isDigit(c)                   ||
-           CSTL_IS_BETWEEN(c, 'a', 'f') ||
-           CSTL_IS_BETWEEN(c, 'A', 'F'); 
-}
-
-
-static inline bool isLetter(char c) {
-    return  (c >= 'a' && c <= 'z') || 
-            (c >= 'A' && c <= 'Z') || 
-            (c == '_') ;
-}
+static inline bool isHexDigit(char c) { return CSTL_CHAR_IS(c, CSTL_CHAR_HEX); }
+// [A-Za-z_]
+static inline bool isLetter(char c) { return CSTL_CHAR_IS(c, CSTL_CHAR_LETTER); }
+// [A-Za-z0-9_]
+static inline bool isIdentifierChar(char c) { return CSTL_CHAR_IS(c, CSTL_CHAR_IDENTIFIER); }
 
 static inline char toLower(char c) {
-    if(c >= 'A' && c <= 'Z') 
+    if(isUpper(c)) 
         return 'a' + (c - 'A');
     return c;
 }
 
 static inline char toUpper(char c) {
-    if(c >= 'a' && c <= 'z') 
+    if(isLower(c)) 
         return 'A' + (c - 'a');
     return c;
 }
 
-static inline bool isWhitespace(char c) {
-    if(c == ' '  || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v')
-        return true; 
-    return false;
-}
+static inline bool isWhitespace(char c) { return CSTL_CHAR_IS(c, CSTL_CHAR_WHITESPACE); }
 
 static inline Int32 digitToInt(char c) { return isDigit(c) ? c-'0' : c-'W'; }
 
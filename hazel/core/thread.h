@@ -0,0 +1,198 @@
+/*
+_ _    _           ______   _______        
+| |  | |    /\    /___  /   |  ____|| |    
+| |__| |   /  \      / /    | |__   | |       Hazel - The Fast, Expressive & Elegant Programming Language
+|  __  |  / /\ \    / /     |  __|  | |       Languages: C, C++, and Assembly
+| |  | | / ____ \  / /___   | |____ | |____   https://github.com/HazelLang/hazel/
+|_|_ |_|/_/    \_\/_______\ |______|_\______|
+
+Licensed under the MIT License <http://opensource.org/licenses/MIT>
+SPDX-License-Identifier: MIT
+Copyright (c) 2021 Jason Dsouza <http://github.com/jasmcaus>
+*/
+
+
+#ifndef CSTL_THREAD_H
+#define CSTL_THREAD_H
+
+#include <hazel/core/os.h>
+#include <hazel/core/types.h>
+#include <hazel/core/debug.h>
+
+// A thin layer over the platform's native threads (Win32 threads or pthreads).
+// Link against `Threads::Threads` (see hazel/CMakeLists.txt) when using this on Unix.
+
+#if defined(CSTL_OS_WINDOWS)
+    #ifndef WIN32_LEAN_AND_MEAN
+        #define WIN32_LEAN_AND_MEAN
+    #endif 
+    #include <windows.h>
+    #include <process.h>
+#else
+    #include <pthread.h>
+    #include <unistd.h>
+#endif // CSTL_OS_WINDOWS
+
+typedef void* (*cstlThreadProc)(void* arg);
+
+typedef struct cstlThread {
+    cstlThreadProc proc;    // function run by the thread
+    void* arg;              // argument passed to `proc`
+    void* result;           // return value of `proc` (valid after `thread_join()`)
+#if defined(CSTL_OS_WINDOWS)
+    HANDLE handle;
+#else
+    pthread_t handle;
+#endif // CSTL_OS_WINDOWS
+} cstlThread;
+
+#if defined(CSTL_OS_WINDOWS)
+    static unsigned __stdcall thread__trampoline(void* data) {
+        cstlThread* thread = (cstlThread*)data;
+        thread->result = thread->proc(thread->arg);
+        return 0;
+    }
+#else
+    static void* thread__trampoline(void* data) {
+        cstlThread* thread = (cstlThread*)data;
+        thread->result = thread->proc(thread->arg);
+        return null;
+    }
+#endif // CSTL_OS_WINDOWS
+
+// Start running `proc(arg)` on a new thread. `thread` must stay alive (and must not move) until it is joined.
+// Returns `false` if the thread couldn't be created.
+static bool thread_create(cstlThread* thread, cstlThreadProc proc, void* arg) {
+    thread->proc = proc;
+    thread->arg = arg;
+    thread->result = null;
+#if defined(CSTL_OS_WINDOWS)
+    thread->handle = (HANDLE)_beginthreadex(null, 0, thread__trampoline, thread, 0, null);
+    return thread->handle != 0;
+#else
+    return pthread_create(&thread->handle, null, thread__trampoline, thread) == 0;
+#endif // CSTL_OS_WINDOWS
+}
+
+// Wait for `thread` to finish and return whatever its `proc` returned
+static void* thread_join(cstlThread* thread) {
+#if defined(CSTL_OS_WINDOWS)
+    WaitForSingleObject(thread->handle, INFINITE);
+    CloseHandle(thread->handle);
+#else
+    pthread_join(thread->handle, null);
+#endif // CSTL_OS_WINDOWS
+    return thread->result;
+}
+
+// No. of logical processors available
+static UInt32 thread_hardware_concurrency(void) {
+#if defined(CSTL_OS_WINDOWS)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (UInt32)info.dwNumberOfProcessors;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (UInt32)count : 1;
+#endif // CSTL_OS_WINDOWS
+}
+
+// A mutual exclusion lock (SRW lock on Windows, pthread mutex elsewhere). Not recursive.
+typedef struct cstlMutex {
+#if defined(CSTL_OS_WINDOWS)
+    SRWLOCK handle;
+#else
+    pthread_mutex_t handle;
+#endif // CSTL_OS_WINDOWS
+} cstlMutex;
+
+static void thread_mutex_init(cstlMutex* mutex) {
+#if defined(CSTL_OS_WINDOWS)
+    InitializeSRWLock(&mutex->handle);
+#else
+    pthread_mutex_init(&mutex->handle, null);
+#endif // CSTL_OS_WINDOWS
+}
+
+static void thread_mutex_free(cstlMutex* mutex) {
+#if !defined(CSTL_OS_WINDOWS)
+    pthread_mutex_destroy(&mutex->handle);
+#endif // CSTL_OS_WINDOWS
+    (void)mutex;
+}
+
+static void thread_mutex_lock(cstlMutex* mutex) {
+#if defined(CSTL_OS_WINDOWS)
+    AcquireSRWLockExclusive(&mutex->handle);
+#else
+    pthread_mutex_lock(&mutex->handle);
+#endif // CSTL_OS_WINDOWS
+}
+
+static void thread_mutex_unlock(cstlMutex* mutex) {
+#if defined(CSTL_OS_WINDOWS)
+    ReleaseSRWLockExclusive(&mutex->handle);
+#else
+    pthread_mutex_unlock(&mutex->handle);
+#endif // CSTL_OS_WINDOWS
+}
+
+// One-time initialization: `thread_once(&flag, proc)` runs `proc` exactly once, no matter how many threads call it 
+// (the others wait for it to finish). `flag` must be statically initialized with CSTL_ONCE_INIT.
+#if defined(CSTL_OS_WINDOWS)
+    typedef INIT_ONCE cstlOnce;
+    #define CSTL_ONCE_INIT  INIT_ONCE_STATIC_INIT
+
+    static BOOL CALLBACK thread__once_trampoline(PINIT_ONCE flag, PVOID proc, PVOID* context) {
+        (void)flag; (void)context;
+        ((void (*)(void))proc)();
+        return TRUE;
+    }
+#else
+    typedef pthread_once_t cstlOnce;
+    #define CSTL_ONCE_INIT  PTHREAD_ONCE_INIT
+#endif // CSTL_OS_WINDOWS
+
+static void thread_once(cstlOnce* flag, void (*proc)(void)) {
+#if defined(CSTL_OS_WINDOWS)
+    InitOnceExecuteOnce(flag, thread__once_trampoline, (PVOID)proc, null);
+#else
+    pthread_once(flag, proc);
+#endif // CSTL_OS_WINDOWS
+}
+
+// Atomic operations on 64-bit counters (relaxed - they order nothing but themselves)
+// Add `value` to `*target`, and return the new value
+static inline UInt64 thread_atomic_add(volatile UInt64* target, UInt64 value) {
+#if defined(_MSC_VER)
+    return (UInt64)InterlockedExchangeAdd64((volatile LONG64*)target, (LONG64)value) + value;
+#else
+    return __atomic_add_fetch(target, value, __ATOMIC_RELAXED);
+#endif // _MSC_VER
+}
+
+static inline UInt64 thread_atomic_load(volatile UInt64* target) {
+#if defined(_MSC_VER)
+    return (UInt64)InterlockedCompareExchange64((volatile LONG64*)target, 0, 0);
+#else
+    return __atomic_load_n(target, __ATOMIC_RELAXED);
+#endif // _MSC_VER
+}
+
+// Raise `*target` to `value`, if it is lower
+static inline void thread_atomic_max(volatile UInt64* target, UInt64 value) {
+    UInt64 current = thread_atomic_load(target);
+    while(current < value) {
+#if defined(_MSC_VER)
+        UInt64 seen = (UInt64)InterlockedCompareExchange64((volatile LONG64*)target, (LONG64)value, (LONG64)current);
+        if(seen == current)
+            break;
+        current = seen;
+#else
+        if(__atomic_compare_exchange_n(target, &current, value, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+            break;
+#endif // _MSC_VER
+    }
+}
+
+#endif // CSTL_THREAD_H
@@ -90,10 +90,10 @@ typedef Int32 Bool32; // Prefer this!
 
 // Unicode codepoint
 typedef Int32 Rune; 
-#define CSTL_RUNE_INVALID cast(Rune)(0xfffd)
-#define CSTL_RUNE_MAX     cast(Rune)(0x0010ffff)
-#define CSTL_RUNE_BOM     cast(Rune)(0xfeff)
-#define CSTL_RUNE_EOF     cast(Rune)(-1)
+#define CSTL_RUNE_INVALID ((Rune)(0xfffd))
+#define CSTL_RUNE_MAX     ((Rune)(0x0010ffff))
+#define CSTL_RUNE_BOM     ((Rune)(0xfeff))
+#define CSTL_RUNE_EOF     ((Rune)(-1))
 
 // Max and Min 
 #ifndef UInt8_MIN 
@@ -0,0 +1,304 @@
+/*
+_ _    _           ______   _______        
+| |  | |    /\    /___  /   |  ____|| |    
+| |__| |   /  \      / /    | |__   | |       Hazel - The Fast, Expressive & Elegant Programming Language
+|  __  |  / /\ \    / /     |  __|  | |       Languages: C, C++, and Assembly
+| |  | | / ____ \  / /___   | |____ | |____   https://github.com/HazelLang/hazel/
+|_|_ |_|/_/    \_\/_______\ |______|_\______|
+
+Licensed under the MIT License <http://opensource.org/licenses/MIT>
+SPDX-License-Identifier: MIT
+Copyright (c) 2021 Jason Dsouza <http://github.com/jasmcaus>
+*/
+
+
+#ifndef CSTL_UTF8_H
+#define CSTL_UTF8_H
+
+#include <string.h>
+#include <hazel/core/types.h>
+#include <hazel/core/simd.h>
+
+/*
+    UTF-8 decoding and validation.
+
+    `utf8_validate()` checks a whole buffer up front, so that everything reading it afterwards (the Lexer, for one) 
+    can decode multibyte characters with `utf8_decode()` and never check them again.
+
+    With byte shuffles available (AVX2, SSSE3 or NEON), validation uses the lookup-table algorithm of Keiser & 
+    Lemire ("Validating UTF-8 In Less Than One Instruction Per Byte", 2021): every byte is classified by three 
+    16-entry table lookups on the high and low nibbles of itself and the byte before it, and the lookups AND together 
+    to an error mask - no branches on the data. Without them, runs of ASCII are skipped with `simd_skip_ascii()` and 
+    only the multibyte sequences are checked one at a time.
+*/
+
+#if defined(CSTL_SIMD_AVX2) || defined(CSTL_SIMD_SSSE3) || defined(CSTL_SIMD_NEON)
+    #define CSTL_UTF8_LOOKUP 1
+#endif 
+
+// Is `c` a continuation byte (10xxxxxx)?
+#define UTF8_IS_CONTINUATION(c)     (((UInt8)(c) & 0xC0) == 0x80)
+
+// Decode the character at `s` into `rune` and return its length (in bytes). 
+// `s` must point at the beginning of a valid UTF-8 sequence (see `utf8_validate()`).
+static inline UInt32 utf8_decode(const char* s, Rune* rune) {
+    const UInt8* u = (const UInt8*)s;
+    if(u[0] < 0x80) {
+        *rune = u[0];
+        return 1;
+    }
+    if(u[0] < 0xE0) {
+        *rune = ((Rune)(u[0] & 0x1F) << 6) | (u[1] & 0x3F);
+        return 2;
+    }
+    if(u[0] < 0xF0) {
+        *rune = ((Rune)(u[0] & 0x0F) << 12) | ((Rune)(u[1] & 0x3F) << 6) | (u[2] & 0x3F);
+        return 3;
+    }
+    *rune = ((Rune)(u[0] & 0x07) << 18) | ((Rune)(u[1] & 0x3F) << 12) | ((Rune)(u[2] & 0x3F) << 6) | (u[3] & 0x3F);
+    return 4;
+}
+
+// Returns the no. of bytes `rune` takes up in UTF-8
+static inline UInt32 utf8_rune_length(Rune rune) {
+    return rune < 0x80 ? 1 : rune < 0x800 ? 2 : rune < 0x10000 ? 3 : 4;
+}
+
+// Returns the length of the valid UTF-8 sequence at `s` (which ends before `end`), or 0 if it isn't one.
+// Overlong encodings, surrogates (U+D800 - U+DFFF) and anything above U+10FFFF are invalid (RFC 3629).
+static inline UInt32 utf8_sequence_length(const char* s, const char* end) {
+    const UInt8* u = (const UInt8*)s;
+    Int64 available = end - s;
+    if(u[0] < 0x80)
+        return 1;
+    if(u[0] < 0xC2)
+        return 0;
+    if(u[0] < 0xE0)
+        return available >= 2 && UTF8_IS_CONTINUATION(u[1]) ? 2 : 0;
+
+    // The second byte of some of the longer sequences is restricted further
+    UInt8 lo = 0x80, hi = 0xBF;
+    if(u[0] < 0xF0) {
+        if(u[0] == 0xE0)        lo = 0xA0;  // overlong
+        else if(u[0] == 0xED)   hi = 0x9F;  // surrogates
+        return available >= 3 && u[1] >= lo && u[1] <= hi && UTF8_IS_CONTINUATION(u[2]) ? 3 : 0;
+    }
+    if(u[0] < 0xF5) {
+        if(u[0] == 0xF0)        lo = 0x90;  // overlong
+        else if(u[0] == 0xF4)   hi = 0x8F;  // > U+10FFFF
+        return available >= 4 && u[1] >= lo && u[1] <= hi && 
+               UTF8_IS_CONTINUATION(u[2]) && UTF8_IS_CONTINUATION(u[3]) ? 4 : 0;
+    }
+    return 0;
+}
+
+// Returns the first byte in [p, end) that doesn't begin a valid UTF-8 sequence, checking one sequence at a time 
+// (ASCII runs are skipped in bulk), or `end` if it is all valid
+static inline const char* utf8_validate_scalar(const char* p, const char* end) {
+    while(p < end) {
+        p = simd_skip_ascii(p, end);
+        // Check the multibyte sequences until we're back to ASCII
+        while(p < end && (UInt8)*p >= 0x80) {
+            UInt32 length = utf8_sequence_length(p, end);
+            if(length == 0)
+                return p;
+            p += length;
+        }
+    }
+    return end;
+}
+
+#ifdef CSTL_UTF8_LOOKUP
+// 
+// Per-ISA primitives for the lookup algorithm (on a SimdVec of CSTL_SIMD_WIDTH bytes)
+// 
+#if defined(CSTL_SIMD_AVX2) || defined(CSTL_SIMD_SSSE3)
+    #if defined(CSTL_SIMD_AVX2)
+        // `vpshufb` looks up each 128-bit lane on its own, so the tables are repeated in both lanes
+        #define UTF8__TABLE(...)        _mm256_setr_epi8(__VA_ARGS__, __VA_ARGS__)
+        #define utf8__lookup(t, i)      _mm256_shuffle_epi8(t, i)
+        #define utf8__splat(c)          _mm256_set1_epi8((char)(c))
+        #define utf8__and(a, b)         _mm256_and_si256(a, b)
+        #define utf8__or(a, b)          _mm256_or_si256(a, b)
+        #define utf8__xor(a, b)         _mm256_xor_si256(a, b)
+        #define utf8__subs(a, b)        _mm256_subs_epu8(a, b)
+        #define utf8__shr4(v)           _mm256_and_si256(_mm256_srli_epi16(v, 4), utf8__splat(0x0F))
+        // The last `n` bytes of `prev`, followed by the first (CSTL_SIMD_WIDTH - n) bytes of `v`
+        #define utf8__prev(v, prev, n)  _mm256_alignr_epi8(v, _mm256_permute2x128_si256(prev, v, 0x21), 16 - (n))
+        #define utf8__any(v)            (!_mm256_testz_si256(v, v))
+        #define utf8__is_ascii(v)       (_mm256_movemask_epi8(v) == 0)
+        #define utf8__zero()            _mm256_setzero_si256()
+    #else 
+        #define UTF8__TABLE(...)        _mm_setr_epi8(__VA_ARGS__)
+        #define utf8__lookup(t, i)      _mm_shuffle_epi8(t, i)
+        #define utf8__splat(c)          _mm_set1_epi8((char)(c))
+        #define utf8__and(a, b)         _mm_and_si128(a, b)
+        #define utf8__or(a, b)          _mm_or_si128(a, b)
+        #define utf8__xor(a, b)         _mm_xor_si128(a, b)
+        #define utf8__subs(a, b)        _mm_subs_epu8(a, b)
+        #define utf8__shr4(v)           _mm_and_si128(_mm_srli_epi16(v, 4), utf8__splat(0x0F))
+        #define utf8__prev(v, prev, n)  _mm_alignr_epi8(v, prev, 16 - (n))
+        #define utf8__any(v)            (_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_setzero_si128())) != 0xFFFF)
+        #define utf8__is_ascii(v)       (_mm_movemask_epi8(v) == 0)
+        #define utf8__zero()            _mm_setzero_si128()
+    #endif // CSTL_SIMD_AVX2
+
+#elif defined(CSTL_SIMD_NEON)
+    static inline uint8x16_t utf8__table(const UInt8 table[16]) { return vld1q_u8(table); }
+    #define UTF8__TABLE(...)        utf8__table((const UInt8[16]){ __VA_ARGS__ })
+    #define utf8__lookup(t, i)      vqtbl1q_u8(t, i)
+    #define utf8__splat(c)          vdupq_n_u8((UInt8)(c))
+    #define utf8__and(a, b)         vandq_u8(a, b)
+    #define utf8__or(a, b)          vorrq_u8(a, b)
+    #define utf8__xor(a, b)         veorq_u8(a, b)
+    #define utf8__subs(a, b)        vqsubq_u8(a, b)
+    #define utf8__shr4(v)           vshrq_n_u8(v, 4)
+    #define utf8__prev(v, prev, n)  vextq_u8(prev, v, 16 - (n))
+    #define utf8__any(v)            (vmaxvq_u8(v) != 0)
+    #define utf8__is_ascii(v)       (vmaxvq_u8(v) < 0x80)
+    #define utf8__zero()            vdupq_n_u8(0)
+#endif // CSTL_SIMD_...
+
+// Error classes (one bit each) - a pair of bytes is invalid if all three lookups agree on one of them
+#define UTF8__TOO_SHORT       (1 << 0)    // 11______ 0_______ or 11______ 11______ 
+#define UTF8__TOO_LONG        (1 << 1)    // 0_______ 10______
+#define UTF8__OVERLONG_3      (1 << 2)    // 11100000 100_____
+#define UTF8__TOO_LARGE       (1 << 3)    // 11110100 1001____, 11110100 101_____ or 11110101+ 10______
+#define UTF8__SURROGATE       (1 << 4)    // 11101101 101_____
+#define UTF8__OVERLONG_2      (1 << 5)    // 1100000_ 10______
+#define UTF8__TOO_LARGE_1000  (1 << 6)    // 11110101+ 1000____
+#define UTF8__OVERLONG_4      (1 << 6)    // 11110000 1000____
+#define UTF8__TWO_CONTS       (1 << 7)    // 10______ 10______ (fine, if a 3- or 4-byte sequence calls for it)
+#define UTF8__CARRY           (UTF8__TOO_SHORT | UTF8__TOO_LONG | UTF8__TWO_CONTS)
+
+// Returns the error mask of the CSTL_SIMD_WIDTH bytes in `input`, which follow `prev_input`
+static inline SimdVec utf8__check_block(SimdVec input, SimdVec prev_input) {
+    const SimdVec byte_1_high_table = UTF8__TABLE(
+        // 0_______ ________ (ASCII)
+        UTF8__TOO_LONG, UTF8__TOO_LONG, UTF8__TOO_LONG, UTF8__TOO_LONG, 
+        UTF8__TOO_LONG, UTF8__TOO_LONG, UTF8__TOO_LONG, UTF8__TOO_LONG, 
+        // 10______ ________ (continuation)
+        UTF8__TWO_CONTS, UTF8__TWO_CONTS, UTF8__TWO_CONTS, UTF8__TWO_CONTS, 
+        // 1100____ ________ and 1101____ ________ (2-byte lead)
+        UTF8__TOO_SHORT | UTF8__OVERLONG_2, 
+        UTF8__TOO_SHORT, 
+        // 1110____ ________ (3-byte lead)
+        UTF8__TOO_SHORT | UTF8__OVERLONG_3 | UTF8__SURROGATE, 
+        // 1111____ ________ (4-byte lead)
+        UTF8__TOO_SHORT | UTF8__TOO_LARGE | UTF8__TOO_LARGE_1000 | UTF8__OVERLONG_4);
+    const SimdVec byte_1_low_table = UTF8__TABLE(
+        // ____0000 ________
+        UTF8__CARRY | UTF8__OVERLONG_3 | UTF8__OVERLONG_2 | UTF8__OVERLONG_4, 
+        // ____0001 ________
+        UTF8__CARRY | UTF8__OVERLONG_2, 
+        // ____001_ ________
+        UTF8__CARRY, 
+        UTF8__CARRY, 
+        // ____0100 ________
+        UTF8__CARRY | UTF8__TOO_LARGE, 
+        // ____0101 ________ to ____1100 ________
+        UTF8__CARRY | UTF8__TOO_LARGE | UTF8__TOO_LARGE_1000, 
+        UTF8__CARRY | UTF8__TOO_LARGE | UTF8__TOO_LARGE_1000, 
+        UTF8__CARRY | UTF8__TOO_LARGE | UTF8__TOO_LARGE_1000, 
+        UTF8__CARRY | UTF8__TOO_LARGE | UTF8__TOO_LARGE_1000, 
+        UTF8__CARRY | UTF8__TOO_LARGE | UTF8__TOO_LARGE_1000, 
+        UTF8__CARRY | UTF8__TOO_LARGE | UTF8__TOO_LARGE_1000, 
+        UTF8__CARRY | UTF8__TOO_LARGE | UTF8__TOO_LARGE_1000, 
+        UTF8__CARRY | UTF8__TOO_LARGE | UTF8__TOO_LARGE_1000, 
+        // ____1101 ________
+        UTF8__CARRY | UTF8__TOO_LARGE | UTF8__TOO_LARGE_1000 | UTF8__SURROGATE, 
+        // ____111_ ________
+        UTF8__CARRY | UTF8__TOO_LARGE | UTF8__TOO_LARGE_1000, 
+        UTF8__CARRY | UTF8__TOO_LARGE | UTF8__TOO_LARGE_1000);
+    const SimdVec byte_2_high_table = UTF8__TABLE(
+        // ________ 0_______ (ASCII)
+        UTF8__TOO_SHORT, UTF8__TOO_SHORT, UTF8__TOO_SHORT, UTF8__TOO_SHORT, 
+        UTF8__TOO_SHORT, UTF8__TOO_SHORT, UTF8__TOO_SHORT, UTF8__TOO_SHORT, 
+        // ________ 1000____
+        UTF8__TOO_LONG | UTF8__OVERLONG_2 | UTF8__TWO_CONTS | UTF8__OVERLONG_3 | UTF8__TOO_LARGE_1000 | 
+        UTF8__OVERLONG_4, 
+        // ________ 1001____
+        UTF8__TOO_LONG | UTF8__OVERLONG_2 | UTF8__TWO_CONTS | UTF8__OVERLONG_3 | UTF8__TOO_LARGE, 
+        // ________ 101_____
+        UTF8__TOO_LONG | UTF8__OVERLONG_2 | UTF8__TWO_CONTS | UTF8__SURROGATE | UTF8__TOO_LARGE, 
+        UTF8__TOO_LONG | UTF8__OVERLONG_2 | UTF8__TWO_CONTS | UTF8__SURROGATE | UTF8__TOO_LARGE, 
+        // ________ 11______ (a lead)
+        UTF8__TOO_SHORT, UTF8__TOO_SHORT, UTF8__TOO_SHORT, UTF8__TOO_SHORT);
+
+    SimdVec prev1 = utf8__prev(input, prev_input, 1);
+    SimdVec special = utf8__and(utf8__and(utf8__lookup(byte_1_high_table, utf8__shr4(prev1)), 
+                                          utf8__lookup(byte_1_low_table, utf8__and(prev1, utf8__splat(0x0F)))), 
+                                utf8__lookup(byte_2_high_table, utf8__shr4(input)));
+
+    // Two continuations in a row are only right as the 3rd byte of a 3-byte sequence or the 3rd and 4th bytes of 
+    // a 4-byte one (lead >= 0xE0 two bytes back, or >= 0xF0 three bytes back)
+    SimdVec prev2 = utf8__prev(input, prev_input, 2);
+    SimdVec prev3 = utf8__prev(input, prev_input, 3);
+    SimdVec must_be_continuation = utf8__or(utf8__subs(prev2, utf8__splat(0xE0 - 0x80)), 
+                                            utf8__subs(prev3, utf8__splat(0xF0 - 0x80)));
+    return utf8__xor(utf8__and(must_be_continuation, utf8__splat(0x80)), special);
+}
+
+// Returns a non-zero mask if `input` ends in the middle of a multibyte sequence
+static inline SimdVec utf8__is_incomplete(SimdVec input) {
+    // Each of the last 3 bytes is compared against the smallest lead that needs more bytes than are left (the 
+    // vector is the last CSTL_SIMD_WIDTH bytes of this)
+    static const UInt8 max[32] = {
+        255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 
+        255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 0xF0 - 1, 0xE0 - 1, 0xC0 - 1
+    };
+    return utf8__subs(input, simd__load((const char*)max + 32 - CSTL_SIMD_WIDTH));
+}
+
+// Validate [begin, end) with the lookup algorithm (see `utf8_validate()`)
+static inline const char* utf8__validate_lookup(const char* begin, const char* end) {
+    SimdVec prev_input = utf8__zero();
+    SimdVec prev_incomplete = utf8__zero();
+    const char* p = begin;
+
+    while(p < end) {
+        SimdVec input;
+        if(end - p >= CSTL_SIMD_WIDTH) {
+            input = simd__load(p);
+        } else {
+            // The tail, padded with NULs (which are ASCII, so a sequence cut short by the end is still caught)
+            char tail[CSTL_SIMD_WIDTH] = {0};
+            memcpy(tail, p, (size_t)(end - p));
+            input = simd__load(tail);
+        }
+
+        SimdVec error;
+        if(utf8__is_ascii(input)) {
+            error = prev_incomplete;
+        } else {
+            error = utf8__check_block(input, prev_input);
+            prev_incomplete = utf8__is_incomplete(input);
+        }
+        if(utf8__any(error))
+            break;
+        prev_input = input;
+        p += CSTL_SIMD_WIDTH;
+    }
+    if(p >= end && !utf8__any(prev_incomplete))
+        return end;
+
+    // Something is wrong in this block (or at the end of the one before it). Pin it down from the beginning of the 
+    // last sequence that began before the previous block.
+    const char* from = p - begin > CSTL_SIMD_WIDTH ? p - CSTL_SIMD_WIDTH : begin;
+    for(int i = 0; i < 3 && from > begin && UTF8_IS_CONTINUATION(*from); i++)
+        --from;
+    return utf8_validate_scalar(from, end);
+}
+#endif // CSTL_UTF8_LOOKUP
+
+// Returns the first byte in [p, end) that doesn't begin a valid UTF-8 sequence (or is part of one that gets cut 
+// short), or `end` if [p, end) is all valid UTF-8
+static inline const char* utf8_validate(const char* p, const char* end) {
+#ifdef CSTL_UTF8_LOOKUP
+    return utf8__validate_lookup(p, end);
+#else
+    return utf8_validate_scalar(p, end);
+#endif // CSTL_UTF8_LOOKUP
+}
+
+#endif // CSTL_UTF8_H
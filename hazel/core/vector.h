@@ -16,6 +16,9 @@ Copyright (c) 2021 Jason Dsouza <http://github.com/jasmcaus>
 
 #include <hazel/core/types.h>
 #include <hazel/core/debug.h>
+#include <hazel/core/misc.h>
+#include <hazel/core/math.h>
+#include <hazel/core/allocator.h>
 
 // We require this to be a large number, much more than what you might eventually use for more projects,
 // but because CSTL is of great use and importance in the Hazel Programming Language (which needs these
@@ -28,6 +31,7 @@ typedef struct {
     UInt64 capacity;  // allocated memory capacity (no. of elements)
     UInt64 size;      // number of elements currently in `vec`
     UInt64 objsize;   // size of each element in bytes
+    cstlAllocator* allocator; // where `data` (and the vector itself) come from (null for the heap)
 } cstlVectorInternal;
 
 // The actual `cstlVector` struct
@@ -53,10 +57,12 @@ struct cstlVector {
 // capacity => number of elements
 // Returns `null` in the event of an error (e.g memory full; could not allocate)
 static cstlVector* vec_new(UInt64 objsize, UInt64 capacity);
+// Same as `vec_new()`, but allocating from `allocator` (null for the heap)
+static cstlVector* vec_new_with_allocator(UInt64 objsize, UInt64 capacity, cstlAllocator* allocator);
 // Grow the capacity of `vec` to at least `capacity`.
 // If more space is needed, grow `vec` to `capacity`, but at least by a factor of 1.5.
 static bool vec_grow(cstlVector* vec, UInt64 capacity);
-// Free a cstlVector from it's associated memory
+// Free a cstlVector (and the memory associated with it)
 static void vec_delete(cstlVector* vec);
 // Return a pointer to element `i` in `vec`
 static void* vec_at(cstlVector* vec, UInt64 elem);
@@ -86,21 +92,29 @@ static bool vec_pop(cstlVector* vec);
 // capacity => number of elements
 // Returns `null` in the event of an error (e.g memory full; could not allocate)
 static cstlVector* vec_new(UInt64 objsize, UInt64 capacity) {
+    return vec_new_with_allocator(objsize, capacity, null);
+}
+
+// Same as `vec_new()`, but allocating from `allocator` (null for the heap)
+static cstlVector* vec_new_with_allocator(UInt64 objsize, UInt64 capacity, cstlAllocator* allocator) {
     if(capacity == 0)
         capacity = VEC_INIT_ALLOC_CAP;
-    
-    cstlVector* vec = (cstlVector*)calloc(1, sizeof(cstlVector));
+    CSTL_CHECK_GT(objsize, 0);
+    CSTL_CHECK_LT(capacity, (UInt64)-1/objsize);
+
+    cstlVector* vec = (cstlVector*)CSTL_ALLOC_ZEROED(allocator, sizeof(cstlVector));
     CSTL_CHECK_NOT_NULL(vec, "Could not allocate memory. Memory full.");
 
-    vec->internal.data = (void*)calloc(objsize, capacity);
+    vec->internal.data = (void*)CSTL_ALLOC_ZEROED(allocator, objsize * capacity);
     if(vec->internal.data == null) {
-        free(vec);
-        CSTL_CHECK_NOT_NULL(vec->internal.data, "Could not allocate memory. Memory full.");
+        CSTL_FREE(allocator, vec, sizeof(cstlVector));
+        CSTL_CHECK_NOT_NULL(null, "Could not allocate memory. Memory full.");
     }
 
     vec->internal.capacity = capacity;
     vec->internal.size = 0;
     vec->internal.objsize = objsize;
+    vec->internal.allocator = allocator;
 
     vec->at = &vec_at;
     vec->size = &vec_size;
@@ -117,17 +131,13 @@ static cstlVector* vec_new(UInt64 objsize, UInt64 capacity) {
     return vec;
 } 
 
-// Free a cstlVector from it's associated memory
+// Free a cstlVector (and the memory associated with it)
 static void vec_delete(cstlVector* vec) {
     if(vec == null) 
         return;
-    if(vec->internal.data != null) {
-        free(vec->internal.data);
-        vec->internal.data = null;
-    }
-    vec->internal.capacity = 0;
-    vec->internal.size = 0;
-    vec->internal.objsize = 0;
+    cstlAllocator* allocator = vec->internal.allocator;
+    CSTL_FREE(allocator, vec->internal.data, vec->internal.capacity * vec->internal.objsize);
+    CSTL_FREE(allocator, vec, sizeof(cstlVector));
 }
 
 // Return a pointer to element `i` in `vec`
@@ -135,7 +145,7 @@ static void* vec_at(cstlVector* vec, UInt64 elem) {
     CSTL_CHECK_NOT_NULL(vec, "Expected not null");
     CSTL_CHECK_NOT_NULL(vec->internal.data, "Expected not null");
 
-    if(elem > vec->internal.size)
+    if(elem >= vec->internal.size)
         return null;
 
     return VECTOR_AT_MACRO(vec, elem);
@@ -157,10 +167,10 @@ static void* vec_end(cstlVector* vec) {
     CSTL_CHECK_NOT_NULL(vec, "Expected not null");
     CSTL_CHECK_NOT_NULL(vec->internal.data, "Expected not null");
 
-    if(vec->internal.data == 0)
+    if(vec->internal.size == 0)
         return null;
     
-    return (void*)((char*)vec->internal.data + (vec->internal.size - 1) * sizeof(cstlVector));
+    return VECTOR_AT_MACRO(vec, vec->internal.size - 1);
 }
 
 // Is `vec` empty (i.e no elements)?
@@ -200,7 +210,8 @@ static bool vec_reserve(cstlVector* vec, UInt64 bytes) {
     CSTL_CHECK_GT(vec->internal.objsize, 0);
     CSTL_CHECK_LT(bytes, (UInt64)-1/vec->internal.objsize);
 
-    new_data = (void*)realloc(vec->internal.data, bytes * vec->internal.objsize);
+    new_data = (void*)CSTL_RESIZE(vec->internal.allocator, vec->internal.data, 
+                                  vec->internal.capacity * vec->internal.objsize, bytes * vec->internal.objsize);
     CSTL_CHECK_NOT_NULL(new_data, "Could not realloc memory. Memory full.");
 
     vec->internal.data = new_data;
@@ -275,7 +286,8 @@ static bool vec_grow(cstlVector* vec, UInt64 capacity) {
     if (capacity > newcapacity || newcapacity >= (size_t) -1 / vec->internal.objsize)
         newcapacity = capacity;
 
-    newdata = realloc(vec->internal.data, newcapacity * vec->internal.objsize);
+    newdata = CSTL_RESIZE(vec->internal.allocator, vec->internal.data, vec->internal.capacity * vec->internal.objsize,
+                          newcapacity * vec->internal.objsize);
     CSTL_CHECK_NOT_NULL(newdata, "Expected not null");
 
     vec->internal.data = newdata;
@@ -284,4 +296,211 @@ static bool vec_grow(cstlVector* vec, UInt64 capacity) {
     return true;
 }
 
+/*
+    Typed Vectors
+
+    A `cstlVector` only learns the size of its elements at runtime: every operation goes through a function pointer, 
+    checks its arguments, and copies elements with a `memcpy()` of `objsize` bytes. 
+
+    CSTL_VECTOR(Name, prefix, T) instead defines a vector of `T`s (`Name`) and the functions that go with it 
+    (`prefix_push()`, `prefix_at()`, ...). Their element type is known at compile time, so pushing, indexing and 
+    iterating inline down to a few instructions - only growing the vector takes a call. 
+    
+        CSTL_VECTOR(IntVector, intvec, int)
+
+        IntVector ints = {0};           // an empty vector (allocating from the heap)
+        intvec_push(&ints, 42);
+        for(int* it = intvec_begin(&ints); it != intvec_end(&ints); it++) 
+            ...
+        intvec_free(&ints);
+
+    Bounds (and other) checks are only made with CSTL_VECTOR_DEBUG defined (done for Debug builds).
+*/
+
+#ifdef CSTL_VECTOR_DEBUG
+    #define CSTL_VECTOR_CHECK(cond)     CSTL_CHECK(cond, "Invalid vector access")
+#else
+    #define CSTL_VECTOR_CHECK(cond)     ((void)0)
+#endif // CSTL_VECTOR_DEBUG
+
+// Returns the capacity a typed vector of `capacity` elements (of `objsize` bytes each) grows to, so that it can hold
+// at least `needed` of them: twice as many for small vectors, and 1.5 times as many for larger ones (like `vec_grow()`)
+static inline UInt64 vector__grown_capacity(UInt64 capacity, UInt64 needed, UInt64 objsize) {
+    UInt64 grown = capacity < 4096 / objsize ? capacity + capacity + 1 : capacity + capacity / 2 + 1;
+    return CSTL_MAX(grown, needed);
+}
+
+#define CSTL_VECTOR(Name, prefix, T)                                                                                \
+    typedef struct Name {                                                                                           \
+        T* data;                                                                                                    \
+        UInt64 size;                /* no. of elements in the vector */                                             \
+        UInt64 capacity;            /* no. of elements `data` can hold */                                           \
+        cstlAllocator* allocator;   /* where `data` comes from (null for the heap) */                               \
+    } Name;                                                                                                         \
+                                                                                                                    \
+    /* Initialize an empty vector allocating from `allocator` (null for the heap - same as zeroing it) */           \
+    static inline void prefix##_init(Name* vec, cstlAllocator* allocator) {                                         \
+        vec->data = null;                                                                                           \
+        vec->size = vec->capacity = 0;                                                                              \
+        vec->allocator = allocator;                                                                                 \
+    }                                                                                                               \
+                                                                                                                    \
+    /* Free the elements of `vec` (it is left empty, and can be used again) */                                      \
+    static inline void prefix##_free(Name* vec) {                                                                   \
+        CSTL_FREE(vec->allocator, vec->data, vec->capacity * sizeof(T));                                            \
+        vec->data = null;                                                                                           \
+        vec->size = vec->capacity = 0;                                                                              \
+    }                                                                                                               \
+                                                                                                                    \
+    /* Make sure `vec` can hold at least `capacity` elements */                                                     \
+    static inline void prefix##_reserve(Name* vec, UInt64 capacity) {                                               \
+        if(capacity <= vec->capacity)                                                                               \
+            return;                                                                                                 \
+        CSTL_CHECK_LT(capacity, (UInt64)-1 / sizeof(T));                                                            \
+        T* data = (T*)CSTL_RESIZE(vec->allocator, vec->data, vec->capacity * sizeof(T), capacity * sizeof(T));      \
+        CSTL_CHECK_NOT_NULL(data, "Could not allocate memory. Memory full.");                                       \
+        vec->data = data;                                                                                           \
+        vec->capacity = capacity;                                                                                   \
+    }                                                                                                               \
+                                                                                                                    \
+    /* Grow `vec` to hold at least `needed` elements (out of line: pushes rarely need to) */                        \
+    static CSTL_NOINLINE void prefix##__grow(Name* vec, UInt64 needed) {                                            \
+        prefix##_reserve(vec, vector__grown_capacity(vec->capacity, needed, sizeof(T)));                            \
+    }                                                                                                               \
+                                                                                                                    \
+    /* Append `value` to the end of `vec` */                                                                        \
+    static inline void prefix##_push(Name* vec, T value) {                                                          \
+        if(vec->size == vec->capacity)                                                                              \
+            prefix##__grow(vec, vec->size + 1);                                                                     \
+        vec->data[vec->size++] = value;                                                                             \
+    }                                                                                                               \
+                                                                                                                    \
+    /* Remove the last element of `vec` (which must not be empty) and return it */                                  \
+    static inline T prefix##_pop(Name* vec) {                                                                       \
+        CSTL_VECTOR_CHECK(vec->size > 0);                                                                           \
+        return vec->data[--vec->size];                                                                              \
+    }                                                                                                               \
+                                                                                                                    \
+    /* Returns a pointer to element `i` of `vec` */                                                                 \
+    static inline T* prefix##_at(const Name* vec, UInt64 i) {                                                       \
+        CSTL_VECTOR_CHECK(i < vec->size);                                                                           \
+        return &vec->data[i];                                                                                       \
+    }                                                                                                               \
+                                                                                                                    \
+    /* Returns a pointer to the last element of `vec` (which must not be empty) */                                  \
+    static inline T* prefix##_last(const Name* vec) {                                                               \
+        CSTL_VECTOR_CHECK(vec->size > 0);                                                                           \
+        return &vec->data[vec->size - 1];                                                                           \
+    }                                                                                                               \
+                                                                                                                    \
+    /* Returns a pointer to the first element of `vec`, and one past its last (iterate from one to the other) */    \
+    static inline T* prefix##_begin(const Name* vec) { return vec->data; }                                          \
+    static inline T* prefix##_end(const Name* vec) { return vec->data + vec->size; }                                \
+                                                                                                                    \
+    static inline UInt64 prefix##_size(const Name* vec) { return vec->size; }                                       \
+    static inline bool prefix##_is_empty(const Name* vec) { return vec->size == 0; }                                \
+    /* Remove every element from `vec` (keeping its memory) */                                                      \
+    static inline void prefix##_clear(Name* vec) { vec->size = 0; }
+
+/*
+    Small Vectors
+
+    Most lists in a program are short - a function has a handful of parameters, a block a handful of statements. 
+    CSTL_SMALL_VECTOR(Name, prefix, T, N) defines a typed vector (with the same functions as CSTL_VECTOR) that keeps 
+    its first `N` elements inside itself, and only allocates once it grows past them. An empty one costs nothing but 
+    its own size, and one that stays small never touches the allocator.
+
+    Nothing points into a small vector, so it can be moved (copied) around like any other struct. Pointers to its 
+    elements (`prefix_at()`, `prefix_begin()`, ...) are only good until it next grows - or moves, while it's small.
+*/
+
+#define CSTL_SMALL_VECTOR(Name, prefix, T, N)                                                                       \
+    typedef struct Name {                                                                                           \
+        UInt32 size;                /* no. of elements in the vector */                                             \
+        UInt32 capacity;            /* no. of elements `heap` can hold (0 while they fit in `small`) */             \
+        cstlAllocator* allocator;   /* where `heap` comes from (null for the heap) */                               \
+        union {                                                                                                     \
+            T small[N];             /* the elements, while there are at most `N` of them */                         \
+            T* heap;                /* the elements, once there have been more */                                   \
+        } elems;                                                                                                    \
+    } Name;                                                                                                         \
+                                                                                                                    \
+    /* Initialize an empty vector allocating from `allocator` (null for the heap - same as zeroing it) */           \
+    static inline void prefix##_init(Name* vec, cstlAllocator* allocator) {                                         \
+        vec->size = vec->capacity = 0;                                                                              \
+        vec->allocator = allocator;                                                                                 \
+    }                                                                                                               \
+                                                                                                                    \
+    /* Returns the elements of `vec` */                                                                             \
+    static inline T* prefix##_data(Name* vec) {                                                                     \
+        return vec->capacity ? vec->elems.heap : vec->elems.small;                                                  \
+    }                                                                                                               \
+                                                                                                                    \
+    /* Free the elements of `vec` (it is left empty, and can be used again) */                                      \
+    static inline void prefix##_free(Name* vec) {                                                                   \
+        if(vec->capacity)                                                                                           \
+            CSTL_FREE(vec->allocator, vec->elems.heap, (UInt64)vec->capacity * sizeof(T));                          \
+        vec->size = vec->capacity = 0;                                                                              \
+    }                                                                                                               \
+                                                                                                                    \
+    /* Make sure `vec` can hold at least `capacity` elements */                                                     \
+    static inline void prefix##_reserve(Name* vec, UInt64 capacity) {                                               \
+        if(capacity <= (vec->capacity ? vec->capacity : (UInt64)(N)))                                               \
+            return;                                                                                                 \
+        CSTL_CHECK_LT(capacity, (UInt64)UInt32_MAX);                                                                \
+        T* heap;                                                                                                    \
+        if(vec->capacity) {                                                                                         \
+            heap = (T*)CSTL_RESIZE(vec->allocator, vec->elems.heap, (UInt64)vec->capacity * sizeof(T),              \
+                                   capacity * sizeof(T));                                                           \
+            CSTL_CHECK_NOT_NULL(heap, "Could not allocate memory. Memory full.");                                   \
+        } else {                                                                                                    \
+            /* Spill the elements kept inside the vector */                                                         \
+            heap = (T*)CSTL_ALLOC(vec->allocator, capacity * sizeof(T));                                            \
+            CSTL_CHECK_NOT_NULL(heap, "Could not allocate memory. Memory full.");                                   \
+            memcpy(heap, vec->elems.small, vec->size * sizeof(T));                                                  \
+        }                                                                                                           \
+        vec->elems.heap = heap;                                                                                     \
+        vec->capacity = (UInt32)capacity;                                                                           \
+    }                                                                                                               \
+                                                                                                                    \
+    /* Grow `vec` to hold at least `needed` elements (out of line: pushes rarely need to) */                        \
+    static CSTL_NOINLINE void prefix##__grow(Name* vec, UInt64 needed) {                                            \
+        prefix##_reserve(vec, vector__grown_capacity(vec->capacity ? vec->capacity : (UInt64)(N), needed,           \
+                                                     sizeof(T)));                                                   \
+    }                                                                                                               \
+                                                                                                                    \
+    /* Append `value` to the end of `vec` */                                                                        \
+    static inline void prefix##_push(Name* vec, T value) {                                                          \
+        if(vec->size == (vec->capacity ? vec->capacity : (UInt32)(N)))                                              \
+            prefix##__grow(vec, (UInt64)vec->size + 1);                                                             \
+        prefix##_data(vec)[vec->size++] = value;                                                                    \
+    }                                                                                                               \
+                                                                                                                    \
+    /* Remove the last element of `vec` (which must not be empty) and return it */                                  \
+    static inline T prefix##_pop(Name* vec) {                                                                       \
+        CSTL_VECTOR_CHECK(vec->size > 0);                                                                           \
+        return prefix##_data(vec)[--vec->size];                                                                     \
+    }                                                                                                               \
+                                                                                                                    \
+    /* Returns a pointer to element `i` of `vec` */                                                                 \
+    static inline T* prefix##_at(Name* vec, UInt64 i) {                                                             \
+        CSTL_VECTOR_CHECK(i < vec->size);                                                                           \
+        return &prefix##_data(vec)[i];                                                                              \
+    }                                                                                                               \
+                                                                                                                    \
+    /* Returns a pointer to the last element of `vec` (which must not be empty) */                                  \
+    static inline T* prefix##_last(Name* vec) {                                                                     \
+        CSTL_VECTOR_CHECK(vec->size > 0);                                                                           \
+        return &prefix##_data(vec)[vec->size - 1];                                                                  \
+    }                                                                                                               \
+                                                                                                                    \
+    /* Returns a pointer to the first element of `vec`, and one past its last (iterate from one to the other) */    \
+    static inline T* prefix##_begin(Name* vec) { return prefix##_data(vec); }                                       \
+    static inline T* prefix##_end(Name* vec) { return prefix##_data(vec) + vec->size; }                             \
+                                                                                                                    \
+    static inline UInt64 prefix##_size(const Name* vec) { return vec->size; }                                       \
+    static inline bool prefix##_is_empty(const Name* vec) { return vec->size == 0; }                                \
+    /* Remove every element from `vec` (keeping its memory) */                                                      \
+    static inline void prefix##_clear(Name* vec) { vec->size = 0; }
+
 #endif // CSTL_VECTOR_H
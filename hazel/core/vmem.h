@@ -0,0 +1,254 @@
+/*
+_ _    _           ______   _______        
+| |  | |    /\    /___  /   |  ____|| |    
+| |__| |   /  \      / /    | |__   | |       Hazel - The Fast, Expressive & Elegant Programming Language
+|  __  |  / /\ \    / /     |  __|  | |       Languages: C, C++, and Assembly
+| |  | | / ____ \  / /___   | |____ | |____   https://github.com/HazelLang/hazel/
+|_|_ |_|/_/    \_\/_______\ |______|_\______|
+
+Licensed under the MIT License <http://opensource.org/licenses/MIT>
+SPDX-License-Identifier: MIT
+Copyright (c) 2021 Jason Dsouza <http://github.com/jasmcaus>
+*/
+
+#ifndef CSTL_VMEM_H
+#define CSTL_VMEM_H
+
+// Before any system header: MAP_ANONYMOUS and MADV_HUGEPAGE aren't C11
+#include <hazel/core/headers.h>
+#include <string.h>
+#include <hazel/core/os.h>
+#include <hazel/core/types.h>
+#include <hazel/core/debug.h>
+#include <hazel/core/math.h>
+#include <hazel/core/misc.h>
+#include <hazel/core/vector.h>
+
+#if !defined(CSTL_OS_WINDOWS)
+    #include <unistd.h>
+    #include <sys/mman.h>
+
+    #if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+        #define MAP_ANONYMOUS MAP_ANON
+    #endif 
+    #if !defined(MAP_NORESERVE)
+        #define MAP_NORESERVE 0
+    #endif 
+#endif // CSTL_OS_WINDOWS
+
+/*
+    Virtual Memory
+
+    A growable array that lives in the heap has to move when it grows: `realloc()` copies everything it holds to a 
+    new block (and, for a moment, needs room for both). An array that knows how large it can ever get can instead 
+    reserve that much address space up front - which costs no memory - and commit pages to it as it grows. Its 
+    elements never move, so growing it copies nothing and pointers into it stay valid.
+
+    `vmem_*()` reserve, commit and release address space (mmap()/mprotect() or VirtualAlloc()). A `cstlVirtualArray` 
+    is a reserved range that commits itself as it grows, and CSTL_VIRTUAL_VECTOR(Name, prefix, T) a typed vector 
+    (see <hazel/core/vector.h>) on top of one.
+
+    Large arrays can ask for transparent huge pages (MADV_HUGEPAGE, where there are any), which cuts down on TLB 
+    misses when they are walked.
+*/
+
+// Size of a (transparent) huge page. Huge-page ranges are aligned to, and committed in multiples of, this.
+#define CSTL_VMEM_HUGE_PAGE_SIZE        ((UInt64)2 << 20)
+// `cstlVirtualArray`s commit at least this many bytes at a time
+#define CSTL_VMEM_COMMIT_GRANULARITY    ((UInt64)64 << 10)
+
+// Returns the size of a page
+static UInt64 vmem_page_size(void) {
+#if defined(CSTL_OS_WINDOWS)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (UInt64)info.dwPageSize;
+#else
+    return (UInt64)sysconf(_SC_PAGESIZE);
+#endif // CSTL_OS_WINDOWS
+}
+
+// Round `size` up to a multiple of `alignment` (a power of 2)
+static inline UInt64 vmem__align(UInt64 size, UInt64 alignment) {
+    return (size + alignment - 1) & ~(alignment - 1);
+}
+
+// Reserve `size` bytes of address space (a multiple of the page size), aligned to CSTL_VMEM_HUGE_PAGE_SIZE if 
+// `huge_pages`. Nothing can be read or written until it is committed. Returns null if there isn't enough.
+static void* vmem_reserve(UInt64 size, bool huge_pages) {
+#if defined(CSTL_OS_WINDOWS)
+    (void)huge_pages;
+    return VirtualAlloc(null, (SIZE_T)size, MEM_RESERVE, PAGE_NOACCESS);
+#else
+    UInt64 slack = huge_pages ? CSTL_VMEM_HUGE_PAGE_SIZE : 0;
+    char* base = (char*)mmap(null, size + slack, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if(base == (char*)MAP_FAILED)
+        return null;
+    if(huge_pages) {
+        // Trim the range down to an aligned one
+        char* aligned = (char*)vmem__align((UInt64)(uintptr_t)base, CSTL_VMEM_HUGE_PAGE_SIZE);
+        if(aligned > base)
+            munmap(base, (size_t)(aligned - base));
+        if(aligned + size < base + size + slack)
+            munmap(aligned + size, (size_t)(base + size + slack - (aligned + size)));
+        base = aligned;
+    #ifdef MADV_HUGEPAGE
+        madvise(base, size, MADV_HUGEPAGE);
+    #endif // MADV_HUGEPAGE
+    }
+    return base;
+#endif // CSTL_OS_WINDOWS
+}
+
+// Commit `size` bytes (a multiple of the page size) at `ptr`, in a reserved range: they read as zero until written 
+// to. Returns false if there isn't enough memory.
+static bool vmem_commit(void* ptr, UInt64 size) {
+#if defined(CSTL_OS_WINDOWS)
+    return VirtualAlloc(ptr, (SIZE_T)size, MEM_COMMIT, PAGE_READWRITE) != null;
+#else
+    return mprotect(ptr, size, PROT_READ | PROT_WRITE) == 0;
+#endif // CSTL_OS_WINDOWS
+}
+
+// Release a range of `size` bytes reserved by `vmem_reserve()` (committed or not)
+static void vmem_release(void* ptr, UInt64 size) {
+    if(ptr == null)
+        return;
+#if defined(CSTL_OS_WINDOWS)
+    (void)size;
+    VirtualFree(ptr, 0, MEM_RELEASE);
+#else
+    munmap(ptr, size);
+#endif // CSTL_OS_WINDOWS
+}
+
+/*
+    Virtual Arrays
+*/
+typedef struct cstlVirtualArray {
+    char* base;             // the reserved range (null if nothing is reserved)
+    UInt64 reserved;        // no. of bytes reserved
+    UInt64 committed;       // no. of bytes (from `base`) that can be read and written
+    UInt64 granularity;     // what commits are rounded up to
+} cstlVirtualArray;
+
+// Reserve room for `size` bytes in `array` (with transparent huge pages, if `huge_pages`). 
+// Returns false (leaving `array` empty) if there isn't enough address space.
+static bool varray_reserve(cstlVirtualArray* array, UInt64 size, bool huge_pages) {
+    UInt64 granularity = huge_pages ? CSTL_VMEM_HUGE_PAGE_SIZE 
+                                    : CSTL_MAX(vmem_page_size(), CSTL_VMEM_COMMIT_GRANULARITY);
+    memset(array, 0, sizeof(cstlVirtualArray));
+    size = vmem__align(CSTL_MAX(size, (UInt64)1), granularity);
+    array->base = (char*)vmem_reserve(size, huge_pages);
+    if(array->base == null)
+        return false;
+    array->reserved = size;
+    array->granularity = granularity;
+    return true;
+}
+
+// Make sure the first `size` bytes of `array` can be read and written. Commits (at least) 1.5 times as much as before,
+// so that a growing array commits O(log n) times. Returns false if `size` is more than was reserved, or if there 
+// isn't enough memory.
+static bool varray_commit(cstlVirtualArray* array, UInt64 size) {
+    if(size <= array->committed)
+        return true;
+    if(size > array->reserved)
+        return false;
+
+    UInt64 committed = vmem__align(CSTL_MAX(size, array->committed + array->committed / 2), array->granularity);
+    committed = CSTL_MIN(committed, array->reserved);
+    if(!vmem_commit(array->base + array->committed, committed - array->committed))
+        return false;
+    array->committed = committed;
+    return true;
+}
+
+// Release everything `array` has reserved
+static void varray_free(cstlVirtualArray* array) {
+    vmem_release(array->base, array->reserved);
+    memset(array, 0, sizeof(cstlVirtualArray));
+}
+
+/*
+    Virtual Vectors
+
+    CSTL_VIRTUAL_VECTOR(Name, prefix, T) defines a typed vector that can hold up to `max` elements (fixed when it is 
+    initialized), in a `cstlVirtualArray`. It has the same functions as CSTL_VECTOR (see <hazel/core/vector.h>), 
+    except that `prefix_init()` can fail, and pushing past `max` is an error. Its elements never move.
+*/
+
+#define CSTL_VIRTUAL_VECTOR(Name, prefix, T)                                                                        \
+    typedef struct Name {                                                                                           \
+        T* data;                                                                                                    \
+        UInt64 size;                /* no. of elements in the vector */                                             \
+        UInt64 capacity;            /* no. of elements that fit in the committed memory */                          \
+        UInt64 max;                 /* no. of elements that fit in the reserved memory */                           \
+        cstlVirtualArray memory;                                                                                    \
+    } Name;                                                                                                         \
+                                                                                                                    \
+    /* Initialize an empty vector that can hold up to `max` elements. Returns false if there isn't enough address   \
+       space. */                                                                                                    \
+    static inline bool prefix##_init(Name* vec, UInt64 max, bool huge_pages) {                                      \
+        CSTL_CHECK_LT(max, (UInt64)-1 / sizeof(T) / 2);                                                             \
+        vec->size = vec->capacity = 0;                                                                              \
+        if(!varray_reserve(&vec->memory, max * sizeof(T), huge_pages)) {                                            \
+            vec->data = null;                                                                                       \
+            vec->max = 0;                                                                                           \
+            return false;                                                                                           \
+        }                                                                                                           \
+        vec->data = (T*)vec->memory.base;                                                                           \
+        vec->max = vec->memory.reserved / sizeof(T);                                                                \
+        return true;                                                                                                \
+    }                                                                                                               \
+                                                                                                                    \
+    static inline void prefix##_free(Name* vec) {                                                                   \
+        varray_free(&vec->memory);                                                                                  \
+        vec->data = null;                                                                                           \
+        vec->size = vec->capacity = vec->max = 0;                                                                   \
+    }                                                                                                               \
+                                                                                                                    \
+    /* Make sure `vec` can hold at least `capacity` elements (no more than `max`) */                                \
+    static inline void prefix##_reserve(Name* vec, UInt64 capacity) {                                               \
+        if(capacity <= vec->capacity)                                                                               \
+            return;                                                                                                 \
+        CSTL_CHECK(capacity <= vec->max, "Virtual vector is full");                                                 \
+        CSTL_CHECK(varray_commit(&vec->memory, capacity * sizeof(T)), "Could not commit memory. Memory full.");     \
+        vec->capacity = CSTL_MIN(vec->memory.committed / sizeof(T), vec->max);                                      \
+    }                                                                                                               \
+                                                                                                                    \
+    static CSTL_NOINLINE void prefix##__grow(Name* vec, UInt64 needed) {                                            \
+        prefix##_reserve(vec, needed);                                                                              \
+    }                                                                                                               \
+                                                                                                                    \
+    /* Append `value` to the end of `vec` */                                                                        \
+    static inline void prefix##_push(Name* vec, T value) {                                                          \
+        if(vec->size == vec->capacity)                                                                              \
+            prefix##__grow(vec, vec->size + 1);                                                                     \
+        vec->data[vec->size++] = value;                                                                             \
+    }                                                                                                               \
+                                                                                                                    \
+    /* Remove the last element of `vec` (which must not be empty) and return it */                                  \
+    static inline T prefix##_pop(Name* vec) {                                                                       \
+        CSTL_VECTOR_CHECK(vec->size > 0);                                                                           \
+        return vec->data[--vec->size];                                                                              \
+    }                                                                                                               \
+                                                                                                                    \
+    /* Returns a pointer to element `i` of `vec` (valid for as long as `vec` is) */                                 \
+    static inline T* prefix##_at(const Name* vec, UInt64 i) {                                                       \
+        CSTL_VECTOR_CHECK(i < vec->size);                                                                           \
+        return &vec->data[i];                                                                                       \
+    }                                                                                                               \
+                                                                                                                    \
+    static inline T* prefix##_last(const Name* vec) {                                                               \
+        CSTL_VECTOR_CHECK(vec->size > 0);                                                                           \
+        return &vec->data[vec->size - 1];                                                                           \
+    }                                                                                                               \
+                                                                                                                    \
+    static inline T* prefix##_begin(const Name* vec) { return vec->data; }                                          \
+    static inline T* prefix##_end(const Name* vec) { return vec->data + vec->size; }                                \
+    static inline UInt64 prefix##_size(const Name* vec) { return vec->size; }                                       \
+    static inline bool prefix##_is_empty(const Name* vec) { return vec->size == 0; }                                \
+    static inline void prefix##_clear(Name* vec) { vec->size = 0; }
+
+#endif // CSTL_VMEM_H
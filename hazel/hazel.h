@@ -17,7 +17,10 @@ Copyright (c) 2021 Jason Dsouza <http://github.com/jasmcaus>
 #include <hazel/core/hcore.h> 
 
 #include <hazel/compiler/types.h>
+#include <hazel/compiler/allocator.h>
 #include <hazel/compiler/tokens.h>  
+#include <hazel/compiler/intern.h>
+#include <hazel/compiler/profiler.h>
 #include <hazel/compiler/lexer.h>
 #include <hazel/compiler/ast.h>
 #include <hazel/compiler/parser.h>
\ No newline at end of file
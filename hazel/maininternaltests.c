@@ -22,13 +22,25 @@ int main(int argc, const char* const argv[]) {
     //     // printf("\n");
     // }
 
-	char* buffer = readFile("test/LexerDemo.hzl");
+    // Prints where the time (and the memory) went (see hazel/compiler/profiler.h) at the end
+    profiler_enable(true);
+    compiler_set_allocator(profiler_allocator());
+
+    const char* fname = "test/LexerDemo.hzl";
+    cstlFile source;
+    profiler_begin(PROFILER_READ, fname);
+    int error = file_load(&source, fname);
+    profiler_end();
+    if(error) {
+        fprintf(stderr, "Could not read <%s>: %s\n", fname, strerror(error));
+        return 1;
+    }
     // char* buffer = "0123456789abcdefghijklmnopqrstuvwxyz";
-	Lexer* lexer = lexer_init(buffer, "test/LexerDemo.hzl"); 
+	Lexer* lexer = lexer_init_with_length(source.data, (UInt32)source.length, fname); 
     // printf("-- LEXER_BUFFER: \n%s\n", lexer->buffer);
     printf("--------------\n");
 
-    clock_t st, end;
+    double st, end;
     printf("Lexing beginning...\n");
     st = now();
     int count = 0;
@@ -37,15 +49,25 @@ int main(int argc, const char* const argv[]) {
     printf("Lexing finished...\n");
     double total = duration(st, end);
 
-    printf("Number of tokens = %d\n", lexer->tokenList->size(lexer->tokenList));
-    printf("Total allocated memory (in bytes) = %d\n", lexer->tokenList->internal.objsize * lexer->tokenList->size(lexer->tokenList));
+    UInt64 ntokens = lexer->tokenList.size;
+    UInt64 nallocs = lexer_nallocs(lexer);
+    // Everything allocated so far (the buffer, the token stream and its side tables, interned strings, ...)
+    const cstlCountingAllocator* allocated = profiler_allocator_totals();
+    printf("Number of tokens = %" CSTL_PRIu64 "\n", ntokens);
+    printf("Total allocated memory (in bytes) = %" CSTL_PRIu64 " (peak: %" CSTL_PRIu64 ")\n", allocated->bytes, 
+           allocated->peak);
+    printf("Allocations = %" CSTL_PRIu64 " (%lf per token)\n", nallocs, (double)nallocs / ntokens);
     
     printf("\033[1;32m\nTokens Vector: \033[0m\n");
-    for(UInt64 i=0; i < lexer->tokenList->size(lexer->tokenList); i++) {
-        Token* tok = lexer->tokenList->at(lexer->tokenList, i);
-        printf("TOKEN(%s, \"%s\")\n", token_to_string(tok->kind), tok->value);
+    for(UInt32 i=0; i < ntokens; i++) {
+        Token tok = lexer_token_at(lexer, i);
+        printf("TOKEN(%s, \"%s\")\n", token_to_string(tok.kind), lexer_token_value(lexer, &tok));
     } 
     printf("Total time = %lfs\n", total);
 
+    lexer_free(lexer);
+    file_unload(&source);
+    profiler_report(stdout);
+    profiler_free();
     return 0; 
 }
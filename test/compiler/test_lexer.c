@@ -1,5 +1,6 @@
 #include <HazelInternalTests/HazelInternalTests.h>
 #include <tau/tau.h>
+#include <ctype.h>
 TAU_MAIN()
  
 TEST(Lexer, Init) {
@@ -8,11 +9,11 @@ TEST(Lexer, Init) {
 
     CHECK_STRNE(lexer->buffer->data, "");
     CHECK_EQ(lexer->buffer->length, strlen(buffer));
-    CHECK_EQ(lexer->tokenList->capacity(lexer->tokenList), TOKENLIST_ALLOC_CAPACITY);
-    CHECK_EQ(lexer->tokenList->size(lexer->tokenList), 0);
+    CHECK_EQ(lexer->tokenList.capacity, TOKENLIST_ALLOC_CAPACITY);
+    CHECK_EQ(lexer->tokenList.size, 0);
     CHECK_EQ(lexer->offset, 0);
-    CHECK_EQ(lexer->lineno, 1);
-    CHECK_EQ(lexer->colno, 1);
+    CHECK_EQ(lexer_location(lexer, lexer->offset).lineno, 1);
+    CHECK_EQ(lexer_location(lexer, lexer->offset).colno, 1);
     CHECK_STREQ(lexer->fname, "");
 
     free(lexer);
@@ -26,11 +27,11 @@ TEST(Lexer, advance_without_newline) {
     for(UInt32 i=0; i < strlen(buffer); i++) {
         CHECK_STREQ(lexer->buffer->data, buffer);
         CHECK_EQ(lexer_advance(lexer), lexer->buffer->data[lexer->offset-1]);
-        CHECK_EQ(lexer->tokenList->capacity(lexer->tokenList), TOKENLIST_ALLOC_CAPACITY);
-        CHECK_EQ(lexer->tokenList->size(lexer->tokenList), 0);
+        CHECK_EQ(lexer->tokenList.capacity, TOKENLIST_ALLOC_CAPACITY);
+        CHECK_EQ(lexer->tokenList.size, 0);
         CHECK_EQ(lexer->offset, i+1);
-        CHECK_EQ(lexer->colno, i+2);
-        CHECK_EQ(lexer->lineno, 1);
+        CHECK_EQ(lexer_location(lexer, lexer->offset).colno, i+2);
+        CHECK_EQ(lexer_location(lexer, lexer->offset).lineno, 1);
     }
 }
 
@@ -42,19 +43,20 @@ TEST(Lexer, advance_with_newline) {
     CHECK_STREQ(lexer->buffer->data, buffer);
     CHECK_EQ(lexer_advance(lexer), 'a');
     CHECK_EQ(lexer->offset, 1);
-    CHECK_EQ(lexer->tokenList->capacity(lexer->tokenList), TOKENLIST_ALLOC_CAPACITY);
-    CHECK_EQ(lexer->tokenList->size(lexer->tokenList), 0);
-    CHECK_EQ(lexer->colno, 2);
-    CHECK_EQ(lexer->lineno, 1);
+    CHECK_EQ(lexer->tokenList.capacity, TOKENLIST_ALLOC_CAPACITY);
+    CHECK_EQ(lexer->tokenList.size, 0);
+    CHECK_EQ(lexer_location(lexer, lexer->offset).colno, 2);
+    CHECK_EQ(lexer_location(lexer, lexer->offset).lineno, 1);
 
     // Hit a newline
     CHECK_STREQ(lexer->buffer->data, buffer);
     CHECK_EQ(lexer_advance(lexer), '\n');
     CHECK_EQ(lexer->offset, 2);
-    CHECK_EQ(lexer->tokenList->capacity(lexer->tokenList), TOKENLIST_ALLOC_CAPACITY);
-    CHECK_EQ(lexer->tokenList->size(lexer->tokenList), 0);
-    CHECK_EQ(lexer->colno, 3);
-    CHECK_EQ(lexer->lineno, 1);
+    CHECK_EQ(lexer->tokenList.capacity, TOKENLIST_ALLOC_CAPACITY);
+    // We are now at the `b` which begins the second line
+    CHECK_EQ(lexer->tokenList.size, 0);
+    CHECK_EQ(lexer_location(lexer, lexer->offset).colno, 1);
+    CHECK_EQ(lexer_location(lexer, lexer->offset).lineno, 2);
 }
 
 TEST(Lexer, advancen) {
@@ -64,139 +66,205 @@ TEST(Lexer, advancen) {
     // Go ahead 4 chars
     char e = lexer_advancen(lexer, 4); // should be 'e'
     CHECK_EQ(e, 'e');
-    CHECK_EQ(lexer->tokenList->capacity(lexer->tokenList), TOKENLIST_ALLOC_CAPACITY);
-    CHECK_EQ(lexer->tokenList->size(lexer->tokenList), 0);
+    CHECK_EQ(lexer->tokenList.capacity, TOKENLIST_ALLOC_CAPACITY);
+    CHECK_EQ(lexer->tokenList.size, 0);
     CHECK_EQ(lexer->offset, 4);
-    CHECK_EQ(lexer->colno, 5);
-    CHECK_EQ(lexer->lineno, 1);
+    CHECK_EQ(lexer_location(lexer, lexer->offset).colno, 5);
+    CHECK_EQ(lexer_location(lexer, lexer->offset).lineno, 1);
 
     // Go ahead 1 char
     char f = lexer_advancen(lexer, 1); // 'f'
     CHECK_EQ(f, 'f');
-    CHECK_EQ(lexer->tokenList->capacity(lexer->tokenList), TOKENLIST_ALLOC_CAPACITY);
-    CHECK_EQ(lexer->tokenList->size(lexer->tokenList), 0);
+    CHECK_EQ(lexer->tokenList.capacity, TOKENLIST_ALLOC_CAPACITY);
+    CHECK_EQ(lexer->tokenList.size, 0);
     CHECK_EQ(lexer->offset, 5);
-    CHECK_EQ(lexer->colno, 6);
-    CHECK_EQ(lexer->lineno, 1);
+    CHECK_EQ(lexer_location(lexer, lexer->offset).colno, 6);
+    CHECK_EQ(lexer_location(lexer, lexer->offset).lineno, 1);
 
     // Go ahead 3 chars
     char i = lexer_advancen(lexer, 3); // 'i'
     CHECK_EQ(i, 'i');
-    CHECK_EQ(lexer->tokenList->capacity(lexer->tokenList), TOKENLIST_ALLOC_CAPACITY);
-    CHECK_EQ(lexer->tokenList->size(lexer->tokenList), 0);
+    CHECK_EQ(lexer->tokenList.capacity, TOKENLIST_ALLOC_CAPACITY);
+    CHECK_EQ(lexer->tokenList.size, 0);
     CHECK_EQ(lexer->offset, 8);
-    CHECK_EQ(lexer->colno, 9);
-    CHECK_EQ(lexer->lineno, 1);
+    CHECK_EQ(lexer_location(lexer, lexer->offset).colno, 9);
+    CHECK_EQ(lexer_location(lexer, lexer->offset).lineno, 1);
 
     // Go ahead 7 chars
     char p = lexer_advancen(lexer, 7); // 'p'
     CHECK_EQ(p, 'p');
-    CHECK_EQ(lexer->tokenList->capacity(lexer->tokenList), TOKENLIST_ALLOC_CAPACITY);
-    CHECK_EQ(lexer->tokenList->size(lexer->tokenList), 0);
+    CHECK_EQ(lexer->tokenList.capacity, TOKENLIST_ALLOC_CAPACITY);
+    CHECK_EQ(lexer->tokenList.size, 0);
     CHECK_EQ(lexer->offset, 15);
-    CHECK_EQ(lexer->colno, 16);
-    CHECK_EQ(lexer->lineno, 1);
+    CHECK_EQ(lexer_location(lexer, lexer->offset).colno, 16);
+    CHECK_EQ(lexer_location(lexer, lexer->offset).lineno, 1);
     
     // Go ahead 10 chars
     char z = lexer_advancen(lexer, 10); // 'z'
     CHECK_EQ(z, 'z');
-    CHECK_EQ(lexer->tokenList->capacity(lexer->tokenList), TOKENLIST_ALLOC_CAPACITY);
-    CHECK_EQ(lexer->tokenList->size(lexer->tokenList), 0);
+    CHECK_EQ(lexer->tokenList.capacity, TOKENLIST_ALLOC_CAPACITY);
+    CHECK_EQ(lexer->tokenList.size, 0);
     CHECK_EQ(lexer->offset, 25);
-    CHECK_EQ(lexer->colno, 26);
-    CHECK_EQ(lexer->lineno, 1);
+    CHECK_EQ(lexer_location(lexer, lexer->offset).colno, 26);
+    CHECK_EQ(lexer_location(lexer, lexer->offset).lineno, 1);
 
     // Go ahead 10 chars
     char nine = lexer_advancen(lexer, 10); // '9'
     CHECK_EQ(nine, '9');
-    CHECK_EQ(lexer->tokenList->capacity(lexer->tokenList), TOKENLIST_ALLOC_CAPACITY);
-    CHECK_EQ(lexer->tokenList->size(lexer->tokenList), 0);
+    CHECK_EQ(lexer->tokenList.capacity, TOKENLIST_ALLOC_CAPACITY);
+    CHECK_EQ(lexer->tokenList.size, 0);
     CHECK_EQ(lexer->offset, 35);
-    CHECK_EQ(lexer->colno, 36);
-    CHECK_EQ(lexer->lineno, 1);
+    CHECK_EQ(lexer_location(lexer, lexer->offset).colno, 36);
+    CHECK_EQ(lexer_location(lexer, lexer->offset).lineno, 1);
 
     // Go ahead 1 char (end of buff cap)
     char eof1 = lexer_advancen(lexer, 1);
     CHECK_EQ(eof1, nullchar);
     // Options should remain the same
-    CHECK_EQ(lexer->tokenList->capacity(lexer->tokenList), TOKENLIST_ALLOC_CAPACITY);
-    CHECK_EQ(lexer->tokenList->size(lexer->tokenList), 0);
+    CHECK_EQ(lexer->tokenList.capacity, TOKENLIST_ALLOC_CAPACITY);
+    CHECK_EQ(lexer->tokenList.size, 0);
     CHECK_EQ(lexer->offset, 35);
-    CHECK_EQ(lexer->colno, 36);
-    CHECK_EQ(lexer->lineno, 1);
+    CHECK_EQ(lexer_location(lexer, lexer->offset).colno, 36);
+    CHECK_EQ(lexer_location(lexer, lexer->offset).lineno, 1);
 
     // Go ahead 4 more chars (end of cap)
     char eof2 = lexer_advancen(lexer, 4);
     CHECK_EQ(eof2, nullchar);
     // Options should remain the same
-    CHECK_EQ(lexer->tokenList->capacity(lexer->tokenList), TOKENLIST_ALLOC_CAPACITY);
-    CHECK_EQ(lexer->tokenList->size(lexer->tokenList), 0);
+    CHECK_EQ(lexer->tokenList.capacity, TOKENLIST_ALLOC_CAPACITY);
+    CHECK_EQ(lexer->tokenList.size, 0);
     CHECK_EQ(lexer->offset, 35);
-    CHECK_EQ(lexer->colno, 36);
-    CHECK_EQ(lexer->lineno, 1);
+    CHECK_EQ(lexer_location(lexer, lexer->offset).colno, 36);
+    CHECK_EQ(lexer_location(lexer, lexer->offset).lineno, 1);
 }
 
-#define lt  lexer->tokenList
-
 TEST(lexer, lex_keywords) {
     char* buffer = "atomic UInt32 var = 0x123;";
     Lexer* lexer = lexer_init(buffer, null);
-    Token* tok;
+    Token tok;
     
     lexer_lex(lexer);
+    CHECK_STREQ(lexer->tokenList.fname, "");
 
     // Test
-    tok = lt->at(lt, 0);
-    CHECK(tok->kind == ATOMIC);
-    CHECK_EQ(tok->offset, 0);
-    CHECK_EQ(tok->lineno, 1);
-    CHECK_EQ(tok->colno, 1);
-    CHECK_STREQ(tok->value, "atomic");
-    CHECK_STREQ(tok->fname, "");
+    tok = lexer_token_at(lexer, 0);
+    CHECK(tok.kind == ATOMIC);
+    CHECK_EQ(tok.offset, 0);
+    CHECK_EQ(lexer_token_location(lexer, &tok).lineno, 1);
+    CHECK_EQ(lexer_token_location(lexer, &tok).colno, 1);
+    CHECK_STREQ(lexer_token_value(lexer, &tok), "atomic");
     
-    tok = lt->at(lt, 1);
-    CHECK(tok->kind == IDENTIFIER);
-    CHECK_EQ(tok->offset, 7);
-    CHECK_EQ(tok->lineno, 1);
-    CHECK_EQ(tok->colno, 8);
-    CHECK_STREQ(tok->value, "UInt32");
-    CHECK_STREQ(tok->fname, "");
-
-    tok = lt->at(lt, 2);
-    CHECK(tok->kind == IDENTIFIER);
-    CHECK_EQ(tok->offset, 14);
-    CHECK_EQ(tok->lineno, 1);
-    CHECK_EQ(tok->colno, 15);
-    CHECK_STREQ(tok->value, "var");
-    CHECK_STREQ(tok->fname, "");
-
-    tok = lt->at(lt, 3);
-    CHECK(tok->kind == EQUALS);
-    CHECK_EQ(tok->offset, 18);
-    CHECK_EQ(tok->lineno, 1);
-    CHECK_EQ(tok->colno, 19);
-    CHECK_STREQ(tok->value, "=");
-    CHECK_STREQ(tok->fname, "");
-
-    tok = lt->at(lt, 4);
-    CHECK(tok->kind == HEX_INT);
-    CHECK_EQ(tok->offset, 20);
-    CHECK_EQ(tok->lineno, 1);
-    CHECK_EQ(tok->colno, 21);
-    CHECK_STREQ(tok->value, "0x123");
-    CHECK_STREQ(tok->fname, "");
-
-    tok = lt->at(lt, 5);
-    CHECK(tok->kind == SEMICOLON);
-    CHECK_EQ(tok->offset, 25);
-    CHECK_EQ(tok->lineno, 1);
-    CHECK_EQ(tok->colno, 26);
-    CHECK_STREQ(tok->value, ";");
-    CHECK_STREQ(tok->fname, "");
-
-    tok = lt->at(lt, 6);
-    CHECK(tok->kind == TOK_EOF);
-    CHECK_STREQ(tok->value, "EOF");
+    tok = lexer_token_at(lexer, 1);
+    CHECK(tok.kind == IDENTIFIER);
+    CHECK_EQ(tok.offset, 7);
+    CHECK_EQ(lexer_token_location(lexer, &tok).lineno, 1);
+    CHECK_EQ(lexer_token_location(lexer, &tok).colno, 8);
+    CHECK_STREQ(lexer_token_value(lexer, &tok), "UInt32");
+
+    tok = lexer_token_at(lexer, 2);
+    CHECK(tok.kind == IDENTIFIER);
+    CHECK_EQ(tok.offset, 14);
+    CHECK_EQ(lexer_token_location(lexer, &tok).lineno, 1);
+    CHECK_EQ(lexer_token_location(lexer, &tok).colno, 15);
+    CHECK_STREQ(lexer_token_value(lexer, &tok), "var");
+
+    tok = lexer_token_at(lexer, 3);
+    CHECK(tok.kind == EQUALS);
+    CHECK_EQ(tok.offset, 18);
+    CHECK_EQ(lexer_token_location(lexer, &tok).lineno, 1);
+    CHECK_EQ(lexer_token_location(lexer, &tok).colno, 19);
+    CHECK_STREQ(lexer_token_value(lexer, &tok), "=");
+
+    tok = lexer_token_at(lexer, 4);
+    CHECK(tok.kind == HEX_INT);
+    CHECK_EQ(tok.offset, 20);
+    CHECK_EQ(lexer_token_location(lexer, &tok).lineno, 1);
+    CHECK_EQ(lexer_token_location(lexer, &tok).colno, 21);
+    CHECK_STREQ(lexer_token_value(lexer, &tok), "0x123");
+
+    tok = lexer_token_at(lexer, 5);
+    CHECK(tok.kind == SEMICOLON);
+    CHECK_EQ(tok.offset, 25);
+    CHECK_EQ(lexer_token_location(lexer, &tok).lineno, 1);
+    CHECK_EQ(lexer_token_location(lexer, &tok).colno, 26);
+    CHECK_STREQ(lexer_token_value(lexer, &tok), ";");
+
+    tok = lexer_token_at(lexer, 6);
+    CHECK(tok.kind == TOK_EOF);
+    CHECK_STREQ(lexer_token_value(lexer, &tok), "EOF");
+}
+
+TEST(lexer, lex_values_are_slices) {
+    char* buffer = "@inline \"Hello\" \"\" name # comment\n";
+    Lexer* lexer = lexer_init(buffer, null);
+    Token tok;
+    
+    lexer_lex(lexer);
+    // Lexing by itself should not allocate anything other than the initial token list
+    CHECK_EQ(lexer_nallocs(lexer), 0);
+
+    tok = lexer_token_at(lexer, 0);
+    CHECK(tok.kind == MACRO);
+    CHECK_EQ(tok.offset, 0);
+    CHECK_EQ(tok.length, 7);
+    CHECK_STREQ(lexer_token_value(lexer, &tok), "inline");
+
+    tok = lexer_token_at(lexer, 1);
+    CHECK(tok.kind == STRING);
+    CHECK_EQ(tok.offset, 8);
+    CHECK_EQ(tok.length, 7);
+    CHECK_STREQ(lexer_token_value(lexer, &tok), "Hello");
+
+    tok = lexer_token_at(lexer, 2);
+    CHECK(tok.kind == STRING);
+    CHECK_EQ(tok.offset, 16);
+    CHECK_EQ(tok.length, 2);
+    CHECK_STREQ(lexer_token_value(lexer, &tok), "");
+
+    tok = lexer_token_at(lexer, 3);
+    CHECK(tok.kind == IDENTIFIER);
+    CHECK_EQ(tok.offset, 19);
+    CHECK_EQ(tok.length, 4);
+    CHECK_STREQ(lexer_token_value(lexer, &tok), "name");
+
+    // Comments are kept on the side
+    tok = lexer_token_at(lexer, 4);
+    CHECK(tok.kind == TOK_EOF);
+    REQUIRE_EQ(lexer->comments.size, 1);
+    tok = lexer_comment_at(lexer, 0);
+    CHECK(tok.kind == COMMENT);
+    CHECK_EQ(tok.offset, 24);
+    CHECK_EQ(tok.length, 9);
+    CHECK_STREQ(lexer_token_value(lexer, &tok), " comment");
+
+    // All copies come out of a single arena chunk
+    CHECK_EQ(lexer_nallocs(lexer), 1);
+
+    lexer_free(lexer);
+}
+
+TEST(lexer, token_stream) {
+    char* buffer = "a = b";
+    Lexer* lexer = lexer_init(buffer, "file.hzl");
+    TokenStream* stream = &lexer->tokenList;
+
+    lexer_lex(lexer);
+
+    CHECK_EQ(stream->size, 4);
+    CHECK_STREQ(stream->fname, "file.hzl");
+    CHECK(TOKEN_KIND(stream, 0) == IDENTIFIER);
+    CHECK(TOKEN_KIND(stream, 1) == EQUALS);
+    CHECK(TOKEN_KIND(stream, 2) == IDENTIFIER);
+    CHECK(TOKEN_KIND(stream, 3) == TOK_EOF);
+    CHECK_EQ(TOKEN_OFFSET(stream, 2), 4);
+    CHECK_EQ(TOKEN_LENGTH(stream, 2), 1);
+
+    // Growing the stream keeps the tokens intact
+    CHECK_TRUE(token_stream_reserve(stream, stream->capacity * 4));
+    CHECK(TOKEN_KIND(stream, 1) == EQUALS);
+    CHECK_EQ(TOKEN_OFFSET(stream, 1), 2);
+
+    lexer_free(lexer);
 }
 
 // TEST(Lexer, lexer_lex_digits) {
@@ -239,4 +307,1139 @@ TEST(lexer, lex_keywords) {
 
 //     lexer_free(lexer);
 //     LexerTestArr_free(lta);
-// }
\ No newline at end of file
+// }
+TEST(lexer, keyword_lookup) {
+    char* buffer = "while where except export notin elseif i whiles expor _if pragma";
+    TokenKind expected[] = { WHILE, WHERE, EXCEPT, EXPORT, NOT_IN, ELSEIF,
+                             IDENTIFIER, IDENTIFIER, IDENTIFIER, IDENTIFIER, PRAGMA, TOK_EOF };
+    Lexer* lexer = lexer_init(buffer, null);
+    lexer_lex(lexer);
+
+    REQUIRE_EQ(lexer->tokenList.size, sizeof(expected)/sizeof(expected[0]));
+    for(UInt32 i = 0; i < lexer->tokenList.size; i++)
+        CHECK(TOKEN_KIND(&lexer->tokenList, i) == expected[i]);
+    lexer_free(lexer);
+}
+
+TEST(lexer, scanning_kernels) {
+    // Exercise every alignment of the match relative to the vector width, and the scalar tail
+    char buffer[100];
+    for(UInt32 pos = 0; pos < 64; pos++) {
+        memset(buffer, 'a', sizeof(buffer));
+        buffer[pos] = '\n';
+        CHECK_EQ(simd_find_byte(buffer, buffer + 64, '\n') - buffer, pos);
+        CHECK_EQ(simd_find_byte(buffer, buffer + pos, '\n') - buffer, pos);
+
+        buffer[pos] = '*';
+        CHECK_EQ(simd_find_byte2(buffer, buffer + 64, '*', '\n') - buffer, pos);
+        buffer[pos] = '\\';
+        CHECK_EQ(simd_find_byte3(buffer, buffer + 64, '"', '\\', '\n') - buffer, pos);
+
+        memset(buffer, '_', sizeof(buffer));
+        buffer[pos / 2] = 'Z';
+        buffer[pos] = '-';
+        CHECK_EQ(simd_skip_identifier(buffer, buffer + 64) - buffer, pos);
+        buffer[pos] = 0x80 | 'a';
+        CHECK_EQ(simd_skip_identifier(buffer, buffer + 64) - buffer, pos);
+
+        memset(buffer, ' ', sizeof(buffer));
+        buffer[pos / 2] = '\t';
+        buffer[pos] = '\n';
+        CHECK_EQ(simd_skip_blanks(buffer, buffer + 64) - buffer, pos);
+    }
+}
+
+TEST(lexer, lex_long_runs) {
+    char* buffer = 
+        "                                        an_identifier_that_is_longer_than_32_bytes_0123456789 x\n"
+        "/* A multi-line comment that spans\n"
+        "   more than one line */ y // a comment long enough to need more than one vector load\n"
+        "\"a string with an \\\" escaped quote and\n a newline\" z";
+    Lexer* lexer = lexer_init(buffer, null);
+    Token tok;
+    lexer_lex(lexer);
+
+    tok = lexer_token_at(lexer, 0);
+    CHECK(tok.kind == IDENTIFIER);
+    CHECK_EQ(tok.offset, 40);
+    CHECK_EQ(tok.length, 53);
+    CHECK_EQ(lexer_token_location(lexer, &tok).colno, 41);
+
+    tok = lexer_token_at(lexer, 1);
+    CHECK(tok.kind == IDENTIFIER);
+    CHECK_EQ(lexer_token_location(lexer, &tok).colno, 95);
+
+    tok = lexer_token_at(lexer, 2);
+    CHECK(tok.kind == IDENTIFIER);
+    CHECK_STREQ(lexer_token_value(lexer, &tok), "y");
+    CHECK_EQ(lexer_token_location(lexer, &tok).lineno, 3);
+    CHECK_EQ(lexer_token_location(lexer, &tok).colno, 26);
+    CHECK_EQ(tok.offset, 156);
+
+    REQUIRE_EQ(lexer->comments.size, 2);
+    tok = lexer_comment_at(lexer, 0);
+    CHECK(tok.kind == COMMENT);
+    CHECK_STREQ(lexer_token_value(lexer, &tok), " A multi-line comment that spans\n   more than one line ");
+    tok = lexer_comment_at(lexer, 1);
+    CHECK(tok.kind == COMMENT);
+    CHECK_STREQ(lexer_token_value(lexer, &tok), " a comment long enough to need more than one vector load");
+
+    tok = lexer_token_at(lexer, 3);
+    CHECK(tok.kind == STRING);
+    CHECK_EQ(lexer_token_location(lexer, &tok).lineno, 4);
+    CHECK_STREQ(lexer_token_value(lexer, &tok), "a string with an \\\" escaped quote and\n a newline");
+
+    tok = lexer_token_at(lexer, 4);
+    CHECK(tok.kind == IDENTIFIER);
+    CHECK_EQ(lexer_token_location(lexer, &tok).lineno, 5);
+    CHECK_EQ(lexer_token_location(lexer, &tok).colno, 13);
+    CHECK_EQ(tok.offset, 268);
+
+    tok = lexer_token_at(lexer, 5);
+    CHECK(tok.kind == TOK_EOF);
+    lexer_free(lexer);
+}
+
+TEST(lexer, char_classes) {
+    for(int i = 0; i < 256; i++) {
+        char c = (char)i;
+        bool ascii = i < 0x80;
+        CHECK_EQ(isLetter(c), ascii && (isalpha(i) || c == '_'));
+        CHECK_EQ(isIdentifierChar(c), ascii && (isalnum(i) || c == '_'));
+        CHECK_EQ(isHexDigit(c), ascii && isxdigit(i));
+        CHECK_EQ(isOctalDigit(c), c >= '0' && c <= '7');
+        CHECK_EQ(isWhitespace(c), ascii && isspace(i));
+        CHECK_EQ(toUpper(c), ascii ? (char)toupper(i) : c);
+    }
+}
+
+TEST(lexer, line_index) {
+    // 100 lines of increasing length (long enough to be indexed a vector at a time)
+    char buffer[8192];
+    UInt32 starts[100];
+    UInt32 length = 0;
+    for(UInt32 line = 0; line < 100; line++) {
+        starts[line] = length;
+        for(UInt32 i = 0; i < line % 40; i++)
+            buffer[length++] = 'x';
+        buffer[length++] = '\n';
+    }
+    buffer[length] = nullchar;
+
+    LineIndex index;
+    line_index_build(&index, buffer, length);
+    CHECK_EQ(index.nlines, 101);
+    for(UInt32 line = 0; line < 100; line++) {
+        SourceLocation first = line_index_lookup(&index, starts[line]);
+        CHECK_EQ(first.lineno, line + 1);
+        CHECK_EQ(first.colno, 1);
+
+        // The newline belongs to the line it ends
+        SourceLocation newline = line_index_lookup(&index, starts[line] + line % 40);
+        CHECK_EQ(newline.lineno, line + 1);
+        CHECK_EQ(newline.colno, line % 40 + 1);
+    }
+    // One past the last newline begins an (empty) last line
+    CHECK_EQ(line_index_lookup(&index, length).lineno, 101);
+    line_index_free(&index);
+
+    line_index_build(&index, "", 0);
+    CHECK_EQ(index.nlines, 1);
+    CHECK_EQ(line_index_lookup(&index, 0).lineno, 1);
+    CHECK_EQ(line_index_lookup(&index, 0).colno, 1);
+    line_index_free(&index);
+}
+
+TEST(lexer, next_token) {
+    // Long enough to wrap around the token window many times over
+    char buffer[4096];
+    UInt32 length = 0;
+    for(UInt32 i = 0; i < 200; i++)
+        length += sprintf(buffer + length, "x%u += 0x%X; ", i, i);
+
+    Lexer* batch = lexer_init(buffer, null);
+    Lexer* stream = lexer_init(buffer, null);
+    lexer_lex(batch);
+    REQUIRE_GT(batch->tokenList.size, 3 * LEXER_WINDOW_SIZE);
+
+    for(UInt32 i = 0; i < batch->tokenList.size; i++) {
+        Token expected = lexer_token_at(batch, i);
+
+        // Lookahead doesn't consume anything
+        Token ahead = lexer_peek_token(stream, 0);
+        CHECK(ahead.kind == expected.kind);
+        if(i + 3 < batch->tokenList.size)
+            CHECK_EQ(lexer_peek_token(stream, 3).offset, lexer_token_at(batch, i + 3).offset);
+
+        Token tok = lexer_next_token(stream);
+        CHECK(tok.kind == expected.kind);
+        CHECK_EQ(tok.offset, expected.offset);
+        CHECK_EQ(tok.length, expected.length);
+    }
+
+    // Past the end, we keep getting TOK_EOF
+    CHECK(lexer_next_token(stream).kind == TOK_EOF);
+    CHECK(lexer_peek_token(stream, 5).kind == TOK_EOF);
+    CHECK_EQ(lexer_next_token(stream).offset, length);
+
+    // Streaming never touches the token list
+    CHECK_EQ(stream->tokenList.size, 0);
+    lexer_free(batch);
+    lexer_free(stream);
+}
+
+// Returns whether `a` and `b` have the same comments, linked to the same tokens
+static bool same_comments(const CommentTable* a, const CommentTable* b) {
+    if(a->size != b->size)
+        return false;
+    for(UInt32 i = 0; i < a->size; i++) {
+        if(a->kinds[i] != b->kinds[i] || a->offsets[i] != b->offsets[i] || a->lengths[i] != b->lengths[i] || 
+           a->tokens[i] != b->tokens[i])
+            return false;
+    }
+    return true;
+}
+
+TEST(lexer, lex_parallel) {
+    // Strings and comments that run over several lines (and so, over chunk boundaries), and contain each other's 
+    // delimiters
+    const char* lines[] = {
+        "func f(x) { return x + 0x1F }\n",
+        "/* a comment with a \"quote\n   and // more\n   over three lines */ y = @inline z\n",
+        "s = \"a string with /* and # in it\n   that spans\n   lines\" t\n",
+        "# a comment with a \" quote\n",
+        "a != b; c <<= d; e -> f...\n",
+    };
+    char* buffer = (char*)malloc(64 * 1024);
+    UInt32 length = 0;
+    for(UInt32 i = 0; length < 60 * 1024; i++) {
+        length += sprintf(buffer + length, "%s", lines[(i * 7) % 5]);
+    }
+
+    Lexer* serial = lexer_init(buffer, null);
+    lexer_lex(serial);
+
+    for(UInt32 nthreads = 2; nthreads <= 16; nthreads += 3) {
+        Lexer* parallel = lexer_init(buffer, null);
+        lexer_lex_parallel(parallel, nthreads);
+
+        REQUIRE_EQ(parallel->tokenList.size, serial->tokenList.size);
+        for(UInt32 i = 0; i < serial->tokenList.size; i++) {
+            CHECK(TOKEN_KIND(&parallel->tokenList, i) == TOKEN_KIND(&serial->tokenList, i));
+            CHECK_EQ(TOKEN_OFFSET(&parallel->tokenList, i), TOKEN_OFFSET(&serial->tokenList, i));
+            CHECK_EQ(TOKEN_LENGTH(&parallel->tokenList, i), TOKEN_LENGTH(&serial->tokenList, i));
+            CHECK_EQ(TOKEN_SYMBOL(&parallel->tokenList, i), TOKEN_SYMBOL(&serial->tokenList, i));
+        }
+        CHECK_TRUE(same_comments(&parallel->comments, &serial->comments));
+        lexer_free(parallel);
+    }
+    lexer_free(serial);
+    free(buffer);
+}
+
+TEST(lexer, file_load) {
+    const char* fname = "test_lexer_file_load.hzl";
+    const char* source = "func main() {\n    return 0x2A\n}\n";
+    FILE* out = fopen(fname, "wb");
+    REQUIRE(out != null);
+    fputs(source, out);
+    fclose(out);
+
+    cstlFile file;
+    REQUIRE_EQ(file_load(&file, fname), 0);
+    CHECK_EQ(file.length, strlen(source));
+    CHECK_BUF_EQ(file.data, source, strlen(source));
+    // The contents are always followed by `CSTL_FILE_PADDING` zeros
+    for(UInt32 i = 0; i < CSTL_FILE_PADDING; i++)
+        CHECK_EQ(file.data[file.length + i], 0);
+
+    Lexer* lexer = lexer_init_with_length(file.data, (UInt32)file.length, fname);
+    lexer_lex(lexer);
+    CHECK_EQ(lexer->buffer->length, strlen(source));
+    CHECK(TOKEN_KIND(&lexer->tokenList, 0) == FUNC);
+    CHECK(TOKEN_KIND(&lexer->tokenList, lexer->tokenList.size - 1) == TOK_EOF);
+    lexer_free(lexer);
+    file_unload(&file);
+    CHECK(file.data == null);
+
+    // Empty files load as ""
+    out = fopen(fname, "wb");
+    REQUIRE(out != null);
+    fclose(out);
+    REQUIRE_EQ(file_load(&file, fname), 0);
+    CHECK_EQ(file.length, 0);
+    CHECK_STREQ(file.data, "");
+    file_unload(&file);
+    remove(fname);
+
+    CHECK_EQ(file_load(&file, "this/file/does/not/exist.hzl"), ENOENT);
+    CHECK(file.data == null);
+}
+
+TEST(lexer, sentinel_padding) {
+    char* buffer = "x = y";
+    Lexer* lexer = lexer_init(buffer, null);
+
+    // `lexer_init()` lexes a padded copy of `buffer`
+    CHECK(lexer->buffer->data != buffer);
+    CHECK_STREQ(lexer->buffer->data, buffer);
+    for(UInt32 i = 0; i < CSTL_BUFFER_PADDING; i++)
+        CHECK_EQ(lexer->buffer->at(lexer->buffer, lexer->buffer->length + i), nullchar);
+
+    // Looking past the end reads the sentinel, and the offset never moves past it
+    lexer->offset = 4;
+    CHECK_EQ(lexer_peekn(lexer, 1), nullchar);
+    CHECK_EQ(lexer_peekn(lexer, CSTL_BUFFER_PADDING - 1), nullchar);
+    CHECK_EQ(lexer_advance(lexer), 'y');
+    CHECK_EQ(lexer_advance(lexer), nullchar);
+    CHECK_EQ(lexer_advance(lexer), nullchar);
+    CHECK_EQ(lexer->offset, 5);
+    CHECK_EQ(lexer_advancen(lexer, 3), nullchar);
+    CHECK_EQ(lexer->offset, 5);
+
+    lexer->offset = 0;
+    lexer_lex(lexer);
+    CHECK_EQ(lexer->tokenList.size, 4);
+    CHECK(TOKEN_KIND(&lexer->tokenList, 3) == TOK_EOF);
+    CHECK_EQ(TOKEN_OFFSET(&lexer->tokenList, 3), 5);
+    lexer_free(lexer);
+}
+
+TEST(lexer, relex) {
+    const char* lines[] = {
+        "let foo = bar + baz\n",
+        "func f(x) { return x * y }\n",
+        "/* a comment with\n   two lines */ y = @inline z\n",
+        "s = \"a string /* with */ # things in it\" t\n",
+        "# a comment\n",
+        "a != b; c <<= d; e -> f...\n",
+    };
+    // Edits never touch quotes or backslashes (so strings stay terminated), and never introduce digits
+    const char* inserts[] = { "", "x", "q_1", " ", "\n", "/*", "*/", "#", "<", "=", "...", "{ }", "@", "ab\ncd" };
+    const UInt32 ninserts = sizeof(inserts) / sizeof(inserts[0]);
+
+    char* text = (char*)malloc(16 * 1024);
+    UInt32 length = 0;
+    for(UInt32 i = 0; length < 4 * 1024; i++)
+        length += sprintf(text + length, "%s", lines[(i * 5) % 6]);
+
+    Lexer* lexer = lexer_init(text, null);
+    lexer_lex(lexer);
+
+    UInt32 seed = 12345;
+    for(UInt32 n = 0; n < 400; n++) {
+        seed = seed * 1103515245 + 12345;
+        UInt32 offset = (seed >> 8) % (length + 1);
+        seed = seed * 1103515245 + 12345;
+        UInt32 removed = CSTL_MIN((seed >> 8) % 6, length - offset);
+        for(UInt32 i = offset; i < offset + removed; i++)
+            if(text[i] == '"' || text[i] == '\\')
+                removed = i - offset;
+        const char* inserted = inserts[(seed >> 16) % ninserts];
+        UInt32 inserted_length = (UInt32)strlen(inserted);
+
+        LexerSplice splice = lexer_relex(lexer, offset, removed, inserted, inserted_length);
+        memmove(text + offset + inserted_length, text + offset + removed, length - offset - removed + 1);
+        memcpy(text + offset, inserted, inserted_length);
+        length = length - removed + inserted_length;
+        REQUIRE_STREQ(lexer->buffer->data, text);
+
+        // Re-lexing the whole buffer gives the same tokens
+        Lexer* expected = lexer_init(text, null);
+        lexer_lex(expected);
+        REQUIRE_EQ(lexer->tokenList.size, expected->tokenList.size);
+        for(UInt32 i = 0; i < expected->tokenList.size; i++) {
+            REQUIRE(TOKEN_KIND(&lexer->tokenList, i) == TOKEN_KIND(&expected->tokenList, i));
+            REQUIRE_EQ(TOKEN_OFFSET(&lexer->tokenList, i), TOKEN_OFFSET(&expected->tokenList, i));
+            REQUIRE_EQ(TOKEN_LENGTH(&lexer->tokenList, i), TOKEN_LENGTH(&expected->tokenList, i));
+            REQUIRE_EQ(TOKEN_SYMBOL(&lexer->tokenList, i), TOKEN_SYMBOL(&expected->tokenList, i));
+        }
+        REQUIRE_TRUE(same_comments(&lexer->comments, &expected->comments));
+        CHECK_LE(splice.first + splice.ninserted, lexer->tokenList.size);
+        lexer_free(expected);
+    }
+
+    // A single keystroke only re-lexes the tokens around it
+    LexerSplice splice = lexer_relex(lexer, length / 2, 0, " ", 1);
+    CHECK_LE(splice.nremoved, 4);
+    CHECK_LE(splice.ninserted, 4);
+
+    lexer_free(lexer);
+    free(text);
+}
+
+TEST(lexer, comments_are_kept_on_the_side) {
+    char* buffer = 
+        "/// Adds one\n"
+        "/// to x\n"
+        "func inc(x) { # trailing\n"
+        "    return x + 1 /* inline */\n"
+        "}\n"
+        "//// not documentation\n"
+        "# at the end";
+    Lexer* lexer = lexer_init(buffer, null);
+    lexer_lex(lexer);
+
+    // The token stream only has the tokens the Parser needs
+    TokenStream* stream = &lexer->tokenList;
+    REQUIRE_EQ(stream->size, 12);
+    for(UInt32 i = 0; i < stream->size; i++) {
+        CHECK(TOKEN_KIND(stream, i) != COMMENT);
+        CHECK(TOKEN_KIND(stream, i) != DOCS_COMMENT);
+    }
+
+    // `func` has two lines of documentation
+    UInt32 first;
+    Token tok;
+    REQUIRE_EQ(lexer_token_comments(lexer, 0, &first), 2);
+    tok = lexer_comment_at(lexer, first);
+    CHECK(tok.kind == DOCS_COMMENT);
+    CHECK_STREQ(lexer_token_value(lexer, &tok), " Adds one");
+    tok = lexer_comment_at(lexer, first + 1);
+    CHECK(tok.kind == DOCS_COMMENT);
+    CHECK_STREQ(lexer_token_value(lexer, &tok), " to x");
+
+    // `return` (after `{`) and `}` (after `1`)
+    CHECK_EQ(lexer_token_comments(lexer, 1, &first), 0);
+    REQUIRE_EQ(lexer_token_comments(lexer, 6, &first), 1);
+    tok = lexer_comment_at(lexer, first);
+    CHECK_STREQ(lexer_token_value(lexer, &tok), " trailing");
+    REQUIRE_EQ(lexer_token_comments(lexer, 10, &first), 1);
+    tok = lexer_comment_at(lexer, first);
+    CHECK(tok.kind == COMMENT);
+    CHECK_STREQ(lexer_token_value(lexer, &tok), " inline ");
+
+    // Comments at the end of the file go with TOK_EOF
+    CHECK(TOKEN_KIND(stream, 11) == TOK_EOF);
+    REQUIRE_EQ(lexer_token_comments(lexer, 11, &first), 2);
+    tok = lexer_comment_at(lexer, first);
+    CHECK(tok.kind == COMMENT);
+    CHECK_STREQ(lexer_token_value(lexer, &tok), "// not documentation");
+    tok = lexer_comment_at(lexer, first + 1);
+    CHECK_STREQ(lexer_token_value(lexer, &tok), " at the end");
+    CHECK_EQ(lexer->comments.size, 6);
+
+    // The streaming interface links comments the same way
+    Lexer* streaming = lexer_init(buffer, null);
+    while(lexer_next_token(streaming).kind != TOK_EOF) {}
+    CHECK_TRUE(same_comments(&streaming->comments, &lexer->comments));
+
+    lexer_free(streaming);
+    lexer_free(lexer);
+}
+
+TEST(lexer, identifiers_are_interned) {
+    char* buffer = "foo = bar(foo) if foo_ x\nbar";
+    Lexer* lexer = lexer_init(buffer, null);
+    TokenStream* stream = &lexer->tokenList;
+    lexer_lex(lexer);
+
+    REQUIRE_EQ(stream->size, 11);
+    Symbol foo = TOKEN_SYMBOL(stream, 0);
+    Symbol bar = TOKEN_SYMBOL(stream, 2);
+    CHECK_NE(foo, SYMBOL_NONE);
+    CHECK_NE(foo, bar);
+    CHECK_EQ(TOKEN_SYMBOL(stream, 4), foo);
+    CHECK_EQ(TOKEN_SYMBOL(stream, 9), bar);
+    CHECK_NE(TOKEN_SYMBOL(stream, 7), foo);
+    // Keywords and operators don't have one
+    CHECK_EQ(TOKEN_SYMBOL(stream, 1), SYMBOL_NONE);
+    CHECK_EQ(TOKEN_SYMBOL(stream, 6), SYMBOL_NONE);
+
+    UInt32 length;
+    CHECK_STREQ(interner_string(lexer->interner, foo, &length), "foo");
+    CHECK_EQ(length, 3);
+    CHECK_EQ(interner_hash(lexer->interner, bar), intern_hash("bar", 3));
+    CHECK_EQ(intern_hash("bar", 3), hash_bytes64("bar", 3, 0));
+    CHECK_EQ(lexer_token_at(lexer, 6).symbol, SYMBOL_NONE);
+
+    // Every Lexer shares the same (global) Interner
+    Lexer* other = lexer_init("  bar", null);
+    lexer_lex(other);
+    CHECK_EQ(TOKEN_SYMBOL(&other->tokenList, 0), bar);
+    CHECK_EQ(interner_intern(interner_global(), "foo", 3), foo);
+
+    lexer_free(other);
+    lexer_free(lexer);
+}
+
+#define INTERN_TEST_NTHREADS    4
+#define INTERN_TEST_NNAMES      20000
+
+typedef struct InternTestThread {
+    Interner* interner;
+    UInt32 first;                       // name each thread starts interning at
+    Symbol symbols[INTERN_TEST_NNAMES]; // symbol of name `i`
+} InternTestThread;
+
+static void* intern_test_thread(void* arg) {
+    InternTestThread* t = (InternTestThread*)arg;
+    char name[32];
+    for(UInt32 n = 0; n < INTERN_TEST_NNAMES; n++) {
+        UInt32 i = (t->first + n) % INTERN_TEST_NNAMES;
+        UInt32 length = (UInt32)sprintf(name, "name_%u", i * 7919u);
+        t->symbols[i] = interner_intern(t->interner, name, length);
+    }
+    return null;
+}
+
+TEST(lexer, interner_is_thread_safe) {
+    Interner interner;
+    interner_init(&interner);
+
+    InternTestThread* threads = (InternTestThread*)calloc(INTERN_TEST_NTHREADS, sizeof(InternTestThread));
+    cstlThread handles[INTERN_TEST_NTHREADS];
+    for(UInt32 i = 0; i < INTERN_TEST_NTHREADS; i++) {
+        threads[i].interner = &interner;
+        threads[i].first = i * (INTERN_TEST_NNAMES / INTERN_TEST_NTHREADS);
+        REQUIRE_TRUE(thread_create(&handles[i], intern_test_thread, &threads[i]));
+    }
+    for(UInt32 i = 0; i < INTERN_TEST_NTHREADS; i++)
+        thread_join(&handles[i]);
+
+    // Every thread got the same Symbol for the same name, and a different one for every other name
+    CHECK_EQ(interner_size(&interner), INTERN_TEST_NNAMES);
+    char name[32];
+    for(UInt32 i = 0; i < INTERN_TEST_NNAMES; i++) {
+        for(UInt32 t = 1; t < INTERN_TEST_NTHREADS; t++)
+            REQUIRE_EQ(threads[t].symbols[i], threads[0].symbols[i]);
+        sprintf(name, "name_%u", i * 7919u);
+        REQUIRE_STREQ(interner_string(&interner, threads[0].symbols[i], null), name);
+    }
+
+    free(threads);
+    interner_free(&interner);
+}
+
+// Lex `source` (a single numeric literal) and return its token
+static Token lex_number(Lexer** lexer, const char* source) {
+    *lexer = lexer_init(source, null);
+    lexer_lex(*lexer);
+    return lexer_token_at(*lexer, 0);
+}
+
+TEST(lexer, numeric_literals) {
+    struct { const char* source; TokenKind kind; UInt64 value; } integers[] = {
+        {"0", INTEGER, 0},
+        {"7", INTEGER, 7},
+        {"1234567", INTEGER, 1234567},
+        {"12345678", INTEGER, 12345678},
+        {"1_000_000", INTEGER, 1000000},
+        {"000000000000000000000042", INTEGER, 42},
+        {"18446744073709551615", INTEGER, 18446744073709551615ull},
+        {"0x1F", HEX_INT, 0x1F},
+        {"0Xdead_BEEF", HEX_INT, 0xDEADBEEF},
+        {"0xFFFFFFFFFFFFFFFF", HEX_INT, 0xFFFFFFFFFFFFFFFFull},
+        {"0o777", OCT_INT, 0777},
+        {"0b1010_1010", BIN_INT, 0xAA},
+        {"127i8", INT8_LIT, 127},
+        {"128i8", INT8_LIT, 128},
+        {"42i16", INT16_LIT, 42},
+        {"42i32", INT32_LIT, 42},
+        {"42i64", INT64_LIT, 42},
+        {"42u", UINT_LIT, 42},
+        {"255u8", UINT8_LIT, 255},
+        {"0xFFFFu16", UINT16_LIT, 0xFFFF},
+        {"0b1u32", UINT32_LIT, 1},
+        {"1_0u64", UINT64_LIT, 10},
+    };
+    for(UInt32 i = 0; i < sizeof(integers) / sizeof(integers[0]); i++) {
+        Lexer* lexer;
+        Token tok = lex_number(&lexer, integers[i].source);
+        CHECK(tok.kind == integers[i].kind);
+        CHECK_EQ(tok.length, strlen(integers[i].source));
+        const LiteralValue* value = lexer_token_literal(lexer, &tok);
+        REQUIRE(value != null);
+        CHECK_EQ(value->integer, integers[i].value);
+        lexer_free(lexer);
+    }
+
+    struct { const char* source; TokenKind kind; Float64 value; } floats[] = {
+        {"0.5", TOK_FLOAT, 0.5},
+        {".25", TOK_FLOAT, 0.25},
+        {"3.14159", TOK_FLOAT, 3.14159},
+        {"1e10", TOK_FLOAT, 1e10},
+        {"1E-7", TOK_FLOAT, 1E-7},
+        {"2.5e+3", TOK_FLOAT, 2.5e+3},
+        {"6.02214076e23", TOK_FLOAT, 6.02214076e23},
+        {"1_000.000_1", TOK_FLOAT, 1000.0001},
+        {"0.1f32", FLOAT32_LIT, (Float64)0.1f},
+        {"16777217f32", FLOAT32_LIT, (Float64)16777217.0f},
+        {"2.5f64", FLOAT64_LIT, 2.5},
+        {"1f128", FLOAT128_LIT, 1.0},
+        {"2j", IMAG, 2.0},
+        {"1.5j", IMAG, 1.5},
+        {"2.2250738585072014e-308", TOK_FLOAT, 2.2250738585072014e-308},
+        {"1.7976931348623157e308", TOK_FLOAT, 1.7976931348623157e308},
+        {"123456789012345678901234567890", INTEGER, 0}, // Too large for an integer: see below
+    };
+    for(UInt32 i = 0; i < sizeof(floats) / sizeof(floats[0]) - 1; i++) {
+        Lexer* lexer;
+        Token tok = lex_number(&lexer, floats[i].source);
+        CHECK(tok.kind == floats[i].kind);
+        CHECK_EQ(tok.length, strlen(floats[i].source));
+        const LiteralValue* value = lexer_token_literal(lexer, &tok);
+        REQUIRE(value != null);
+        CHECK(value->real == floats[i].value);
+        lexer_free(lexer);
+    }
+
+    // A `.` only starts a fraction if a digit follows it
+    Lexer* lexer = lexer_init("1..5 x.0 2.", null);
+    lexer_lex(lexer);
+    TokenKind kinds[] = { INTEGER, DDOT, INTEGER, IDENTIFIER, TOK_FLOAT, INTEGER, DOT, TOK_EOF };
+    REQUIRE_EQ(lexer->tokenList.size, sizeof(kinds) / sizeof(kinds[0]));
+    for(UInt32 i = 0; i < lexer->tokenList.size; i++)
+        CHECK(TOKEN_KIND(&lexer->tokenList, i) == kinds[i]);
+    Token five = lexer_token_at(lexer, 2);
+    CHECK_EQ(lexer_token_literal(lexer, &five)->integer, 5);
+    Token dot = lexer_token_at(lexer, 1);
+    CHECK(lexer_token_literal(lexer, &dot) == null);
+    lexer_free(lexer);
+
+    // Malformed literals are reported
+    const char* errors[] = { "0x", "0b2", "1i9", "256u8", "129i8", "1.5i32", "18446744073709551616", 
+                             "123456789012345678901234567890", "0xFFFFFFFFFFFFFFFFF", "1e999" };
+    for(UInt32 i = 0; i < sizeof(errors) / sizeof(errors[0]); i++) {
+        jmp_buf recover;
+        Lexer* bad = lexer_init(errors[i], null);
+        bad->recover = &recover;
+        bool failed = setjmp(recover) != 0;
+        if(!failed)
+            lexer_lex(bad);
+        CHECK(failed);
+        lexer_free(bad);
+    }
+}
+
+TEST(lexer, float_literals_round_correctly) {
+    // Compare against the C library on a spread of decimal strings
+    UInt64 seed = 0x9E3779B97F4A7C15ull;
+    char source[64];
+    for(UInt32 n = 0; n < 20000; n++) {
+        seed ^= seed << 13; seed ^= seed >> 7; seed ^= seed << 17;
+        UInt32 ndigits = 1 + (UInt32)(seed % 19);
+        UInt32 point = (UInt32)((seed >> 8) % ndigits);
+        Int32 exp10 = (Int32)((seed >> 16) % 80) - 40;
+        UInt32 length = 0;
+        UInt64 digits = seed >> 20;
+        for(UInt32 i = 0; i < ndigits; i++) {
+            if(i == point && i > 0)
+                source[length++] = '.';
+            source[length++] = (char)('0' + (digits % 10));
+            digits = digits / 10 ? digits / 10 : seed;
+        }
+        length += sprintf(source + length, "e%d", exp10);
+        source[0] = source[0] == '0' ? '1' : source[0];
+
+        Lexer* lexer;
+        Token tok = lex_number(&lexer, source);
+        REQUIRE(tok.kind == TOK_FLOAT);
+        Float64 expected = strtod(source, null);
+        CHECK_EQ(memcmp(&lexer_token_literal(lexer, &tok)->real, &expected, sizeof(Float64)), 0);
+        lexer_free(lexer);
+    }
+}
+
+TEST(lexer, long_float_literals) {
+    // Past MAX_TOKEN_LENGTH a literal is only warned about, and must still convert in full
+    char source[MAX_TOKEN_LENGTH + 64];
+    UInt32 length = (UInt32)sprintf(source, "0.");
+    for(UInt32 i = 0; i < 299; i++)
+        source[length++] = '0';
+    source[length++] = '1';
+    source[length] = nullchar;
+    REQUIRE_GT(length, MAX_TOKEN_LENGTH);
+
+    Lexer* lexer;
+    Token tok = lex_number(&lexer, source);
+    REQUIRE(tok.kind == TOK_FLOAT);
+    Float64 expected = strtod(source, null);
+    CHECK_EQ(memcmp(&lexer_token_literal(lexer, &tok)->real, &expected, sizeof(Float64)), 0);
+    lexer_free(lexer);
+}
+
+// Flip the byte at `offset` in the file `fname`
+static bool flip_byte(const char* fname, long offset) {
+    FILE* file = fopen(fname, "r+b");
+    if(file == null)
+        return false;
+    fseek(file, offset, SEEK_SET);
+    int byte = fgetc(file);
+    fseek(file, offset, SEEK_SET);
+    fputc(byte ^ 0x5A, file);
+    return fclose(file) == 0;
+}
+
+// Overwrite the 4 bytes at `offset` in the cache file `fname` with `value`, and fix up its checksum (the way a 
+// cache file made by a buggy or hostile writer would look)
+static bool forge_cache(const char* fname, long offset, UInt32 value) {
+    cstlFile file;
+    if(file_load(&file, fname) != 0)
+        return false;
+    UInt64 size = file.length;
+    char* bytes = (char*)malloc(size);
+    memcpy(bytes, file.data, size);
+    file_unload(&file);
+
+    endian_store_le32(bytes + offset, value);
+    endian_store_le64(bytes + 24, token_cache_hash(bytes + TOKEN_CACHE_HEADER_SIZE, size - TOKEN_CACHE_HEADER_SIZE));
+    FILE* out = fopen(fname, "wb");
+    bool written = out != null && fwrite(bytes, 1, size, out) == size;
+    if(out != null)
+        written &= fclose(out) == 0;
+    free(bytes);
+    return written;
+}
+
+TEST(lexer, token_cache) {
+    // Known answers (the low half of `hash_bytes128()`, seed 0)
+    CHECK_EQ(token_cache_hash("", 0), 0x409F4F95E93B62DCull);
+    CHECK_EQ(token_cache_hash("abc", 3), 0xF3027DE13BDAF3A6ull);
+
+    const char* lines[] = {
+        "/// docs for f\nfunc f(x) { return x + 0x1F }\n",
+        "/* a comment */ y = @inline z * 2.5e3\n",
+        "s = \"a string\" # trailing\n",
+        "let n = 0b1010 + 077 + foo_bar\n",
+    };
+    char* buffer = (char*)malloc(16 * 1024);
+    UInt32 length = 0;
+    for(UInt32 i = 0; length < 15 * 1024; i++) {
+        length += sprintf(buffer + length, "%s", lines[(i * 3) % 4]);
+    }
+
+    char path[256];
+    REQUIRE_TRUE(token_cache_path(path, sizeof(path), ".", token_cache_hash(buffer, length)));
+    remove(path);
+
+    Lexer* lexer = lexer_init(buffer, null);
+    lexer_lex(lexer);
+
+    // The first time around, the buffer is lexed (and the cache written) - after that, the cache is used
+    Lexer* first = lexer_init(buffer, null);
+    CHECK_FALSE(lexer_lex_cached(first, "."));
+    lexer_free(first);
+    Lexer* cached = lexer_init(buffer, null);
+    REQUIRE_TRUE(lexer_lex_cached(cached, "."));
+
+    TokenStream* expected = &lexer->tokenList;
+    REQUIRE_EQ(cached->tokenList.size, expected->size);
+    for(UInt32 i = 0; i < expected->size; i++) {
+        CHECK(TOKEN_KIND(&cached->tokenList, i) == TOKEN_KIND(expected, i));
+        CHECK_EQ(TOKEN_OFFSET(&cached->tokenList, i), TOKEN_OFFSET(expected, i));
+        CHECK_EQ(TOKEN_LENGTH(&cached->tokenList, i), TOKEN_LENGTH(expected, i));
+        CHECK_EQ(TOKEN_SYMBOL(&cached->tokenList, i), TOKEN_SYMBOL(expected, i));
+    }
+    REQUIRE_EQ(cached->literals.size, lexer->literals.size);
+    for(UInt32 i = 0; i < lexer->literals.size; i++) {
+        CHECK_EQ(cached->literals.offsets[i], lexer->literals.offsets[i]);
+        CHECK_EQ(cached->literals.values[i].integer, lexer->literals.values[i].integer);
+    }
+    CHECK_TRUE(same_comments(&cached->comments, &lexer->comments));
+    // The Lexer is left at the end of the buffer
+    CHECK(lexer_next_token(cached).kind == TOK_EOF);
+    lexer_free(cached);
+
+    TokenStream tokens = {0};
+    LiteralTable literals = {0};
+    CommentTable comments = {0};
+    TokenCacheData data = { &tokens, &literals, &comments, interner_global() };
+    // A different source (or the same hash with a different length) misses
+    CHECK_FALSE(token_cache_load(path, token_cache_hash(buffer, length) ^ 1, length, &data));
+    CHECK_FALSE(token_cache_load(path, token_cache_hash(buffer, length), length - 1, &data));
+    CHECK_TRUE(token_cache_load(path, token_cache_hash(buffer, length), length, &data));
+
+    // So does a damaged file, or one from another version
+    REQUIRE_TRUE(flip_byte(path, TOKEN_CACHE_HEADER_SIZE + 3));
+    CHECK_FALSE(token_cache_load(path, token_cache_hash(buffer, length), length, &data));
+    REQUIRE_TRUE(flip_byte(path, TOKEN_CACHE_HEADER_SIZE + 3));
+    CHECK_TRUE(token_cache_load(path, token_cache_hash(buffer, length), length, &data));
+    REQUIRE_TRUE(flip_byte(path, 8));
+    CHECK_FALSE(token_cache_load(path, token_cache_hash(buffer, length), length, &data));
+    Lexer* stale = lexer_init(buffer, null);
+    CHECK_FALSE(lexer_lex_cached(stale, "."));
+    CHECK_EQ(stale->tokenList.size, expected->size);
+    lexer_free(stale);
+    // ... which is replaced by a good one
+    CHECK_TRUE(token_cache_load(path, token_cache_hash(buffer, length), length, &data));
+
+    // A file with the right checksum that points outside of the source (or of its own tables) misses, too
+    UInt32 ntokens = expected->size;
+    long token_offsets = TOKEN_CACHE_HEADER_SIZE + (long)((ntokens + 7) & ~7u);
+    long token_lengths = token_offsets + (long)(((UInt64)ntokens * 4 + 7) & ~(UInt64)7);
+    struct { long offset; UInt32 value; } forgeries[] = {
+        { TOKEN_CACHE_HEADER_SIZE, TOK_COUNT },                 // a kind that doesn't exist (in the first 4 kinds)
+        { token_offsets, length },                              // a token past the end of the source
+        { token_lengths + 4, length },                          // a token running past it
+    };
+    for(UInt32 f = 0; f < sizeof(forgeries) / sizeof(forgeries[0]); f++) {
+        REQUIRE_TRUE(forge_cache(path, forgeries[f].offset, forgeries[f].value));
+        CHECK_FALSE(token_cache_load(path, token_cache_hash(buffer, length), length, &data));
+        Lexer* forged = lexer_init(buffer, null);
+        CHECK_FALSE(lexer_lex_cached(forged, "."));
+        lexer_free(forged);
+        CHECK_TRUE(token_cache_load(path, token_cache_hash(buffer, length), length, &data));
+    }
+
+    token_stream_free(&tokens);
+    literal_table_free(&literals);
+    comment_table_free(&comments);
+    remove(path);
+    CHECK_FALSE(token_cache_load(path, token_cache_hash(buffer, length), length, &data));
+    lexer_free(lexer);
+    free(buffer);
+}
+
+TEST(lexer, utf8_validation) {
+    // Each is invalid at the given offset
+    struct { const char* value; UInt32 invalid_at; } cases[] = {
+        { "ok \xC3\xA9 \xE2\x82\xAC \xF0\x9F\x98\x80", UInt32_MAX }, 
+        { "a\x80", 1 },                 // stray continuation
+        { "\xC0\x80", 0 },              // overlong NUL
+        { "\xE0\x9F\xBF", 0 },          // overlong 3-byte
+        { "\xF0\x8F\xBF\xBF", 0 },      // overlong 4-byte
+        { "x\xED\xA0\x80", 1 },         // surrogate
+        { "\xF4\x90\x80\x80", 0 },      // > U+10FFFF
+        { "\xF5\x80\x80\x80", 0 }, 
+        { "ab\xE2\x82", 2 },            // cut short by the end
+        { "\xC3(", 0 }, 
+        { "\xFF", 0 }, 
+    };
+    char buffer[256];
+    for(UInt32 i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        UInt32 length = (UInt32)strlen(cases[i].value);
+        UInt32 expected = cases[i].invalid_at == UInt32_MAX ? length : cases[i].invalid_at;
+        CHECK_EQ(utf8_validate(cases[i].value, cases[i].value + length) - cases[i].value, expected);
+        CHECK_EQ(utf8_validate_scalar(cases[i].value, cases[i].value + length) - cases[i].value, expected);
+
+        // Again, after enough valid text to go through the vector loop (with the error in a later block)
+        UInt32 prefix = 0;
+        while(prefix < 150)
+            prefix += sprintf(buffer + prefix, "%s", (prefix % 3) ? "\xE2\x82\xAC" : "id_");
+        memcpy(buffer + prefix, cases[i].value, length);
+        CHECK_EQ(utf8_validate(buffer, buffer + prefix + length) - buffer, prefix + expected);
+    }
+
+    // A sequence is either whole or caught, wherever it falls (this also covers the seams between blocks)
+    memset(buffer, 'a', sizeof(buffer));
+    for(UInt32 at = 60; at < 70; at++) {
+        // U+1F7C0, cut short after 1, 2 and 3 bytes
+        const char* sequence = "\xF0\x9F\x9F\x80";
+        for(UInt32 n = 1; n < 4; n++) {
+            memcpy(buffer + at, sequence, n);
+            CHECK_EQ(utf8_validate(buffer, buffer + at + n) - buffer, at);
+            CHECK_EQ(utf8_validate(buffer, buffer + at + n + 1) - buffer, at);
+        }
+        memcpy(buffer + at, sequence, 4);
+        CHECK_EQ(utf8_validate(buffer, buffer + at + 4) - buffer, at + 4);
+        CHECK_EQ(utf8_validate(buffer, buffer + sizeof(buffer)) - buffer, sizeof(buffer));
+        memset(buffer, 'a', sizeof(buffer));
+    }
+
+    // The Lexer refuses invalid UTF-8, wherever it is
+    const char* invalid[] = { "s = \"caf\xE9\"", "# \xC3\n", "x = 1 /* \xED\xBF\xBF */" };
+    for(UInt32 i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+        jmp_buf recover;
+        Lexer* bad = lexer_init(invalid[i], null);
+        bad->recover = &recover;
+        bool failed = setjmp(recover) != 0;
+        if(!failed)
+            lexer_lex(bad);
+        CHECK(failed);
+        lexer_free(bad);
+    }
+}
+
+TEST(lexer, unicode_identifiers) {
+    CHECK_TRUE(unicode_is_xid_start(0xE9));        // é
+    CHECK_TRUE(unicode_is_xid_start(0x540D));      // 名
+    CHECK_FALSE(unicode_is_xid_start(0x0663));     // ٣ (a digit)
+    CHECK_TRUE(unicode_is_xid_continue(0x0663));
+    CHECK_FALSE(unicode_is_xid_start(0x20AC));     // €
+    CHECK_FALSE(unicode_is_xid_continue(0x20AC));
+    CHECK_TRUE(unicode_is_xid_continue(0xE0100));  // a variation selector
+    CHECK_FALSE(unicode_is_xid_continue(0x110000));
+
+    const char* source = "const café = 名前 + x٣ # ça\ns = \"€\"";
+    Lexer* lexer = lexer_init(source, null);
+    lexer_lex(lexer);
+    TokenKind kinds[] = { CONST, IDENTIFIER, EQUALS, IDENTIFIER, PLUS, IDENTIFIER, IDENTIFIER, EQUALS, STRING, TOK_EOF };
+    const char* values[] = { "const", "café", "=", "名前", "+", "x٣", "s", "=", "€", "EOF" };
+    REQUIRE_EQ(lexer->tokenList.size, sizeof(kinds) / sizeof(kinds[0]));
+    for(UInt32 i = 0; i < lexer->tokenList.size; i++) {
+        Token token = lexer_token_at(lexer, i);
+        CHECK(token.kind == kinds[i]);
+        CHECK_STREQ(lexer_token_value(lexer, &token), values[i]);
+    }
+    UInt32 length;
+    CHECK_STREQ(interner_string(lexer->interner, TOKEN_SYMBOL(&lexer->tokenList, 3), &length), "名前");
+    lexer_free(lexer);
+
+    // Characters that can't begin (or be part of) an identifier are reported
+    const char* errors[] = { "x = €", "a٣ = ٣" };
+    for(UInt32 i = 0; i < sizeof(errors) / sizeof(errors[0]); i++) {
+        jmp_buf recover;
+        Lexer* bad = lexer_init(errors[i], null);
+        bad->recover = &recover;
+        bool failed = setjmp(recover) != 0;
+        if(!failed)
+            lexer_lex(bad);
+        CHECK(failed);
+        lexer_free(bad);
+    }
+
+    // Edits that would split a character are refused
+    lexer = lexer_init("x = café", null);
+    lexer_lex(lexer);
+    jmp_buf recover;
+    lexer->recover = &recover;
+    bool failed = setjmp(recover) != 0;
+    if(!failed)
+        lexer_relex(lexer, 8, 1, "", 0);
+    CHECK(failed);
+    lexer_free(lexer);
+}
+
+TEST(lexer, rune_literals) {
+    const char* source = "'a' '\\n' 'é' '名' '\\u{1F600}' '\\x41' '\\'' '😀'";
+    Rune expected[] = { 'a', '\n', 0xE9, 0x540D, 0x1F600, 0x41, '\'', 0x1F600 };
+    Lexer* lexer = lexer_init(source, null);
+    lexer_lex(lexer);
+    REQUIRE_EQ(lexer->tokenList.size, sizeof(expected) / sizeof(expected[0]) + 1);
+    for(UInt32 i = 0; i < sizeof(expected) / sizeof(expected[0]); i++) {
+        Token token = lexer_token_at(lexer, i);
+        CHECK(token.kind == RUNE);
+        CHECK_EQ(lexer_token_literal(lexer, &token)->integer, (UInt64)expected[i]);
+    }
+    Token token = lexer_token_at(lexer, 2);
+    CHECK_STREQ(lexer_token_value(lexer, &token), "é");
+    lexer_free(lexer);
+
+    const char* errors[] = { "''", "'ab'", "'a", "'\\q'", "'\\u{D800}'", "'\\u{110000}'", "'\\x4'", "'\\u41'" };
+    for(UInt32 i = 0; i < sizeof(errors) / sizeof(errors[0]); i++) {
+        jmp_buf recover;
+        Lexer* bad = lexer_init(errors[i], null);
+        bad->recover = &recover;
+        bool failed = setjmp(recover) != 0;
+        if(!failed)
+            lexer_lex(bad);
+        CHECK(failed);
+        lexer_free(bad);
+    }
+}
+
+TEST(lexer, phase_profiler) {
+    // The monotonic clock never goes back
+    UInt64 before = clock_now_ns();
+    CHECK_GE(clock_now_ns(), before);
+    double start = now();
+    CHECK_GE(duration(start, now()), 0.0);
+
+    // a.hzl and b.hzl take a millisecond or more, so that they're among the slowest files listed
+    profiler_enable(true);
+    PROFILER_SCOPE(PROFILER_READ, "a.hzl") {
+        Lexer* lexer = lexer_init("x = y + 1\n", "a.hzl");
+        lexer_lex(lexer);
+        lexer_free(lexer);
+        for(UInt64 spin = clock_now_ns(); clock_now_ns() - spin < 1000000;)
+            ;
+    }
+    for(int i = 0; i < 3; i++) {
+        profiler_begin("outer", "b.hzl");
+        profiler_begin("inner", null);
+        for(UInt64 spin = clock_now_ns(); clock_now_ns() - spin < 1000000;)
+            ;
+        profiler_end();
+        profiler_end();
+    }
+    // Phases are told apart by the contents of their names: twice as many runs, on as many files (enough to grow 
+    // the index of the nodes a few times, and for a report quadratic in them to take seconds), named by different 
+    // copies of the same strings
+    static char names[2][20000][16];
+    for(int copy = 0; copy < 2; copy++) {
+        for(int i = 0; i < 20000; i++) {
+            snprintf(names[copy][i], sizeof(names[copy][i]), "f%05d.hzl", i);
+            profiler_begin("many", names[copy][i]);
+            profiler_end();
+        }
+    }
+    // An unmatched end is ignored
+    profiler_end();
+    profiler_enable(false);
+    // Not recorded
+    profiler_begin("disabled", null);
+    profiler_end();
+
+    FILE* out = tmpfile();
+    REQUIRE(out != null);
+    UInt64 report_start = clock_now_ns();
+    profiler_report(out);
+    // Milliseconds, but leave plenty of room for slow (sanitized) builds
+    CHECK_LT(clock_now_ns() - report_start, 1000000000ull);
+    rewind(out);
+    char report[4096];
+    size_t length = fread(report, 1, sizeof(report) - 1, out);
+    report[length] = nullchar;
+    fclose(out);
+
+    // Nested phases are indented under their parent, with the no. of times they ran
+    CHECK(strstr(report, "\n read ") != null);
+    CHECK(strstr(report, "\n   lex ") != null);
+    CHECK(strstr(report, "\n outer ") != null);
+    const char* inner = strstr(report, "\n   inner ");
+    REQUIRE(inner != null);
+    CHECK(strstr(inner, " 3\n") != null);
+    CHECK(strstr(report, "disabled") == null);
+    const char* many = strstr(report, "\n many ");
+    REQUIRE(many != null);
+    CHECK(strstr(many, " 40000\n") != null);
+    // ... and the files they ran on
+    CHECK(strstr(report, "\n a.hzl ") != null);
+    const char* file = strstr(report, "\n b.hzl ");
+    REQUIRE(file != null);
+    // ... with the phases that ran on them
+    const char* eol = strchr(file + 1, '\n');
+    REQUIRE(eol != null);
+    const char* phase = strstr(file, " inner ");
+    CHECK(phase != null && phase < eol);
+
+    profiler_free();
+}
+
+TEST(lexer, allocation_accounting) {
+    cstlCountingAllocator counter;
+    allocator_counting_init(&counter, null);
+
+    // Core containers: the vector (and its data), growing it, and freeing it all
+    cstlVector* vec = vec_new_with_allocator(sizeof(int), 4, &counter.base);
+    REQUIRE(vec != null);
+    CHECK_EQ(counter.nallocs, 2);
+    CHECK_EQ(counter.live, sizeof(cstlVector) + 4 * sizeof(int));
+    for(int i = 0; i < 100; i++)
+        vec_push(vec, &i);
+    CHECK_GT(counter.nallocs, 2);
+    CHECK_EQ(counter.live, sizeof(cstlVector) + vec_cap(vec) * sizeof(int));
+    vec_delete(vec);
+    CHECK_EQ(counter.live, 0);
+    CHECK_EQ(counter.nfrees, 2);
+
+    cstlBuffer* buffer = buff_create(&counter.base, (char*)"hello", 5, true);
+    buff_splice(buffer, 5, 0, ", world", 7);
+    CHECK(strcmp(buffer->data, "hello, world") == 0);
+    buffer->free(buffer);
+    CHECK_EQ(counter.live, 0);
+    CHECK_GE(counter.peak, sizeof(cstlBuffer) + 12 + CSTL_BUFFER_PADDING);
+
+    // The Lexer (and everything it owns) allocates from the compiler's allocator. The global Interner lives on, so 
+    // it mustn't be created while counting.
+    interner_global();
+    allocator_counting_init(&counter, null);
+    compiler_set_allocator(&counter.base);
+    Lexer* lexer = lexer_init("let x = 'a' + 1.5 // done\nx", "c.hzl");
+    lexer_lex(lexer);
+    Token token = lexer_token_at(lexer, 1);
+    CHECK(strcmp(lexer_token_value(lexer, &token), "x") == 0);
+    SourceLocation location = lexer_location(lexer, lexer->tokenList.offsets[lexer->tokenList.size - 2]);
+    CHECK_EQ(location.lineno, 2);
+    CHECK_GT(counter.nallocs, 0);
+    CHECK_GT(counter.live, sizeof(Lexer));
+    lexer_free(lexer);
+    CHECK_EQ(counter.live, 0);
+
+    // The profiler charges allocations to the phase that made them
+    compiler_set_allocator(profiler_allocator());
+    UInt64 held = profiler_allocator_totals()->live;
+    profiler_enable(true);
+    PROFILER_SCOPE(PROFILER_LEX, "c.hzl") {
+        lexer = lexer_init("let y = 2", "c.hzl");
+        lexer_lex(lexer);
+        lexer_free(lexer);
+    }
+    profiler_enable(false);
+    compiler_set_allocator(null);
+    CHECK_EQ(profiler_allocator_totals()->live, held);
+
+    FILE* out = tmpfile();
+    REQUIRE(out != null);
+    profiler_report(out);
+    rewind(out);
+    char report[8192];
+    size_t length = fread(report, 1, sizeof(report) - 1, out);
+    report[length] = nullchar;
+    fclose(out);
+
+    const char* memory = strstr(report, "Memory report");
+    REQUIRE(memory != null);
+    CHECK(strstr(memory, "\n lex ") != null);
+    CHECK(strstr(memory, "lexer.c:") != null);
+    CHECK(strstr(memory, "outside any phase") == null);
+
+    profiler_free();
+}
+
+TEST(lexer, reserved_token_stream) {
+    // A reserved token stream grows in place ...
+    TokenStream stream;
+    token_stream_init_reserved(&stream, "file.hzl", 100000);
+    REQUIRE(stream.reserved != null);
+    bool moved = false;
+    token_stream_push(&stream, IDENTIFIER, 0, 1, SYMBOL_NONE);
+    UInt8* kinds = stream.kinds;
+    for(UInt32 i = 1; i < 100000; i++)
+        moved |= token_stream_push(&stream, (i & 1) ? EQUALS : IDENTIFIER, i, 1, SYMBOL_NONE);
+    CHECK_FALSE(moved);
+    CHECK(stream.kinds == kinds);
+    CHECK_EQ(stream.size, 100000);
+
+    // ... until it outgrows its reservation, and moves to the heap (once)
+    CHECK_TRUE(token_stream_push(&stream, TOK_EOF, 100000, 0, SYMBOL_NONE));
+    CHECK(stream.reserved == null);
+    CHECK_EQ(stream.size, 100001);
+    CHECK(TOKEN_KIND(&stream, 99999) == EQUALS);
+    CHECK_EQ(TOKEN_OFFSET(&stream, 99999), 99999);
+    CHECK(TOKEN_KIND(&stream, 100000) == TOK_EOF);
+    token_stream_free(&stream);
+
+    // Large files are lexed into a reserved stream, with the same tokens as a heap one
+    const char* line = "func f(x) { return x + 0x1F } # comment\n";
+    UInt64 length = 0;
+    char* buffer = (char*)malloc(TOKENLIST_RESERVED_MIN_SIZE + 64);
+    while(length < TOKENLIST_RESERVED_MIN_SIZE)
+        length += sprintf(buffer + length, "%s", line);
+
+    Lexer* reserved = lexer_init(buffer, null);
+    CHECK(reserved->tokenList.reserved != null);
+    lexer_lex(reserved);
+    Lexer* heap = lexer_init(buffer, null);
+    token_stream_free(&heap->tokenList);
+    token_stream_init(&heap->tokenList, "", 16);
+    lexer_lex(heap);
+
+    REQUIRE_EQ(reserved->tokenList.size, heap->tokenList.size);
+    bool same = true;
+    for(UInt32 i = 0; i < heap->tokenList.size; i++) {
+        same &= TOKEN_KIND(&reserved->tokenList, i) == TOKEN_KIND(&heap->tokenList, i);
+        same &= TOKEN_OFFSET(&reserved->tokenList, i) == TOKEN_OFFSET(&heap->tokenList, i);
+        same &= TOKEN_LENGTH(&reserved->tokenList, i) == TOKEN_LENGTH(&heap->tokenList, i);
+        same &= TOKEN_SYMBOL(&reserved->tokenList, i) == TOKEN_SYMBOL(&heap->tokenList, i);
+    }
+    CHECK_TRUE(same);
+    CHECK_LT(reserved->nallocs, heap->nallocs);
+    lexer_free(reserved);
+    lexer_free(heap);
+    free(buffer);
+}
+
+TEST(lexer, scratch_arenas) {
+    // Every thread has two scratch arenas
+    cstlArena* scratch = compiler_scratch(null);
+    CHECK(compiler_scratch(scratch) != scratch);
+    CHECK(compiler_scratch(compiler_scratch(scratch)) == scratch);
+    cstlArenaMark mark = arena_mark(scratch);
+    arena_alloc(scratch, 1000);
+    arena_restore(scratch, mark);
+    CHECK_EQ(scratch->used, mark.used);
+    compiler_scratch_free();
+    CHECK_EQ(scratch->nchunks, 0);
+}
@@ -0,0 +1,96 @@
+#include <HazelInternalTests/core/hcore.h>
+#include <tau/tau.h>
+TAU_MAIN()
+
+#define TEST_HASH_DATA_SIZE     5000
+
+// The input the hashes are tested on (`data[i]` depends on `i` only)
+static const UInt8* test_hash_data(void) {
+    static UInt8 data[TEST_HASH_DATA_SIZE];
+    for(UInt32 i = 0; i < TEST_HASH_DATA_SIZE; i++)
+        data[i] = (UInt8)(i * 131 + 7);
+    return data;
+}
+
+TEST(hash, known_answers) {
+    const UInt8* data = test_hash_data();
+
+    // Known answers: these are the same on every platform and instruction set (see hazel/core/hash.h). If they 
+    // change, so do the names of token cache files - bump TOKEN_CACHE_VERSION.
+    static const UInt64 answers64[][3] = {
+        // length, seed 0, seed 42
+        {  0, 0xD7DB534B84D52F44ull, 0xF5A9616CA1178BEBull},
+        {  1, 0x1C87120D6C056C22ull, 0x708EE5DFB6474AC8ull},
+        {  3, 0x942158808052834Dull, 0x2FC7671FD63514BCull},
+        {  4, 0x11B3FF54D4242FB5ull, 0x7950A921A9F12EF6ull},
+        {  8, 0x56EAA7C31B4A0DD2ull, 0xDCAB702370B26713ull},
+        { 16, 0x0C1F01025583C30Aull, 0x19E64822160C6B27ull},
+        { 17, 0x26C45F94F547A757ull, 0x7C05AC0D3753B90Bull},
+        { 48, 0x06424CBDCF8068BAull, 0x93F20B5720B0F615ull},
+        { 49, 0x8DE6DF0EA6E8364Cull, 0x6109C365F8EAEE55ull},
+        {100, 0x99AEBC2A0EC32014ull, 0x0C7A1F1C39B74C2Full},
+    };
+    for(UInt32 i = 0; i < sizeof(answers64) / sizeof(answers64[0]); i++) {
+        CHECK_EQ(hash_bytes64(data, answers64[i][0], 0), answers64[i][1]);
+        CHECK_EQ(hash_bytes64(data, answers64[i][0], 42), answers64[i][2]);
+    }
+    static const UInt64 answers128[][4] = {
+        // length, low and high half (seed 0), low half (seed 42)
+        {   0, 0x409F4F95E93B62DCull, 0xB1D59B4ACBCF77F2ull, 0x3E40782D48FF4DB9ull},
+        {   3, 0xF009D206CCE8F94Cull, 0x827B482ED75F10FCull, 0x6D15319FA1DF15CBull},
+        {  64, 0xA904E7D1B328E0CCull, 0xE31F8BDFA1075D44ull, 0xE231997D8626D344ull},
+        {1000, 0x7D3D6D3E480C6576ull, 0x6DFB903202936643ull, 0xC7D8B09F26C23482ull},
+        {5000, 0x0F0D1899658BAF68ull, 0xA37924D7528557AFull, 0x42B00AD0F22A1150ull},
+    };
+    for(UInt32 i = 0; i < sizeof(answers128) / sizeof(answers128[0]); i++) {
+        cstlHash128 hash = hash_bytes128(data, answers128[i][0], 0);
+        CHECK_EQ(hash.low, answers128[i][1]);
+        CHECK_EQ(hash.high, answers128[i][2]);
+        CHECK_EQ(hash_bytes128(data, answers128[i][0], 42).low, answers128[i][3]);
+    }
+    CHECK_EQ(map_hash_u64(12345), hash_u64(12345));
+}
+
+TEST(hash, distinct) {
+    const UInt8* data = test_hash_data();
+
+    // Every length hashes differently, and so does every single flipped bit (of short keys)
+    bool distinct = true;
+    for(UInt32 length = 1; length <= 64; length++) {
+        distinct &= hash_bytes64(data, length, 0) != hash_bytes64(data, length - 1, 0);
+        distinct &= hash_bytes128(data, length, 0).low != hash_bytes128(data, length - 1, 0).low;
+    }
+    UInt8 key[32];
+    memcpy(key, data, sizeof(key));
+    UInt64 original = hash_bytes64(key, sizeof(key), 0);
+    for(UInt32 bit = 0; bit < sizeof(key) * 8; bit++) {
+        key[bit / 8] ^= (UInt8)(1 << (bit % 8));
+        distinct &= hash_bytes64(key, sizeof(key), 0) != original;
+        key[bit / 8] ^= (UInt8)(1 << (bit % 8));
+    }
+    CHECK_TRUE(distinct);
+}
+
+TEST(hash, streaming) {
+    const UInt8* data = test_hash_data();
+
+    // Hashing in pieces (of any size) gives the same hash as hashing in one go
+    bool same = true;
+    UInt64 rng = 0x9E3779B97F4A7C15ull;
+    for(UInt32 round = 0; round < 50; round++) {
+        rng = rng * 6364136223846793005ull + 1442695040888963407ull;
+        UInt64 length = (rng >> 33) % TEST_HASH_DATA_SIZE;
+        cstlHashState state;
+        hash_init(&state, round);
+        for(UInt64 offset = 0; offset < length; ) {
+            rng = rng * 6364136223846793005ull + 1442695040888963407ull;
+            UInt64 piece = CSTL_MIN((rng >> 33) % 200, length - offset);
+            hash_update(&state, data + offset, piece);
+            offset += piece;
+        }
+        cstlHash128 streamed = hash_final(&state);
+        cstlHash128 whole = hash_bytes128(data, length, round);
+        same &= streamed.low == whole.low && streamed.high == whole.high;
+    }
+    CHECK_TRUE(same);
+}
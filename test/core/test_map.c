@@ -0,0 +1,82 @@
+#include <HazelInternalTests/core/hcore.h>
+#include <tau/tau.h>
+TAU_MAIN()
+
+CSTL_MAP(TestMap, test_map, UInt64, UInt64, map_hash_u64, CSTL_MAP_EQUALS)
+// Every key collides (so that runs wrap around the end of the slots)
+#define test_collide(key)   ((UInt64)0x7F << 7)
+CSTL_MAP(TestCollidingMap, test_colliding, UInt64, UInt64, test_collide, CSTL_MAP_EQUALS)
+
+TEST(map, hash_map) {
+    cstlCountingAllocator counter;
+    allocator_counting_init(&counter, null);
+    TestMap map;
+    test_map_init(&map, &counter.base);
+    CHECK(test_map_find(&map, 1) == null);
+    CHECK_FALSE(test_map_remove(&map, 1));
+
+    // Inserts, lookups and removals agree with a plain array
+    enum { N = 20000 };
+    static UInt64 expected[N];
+    memset(expected, 0, sizeof(expected));
+    UInt64 rng = 0x9E3779B97F4A7C15ull;
+    UInt64 size = 0;
+    bool same = true;
+    for(UInt32 op = 0; op < 200000; op++) {
+        rng = rng * 6364136223846793005ull + 1442695040888963407ull;
+        UInt64 key = (rng >> 33) % N;
+        if((rng >> 20) % 3 == 0) {
+            same &= test_map_remove(&map, key) == (expected[key] != 0);
+            size -= expected[key] != 0;
+            expected[key] = 0;
+        } else {
+            same &= test_map_put(&map, key, op + 1) == (expected[key] == 0);
+            size += expected[key] == 0;
+            expected[key] = op + 1;
+        }
+    }
+    CHECK_TRUE(same);
+    CHECK_EQ(test_map_size(&map), size);
+    for(UInt64 key = 0; key < N; key++) {
+        UInt64* value = test_map_find(&map, key);
+        same &= expected[key] ? (value != null && *value == expected[key]) : value == null;
+    }
+    CHECK_TRUE(same);
+    CHECK_LE(map.size, CSTL_MAP_MAX_LOAD(map.capacity));
+
+    // Iteration visits every entry once
+    UInt64 visited = 0;
+    for(UInt64 i = test_map_next(&map, 0); i < map.capacity; i = test_map_next(&map, i + 1)) {
+        same &= expected[map.entries[i].key] == map.entries[i].value;
+        visited++;
+    }
+    CHECK_TRUE(same);
+    CHECK_EQ(visited, size);
+
+    bool inserted;
+    *test_map_find_or_insert(&map, N + 1, &inserted) = 7;
+    CHECK_TRUE(inserted);
+    CHECK_EQ(*test_map_find_or_insert(&map, N + 1, &inserted), 7);
+    CHECK_FALSE(inserted);
+    test_map_clear(&map);
+    CHECK(test_map_is_empty(&map));
+    CHECK(test_map_find(&map, N + 1) == null);
+    test_map_free(&map);
+    CHECK_EQ(counter.live, 0);
+
+    // Removing from the middle of a run (that wraps around) keeps the rest of it reachable
+    TestCollidingMap colliding = {0};
+    for(UInt64 key = 0; key < 12; key++)
+        test_colliding_put(&colliding, key, key * 10);
+    CHECK_TRUE(test_colliding_remove(&colliding, 3));
+    CHECK_TRUE(test_colliding_remove(&colliding, 0));
+    CHECK_TRUE(test_colliding_remove(&colliding, 11));
+    CHECK_FALSE(test_colliding_remove(&colliding, 3));
+    for(UInt64 key = 0; key < 12; key++) {
+        UInt64* value = test_colliding_find(&colliding, key);
+        same &= (key == 0 || key == 3 || key == 11) ? value == null : (value != null && *value == key * 10);
+    }
+    CHECK_TRUE(same);
+    CHECK_EQ(test_colliding_size(&colliding), 9);
+    test_colliding_free(&colliding);
+}
@@ -0,0 +1,49 @@
+#include <HazelInternalTests/core/hcore.h>
+#include <tau/tau.h>
+TAU_MAIN()
+
+TEST(memory, arena) {
+    cstlCountingAllocator counter;
+    allocator_counting_init(&counter, null);
+    cstlArena arena;
+    arena_init(&arena, &counter.base, 1024);
+    CHECK_EQ(counter.nallocs, 0);
+
+    // Allocations are aligned, and bumped out of one chunk
+    char* a = (char*)arena_alloc_aligned(&arena, 3, 1);
+    UInt64* b = (UInt64*)arena_alloc(&arena, sizeof(UInt64));
+    char* c = arena_strndup(&arena, "hello world", 5);
+    CHECK_EQ((UIntptr)b % CSTL_ARENA_ALIGNMENT, 0);
+    CHECK(a < (char*)b);
+    CHECK_STREQ(c, "hello");
+    CHECK_EQ(arena.nchunks, 1);
+    CHECK_EQ(counter.nallocs, 1);
+    CHECK_GE(arena.used, 3 + sizeof(UInt64) + 6);
+
+    // Going back to a mark gives back everything allocated since (and the chunks that came with it)
+    cstlArenaMark mark = arena_mark(&arena);
+    UInt64 used = arena.used;
+    for(int i = 0; i < 100; i++)
+        arena_alloc(&arena, 100);
+    char* large = (char*)arena_alloc_zeroed(&arena, 4096);
+    CHECK_EQ(large[4095], 0);
+    CHECK_GT(arena.nchunks, 5);
+    CHECK_GE(arena.peak, used + 100 * 100 + 4096);
+    arena_restore(&arena, mark);
+    CHECK_EQ(arena.nchunks, 1);
+    CHECK_EQ(arena.used, used);
+    CHECK(arena_alloc_aligned(&arena, 1, 1) == c + 6);
+    CHECK_STREQ(c, "hello");
+
+    // A reset holds on to a chunk; a free gives everything back
+    UInt64 nallocs = counter.nallocs;
+    arena_reset(&arena);
+    CHECK_EQ(arena.used, 0);
+    CHECK_EQ(arena.nchunks, 1);
+    arena_alloc(&arena, 16);
+    CHECK_EQ(counter.nallocs, nallocs);
+    arena_free(&arena);
+    CHECK_EQ(arena.nchunks, 0);
+    CHECK_EQ(arena.capacity, 0);
+    CHECK_EQ(counter.live, 0);
+}
@@ -0,0 +1,99 @@
+#include <HazelInternalTests/core/hcore.h>
+#include <tau/tau.h>
+TAU_MAIN()
+
+typedef struct TestPoint {
+    UInt32 x;
+    UInt32 y;
+} TestPoint;
+
+CSTL_VECTOR(TestPointVector, test_points, TestPoint)
+CSTL_VECTOR(TestPointerVector, test_pointers, void*)
+#define TEST_SMALL_VECTOR_N     4
+CSTL_SMALL_VECTOR(TestSmallVector, test_small, void*, TEST_SMALL_VECTOR_N)
+
+TEST(vector, typed_vector) {
+    TestPointVector points = {0};
+    CHECK(test_points_is_empty(&points));
+    for(UInt32 i = 0; i < 1000; i++) {
+        TestPoint point = { i, 2 * i };
+        test_points_push(&points, point);
+    }
+    CHECK_EQ(test_points_size(&points), 1000);
+    CHECK_GE(points.capacity, 1000);
+    CHECK_EQ(test_points_at(&points, 123)->y, 246);
+    CHECK_EQ(test_points_last(&points)->x, 999);
+
+    UInt64 sum = 0;
+    for(TestPoint* it = test_points_begin(&points); it != test_points_end(&points); it++)
+        sum += it->x;
+    CHECK_EQ(sum, 999 * 1000 / 2);
+
+    CHECK_EQ(test_points_pop(&points).y, 2 * 999);
+    CHECK_EQ(test_points_size(&points), 999);
+    test_points_clear(&points);
+    CHECK(test_points_is_empty(&points));
+    test_points_free(&points);
+
+    // Allocating from an allocator, and growing by a factor of 1.5 (or 2, while it's small) at a time
+    cstlCountingAllocator counter;
+    allocator_counting_init(&counter, null);
+    TestPointerVector pointers;
+    test_pointers_init(&pointers, &counter.base);
+    test_pointers_reserve(&pointers, 4);
+    for(UInt64 i = 0; i < 100000; i++)
+        test_pointers_push(&pointers, (void*)(uintptr_t)(i + 1));
+    CHECK_EQ(*test_pointers_at(&pointers, 99999), (void*)(uintptr_t)100000);
+    CHECK_LT(counter.nallocs, 30);
+    CHECK_EQ(counter.live, pointers.capacity * sizeof(void*));
+    test_pointers_free(&pointers);
+    CHECK_EQ(counter.live, 0);
+
+    // The last element of a `cstlVector`, whatever the size of its elements
+    cstlVector* vec = vec_new(sizeof(UInt8), 16);
+    for(UInt8 i = 0; i < 10; i++)
+        vec_push(vec, &i);
+    CHECK_EQ(*(UInt8*)vec_end(vec), 9);
+    CHECK(vec_at(vec, 10) == null);
+    vec_delete(vec);
+}
+
+TEST(vector, small_vector) {
+    cstlCountingAllocator counter;
+    allocator_counting_init(&counter, null);
+
+    // A short vector never allocates
+    TestSmallVector small;
+    test_small_init(&small, &counter.base);
+    for(UInt64 i = 0; i < TEST_SMALL_VECTOR_N; i++)
+        test_small_push(&small, (void*)(uintptr_t)(i + 1));
+    CHECK_EQ(counter.nallocs, 0);
+    CHECK_EQ(test_small_size(&small), TEST_SMALL_VECTOR_N);
+    CHECK_EQ(*test_small_last(&small), (void*)(uintptr_t)TEST_SMALL_VECTOR_N);
+    CHECK_LE(sizeof(TestSmallVector), 16 + TEST_SMALL_VECTOR_N * sizeof(void*));
+
+    // ... and can be moved around
+    TestSmallVector moved = small;
+    CHECK_EQ(*test_small_at(&moved, 0), (void*)(uintptr_t)1);
+
+    // A longer one spills its elements to the allocator
+    for(UInt64 i = TEST_SMALL_VECTOR_N; i < 1000; i++)
+        test_small_push(&small, (void*)(uintptr_t)(i + 1));
+    CHECK_GT(counter.nallocs, 0);
+    CHECK_LT(counter.nallocs, 20);
+    UInt64 sum = 0;
+    for(void** it = test_small_begin(&small); it != test_small_end(&small); it++)
+        sum += (UInt64)(uintptr_t)*it;
+    CHECK_EQ(sum, 1000 * 1001 / 2);
+    CHECK_EQ((UInt64)(uintptr_t)test_small_pop(&small), 1000);
+    test_small_free(&small);
+    CHECK_EQ(counter.live, 0);
+    CHECK(test_small_is_empty(&small));
+
+    // A zeroed vector is empty (and allocates from the heap)
+    TestSmallVector zeroed = {0};
+    for(UInt64 i = 0; i < 10; i++)
+        test_small_push(&zeroed, null);
+    CHECK_EQ(test_small_size(&zeroed), 10);
+    test_small_free(&zeroed);
+}
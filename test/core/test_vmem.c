@@ -0,0 +1,34 @@
+#include <HazelInternalTests/core/hcore.h>
+#include <tau/tau.h>
+TAU_MAIN()
+
+CSTL_VIRTUAL_VECTOR(TestVirtualVector, test_virtual, UInt64)
+
+TEST(vmem, virtual_arrays) {
+    // A virtual array commits as it grows, without moving
+    cstlVirtualArray array;
+    REQUIRE_TRUE(varray_reserve(&array, MB_TO_BYTES(64), false));
+    CHECK_TRUE(varray_commit(&array, 100));
+    char* base = (char*)array.base;
+    memset(base, 'x', 100);
+    CHECK_TRUE(varray_commit(&array, MB_TO_BYTES(10)));
+    CHECK(array.base == base);
+    CHECK_EQ(base[99], 'x');
+    base[MB_TO_BYTES(10) - 1] = 'y';
+    CHECK_FALSE(varray_commit(&array, MB_TO_BYTES(64) + 1));
+    varray_free(&array);
+
+    TestVirtualVector vec;
+    REQUIRE_TRUE(test_virtual_init(&vec, 1 << 24, false));
+    test_virtual_push(&vec, 1);
+    UInt64* first = test_virtual_begin(&vec);
+    for(UInt64 i = 2; i <= 1000000; i++)
+        test_virtual_push(&vec, i);
+    CHECK(test_virtual_begin(&vec) == first);
+    UInt64 sum = 0;
+    for(UInt64* it = test_virtual_begin(&vec); it != test_virtual_end(&vec); it++)
+        sum += *it;
+    CHECK_EQ(sum, (UInt64)1000000 * 1000001 / 2);
+    CHECK_EQ(test_virtual_pop(&vec), 1000000);
+    test_virtual_free(&vec);
+}
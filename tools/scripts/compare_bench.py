@@ -0,0 +1,73 @@
+# Compares the JSON output of a benchmark (bench/bench_*.c, run with `--json`) against a stored baseline
+#
+#   python3 tools/scripts/compare_bench.py <baseline.json> <current.json> [threshold%]
+#
+# Throughput (MB/s and tokens/s) may not drop, and allocations/token and peak RSS may not grow, by more than
+# `threshold` percent (5 by default) for any corpus. Exits with 1 on a regression, and with 2 if the two runs can't
+# be compared (different benchmark, seed or corpus sizes - regenerate the baseline).
+# Timings are only comparable on the same machine: keep one baseline per machine, and record it with
+# `make bench-baseline`.
+
+import json
+import sys
+
+DEFAULT_THRESHOLD = 5.0
+
+# (key, label, whether a higher value is better)
+METRICS = (
+    ('mb_per_s',         'MB/s',       True),
+    ('tokens_per_s',     'tokens/s',   True),
+    ('allocs_per_token', 'allocs/tok', False),
+    ('peak_rss_bytes',   'peak RSS',   False),
+)
+
+def load(path):
+    with open(path) as fobj:
+        return json.load(fobj)
+
+def change(old, new):
+    """ Returns the change from `old` to `new`, in percent """
+    if old == 0:
+        return 0.0 if new == 0 else float('inf')
+    return (new - old) * 100.0 / old
+
+def compare(baseline, current, threshold):
+    for key in ('benchmark', 'seed'):
+        if baseline.get(key) != current.get(key):
+            print("Cannot compare: `%s` differs (%s vs %s)" % (key, baseline.get(key), current.get(key)))
+            return 2
+
+    old_results = dict((r['corpus'], r) for r in baseline['results'])
+    regressions = 0
+    print("%-12s %-11s %14s %14s %9s" % ('corpus', 'metric', 'baseline', 'current', 'change'))
+    for new in current['results']:
+        old = old_results.get(new['corpus'])
+        if old is None:
+            print("%-12s (not in the baseline)" % new['corpus'])
+            continue
+        if old['bytes'] != new['bytes']:
+            print("Cannot compare: corpus `%s` differs in size (%d vs %d bytes)" % (new['corpus'], old['bytes'],
+                                                                                    new['bytes']))
+            return 2
+
+        for key, label, higher_is_better in METRICS:
+            delta = change(old[key], new[key])
+            regressed = -delta > threshold if higher_is_better else delta > threshold
+            regressions += regressed
+            print("%-12s %-11s %14.6g %14.6g %+8.1f%%%s" % (new['corpus'], label, old[key], new[key], delta,
+                                                           '  <-- REGRESSION' if regressed else ''))
+
+    if regressions:
+        print("%d regression(s) beyond %.1f%%" % (regressions, threshold))
+        return 1
+    print("No regressions beyond %.1f%%" % threshold)
+    return 0
+
+def main(baseline_path, current_path, threshold=DEFAULT_THRESHOLD):
+    return compare(load(baseline_path), load(current_path), float(threshold))
+
+if __name__ == '__main__':
+    if len(sys.argv) not in (3, 4):
+        print("Usage: compare_bench.py <baseline.json> <current.json> [threshold%]")
+        sys.exit(2)
+    sys.exit(main(*sys.argv[1:]))
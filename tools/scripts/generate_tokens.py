@@ -2,6 +2,9 @@
 # The files are (relative to the root) are:
 #   1. hazel/compiler/tokens/token.h
 #   2. hazel/compiler/tokens/token.c
+#   3. hazel/compiler/keywords.h (`python3 tools/scripts/generate_tokens.py keywords`)
+
+import os
 
 NT_OFFSET = 256 
 
@@ -245,8 +248,173 @@ def make_token_py(infile, outfile='hazel/compiler/tokens/tokens.py'):
         print("%s regenerated from %s" % (outfile, infile))
 
 
+keywords_h_template = """\
+// Auto-generated by tools/scripts/generate_tokens.py from %(source)s
+// DO NOT EDIT. Any changes to the keywords must be made to the `ALLTOKENS` macro (and to syntax.toml) instead.
+//
+// A collision-free (perfect) hash of every Hazel keyword. An identifier is classified by hashing its length, first
+// and last two characters, followed by a single `memcmp()` against the only keyword it could possibly be.
+#ifndef HAZEL_KEYWORDS_H
+#define HAZEL_KEYWORDS_H
+
+#include <string.h>
+#include <hazel/compiler/tokens.h>
+
+#define KEYWORD_MIN_LENGTH     %(min_length)d
+#define KEYWORD_MAX_LENGTH     %(max_length)d
+#define KEYWORD_TABLE_SIZE     %(table_size)d
+
+// `value` must have at least KEYWORD_MIN_LENGTH (>= 2) characters
+#define KEYWORD_HASH(value, length)                          \\
+    ((((UInt32)(UInt8)(value)[0] * %(m1)du) +                   \\
+      ((UInt32)(UInt8)(value)[(length) - 2] * %(m2)du) +        \\
+      ((UInt32)(UInt8)(value)[(length) - 1] * %(m3)du) +        \\
+      (UInt32)(length)) & (KEYWORD_TABLE_SIZE - 1))
+
+typedef struct {
+    const char* value;
+    UInt8 length;
+    UInt8 kind;
+} KeywordEntry;
+
+static const KeywordEntry keywordTable[KEYWORD_TABLE_SIZE] = {
+%(entries)s};
+
+// Returns the TokenKind of the keyword `value` (of `length` bytes), or IDENTIFIER if it isn't one
+static inline TokenKind keyword_lookup(const char* value, UInt32 length) {
+    if(length < KEYWORD_MIN_LENGTH || length > KEYWORD_MAX_LENGTH)
+        return IDENTIFIER;
+
+    const KeywordEntry* entry = &keywordTable[KEYWORD_HASH(value, length)];
+    if(entry->length == length && memcmp(entry->value, value, length) == 0)
+        return (TokenKind)entry->kind;
+
+    return IDENTIFIER;
+}
+
+#endif // HAZEL_KEYWORDS_H
+"""
+
+def load_keywords(path):
+    """ Returns a list of (TokenKind, keyword) pairs from the `ALLTOKENS` X-macro in `path` """
+    import re
+    keywords = []
+    inside = False
+    with open(path) as fp:
+        for line in fp:
+            # Skip commented-out tokens like `/* TOKENKIND(DEF, "def"), */`
+            line = re.sub(r'/\*.*?\*/', '', line)
+            m = re.search(r'TOKENKIND\(\s*(\w+)\s*(?:=\s*\w+\s*)?,\s*"((?:[^"\\]|\\.)*)"\s*\)', line)
+            if not m:
+                continue
+            kind, string = m.groups()
+            if kind == 'TOK___KEYWORDS_BEGIN':
+                inside = True
+            elif kind == 'TOK___KEYWORDS_END':
+                break
+            elif inside and string:
+                keywords.append((kind, string))
+    return keywords
+
+
+def load_syntax_keywords(path):
+    """ Returns the `keywords` list in syntax.toml """
+    try:
+        import tomllib
+        with open(path, 'rb') as fp:
+            return tomllib.load(fp)['keywords']
+    except ImportError:
+        import re
+        with open(path) as fp:
+            s = fp.read()
+        m = re.search(r'^keywords\s*=\s*\[(.*?)\]', s, re.S | re.M)
+        return re.findall(r'"([^"]*)"', m.group(1))
+
+
+def keyword_hash(kw, m1, m2, m3, table_size):
+    """ Must match KEYWORD_HASH in keywords_h_template """
+    return (ord(kw[0]) * m1 + ord(kw[-2]) * m2 + ord(kw[-1]) * m3 + len(kw)) & (table_size - 1)
+
+
+def find_perfect_hash(keywords):
+    """ Search for multipliers (m1, m2, m3) and a table size such that no two keywords hash to the same slot """
+    if min(len(kw) for _, kw in keywords) < 2:
+        raise SystemExit("Keywords must have at least 2 characters")
+
+    # No choice of multipliers can separate keywords that agree on everything the hash looks at
+    seen = {}
+    for _, kw in keywords:
+        key = (kw[0], kw[-2], kw[-1], len(kw))
+        if key in seen:
+            raise SystemExit("`%s` and `%s` cannot be told apart by KEYWORD_HASH" % (seen[key], kw))
+        seen[key] = kw
+
+    table_size = 1
+    while table_size < 2 * len(keywords):
+        table_size *= 2
+
+    while True:
+        for m1 in range(1, 32):
+            for m2 in range(1, 32):
+                for m3 in range(1, 32):
+                    slots = set()
+                    for _, kw in keywords:
+                        h = keyword_hash(kw, m1, m2, m3, table_size)
+                        if h in slots:
+                            break
+                        slots.add(h)
+                    else:
+                        return table_size, m1, m2, m3
+        table_size *= 2
+
+
+def make_keywords(infile=None, outfile=None, syntaxfile=None):
+    root = os.path.dirname(os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+    infile = infile or os.path.join(root, 'hazel', 'compiler', 'tokens.h')
+    outfile = outfile or os.path.join(root, 'hazel', 'compiler', 'keywords.h')
+    syntaxfile = syntaxfile or os.path.join(root, 'hazel', 'compiler', 'syntax', 'syntax.toml')
+
+    keywords = load_keywords(infile)
+    if not keywords:
+        raise SystemExit("No keywords found in %s" % infile)
+
+    # ALLTOKENS is the source of truth, but syntax.toml must agree with it
+    syntax = set(load_syntax_keywords(syntaxfile))
+    strings = set(kw for _, kw in keywords)
+    if syntax != strings:
+        raise SystemExit("Keywords in %s and %s differ: %s" % (infile, syntaxfile, sorted(syntax ^ strings)))
+
+    table_size, m1, m2, m3 = find_perfect_hash(keywords)
+    table = [None] * table_size
+    for kind, kw in keywords:
+        table[keyword_hash(kw, m1, m2, m3, table_size)] = (kind, kw)
+
+    entries = []
+    for slot in table:
+        if slot is None:
+            entries.append('    { "", 0, IDENTIFIER },\n')
+        else:
+            kind, kw = slot
+            entries.append('    { "%s", %d, %s },\n' % (kw, len(kw), kind))
+
+    content = keywords_h_template % {
+        'source': 'hazel/compiler/tokens.h',
+        'min_length': min(len(kw) for _, kw in keywords),
+        'max_length': max(len(kw) for _, kw in keywords),
+        'table_size': table_size,
+        'm1': m1,
+        'm2': m2,
+        'm3': m3,
+        'entries': ''.join(entries),
+    }
+    if update_file(outfile, content):
+        print("%s regenerated from %s" % (outfile, infile))
+
+
 def mainfunc(op, infile='hazel/compiler/tokens', *args):
     make = globals()['make_' + op]
+    if op == 'keywords' and infile == 'hazel/compiler/tokens':
+        infile = None
     make(infile, *args)
 
 #pylint:disable=no-value-for-parameter
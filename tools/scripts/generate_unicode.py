@@ -0,0 +1,141 @@
+# Generates the Unicode identifier tables in hazel/core/unicode.h (`python3 tools/scripts/generate_unicode.py`)
+#
+# XID_Start and XID_Continue are taken from Python's own identifier rules (`str.isidentifier()` is defined in terms
+# of them), so the tables follow the Unicode version of the Python running this script. Regenerate them when
+# moving to a newer Unicode version.
+
+import os
+import sys
+import unicodedata
+
+# No. of code points covered by a single leaf of the tables (log2)
+LEAF_BITS = 7
+LEAF_SIZE = 1 << LEAF_BITS
+# Variation selectors (U+E0100 - U+E01EF) are the only XID_Continue code points this far out. They're checked
+# directly, instead of stretching the index all the way to them.
+PLANE_14_SELECTORS = (0xE0100, 0xE01EF)
+
+unicode_h_template = """\
+// Auto-generated by tools/scripts/generate_unicode.py (Unicode %(version)s)
+// DO NOT EDIT. Regenerate it instead.
+//
+// XID_Start and XID_Continue (see Unicode Standard Annex #31), as a two-level bitmap: code points are grouped into
+// leaves of UNICODE_XID_LEAF_SIZE, `unicodeXidIndex` maps every group to one of the (deduplicated) leaves, and each
+// leaf holds a bit per code point for either property. A lookup is two dependent loads, and the whole thing is
+// %(total_size)d bytes.
+#ifndef CSTL_UNICODE_H
+#define CSTL_UNICODE_H
+
+#include <hazel/core/types.h>
+
+#define UNICODE_VERSION             "%(version)s"
+#define UNICODE_XID_LEAF_BITS       %(leaf_bits)d
+#define UNICODE_XID_LEAF_SIZE       (1 << UNICODE_XID_LEAF_BITS)
+// Code points at or above this are neither XID_Start nor XID_Continue (save for the variation selectors)
+#define UNICODE_XID_LIMIT           0x%(limit)X
+
+// Leaf that each group of UNICODE_XID_LEAF_SIZE code points (below UNICODE_XID_LIMIT) uses
+static const UInt8 unicodeXidIndex[%(index_size)d] = {
+%(index)s};
+
+// XID_Start bits, followed by XID_Continue bits
+static const UInt64 unicodeXidLeaves[%(nleaves)d][%(leaf_words)d] = {
+%(leaves)s};
+
+// Can `rune` begin an identifier?
+static inline bool unicode_is_xid_start(Rune rune) {
+    if((UInt32)rune >= UNICODE_XID_LIMIT)
+        return false;
+    const UInt64* leaf = unicodeXidLeaves[unicodeXidIndex[rune >> UNICODE_XID_LEAF_BITS]];
+    UInt32 bit = (UInt32)rune & (UNICODE_XID_LEAF_SIZE - 1);
+    return (leaf[bit >> 6] >> (bit & 63)) & 1;
+}
+
+// Can `rune` appear in an identifier, past its first character?
+static inline bool unicode_is_xid_continue(Rune rune) {
+    if((UInt32)rune >= UNICODE_XID_LIMIT)
+        return rune >= 0x%(selectors_begin)X && rune <= 0x%(selectors_end)X;
+    const UInt64* leaf = unicodeXidLeaves[unicodeXidIndex[rune >> UNICODE_XID_LEAF_BITS]];
+    UInt32 bit = (UInt32)rune & (UNICODE_XID_LEAF_SIZE - 1);
+    return (leaf[UNICODE_XID_LEAF_SIZE/64 + (bit >> 6)] >> (bit & 63)) & 1;
+}
+
+#endif // CSTL_UNICODE_H
+"""
+
+def is_surrogate(cp):
+    return 0xD800 <= cp <= 0xDFFF
+
+def load_xid():
+    """ Returns the sets of XID_Start and XID_Continue code points """
+    start = set()
+    cont = set()
+    for cp in range(0x110000):
+        if is_surrogate(cp):
+            continue
+        c = chr(cp)
+        # `_` is an identifier (start) for Python, but not XID_Start
+        if c.isidentifier() and c != '_':
+            start.add(cp)
+        if ('a' + c).isidentifier():
+            cont.add(cp)
+    return start, cont
+
+def leaf_words(codepoints, base):
+    words = []
+    for w in range(LEAF_SIZE // 64):
+        word = 0
+        for bit in range(64):
+            if base + w * 64 + bit in codepoints:
+                word |= 1 << bit
+        words.append(word)
+    return words
+
+def make_unicode(outfile=None):
+    root = os.path.dirname(os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+    outfile = outfile or os.path.join(root, 'hazel', 'core', 'unicode.h')
+
+    start, cont = load_xid()
+    lo, hi = PLANE_14_SELECTORS
+    outliers = set(cp for cp in cont if cp >= 0x40000)
+    if outliers != set(range(lo, hi + 1)) or any(cp >= 0x40000 for cp in start):
+        raise SystemExit("Unexpected XID code points beyond U+3FFFF - update PLANE_14_SELECTORS")
+
+    limit = max(cp for cp in cont if cp < 0x40000) + 1
+    limit = (limit + LEAF_SIZE - 1) // LEAF_SIZE * LEAF_SIZE
+    leaves = {}
+    index = []
+    for group in range(limit // LEAF_SIZE):
+        base = group * LEAF_SIZE
+        leaf = tuple(leaf_words(start, base) + leaf_words(cont, base))
+        index.append(leaves.setdefault(leaf, len(leaves)))
+    if len(leaves) > 256:
+        raise SystemExit("Too many distinct leaves (%d) for a UInt8 index - raise LEAF_BITS" % len(leaves))
+
+    index_lines = []
+    for i in range(0, len(index), 16):
+        index_lines.append('    ' + ' '.join('%d,' % x for x in index[i:i + 16]) + '\n')
+    leaf_lines = []
+    for leaf in sorted(leaves, key=leaves.get):
+        leaf_lines.append('    { ' + ', '.join('0x%016XULL' % w for w in leaf) + ' },\n')
+
+    nwords = 2 * LEAF_SIZE // 64
+    content = unicode_h_template % {
+        'version': unicodedata.unidata_version,
+        'leaf_bits': LEAF_BITS,
+        'limit': limit,
+        'index_size': len(index),
+        'index': ''.join(index_lines),
+        'nleaves': len(leaves),
+        'leaf_words': nwords,
+        'leaves': ''.join(leaf_lines),
+        'total_size': len(index) + len(leaves) * nwords * 8,
+        'selectors_begin': lo,
+        'selectors_end': hi,
+    }
+    with open(outfile, 'w') as fobj:
+        fobj.write(content)
+    print("%s regenerated (Unicode %s)" % (outfile, unicodedata.unidata_version))
+
+if __name__ == '__main__':
+    make_unicode(*sys.argv[1:])